@@ -0,0 +1,492 @@
+// benchmark/client/chunk_pipeline.hpp
+// Protocol side of the client, shared by the callback TCPClient and the
+// coroutine client: reading chunks (or, in download mode, asking for them),
+// packing them into frames within the in-flight window and verifying the
+// responses. It does no I/O itself; the
+// client drives it from its write and read completions.
+#ifndef CHUNK_PIPELINE_HPP
+#define CHUNK_PIPELINE_HPP
+
+#include "../common/include/adaptive_window.hpp"
+#include "../common/include/chunk_reader.hpp"
+#include "../common/include/compression.hpp"
+#include "../common/include/config.hpp"
+#include "../common/include/event_trace.hpp"
+#include "../common/include/latency_trace.hpp"
+#include "../common/include/metrics_aggregator.hpp"
+#include "../common/include/progress.hpp"
+#include "../common/include/tcp_messaging.hpp"
+#include "../common/include/workload.hpp"
+
+#include <algorithm> // For std::equal
+#include <array>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// How many chunks the client keeps in flight and how it packs them into
+// frames. batch == 1 sends classic one-chunk frames; batch > 1 sends batch
+// frames of up to that many chunks; batch == 0 ("auto") sizes each batch to
+// the free part of the window, capped at about BATCH_TARGET_BYTES.
+// window == 0 picks a default: 1 without batching, two batches with it.
+// With a trace collector (--trace) every frame carries the trace extension
+// and each verified chunk adds its frame's stamps to the collector.
+// With an adaptive controller (--adaptive-window) the window follows it and
+// window is ignored; every verified chunk feeds the controller its RTT.
+// inflight_bytes caps the payload bytes in flight on top of the window
+// (0 = no cap); one chunk may always go out when nothing is in flight.
+struct PipelineOptions {
+  std::size_t window = 0;
+  std::size_t batch = 1;
+  std::size_t inflight_bytes = 0;
+  latency_trace::Collector *trace = nullptr;
+  adaptive_window::Controller *adaptive = nullptr;
+};
+
+class ChunkPipeline {
+public:
+  enum class WriteStep {
+    SEND,    // write_buffers() holds the next frame
+    WAIT,    // Nothing can go out until responses free the window
+    FINISHED // The file is exhausted and nothing is in flight
+  };
+  enum class ResponseStep { CONTINUE, FINISHED, FAILED };
+
+  ChunkPipeline(MetricsAggregator &metrics, const std::string &filename,
+                compression::Codec codec, const PipelineOptions &pipeline,
+                workload::Mode mode, std::size_t chunk_size,
+                std::size_t byte_limit = 0) // 0 = the whole file
+      : m_metrics(metrics), m_chunk_size(chunk_size),
+        m_chunk_reader(filename, chunk_size), m_codec(codec),
+        m_pipeline(pipeline), m_mode(mode) {
+    m_total_chunks_to_send = m_chunk_reader.total_chunks();
+    if (m_chunk_reader.file_size() > 0 && m_total_chunks_to_send == 0 &&
+        m_chunk_reader.chunks_read() == 0) { // File < chunk_size
+      m_total_chunks_to_send = 1;
+    } else if (m_chunk_reader.file_size() == 0) {
+      m_total_chunks_to_send = 0;
+    }
+    m_total_bytes = m_chunk_reader.file_size();
+    if (byte_limit != 0) {
+      m_total_chunks_to_send =
+          std::min(m_total_chunks_to_send,
+                   (byte_limit + m_chunk_size - 1) / m_chunk_size);
+      m_total_bytes = std::min(m_total_bytes, byte_limit);
+    }
+    if (m_pipeline.adaptive != nullptr) {
+      m_pipeline.window = m_pipeline.adaptive->max_window();
+    } else if (m_pipeline.window == 0) {
+      m_pipeline.window = m_pipeline.batch == 1 ? 1 : 2 * batch_limit();
+    }
+    m_ring.resize(m_pipeline.window);
+    std::cout << "TCPClient: Total chunks to send: " << m_total_chunks_to_send
+              << " (from file size: " << m_chunk_reader.file_size() << ")"
+              << std::endl;
+  }
+
+  std::size_t total_chunks() const { return m_total_chunks_to_send; }
+  std::size_t chunks_verified() const { return m_chunks_sent; }
+  bool all_verified() const { return m_chunks_sent >= m_total_chunks_to_send; }
+  // Largest window of the run; the adaptive one moves below it.
+  std::size_t window() const { return m_pipeline.window; }
+  std::size_t wire_bytes_sent() const { return m_wire_bytes_sent; }
+  std::size_t payload_bytes_sent() const { return m_payload_bytes_sent; }
+
+  // How the window and the byte cap held the run back, in the format the
+  // gRPC and Cap'n Proto clients use for their in-flight budget: chunks that
+  // had to wait for responses to free room, for how long, and the peak.
+  std::string budget_report() const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << "budget ";
+    if (m_pipeline.inflight_bytes == 0) {
+      out << "unlimited";
+    } else {
+      out << m_pipeline.inflight_bytes / (1024.0 * 1024.0) << " MB";
+    }
+    out << " / " << m_pipeline.window << " requests, blocked "
+        << std::chrono::duration<double, std::milli>(m_blocked_time).count()
+        << " ms in " << m_blocked_chunks << " of " << m_chunks_dispatched
+        << " requests ("
+        << (m_chunks_dispatched != 0
+                ? 100.0 * m_blocked_chunks / m_chunks_dispatched
+                : 0.0)
+        << "%), peak " << m_peak_bytes_in_flight / (1024.0 * 1024.0) << " MB / "
+        << m_peak_in_flight << " requests";
+    return out.str();
+  }
+
+  // Reads as many chunks as the window allows and frames them for one write.
+  // In auto mode a nearly full window is left alone until responses free up
+  // at least half a batch, so the batches do not degrade into single chunks.
+  WriteStep prepare_write() {
+    TCP_BENCH_TRACE_SCOPE("prepare_write", "client");
+    std::size_t window = current_window();
+    std::size_t free_slots = window > m_in_flight ? window - m_in_flight : 0;
+    std::size_t remaining = m_total_chunks_to_send - m_chunks_dispatched;
+    std::size_t count =
+        std::min({batch_limit(), free_slots, free_byte_slots(), remaining});
+    if (remaining == 0 || m_chunk_reader.eof())
+      return WriteStep::WAIT;
+    if (count == 0 ||
+        (m_pipeline.batch == 0 && m_in_flight != 0 &&
+         count < std::min({batch_limit(), window, byte_cap_slots(),
+                           remaining}) /
+                     2)) {
+      // Chunks are ready to go but the window or the byte cap is full
+      if (!m_blocked)
+        m_blocked_since = std::chrono::steady_clock::now();
+      m_blocked = true;
+      return WriteStep::WAIT;
+    }
+
+    std::size_t first_new = m_in_flight;
+    for (std::size_t i = 0; i < count; ++i) {
+      PendingChunk &chunk = in_flight(m_in_flight);
+      if (m_mode == workload::Mode::DOWNLOAD) {
+        prepare_download_request(chunk);
+        m_in_flight++;
+        progress::on_sent();
+        continue;
+      }
+      if (!m_chunk_reader.read_next_chunk(chunk.data)) {
+        break;
+      }
+      chunk.sent_at = std::chrono::steady_clock::now(); // Compression counts
+      chunk.size = chunk.data.size();
+      chunk.flags = 0;
+      if (m_mode == workload::Mode::UPLOAD) {
+        chunk.checksum = workload::checksum(chunk.data.data(), chunk.size);
+        chunk.flags = tcp_messaging::ACK_FLAG;
+      }
+      if (m_codec != compression::Codec::NONE &&
+          tcp_messaging::encode_compressed_body(m_codec, chunk.data,
+                                                chunk.encoded)) {
+        chunk.flags |= tcp_messaging::COMPRESSED_FLAG;
+      }
+      m_in_flight++;
+      progress::on_sent();
+    }
+
+    std::size_t added = m_in_flight - first_new;
+    if (added == 0) {
+      if (m_in_flight != 0)
+        return WriteStep::WAIT;
+      std::cout << "TCP Client: Reached true EOF after reading last chunk. "
+                   "Processed "
+                << m_chunks_sent << " chunks." << std::endl;
+      return WriteStep::FINISHED;
+    }
+    m_chunks_dispatched += added;
+    if (m_blocked) {
+      m_blocked_time += std::chrono::steady_clock::now() - m_blocked_since;
+      m_blocked_chunks += added;
+      m_blocked = false;
+    }
+
+    for (std::size_t i = first_new; i < m_in_flight; ++i) {
+      m_payload_bytes_sent += in_flight(i).data.size();
+      m_bytes_in_flight += in_flight(i).size;
+    }
+    m_peak_in_flight = std::max(m_peak_in_flight, m_in_flight);
+    m_peak_bytes_in_flight = std::max(m_peak_bytes_in_flight, m_bytes_in_flight);
+
+    if (m_pipeline.batch == 1) {
+      const PendingChunk &chunk = in_flight(first_new);
+      const std::vector<char> &body = chunk.body();
+      m_wire_bytes_sent += tcp_messaging::HEADER_SIZE + body.size();
+      auto frame_buffers = tcp_messaging::prepare_message(
+          body, m_write_header_buffer, chunk.flags);
+      m_write_buffers.assign(frame_buffers.begin(), frame_buffers.end());
+    } else {
+      m_batch_writer.clear();
+      for (std::size_t i = first_new; i < m_in_flight; ++i) {
+        const PendingChunk &chunk = in_flight(i);
+        const std::vector<char> &body = chunk.body();
+        m_batch_writer.add(body.data(), body.size(), chunk.flags);
+      }
+      m_wire_bytes_sent += m_batch_writer.wire_size();
+      const auto &batch_buffers = m_batch_writer.buffers();
+      m_write_buffers.assign(batch_buffers.begin(), batch_buffers.end());
+    }
+
+    if (m_pipeline.trace != nullptr) {
+      // Stamped last, so reading and compressing chunks stay out of the
+      // request network stage.
+      latency_trace::Stamps stamps;
+      stamps.client_send_ns = latency_trace::now_ns();
+      tcp_messaging::add_trace(m_write_buffers, m_write_trace_prefix, stamps);
+      m_wire_bytes_sent += tcp_messaging::TRACE_EXTENSION_SIZE;
+    }
+    m_write_started_at = std::chrono::steady_clock::now();
+    return WriteStep::SEND;
+  }
+
+  // The frame built by the last prepare_write(); valid until the next one.
+  tcp_messaging::BufferSpan write_buffers() const {
+    return tcp_messaging::BufferSpan(m_write_buffers);
+  }
+
+  // Progress is reported by the progress sampler, not per write.
+  void on_write_complete(std::size_t /*bytes_transferred*/) const {
+    event_trace::interval("socket_write", "client", m_write_started_at,
+                          std::chrono::steady_clock::now());
+  }
+
+  // Responses come back in request order, so each entry is matched against
+  // the oldest chunk still in flight. The caller consumes the frame.
+  ResponseStep handle_response(const tcp_messaging::Frame &response) {
+    TCP_BENCH_TRACE_SCOPE("handle_response", "client");
+    tcp_messaging::Frame frame = response;
+    latency_trace::Stamps stamps;
+    const bool traced = tcp_messaging::is_traced(frame.header_value);
+    if (traced && !tcp_messaging::strip_trace(frame, stamps)) {
+      std::cerr << "TCP Client: Traced response of length " << frame.length
+                << " is too short. Closing." << std::endl;
+      return ResponseStep::FAILED;
+    }
+    if (tcp_messaging::is_batch(frame.header_value)) {
+      if (!tcp_messaging::parse_batch(frame, m_entries,
+                                      config::MAX_FRAME_PAYLOAD_SIZE)) {
+        std::cerr << "TCP Client: Malformed batch response of length "
+                  << frame.length << ". Closing." << std::endl;
+        return ResponseStep::FAILED;
+      }
+    } else {
+      m_entries.clear();
+      m_entries.push_back(frame);
+    }
+    if (m_entries.size() > m_in_flight) {
+      std::cerr << "TCP Client: Server answered " << m_entries.size()
+                << " chunks, but only " << m_in_flight
+                << " are in flight. Closing." << std::endl;
+      return ResponseStep::FAILED;
+    }
+
+    auto received_at = std::chrono::steady_clock::now();
+    for (const auto &entry : m_entries) {
+      PendingChunk &chunk = in_flight(0);
+      std::size_t received_size = 0;
+      bool verified = verify_response(entry, chunk, received_size);
+      auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(
+          received_at - chunk.sent_at);
+      m_metrics.record_chunk_rtt(chunk.size, rtt, verified);
+      progress::on_completed(chunk.size, rtt.count());
+      if (m_pipeline.adaptive != nullptr)
+        m_pipeline.adaptive->on_completion(chunk.size, rtt.count());
+      if (traced && verified && m_pipeline.trace != nullptr) {
+        m_pipeline.trace->record(stamps, latency_trace::to_ns(received_at));
+      }
+
+      if (!verified) {
+        std::cerr << "TCP Client: ERROR! Chunk " << (m_chunks_sent + 1)
+                  << " (original size: " << chunk.size
+                  << ", received size: " << received_size
+                  << ") verification FAILED." << std::endl;
+        return ResponseStep::FAILED;
+      }
+
+      m_chunks_sent++;
+      m_bytes_in_flight -= chunk.size;
+      m_ring_head = (m_ring_head + 1) % m_ring.size();
+      m_in_flight--;
+    }
+
+    if (all_verified() || (m_chunk_reader.eof() && m_in_flight == 0)) {
+      std::cout << "TCP Client: Successfully processed all " << m_chunks_sent
+                << " chunks." << std::endl;
+      return ResponseStep::FINISHED;
+    }
+    return ResponseStep::CONTINUE;
+  }
+
+private:
+  // A chunk between being read from the file and having its response
+  // verified. Slots are reused in place, so their buffers are too.
+  struct PendingChunk {
+    std::vector<char> data; // Empty in download mode
+    // Compressed body (COMPRESSED_FLAG) or download request (DOWNLOAD_FLAG)
+    std::vector<char> encoded;
+    uint32_t flags = 0;
+    std::size_t size = 0;  // Payload bytes sent or, in download mode, asked for
+    uint32_t checksum = 0; // CRC32 of data, checked against the upload ack
+    std::chrono::steady_clock::time_point sent_at;
+
+    const std::vector<char> &body() const {
+      return (flags & (tcp_messaging::COMPRESSED_FLAG |
+                       tcp_messaging::DOWNLOAD_FLAG)) != 0
+                 ? encoded
+                 : data;
+    }
+  };
+
+  std::size_t current_window() const {
+    return m_pipeline.adaptive != nullptr ? m_pipeline.adaptive->window()
+                                          : m_pipeline.window;
+  }
+
+  // Chunks of m_chunk_size that fit under the byte cap when nothing is in
+  // flight, and next to what is in flight now. The estimate is exact for all
+  // but the last chunk, which is only smaller.
+  std::size_t byte_cap_slots() const {
+    if (m_pipeline.inflight_bytes == 0)
+      return std::numeric_limits<std::size_t>::max();
+    return std::max<std::size_t>(1, m_pipeline.inflight_bytes / m_chunk_size);
+  }
+  std::size_t free_byte_slots() const {
+    if (m_pipeline.inflight_bytes == 0)
+      return std::numeric_limits<std::size_t>::max();
+    if (m_in_flight == 0)
+      return byte_cap_slots();
+    return m_pipeline.inflight_bytes > m_bytes_in_flight
+               ? (m_pipeline.inflight_bytes - m_bytes_in_flight) / m_chunk_size
+               : 0;
+  }
+
+  // i-th oldest chunk in flight; i == m_in_flight is the next free slot.
+  PendingChunk &in_flight(std::size_t i) {
+    return m_ring[(m_ring_head + i) % m_ring.size()];
+  }
+
+  // Asks for the next chunk_size bytes (less for the last chunk).
+  void prepare_download_request(PendingChunk &chunk) {
+    chunk.size = std::min(m_chunk_size, m_total_bytes - m_bytes_requested);
+    m_bytes_requested += chunk.size;
+    chunk.data.clear();
+    chunk.encoded.resize(tcp_messaging::DOWNLOAD_REQUEST_SIZE);
+    tcp_messaging::write_u32(chunk.encoded.data(),
+                             static_cast<uint32_t>(chunk.size));
+    chunk.flags = tcp_messaging::DOWNLOAD_FLAG;
+    chunk.sent_at = std::chrono::steady_clock::now();
+  }
+
+  // Largest number of chunks to put into one frame right now.
+  std::size_t batch_limit() const {
+    if (m_pipeline.batch != 0) {
+      return m_pipeline.batch;
+    }
+    return std::clamp<std::size_t>(
+        config::BATCH_TARGET_BYTES / m_chunk_size, 1,
+        tcp_messaging::MAX_BATCH_ENTRIES);
+  }
+
+  // Echo responses are checked in place against the chunk read backwards, so
+  // neither a reversed copy nor a separate body buffer is needed. Acks must
+  // match the size and checksum of what was sent; downloaded chunks must have
+  // the requested size and match the checksum the server put in front.
+  bool verify_response(const tcp_messaging::Frame &entry,
+                       const PendingChunk &chunk,
+                       std::size_t &received_size) {
+    const char *body = entry.data;
+    received_size = entry.length;
+    if (tcp_messaging::is_compressed(entry.header_value)) {
+      compression::Codec codec;
+      if (!tcp_messaging::decode_compressed_body(entry.data, entry.length,
+                                                 m_decompressed_body, codec,
+                                                 config::MAX_FRAME_PAYLOAD_SIZE)) {
+        std::cerr << "TCP Client: Failed to decode compressed response."
+                  << std::endl;
+        m_decompressed_body.clear();
+      }
+      body = m_decompressed_body.data();
+      received_size = m_decompressed_body.size();
+    }
+
+    switch (m_mode) {
+    case workload::Mode::UPLOAD: {
+      if (received_size != tcp_messaging::ACK_BODY_SIZE)
+        return false;
+      received_size = tcp_messaging::parse_header(body);
+      return received_size == chunk.size &&
+             tcp_messaging::parse_header(body + sizeof(uint32_t)) ==
+                 chunk.checksum;
+    }
+    case workload::Mode::DOWNLOAD: {
+      if (received_size < tcp_messaging::DOWNLOAD_CHECKSUM_SIZE)
+        return false;
+      const char *payload = body + tcp_messaging::DOWNLOAD_CHECKSUM_SIZE;
+      received_size -= tcp_messaging::DOWNLOAD_CHECKSUM_SIZE;
+      return received_size == chunk.size &&
+             workload::checksum(payload, received_size) ==
+                 tcp_messaging::parse_header(body);
+    }
+    case workload::Mode::ROUND_TRIP:
+      break;
+    }
+    return received_size == chunk.data.size() &&
+           std::equal(body, body + received_size, chunk.data.rbegin());
+  }
+
+  MetricsAggregator &m_metrics;
+  std::size_t m_chunk_size;
+  ChunkReader m_chunk_reader;
+
+  std::array<char, tcp_messaging::HEADER_SIZE> m_write_header_buffer;
+  tcp_messaging::TracePrefix m_write_trace_prefix;
+  tcp_messaging::BatchWriter m_batch_writer;
+  std::vector<boost::asio::const_buffer> m_write_buffers;
+  // When the frame in m_write_buffers was handed to the caller
+  std::chrono::steady_clock::time_point m_write_started_at;
+  std::vector<tcp_messaging::Frame> m_entries;
+
+  compression::Codec m_codec;
+  std::vector<char> m_decompressed_body;
+
+  PipelineOptions m_pipeline;
+  workload::Mode m_mode;
+  std::size_t m_total_bytes = 0;     // Bytes the run covers
+  std::size_t m_bytes_requested = 0; // Download mode: bytes asked for so far
+  // One slot per window entry, used as a ring: no allocation per chunk once
+  // every slot has held a chunk.
+  std::vector<PendingChunk> m_ring;
+  std::size_t m_ring_head = 0;
+  std::size_t m_in_flight = 0;
+  std::size_t m_bytes_in_flight = 0; // Payload bytes (asked for) in flight
+  std::size_t m_peak_in_flight = 0;
+  std::size_t m_peak_bytes_in_flight = 0;
+  // Window or byte cap full while chunks were ready: since when, in total and
+  // how many chunks went out only once responses freed room
+  bool m_blocked = false;
+  std::chrono::steady_clock::time_point m_blocked_since;
+  std::chrono::steady_clock::duration m_blocked_time{};
+  std::size_t m_blocked_chunks = 0;
+  std::size_t m_payload_bytes_sent = 0;
+  std::size_t m_wire_bytes_sent = 0;
+
+  std::size_t m_chunks_sent = 0; // Chunks whose response has been verified
+  std::size_t m_chunks_dispatched = 0;
+  std::size_t m_total_chunks_to_send = 0;
+};
+
+// Logs why the response stream ended. Returns true only for a clean EOF after
+// every chunk was verified, which still counts as a successful run.
+inline bool log_read_error(const boost::system::error_code &ec,
+                           std::size_t buffered_bytes,
+                           const ChunkPipeline &chunks) {
+  if (ec == boost::asio::error::eof && buffered_bytes == 0) {
+    std::cout << "TCP Client: Server closed connection while reading header."
+              << std::endl;
+    if (chunks.all_verified()) {
+      std::cout << "TCP Client: EOF from server, assuming all data processed."
+                << std::endl;
+      return true;
+    }
+    std::cerr << "TCP Client: EOF from server before all data processed. "
+                 "Chunks sent: "
+              << chunks.chunks_verified() << "/" << chunks.total_chunks()
+              << std::endl;
+  } else if (ec == boost::asio::error::eof) {
+    std::cerr << "TCP Client: Server closed connection in the middle of a "
+                 "frame ("
+              << buffered_bytes << " bytes buffered)." << std::endl;
+  } else {
+    std::cerr << "TCP Client: Read error: " << ec.message() << std::endl;
+  }
+  return false;
+}
+
+#endif // CHUNK_PIPELINE_HPP
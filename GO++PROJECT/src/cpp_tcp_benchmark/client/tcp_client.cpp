@@ -1,40 +1,66 @@
 // benchmark/client/tcp_client.cpp
-#include "../common/include/chunk_reader.hpp"
+#include "../common/include/adaptive_window.hpp"
+#include "../common/include/alloc_counter.hpp"
+#include "../common/include/cli_options.hpp"
+#include "../common/include/compression.hpp"
+#include "../common/include/event_trace.hpp"
 #include "../common/include/file_utils.hpp"
+#include "../common/include/handler_allocator.hpp"
+#include "../common/include/latency_trace.hpp"
 #include "../common/include/metrics_aggregator.hpp"
-#include "../common/include/reversal_utils.hpp"
+#include "../common/include/progress.hpp"
+#include "../common/include/socket_tuning.hpp"
+#include "../common/include/sweep.hpp"
 #include "../common/include/tcp_messaging.hpp"
+#include "../common/include/workload.hpp"
 #include "../include/config.hpp"
+#include "chunk_pipeline.hpp"
+#include "tcp_client_inproc.hpp"
 
-#include <array>
+#include <algorithm>
 #include <boost/asio.hpp>
+#include <cstdint>
 #include <filesystem> // Для std::filesystem
 #include <iostream>
 #include <memory>
 #include <string>
 #include <vector>
 
+#ifdef TCP_BENCH_COROUTINES
+#include "tcp_client_coro.hpp"
+#define TCP_BENCH_ASIO_API "coroutine"
+#else
+#define TCP_BENCH_ASIO_API "callback"
+#endif
+
 namespace fs = std::filesystem;
 using boost::asio::ip::tcp;
 
 class TCPClient : public std::enable_shared_from_this<TCPClient> {
 public:
   TCPClient(boost::asio::io_context &io_context, const std::string &host,
-            unsigned short port, MetricsAggregator &metrics)
+            unsigned short port, MetricsAggregator &metrics,
+            const std::string &filename, compression::Codec codec,
+            const PipelineOptions &pipeline, workload::Mode mode,
+            const socket_tuning::Profile &socket_profile, std::size_t chunk_size,
+            std::size_t byte_limit = 0) // 0 = the whole file
       : m_io_context(io_context), m_socket(io_context), m_resolver(io_context),
         m_metrics(metrics), m_host(host), m_port_str(std::to_string(port)),
-        m_chunk_reader(config::TEST_FILE_NAME, config::CHUNK_SIZE) {
-    m_total_chunks_to_send = m_chunk_reader.total_chunks();
-    if (m_chunk_reader.file_size() > 0 && m_total_chunks_to_send == 0 &&
-        m_chunk_reader.chunks_read() == 0) { // File < chunk_size
-      m_total_chunks_to_send = 1;
-    } else if (m_chunk_reader.file_size() == 0) {
-      m_total_chunks_to_send = 0;
-    }
-    std::cout << "TCPClient: Total chunks to send: " << m_total_chunks_to_send
-              << " (from file size: " << m_chunk_reader.file_size() << ")"
-              << std::endl;
+        m_socket_profile(socket_profile),
+        m_chunks(metrics, filename, codec, pipeline, mode, chunk_size,
+                 byte_limit),
+        m_reader(std::max(config::RECEIVE_BUFFER_SIZE, 2 * chunk_size),
+                 tcp_messaging::max_batch_frame_length(
+                     config::MAX_FRAME_PAYLOAD_SIZE)) {}
+
+  std::size_t wire_bytes_sent() const { return m_chunks.wire_bytes_sent(); }
+  std::size_t payload_bytes_sent() const {
+    return m_chunks.payload_bytes_sent();
   }
+  std::size_t chunks_verified() const { return m_chunks.chunks_verified(); }
+  bool succeeded() const { return m_succeeded; }
+  std::size_t window() const { return m_chunks.window(); }
+  std::string budget_report() const { return m_chunks.budget_report(); }
 
   void start() {
     auto self = shared_from_this();
@@ -56,6 +82,7 @@ private:
   void stop_client_operations(bool error_occurred) {
     if (!m_operations_stopped) {
       m_operations_stopped = true;
+      m_succeeded = !error_occurred;
       if (!m_timer_stopped_flag) {
         m_metrics.stop_timer();
         m_timer_stopped_flag = true;
@@ -81,209 +108,139 @@ private:
 
   void do_connect(const tcp::resolver::results_type &endpoints) {
     auto self = shared_from_this();
+    if (!m_socket_profile.is_default()) {
+      // A tuned socket is opened by hand, so only the first endpoint is tried.
+      tcp::endpoint endpoint = *endpoints.begin();
+      boost::system::error_code ec;
+      if (!socket_tuning::open_tuned(m_socket, endpoint, m_socket_profile,
+                                     "TCP Client:", ec)) {
+        on_connect(ec);
+        return;
+      }
+      m_socket.async_connect(
+          endpoint, [this, self](const boost::system::error_code &ec) {
+            on_connect(ec);
+          });
+      return;
+    }
     boost::asio::async_connect(
         m_socket, endpoints,
         [this, self](const boost::system::error_code &ec,
-                     const tcp::endpoint & /*endpoint*/) {
-          if (!ec) {
-            std::cout << "TCP Client: Connected to "
-                      << m_socket.remote_endpoint().address().to_string() << ":"
-                      << m_socket.remote_endpoint().port() << std::endl;
-            m_metrics.start_timer();
-            send_next_chunk();
-          } else {
-            std::cerr << "TCP Client: Connect error: " << ec.message()
-                      << std::endl;
-            stop_client_operations(true);
-          }
-        });
+                     const tcp::endpoint & /*endpoint*/) { on_connect(ec); });
   }
 
-  void send_next_chunk() {
-    if (m_operations_stopped)
+  void on_connect(const boost::system::error_code &ec) {
+    if (ec) {
+      std::cerr << "TCP Client: Connect error: " << ec.message() << std::endl;
+      stop_client_operations(true);
       return;
-
-    if (m_chunks_sent >= m_total_chunks_to_send || m_chunk_reader.eof()) {
-      if (m_chunk_reader.file_size() == 0 && m_chunks_sent == 0) {
-        std::cout << "TCP Client: Test file is empty. Nothing to send."
-                  << std::endl;
-      } else {
-        std::cout << "TCP Client: All " << m_chunks_sent
-                  << " chunks processed or EOF reached (ChunkReader EOF: "
-                  << m_chunk_reader.eof()
-                  << ", Total to send: " << m_total_chunks_to_send
-                  << "). Chunks read by reader: "
-                  << m_chunk_reader.chunks_read() << std::endl;
-      }
+    }
+    std::cout << "TCP Client: Connected to "
+              << m_socket.remote_endpoint().address().to_string() << ":"
+              << m_socket.remote_endpoint().port() << std::endl;
+    m_metrics.start_timer();
+    if (m_chunks.total_chunks() == 0) {
+      std::cout << "TCP Client: Test file is empty. Nothing to send."
+                << std::endl;
       stop_client_operations(false);
       return;
     }
+    do_read();
+    send_next_chunks();
+  }
 
-    m_current_chunk_data = m_chunk_reader.read_next_chunk();
+  // Sends as many chunks as the window allows in one write; called again
+  // whenever a write completes or responses free up the window.
+  void send_next_chunks() {
+    if (m_operations_stopped || m_write_in_progress)
+      return;
 
-    if (m_current_chunk_data.empty() && !m_chunk_reader.eof()) {
-      std::cerr << "TCP Client: Read empty chunk unexpectedly before EOF "
-                   "(chunks_sent: "
-                << m_chunks_sent << "). Aborting." << std::endl;
-      m_metrics.record_chunk_verified(false);
-      stop_client_operations(true);
+    switch (m_chunks.prepare_write()) {
+    case ChunkPipeline::WriteStep::WAIT:
       return;
-    }
-    if (m_current_chunk_data.empty() && m_chunk_reader.eof()) {
-      std::cout
-          << "TCP Client: Reached true EOF after reading last chunk. Processed "
-          << m_chunks_sent << " chunks." << std::endl;
+    case ChunkPipeline::WriteStep::FINISHED:
       stop_client_operations(false);
       return;
+    case ChunkPipeline::WriteStep::SEND:
+      break;
     }
 
-    m_expected_reversed_chunk =
-        utils::get_reversed_vector_content(m_current_chunk_data);
-    m_metrics.start_chunk_rtt_timer();
-
+    m_write_in_progress = true;
     auto self = shared_from_this();
-    auto buffers_to_send = tcp_messaging::prepare_message(
-        m_current_chunk_data, m_write_header_buffer);
-
     boost::asio::async_write(
-        m_socket, buffers_to_send,
-        [this, self](const boost::system::error_code &ec,
-                     std::size_t bytes_transferred) {
-          if (m_operations_stopped)
-            return;
-          if (!ec) {
-            std::cout << "TCP Client: Sent chunk " << (m_chunks_sent + 1) << "/"
-                      << m_total_chunks_to_send << " ("
-                      << bytes_transferred - tcp_messaging::HEADER_SIZE
-                      << " payload bytes)" << std::endl;
-            do_read_header();
-          } else {
-            std::cerr << "TCP Client: Write error: " << ec.message()
-                      << std::endl;
-            stop_client_operations(true);
-          }
-        });
-  }
-
-  void do_read_header() {
-    if (m_operations_stopped)
-      return;
-    auto self = shared_from_this();
-    tcp_messaging::async_read_header(
-        m_socket, m_read_header_buffer,
-        [this, self](const boost::system::error_code &ec, std::size_t) {
-          if (m_operations_stopped)
-            return;
-          if (!ec) {
-            uint32_t body_length =
-                tcp_messaging::parse_header(m_read_header_buffer);
-            if (body_length > config::CHUNK_SIZE * 2) {
-              std::cerr << "TCP Client: Excessive body length in response: "
-                        << body_length
-                        << ". Max expected: " << config::CHUNK_SIZE
-                        << ". Closing." << std::endl;
-              stop_client_operations(true);
-              return;
-            }
-            m_read_body_buffer.resize(body_length); // Prepare buffer for body
-            if (body_length == 0) {
-              std::cout << "TCP Client: Received header for 0-length body."
-                        << std::endl;
-              handle_received_chunk_data();
-            } else {
-              do_read_body();
-            }
-          } else {
-            if (ec == boost::asio::error::eof) {
-              std::cout << "TCP Client: Server closed connection while reading "
-                           "header."
-                        << std::endl;
-              if (m_chunks_sent >= m_total_chunks_to_send) {
-                std::cout << "TCP Client: EOF from server, assuming all data "
-                             "processed."
-                          << std::endl;
-                stop_client_operations(false);
+        m_socket, m_chunks.write_buffers(),
+        handler_alloc::make_custom_alloc_handler(
+            m_write_memory, [this, self](const boost::system::error_code &ec,
+                                         std::size_t bytes_transferred) {
+              m_write_in_progress = false;
+              if (m_operations_stopped)
+                return;
+              if (!ec) {
+                m_chunks.on_write_complete(bytes_transferred);
+                send_next_chunks();
               } else {
-                std::cerr << "TCP Client: EOF from server before all data "
-                             "processed. Chunks sent: "
-                          << m_chunks_sent << "/" << m_total_chunks_to_send
+                std::cerr << "TCP Client: Write error: " << ec.message()
                           << std::endl;
                 stop_client_operations(true);
               }
-            } else {
-              std::cerr << "TCP Client: Read header error: " << ec.message()
-                        << std::endl;
-              stop_client_operations(true);
-            }
-          }
-        });
+            }));
   }
 
-  void do_read_body() {
+  // Keeps exactly one read outstanding for the whole connection; every
+  // complete response frame in the buffer is handled before reading again.
+  void do_read() {
     if (m_operations_stopped)
       return;
-    auto self = shared_from_this();
-    boost::asio::async_read(
-        m_socket,
-        boost::asio::buffer(m_read_body_buffer.data(),
-                            m_read_body_buffer.size()),
-        boost::asio::transfer_exactly(m_read_body_buffer.size()),
-        [this, self](const boost::system::error_code &ec,
-                     std::size_t length_read) {
-          if (m_operations_stopped)
-            return;
-          if (!ec) {
-            if (length_read != m_read_body_buffer.size()) {
-              std::cerr
-                  << "TCP Client: Read body error: Incomplete read. Expected "
-                  << m_read_body_buffer.size() << ", got " << length_read
-                  << std::endl;
-              stop_client_operations(true);
-              return;
-            }
-            handle_received_chunk_data();
-          } else {
-            if (ec == boost::asio::error::eof) {
-              std::cerr << "TCP Client: Server closed connection while reading "
-                           "body. Expected "
-                        << m_read_body_buffer.size() << " bytes." << std::endl;
-            } else {
-              std::cerr << "TCP Client: Read body error: " << ec.message()
-                        << std::endl;
-            }
-            stop_client_operations(true);
-          }
-        });
-  }
 
-  void handle_received_chunk_data() {
-    if (m_operations_stopped)
+    tcp_messaging::Frame frame;
+    switch (m_reader.peek(frame)) {
+    case tcp_messaging::FrameReader::Status::FRAME_READY:
+      handle_response(frame);
       return;
-
-    bool verified = (m_read_body_buffer == m_expected_reversed_chunk);
-    m_metrics.stop_and_record_chunk_rtt(m_current_chunk_data.size(),
-                                        verified); // Stop RTT timer and record
-
-    if (!verified) {
-      std::cerr << "TCP Client: ERROR! Chunk " << (m_chunks_sent + 1)
-                << " (original size: " << m_current_chunk_data.size()
-                << ", received size: " << m_read_body_buffer.size()
-                << ") verification FAILED." << std::endl;
+    case tcp_messaging::FrameReader::Status::FRAME_TOO_LARGE:
+      std::cerr << "TCP Client: Excessive body length in response. Max "
+                   "expected: "
+                << config::MAX_FRAME_PAYLOAD_SIZE << ". Closing." << std::endl;
       stop_client_operations(true);
       return;
+    case tcp_messaging::FrameReader::Status::NEED_MORE:
+      break;
     }
 
-    m_chunks_sent++;
-    std::cout << "TCP Client: Chunk " << m_chunks_sent << " verified OK. ("
-              << m_read_body_buffer.size() << " bytes)" << std::endl;
+    auto self = shared_from_this();
+    m_socket.async_read_some(
+        m_reader.prepare(),
+        handler_alloc::make_custom_alloc_handler(
+            m_read_memory, [this, self](const boost::system::error_code &ec,
+                                        std::size_t bytes_read) {
+              m_reader.commit(bytes_read);
+              if (m_operations_stopped)
+                return;
+              if (!ec) {
+                if (m_socket_profile.quick_ack)
+                  socket_tuning::rearm_quick_ack(m_socket.native_handle());
+                do_read();
+              } else {
+                stop_client_operations(
+                    !log_read_error(ec, m_reader.buffered_bytes(), m_chunks));
+              }
+            }));
+  }
 
-    if (m_chunks_sent >= m_total_chunks_to_send || m_chunk_reader.eof()) {
-      std::cout << "TCP Client: Successfully processed all " << m_chunks_sent
-                << " chunks." << std::endl;
+  void handle_response(const tcp_messaging::Frame &frame) {
+    switch (m_chunks.handle_response(frame)) {
+    case ChunkPipeline::ResponseStep::FAILED:
+      stop_client_operations(true);
+      return;
+    case ChunkPipeline::ResponseStep::FINISHED:
       stop_client_operations(false);
-    } else {
-      send_next_chunk();
+      return;
+    case ChunkPipeline::ResponseStep::CONTINUE:
+      break;
     }
+    m_reader.consume(frame);
+    send_next_chunks();
+    do_read();
   }
 
   boost::asio::io_context &m_io_context;
@@ -293,69 +250,367 @@ private:
 
   std::string m_host;
   std::string m_port_str;
+  socket_tuning::Profile m_socket_profile;
 
-  ChunkReader m_chunk_reader;
-
-  std::vector<char> m_current_chunk_data;
-  std::vector<char> m_expected_reversed_chunk;
+  ChunkPipeline m_chunks;
+  tcp_messaging::FrameReader m_reader;
+  // One read and one write are outstanding at a time, each recycling its own
+  // handler slot.
+  handler_alloc::HandlerMemory m_read_memory;
+  handler_alloc::HandlerMemory m_write_memory;
+  bool m_write_in_progress = false;
 
-  std::array<char, tcp_messaging::HEADER_SIZE> m_write_header_buffer;
-  std::array<char, tcp_messaging::HEADER_SIZE> m_read_header_buffer;
-  std::vector<char> m_read_body_buffer;
-
-  std::size_t m_chunks_sent = 0;
-  std::size_t m_total_chunks_to_send = 0;
   bool m_timer_stopped_flag = false;
   bool m_operations_stopped = false;
+  bool m_succeeded = false;
+};
+
+#ifdef TCP_BENCH_COROUTINES
+using BenchmarkClient = CoroTCPClient;
+#else
+using BenchmarkClient = TCPClient;
+#endif
+
+// What the callers of run_client() need once the client is gone.
+struct ClientRun {
+  bool succeeded = false;
+  std::size_t window = 0;
+  std::size_t wire_bytes_sent = 0;
+  std::size_t payload_bytes_sent = 0;
+  std::string budget_report; // ChunkPipeline::budget_report()
+};
+
+// Where run_client() sends the chunks: the TCP server at server_ip, or the
+// server's frame responder inside this process (--transport=inproc).
+struct ClientTarget {
+  std::string server_ip;
+  bool in_process = false;
+  std::string download_file; // --mode=download in process: what is served
 };
 
+template <typename Client>
+static ClientRun run_to_completion(boost::asio::io_context &io_context,
+                                   const std::shared_ptr<Client> &client) {
+  std::uint64_t allocations_at_start = alloc_counter::allocations();
+  client->start();
+  io_context.run();
+  std::cout << "TCP Client: io_context.run() finished." << std::endl;
+  if (alloc_counter::enabled() && client->chunks_verified() > 0) {
+    std::uint64_t allocations =
+        alloc_counter::allocations() - allocations_at_start;
+    std::cout << "TCP Client: " << allocations << " heap allocations for "
+              << client->chunks_verified() << " chunks ("
+              << static_cast<double>(allocations) / client->chunks_verified()
+              << " per chunk, " << TCP_BENCH_ASIO_API << " build)."
+              << std::endl;
+  }
+  return ClientRun{client->succeeded(), client->window(),
+                   client->wire_bytes_sent(), client->payload_bytes_sent(),
+                   client->budget_report()};
+}
+
+// Runs one client to completion on its own io_context. A non-null
+// adaptive_options gives the run a fresh adaptive window; its history is
+// saved to window_csv unless that is empty.
+static ClientRun
+run_client(const ClientTarget &target, const std::string &test_file,
+           compression::Codec codec, const PipelineOptions &pipeline,
+           workload::Mode mode, const socket_tuning::Profile &socket_profile,
+           std::size_t chunk_size, std::size_t byte_limit,
+           MetricsAggregator &metrics,
+           const adaptive_window::Options *adaptive_options = nullptr,
+           const std::string &window_csv = "") {
+  std::unique_ptr<adaptive_window::Controller> adaptive;
+  PipelineOptions run_pipeline = pipeline;
+  if (adaptive_options != nullptr) {
+    adaptive = std::make_unique<adaptive_window::Controller>(*adaptive_options);
+    run_pipeline.adaptive = adaptive.get();
+  }
+  boost::asio::io_context io_context;
+  ClientRun run =
+      target.in_process
+          ? run_to_completion(io_context,
+                              std::make_shared<InProcessTCPClient>(
+                                  io_context, metrics, test_file, codec,
+                                  run_pipeline, mode, chunk_size, byte_limit,
+                                  target.download_file))
+          : run_to_completion(io_context,
+                              std::make_shared<BenchmarkClient>(
+                                  io_context, target.server_ip,
+                                  config::TCP_SERVER_PORT, metrics, test_file,
+                                  codec, run_pipeline, mode, socket_profile,
+                                  chunk_size, byte_limit));
+  std::cout << "TCP Client: In-flight " << run.budget_report << std::endl;
+  metrics.set_run_parameter("inflight_budget", run.budget_report);
+  if (adaptive) {
+    std::cout << "TCP Client: Adaptive " << adaptive->describe() << std::endl;
+    metrics.set_run_parameter("adaptive_window", adaptive->describe());
+    if (!window_csv.empty())
+      adaptive->save_csv(window_csv);
+  }
+  return run;
+}
+
+// Results of upload/download runs go to their own CSV files
+// (cpp_overall_metrics_upload.csv, ...), so they never mix with echo runs.
+static std::string results_file_for_mode(const std::string &file,
+                                         workload::Mode mode) {
+  if (mode == workload::Mode::ROUND_TRIP)
+    return file;
+  std::size_t dot = file.rfind('.');
+  return file.substr(0, dot) + "_" + workload::mode_to_string(mode) +
+         file.substr(dot);
+}
+
 int main(int argc, char *argv[]) {
   try {
-    std::string server_ip = config::DEFAULT_SERVER_IP;
-    if (argc > 1) {
-      server_ip = argv[1];
-      std::cout << "TCP Client: Using server IP from argument: " << server_ip
+    CliOptions options(argc, argv);
+    // --transport=tcp|inproc: inproc runs the server's frame handling in
+    // this process behind a memory pipe (tcp_client_inproc.hpp).
+    ClientTarget target;
+    const std::string transport = options.get_string("transport", "tcp");
+    if (transport != "tcp" && transport != "inproc") {
+      std::cerr << "TCP Client: --transport must be 'tcp' or 'inproc'."
+                << std::endl;
+      return 1;
+    }
+    target.in_process = transport == "inproc";
+    target.download_file =
+        options.get_string("download-file", config::TEST_FILE_NAME);
+    target.server_ip = config::DEFAULT_SERVER_IP;
+    if (target.in_process) {
+      std::cout << "TCP Client: In-process transport, no server needed."
                 << std::endl;
+    } else if (!options.positional().empty()) {
+      target.server_ip = options.positional().front();
+      std::cout << "TCP Client: Using server IP from argument: "
+                << target.server_ip << std::endl;
     } else {
-      std::cout << "TCP Client: Using default server IP: " << server_ip
+      std::cout << "TCP Client: Using default server IP: " << target.server_ip
                 << std::endl;
     }
+    std::size_t chunk_size = options.get_size("chunk-size", config::CHUNK_SIZE);
+    if (chunk_size == 0 || chunk_size > config::MAX_CHUNK_SIZE) {
+      std::cerr << "TCP Client: --chunk-size must be between 1 and "
+                << config::MAX_CHUNK_SIZE << " bytes." << std::endl;
+      return 1;
+    }
     std::cout << "TCP Client: Target file size: "
               << config::TOTAL_FILE_SIZE / (1024.0 * 1024.0)
-              << " MB, Chunk size: " << config::CHUNK_SIZE / 1024.0 << " KB."
+              << " MB, Chunk size: " << chunk_size / 1024.0 << " KB."
               << std::endl;
 
-    generate_test_file_if_not_exists(config::TEST_FILE_NAME,
-                                     config::TOTAL_FILE_SIZE);
+    ContentProfile profile =
+        content_profile_from_string(options.get_string("content", "random"));
+    compression::Codec codec =
+        compression::codec_from_string(options.get_string("compression", "none"));
+    if (!compression::codec_available(codec)) {
+      std::cerr << "TCP Client: Codec '" << compression::codec_to_string(codec)
+                << "' is not compiled in (rebuild with WITH_ZSTD=1)."
+                << std::endl;
+      return 1;
+    }
+    const std::string test_file =
+        test_file_name_for_profile(config::TEST_FILE_NAME, profile);
+    if (codec != compression::Codec::NONE) {
+      std::cout << "TCP Client: Frame compression: "
+                << compression::codec_to_string(codec) << ", content profile: "
+                << content_profile_to_string(profile) << std::endl;
+    }
+
+    // --batch=N packs N chunks per frame, --batch=auto sizes batches to the
+    // window; --window=N caps the chunks in flight (default: two batches).
+    PipelineOptions pipeline;
+    std::string batch = options.get_string("batch", "1");
+    pipeline.batch = batch == "auto" ? 0 : std::stoul(batch);
+    if (pipeline.batch > tcp_messaging::MAX_BATCH_ENTRIES) {
+      std::cerr << "TCP Client: --batch must be at most "
+                << tcp_messaging::MAX_BATCH_ENTRIES << "." << std::endl;
+      return 1;
+    }
+    pipeline.window = static_cast<std::size_t>(options.get_int("window", 0));
+    // --inflight-bytes=N[K|M|G]: payload bytes in flight, on top of the window
+    pipeline.inflight_bytes = options.get_size("inflight-bytes", 0);
+    // --adaptive-window: the window is tuned during each run (and sweep
+    // point) up to --window-max, starting from --window-initial;
+    // --window-rtt-tolerance-pct is how much queueing delay it accepts.
+    const bool adaptive_enabled = options.get_bool("adaptive-window", false);
+    adaptive_window::Options adaptive_options;
+    adaptive_options.max_window = options.get_size(
+        "window-max", config::ADAPTIVE_WINDOW_DEFAULT_MAX);
+    adaptive_options.initial_window = options.get_size("window-initial", 1);
+    adaptive_options.rtt_tolerance =
+        options.get_int("window-rtt-tolerance-pct",
+                        static_cast<long long>(
+                            config::ADAPTIVE_WINDOW_RTT_TOLERANCE * 100)) /
+        100.0;
+    if (adaptive_options.max_window == 0 || adaptive_options.rtt_tolerance <= 0) {
+      std::cerr << "TCP Client: --window-max and --window-rtt-tolerance-pct "
+                   "must be positive."
+                << std::endl;
+      return 1;
+    }
+    const adaptive_window::Options *adaptive =
+        adaptive_enabled ? &adaptive_options : nullptr;
+    // --trace: per-stage RTT split from client and server timestamps
+    latency_trace::Collector trace;
+    const bool trace_enabled = options.get_bool("trace", false);
+
+    // --mode=echo|upload|download; in download mode the test file only sets
+    // how many bytes are asked for, the data comes from the server's
+    // --download-file.
+    workload::Mode mode =
+        workload::mode_from_string(options.get_string("mode", "echo"));
+    if (mode != workload::Mode::ROUND_TRIP) {
+      std::cout << "TCP Client: Workload mode: "
+                << workload::mode_to_string(mode) << std::endl;
+    }
 
-    if (!fs::exists(config::TEST_FILE_NAME)) {
-      std::cerr << "TCP Client: Test file '" << config::TEST_FILE_NAME
+    socket_tuning::Profile socket_profile = socket_tuning::from_options(options);
+    if (!socket_profile.is_default()) {
+      std::cout << "TCP Client: Socket profile: "
+                << socket_tuning::to_string(socket_profile) << std::endl;
+    }
+
+    generate_test_file_if_not_exists(test_file, config::TOTAL_FILE_SIZE,
+                                     profile);
+
+    if (!fs::exists(test_file)) {
+      std::cerr << "TCP Client: Test file '" << test_file
                 << "' could not be created or found. Aborting." << std::endl;
       return 1;
     }
-    if (fs::file_size(config::TEST_FILE_NAME) != config::TOTAL_FILE_SIZE) {
-      std::cerr << "TCP Client: Test file '" << config::TEST_FILE_NAME
+    if (fs::file_size(test_file) != config::TOTAL_FILE_SIZE) {
+      std::cerr << "TCP Client: Test file '" << test_file
                 << "' has incorrect size. Expected " << config::TOTAL_FILE_SIZE
-                << ", got " << fs::file_size(config::TEST_FILE_NAME)
-                << ". Aborting." << std::endl;
+                << ", got " << fs::file_size(test_file) << ". Aborting."
+                << std::endl;
       return 1;
     }
 
-    boost::asio::io_context io_context;
-    MetricsAggregator metrics("CPP_TCP", config::TOTAL_FILE_SIZE,
-                              config::CHUNK_SIZE);
-
-    auto client = std::make_shared<TCPClient>(io_context, server_ip,
-                                              config::TCP_SERVER_PORT, metrics);
-    client->start();
+    if (options.get_bool("sweep", false)) {
+      // One connection per chunk size; each point sends the first
+      // --sweep-bytes of the test file.
+      std::size_t sweep_bytes =
+          options.get_size("sweep-bytes", config::SWEEP_BYTES_PER_POINT);
+      std::size_t sweep_max = std::min(
+          options.get_size("sweep-max", config::SWEEP_MAX_CHUNK_SIZE),
+          config::MAX_CHUNK_SIZE);
+      std::vector<sweep::SweepPoint> points;
+      for (std::size_t size : sweep::chunk_sizes(
+               options.get_size("sweep-min", config::SWEEP_MIN_CHUNK_SIZE),
+               sweep_max)) {
+        std::cout << "TCP Client: Sweep point, chunk size " << size
+                  << " bytes." << std::endl;
+        MetricsAggregator metrics("CPP_TCP", sweep_bytes, size);
+        ClientRun run = run_client(target, test_file, codec, pipeline, mode,
+                                   socket_profile, size, sweep_bytes, metrics,
+                                   adaptive);
+        sweep::SweepPoint point;
+        point.chunk_size_bytes = size;
+        point.throughput_mbps = metrics.throughput_mbps();
+        point.avg_rtt_ms = metrics.avg_rtt_ms();
+        point.p99_rtt_ms = metrics.percentile_rtt_ms(99.0);
+        point.failed_chunks = metrics.failed_chunks();
+        point.completed = run.succeeded && point.failed_chunks == 0;
+        points.push_back(point);
+      }
+      std::size_t knee = sweep::find_knee(
+          points, options.get_int("knee-tolerance-pct",
+                                  static_cast<long long>(
+                                      config::SWEEP_KNEE_TOLERANCE * 100)) /
+                      100.0);
+      sweep::print_report("CPP_TCP", points, knee);
+      sweep::save_to_csv(
+          results_file_for_mode(config::CPP_SWEEP_METRICS_FILE, mode),
+          "CPP_TCP", points, knee);
+      return 0;
+    }
 
-    io_context.run();
+    if (options.get_bool("socket-sweep", false)) {
+      // One connection per socket profile at --chunk-size; the server keeps
+      // whatever --socket-profile it was started with.
+      std::size_t sweep_bytes =
+          options.get_size("sweep-bytes", config::SWEEP_BYTES_PER_POINT);
+      std::vector<sweep::LabeledPoint> points;
+      for (const std::string &name : socket_tuning::sweep_presets()) {
+        socket_tuning::Profile point_profile = socket_tuning::preset(name);
+        std::cout << "TCP Client: Socket sweep point, "
+                  << socket_tuning::to_string(point_profile) << std::endl;
+        MetricsAggregator metrics("CPP_TCP", sweep_bytes, chunk_size);
+        ClientRun run = run_client(target, test_file, codec, pipeline, mode,
+                                   point_profile, chunk_size, sweep_bytes,
+                                   metrics, adaptive);
+        sweep::LabeledPoint point;
+        point.label = name;
+        point.result.chunk_size_bytes = chunk_size;
+        point.result.throughput_mbps = metrics.throughput_mbps();
+        point.result.avg_rtt_ms = metrics.avg_rtt_ms();
+        point.result.p99_rtt_ms = metrics.percentile_rtt_ms(99.0);
+        point.result.failed_chunks = metrics.failed_chunks();
+        point.result.completed =
+            run.succeeded && point.result.failed_chunks == 0;
+        points.push_back(point);
+      }
+      sweep::print_labeled_report("Socket Profile Sweep", "CPP_TCP", points);
+      sweep::save_labeled_csv(
+          results_file_for_mode(config::CPP_SOCKET_SWEEP_METRICS_FILE, mode),
+          "CPP_TCP", points);
+      return 0;
+    }
 
-    std::cout << "TCP Client: io_context.run() finished." << std::endl;
+    MetricsAggregator metrics("CPP_TCP", config::TOTAL_FILE_SIZE, chunk_size);
+    metrics.set_run_parameter("socket_profile",
+                              socket_tuning::to_string(socket_profile));
+    metrics.set_run_parameter("mode", workload::mode_to_string(mode));
+    metrics.set_run_parameter("transport", transport);
+    if (trace_enabled) {
+      pipeline.trace = &trace;
+      std::cout << "TCP Client: Per-stage latency tracing enabled."
+                << std::endl;
+    }
+    // --event-trace=file.json: what the client thread did, chunk by chunk
+    event_trace::start(options.get_string("event-trace", ""));
+    event_trace::set_thread_name("io_context");
+    // --progress-interval-ms / --progress-window: throughput, in-flight depth
+    // and sliding-window p99 over time (the sweeps only print their points)
+    progress::start(
+        "TCP client",
+        static_cast<int>(options.get_int("progress-interval-ms",
+                                         config::DEFAULT_PROGRESS_INTERVAL_MS)),
+        static_cast<int>(options.get_int(
+            "progress-window", config::DEFAULT_PROGRESS_WINDOW_INTERVALS)),
+        results_file_for_mode(config::CPP_PROGRESS_FILE, mode));
+    ClientRun run = run_client(
+        target, test_file, codec, pipeline, mode, socket_profile, chunk_size,
+        0, metrics, adaptive,
+        results_file_for_mode(config::CPP_ADAPTIVE_WINDOW_FILE, mode));
+    progress::stop();
+    event_trace::stop();
+    if (adaptive_enabled) {
+      std::cout << "TCP Client: Pipelining: adaptive window up to "
+                << run.window << " chunks, batch " << batch << std::endl;
+    } else if (pipeline.batch != 1 || run.window != 1) {
+      std::cout << "TCP Client: Pipelining: window " << run.window
+                << " chunks, batch " << batch << std::endl;
+    }
+    if (codec != compression::Codec::NONE && run.wire_bytes_sent > 0) {
+      std::cout << "TCP Client: Sent " << run.payload_bytes_sent
+                << " payload bytes as " << run.wire_bytes_sent
+                << " bytes on the wire (ratio "
+                << static_cast<double>(run.payload_bytes_sent) /
+                       run.wire_bytes_sent
+                << ")." << std::endl;
+    }
 
     metrics.print_summary();
-    metrics.save_to_csv(config::CPP_OVERALL_METRICS_FILE,
-                        config::CPP_CHUNK_RTT_METRICS_FILE);
+    metrics.save_to_csv(
+        results_file_for_mode(config::CPP_OVERALL_METRICS_FILE, mode),
+        results_file_for_mode(config::CPP_CHUNK_RTT_METRICS_FILE, mode));
+    if (trace_enabled) {
+      trace.print_summary();
+      trace.save_csv(results_file_for_mode(config::CPP_TRACE_FILE, mode));
+    }
 
   } catch (const std::exception &e) {
     std::cerr << "TCP Client Exception in main: " << e.what() << std::endl;
@@ -0,0 +1,240 @@
+// benchmark/client/tcp_client_coro.hpp
+// C++20 coroutine version of TCPClient, built with ASIO_API=coroutine. It
+// drives the same ChunkPipeline with two coroutines per connection: a writer
+// that sends whenever the window has room and a reader that verifies
+// responses. The writer parks on a timer that the reader cancels when
+// responses free up the window. Coroutine frames come from Asio's per-thread
+// recycling allocator, so the steady state does not touch the heap.
+#ifndef TCP_CLIENT_CORO_HPP
+#define TCP_CLIENT_CORO_HPP
+
+#include "../common/include/compression.hpp"
+#include "../common/include/config.hpp"
+#include "../common/include/metrics_aggregator.hpp"
+#include "../common/include/socket_tuning.hpp"
+#include "../common/include/tcp_messaging.hpp"
+#include "../common/include/workload.hpp"
+#include "chunk_pipeline.hpp"
+
+#include <boost/asio.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+
+class CoroTCPClient : public std::enable_shared_from_this<CoroTCPClient> {
+public:
+  CoroTCPClient(boost::asio::io_context &io_context, const std::string &host,
+                unsigned short port, MetricsAggregator &metrics,
+                const std::string &filename, compression::Codec codec,
+                const PipelineOptions &pipeline, workload::Mode mode,
+                const socket_tuning::Profile &socket_profile,
+                std::size_t chunk_size,
+                std::size_t byte_limit = 0) // 0 = the whole file
+      : m_io_context(io_context), m_socket(io_context), m_resolver(io_context),
+        m_window_open(io_context), m_metrics(metrics), m_host(host),
+        m_port_str(std::to_string(port)), m_socket_profile(socket_profile),
+        m_chunks(metrics, filename, codec, pipeline, mode, chunk_size,
+                 byte_limit),
+        m_reader(std::max(config::RECEIVE_BUFFER_SIZE, 2 * chunk_size),
+                 tcp_messaging::max_batch_frame_length(
+                     config::MAX_FRAME_PAYLOAD_SIZE)) {}
+
+  std::size_t wire_bytes_sent() const { return m_chunks.wire_bytes_sent(); }
+  std::size_t payload_bytes_sent() const {
+    return m_chunks.payload_bytes_sent();
+  }
+  std::size_t chunks_verified() const { return m_chunks.chunks_verified(); }
+  bool succeeded() const { return m_succeeded; }
+  std::size_t window() const { return m_chunks.window(); }
+  std::string budget_report() const { return m_chunks.budget_report(); }
+
+  void start() {
+    boost::asio::co_spawn(m_io_context, run(shared_from_this()),
+                          boost::asio::detached);
+  }
+
+private:
+  using tcp = boost::asio::ip::tcp;
+
+  // `self` keeps the client alive for as long as either coroutine runs.
+  boost::asio::awaitable<void> run(std::shared_ptr<CoroTCPClient> self) {
+    using boost::asio::redirect_error;
+    using boost::asio::use_awaitable;
+
+    boost::system::error_code ec;
+    auto endpoints = co_await m_resolver.async_resolve(
+        m_host, m_port_str, redirect_error(use_awaitable, ec));
+    if (ec) {
+      std::cerr << "TCP Client: Resolve error: " << ec.message() << std::endl;
+      stop_client_operations(true);
+      co_return;
+    }
+    if (!m_socket_profile.is_default()) {
+      // A tuned socket is opened by hand, so only the first endpoint is tried.
+      tcp::endpoint endpoint = *endpoints.begin();
+      if (socket_tuning::open_tuned(m_socket, endpoint, m_socket_profile,
+                                    "TCP Client:", ec)) {
+        co_await m_socket.async_connect(endpoint,
+                                        redirect_error(use_awaitable, ec));
+      }
+    } else {
+      co_await boost::asio::async_connect(m_socket, endpoints,
+                                          redirect_error(use_awaitable, ec));
+    }
+    if (ec) {
+      std::cerr << "TCP Client: Connect error: " << ec.message() << std::endl;
+      stop_client_operations(true);
+      co_return;
+    }
+    std::cout << "TCP Client: Connected to "
+              << m_socket.remote_endpoint().address().to_string() << ":"
+              << m_socket.remote_endpoint().port() << std::endl;
+    m_metrics.start_timer();
+    if (m_chunks.total_chunks() == 0) {
+      std::cout << "TCP Client: Test file is empty. Nothing to send."
+                << std::endl;
+      stop_client_operations(false);
+      co_return;
+    }
+
+    boost::asio::co_spawn(m_io_context, read_responses(self),
+                          boost::asio::detached);
+    co_await write_chunks();
+  }
+
+  boost::asio::awaitable<void> write_chunks() {
+    using boost::asio::redirect_error;
+    using boost::asio::use_awaitable;
+
+    boost::system::error_code ec;
+    while (!m_operations_stopped) {
+      switch (m_chunks.prepare_write()) {
+      case ChunkPipeline::WriteStep::FINISHED:
+        stop_client_operations(false);
+        co_return;
+      case ChunkPipeline::WriteStep::WAIT:
+        // Cancelled by the reader (or on stop); the error is expected.
+        m_window_open.expires_at(std::chrono::steady_clock::time_point::max());
+        co_await m_window_open.async_wait(redirect_error(use_awaitable, ec));
+        continue;
+      case ChunkPipeline::WriteStep::SEND:
+        break;
+      }
+
+      std::size_t bytes_transferred = co_await boost::asio::async_write(
+          m_socket, m_chunks.write_buffers(), redirect_error(use_awaitable, ec));
+      if (m_operations_stopped)
+        co_return;
+      if (ec) {
+        std::cerr << "TCP Client: Write error: " << ec.message() << std::endl;
+        stop_client_operations(true);
+        co_return;
+      }
+      m_chunks.on_write_complete(bytes_transferred);
+    }
+  }
+
+  // Every complete response frame in the buffer is handled before the socket
+  // is read again.
+  boost::asio::awaitable<void>
+  read_responses(std::shared_ptr<CoroTCPClient> /*self*/) {
+    using boost::asio::redirect_error;
+    using boost::asio::use_awaitable;
+
+    boost::system::error_code ec;
+    tcp_messaging::Frame frame;
+    while (!m_operations_stopped) {
+      switch (m_reader.peek(frame)) {
+      case tcp_messaging::FrameReader::Status::FRAME_READY:
+        switch (m_chunks.handle_response(frame)) {
+        case ChunkPipeline::ResponseStep::FAILED:
+          stop_client_operations(true);
+          co_return;
+        case ChunkPipeline::ResponseStep::FINISHED:
+          stop_client_operations(false);
+          co_return;
+        case ChunkPipeline::ResponseStep::CONTINUE:
+          break;
+        }
+        m_reader.consume(frame);
+        m_window_open.cancel();
+        continue;
+      case tcp_messaging::FrameReader::Status::FRAME_TOO_LARGE:
+        std::cerr << "TCP Client: Excessive body length in response. Max "
+                     "expected: "
+                  << config::MAX_FRAME_PAYLOAD_SIZE << ". Closing."
+                  << std::endl;
+        stop_client_operations(true);
+        co_return;
+      case tcp_messaging::FrameReader::Status::NEED_MORE:
+        break;
+      }
+
+      std::size_t bytes_read = co_await m_socket.async_read_some(
+          m_reader.prepare(), redirect_error(use_awaitable, ec));
+      m_reader.commit(bytes_read);
+      if (m_operations_stopped)
+        co_return;
+      if (ec) {
+        stop_client_operations(
+            !log_read_error(ec, m_reader.buffered_bytes(), m_chunks));
+        co_return;
+      }
+      if (m_socket_profile.quick_ack)
+        socket_tuning::rearm_quick_ack(m_socket.native_handle());
+    }
+  }
+
+  void stop_client_operations(bool error_occurred) {
+    if (!m_operations_stopped) {
+      m_operations_stopped = true;
+      m_succeeded = !error_occurred;
+      if (!m_timer_stopped_flag) {
+        m_metrics.stop_timer();
+        m_timer_stopped_flag = true;
+      }
+      boost::system::error_code ignored_ec;
+      m_window_open.cancel();
+      if (m_socket.is_open()) {
+        m_socket.shutdown(tcp::socket::shutdown_both, ignored_ec);
+        m_socket.close(ignored_ec);
+      }
+      if (!m_io_context.stopped()) {
+        std::cout << "TCP Client: Stopping io_context explicitly." << std::endl;
+        m_io_context.stop();
+      }
+      if (error_occurred) {
+        std::cout << "TCP Client: Operations stopped due to an error."
+                  << std::endl;
+      } else {
+        std::cout << "TCP Client: Operations finished successfully."
+                  << std::endl;
+      }
+    }
+  }
+
+  boost::asio::io_context &m_io_context;
+  tcp::socket m_socket;
+  tcp::resolver m_resolver;
+  boost::asio::steady_timer m_window_open; // Writer waits here for free slots
+  MetricsAggregator &m_metrics;
+
+  std::string m_host;
+  std::string m_port_str;
+  socket_tuning::Profile m_socket_profile;
+
+  ChunkPipeline m_chunks;
+  tcp_messaging::FrameReader m_reader;
+
+  bool m_timer_stopped_flag = false;
+  bool m_operations_stopped = false;
+  bool m_succeeded = false;
+};
+
+#endif // TCP_CLIENT_CORO_HPP
@@ -0,0 +1,235 @@
+// benchmark/client/tcp_client_inproc.hpp
+// --transport=inproc: the client's ChunkPipeline talks to the server's
+// FrameResponder through an in-memory pipe instead of a TCP connection, both
+// on the client's io_context thread. Framing, reversal, compression and
+// verification are the same code as over loopback, and every byte is still
+// copied into and out of a pipe buffer as it would be through a kernel socket
+// buffer. What is missing is the network stack: no syscalls, no TCP/IP
+// processing and no wakeups. Comparing a loopback run with an in-process run
+// gives the per-chunk cost of that stack. Server stage stats are not
+// collected in this mode.
+#ifndef TCP_CLIENT_INPROC_HPP
+#define TCP_CLIENT_INPROC_HPP
+
+#include "../common/include/compression.hpp"
+#include "../common/include/config.hpp"
+#include "../common/include/metrics_aggregator.hpp"
+#include "../common/include/server_stats.hpp"
+#include "../common/include/tcp_messaging.hpp"
+#include "../common/include/workload.hpp"
+#include "../server/session_common.hpp"
+#include "chunk_pipeline.hpp"
+
+#include <algorithm> // For std::min
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstring> // For std::memcpy
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace memory_pipe {
+
+// One direction of the pipe. Written bytes queue up until they are read,
+// like a socket buffer. The queue keeps its capacity once drained, so the
+// steady state does not allocate.
+class Pipe {
+public:
+  template <typename ConstBufferSequence>
+  std::size_t write(const ConstBufferSequence &buffers) {
+    std::size_t written = 0;
+    for (const boost::asio::const_buffer &buffer : buffers) {
+      const char *data = static_cast<const char *>(buffer.data());
+      m_bytes.insert(m_bytes.end(), data, data + buffer.size());
+      written += buffer.size();
+    }
+    return written;
+  }
+
+  std::size_t read_some(boost::asio::mutable_buffer buffer) {
+    std::size_t count = std::min(buffer.size(), available());
+    std::memcpy(buffer.data(), m_bytes.data() + m_read_pos, count);
+    m_read_pos += count;
+    if (m_read_pos == m_bytes.size()) {
+      m_bytes.clear();
+      m_read_pos = 0;
+    }
+    return count;
+  }
+
+  std::size_t available() const { return m_bytes.size() - m_read_pos; }
+
+private:
+  std::vector<char> m_bytes;
+  std::size_t m_read_pos = 0;
+};
+
+} // namespace memory_pipe
+
+class InProcessTCPClient
+    : public std::enable_shared_from_this<InProcessTCPClient> {
+public:
+  // download_file backs the in-process responder in --mode=download, like the
+  // server's --download-file.
+  InProcessTCPClient(boost::asio::io_context &io_context,
+                     MetricsAggregator &metrics, const std::string &filename,
+                     compression::Codec codec, const PipelineOptions &pipeline,
+                     workload::Mode mode, std::size_t chunk_size,
+                     std::size_t byte_limit, const std::string &download_file)
+      : m_io_context(io_context), m_metrics(metrics),
+        m_chunks(metrics, filename, codec, pipeline, mode, chunk_size,
+                 byte_limit),
+        m_reader(std::max(config::RECEIVE_BUFFER_SIZE, 2 * chunk_size),
+                 tcp_messaging::max_batch_frame_length(
+                     config::MAX_FRAME_PAYLOAD_SIZE)),
+        m_server_reader(config::RECEIVE_BUFFER_SIZE,
+                        tcp_messaging::max_batch_frame_length(
+                            config::MAX_FRAME_PAYLOAD_SIZE)),
+        m_responder(download_file, false) {}
+
+  std::size_t wire_bytes_sent() const { return m_chunks.wire_bytes_sent(); }
+  std::size_t payload_bytes_sent() const {
+    return m_chunks.payload_bytes_sent();
+  }
+  std::size_t chunks_verified() const { return m_chunks.chunks_verified(); }
+  bool succeeded() const { return m_succeeded; }
+  std::size_t window() const { return m_chunks.window(); }
+  std::string budget_report() const { return m_chunks.budget_report(); }
+
+  void start() {
+    auto self = shared_from_this();
+    boost::asio::post(m_io_context, [this, self] { run(); });
+  }
+
+private:
+  // Alternates between the two ends until the pipeline finishes: send what
+  // the window allows, answer every complete request, then verify every
+  // complete response.
+  void run() {
+    std::cout << "TCP Client: In-process transport, memory pipe to the "
+                 "server's frame responder."
+              << std::endl;
+    m_metrics.start_timer();
+    if (m_chunks.total_chunks() == 0) {
+      std::cout << "TCP Client: Test file is empty. Nothing to send."
+                << std::endl;
+      finish(false);
+      return;
+    }
+    for (;;) {
+      bool progressed = false;
+      switch (m_chunks.prepare_write()) {
+      case ChunkPipeline::WriteStep::FINISHED:
+        finish(false);
+        return;
+      case ChunkPipeline::WriteStep::SEND:
+        m_chunks.on_write_complete(m_to_server.write(m_chunks.write_buffers()));
+        progressed = true;
+        break;
+      case ChunkPipeline::WriteStep::WAIT:
+        break;
+      }
+      if (!serve_requests(progressed)) {
+        finish(true);
+        return;
+      }
+      switch (read_responses(progressed)) {
+      case ChunkPipeline::ResponseStep::FAILED:
+        finish(true);
+        return;
+      case ChunkPipeline::ResponseStep::FINISHED:
+        finish(false);
+        return;
+      case ChunkPipeline::ResponseStep::CONTINUE:
+        break;
+      }
+      if (!progressed) {
+        std::cerr << "TCP Client: In-process pipeline stalled with nothing "
+                     "to send or read."
+                  << std::endl;
+        finish(true);
+        return;
+      }
+    }
+  }
+
+  // The server session's loop without the socket: every complete request
+  // frame is answered and the response written to the client's pipe.
+  bool serve_requests(bool &progressed) {
+    while (m_to_server.available() > 0) {
+      m_server_reader.commit(m_to_server.read_some(m_server_reader.prepare()));
+      auto received_at = std::chrono::steady_clock::now();
+      tcp_messaging::Frame frame{};
+      for (;;) {
+        auto status = m_server_reader.peek(frame);
+        if (status == tcp_messaging::FrameReader::Status::FRAME_TOO_LARGE) {
+          log_frame_too_large();
+          return false;
+        }
+        if (status == tcp_messaging::FrameReader::Status::NEED_MORE)
+          break;
+        server_stats::RequestTiming timing;
+        timing.start_at(received_at);
+        timing.lap(server_stats::Stage::QUEUE_WAIT);
+        if (!m_responder.respond(frame, timing))
+          return false;
+        m_to_client.write(m_responder.buffers());
+        m_server_reader.consume(frame);
+        progressed = true;
+      }
+    }
+    return true;
+  }
+
+  ChunkPipeline::ResponseStep read_responses(bool &progressed) {
+    while (m_to_client.available() > 0) {
+      m_reader.commit(m_to_client.read_some(m_reader.prepare()));
+      tcp_messaging::Frame frame;
+      for (;;) {
+        auto status = m_reader.peek(frame);
+        if (status == tcp_messaging::FrameReader::Status::FRAME_TOO_LARGE) {
+          std::cerr << "TCP Client: Excessive body length in response. Max "
+                       "expected: "
+                    << config::MAX_FRAME_PAYLOAD_SIZE << ". Closing."
+                    << std::endl;
+          return ChunkPipeline::ResponseStep::FAILED;
+        }
+        if (status == tcp_messaging::FrameReader::Status::NEED_MORE)
+          break;
+        auto step = m_chunks.handle_response(frame);
+        if (step != ChunkPipeline::ResponseStep::CONTINUE)
+          return step;
+        m_reader.consume(frame);
+        progressed = true;
+      }
+    }
+    return ChunkPipeline::ResponseStep::CONTINUE;
+  }
+
+  void finish(bool error_occurred) {
+    m_succeeded = !error_occurred;
+    m_metrics.stop_timer();
+    if (error_occurred) {
+      std::cout << "TCP Client: Operations stopped due to an error."
+                << std::endl;
+    } else {
+      std::cout << "TCP Client: Operations finished successfully."
+                << std::endl;
+    }
+  }
+
+  boost::asio::io_context &m_io_context;
+  MetricsAggregator &m_metrics;
+
+  ChunkPipeline m_chunks;
+  tcp_messaging::FrameReader m_reader;
+  memory_pipe::Pipe m_to_server;
+  memory_pipe::Pipe m_to_client;
+  tcp_messaging::FrameReader m_server_reader;
+  FrameResponder m_responder;
+
+  bool m_succeeded = false;
+};
+
+#endif // TCP_CLIENT_INPROC_HPP
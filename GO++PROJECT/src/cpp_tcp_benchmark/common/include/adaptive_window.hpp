@@ -0,0 +1,84 @@
+#ifndef ADAPTIVE_WINDOW_HPP
+#define ADAPTIVE_WINDOW_HPP
+
+#include "config.hpp"
+
+#include <chrono>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Adaptive in-flight window (--adaptive-window): how many chunks the client
+// keeps outstanding, tuned from what the responses show. Decisions are taken
+// once per epoch, i.e. once as many responses as the window have come back
+// (at least MIN_EPOCH_SAMPLES), from the epoch's throughput and mean RTT:
+//   - the base RTT is the lowest epoch mean seen so far (no queueing);
+//   - slow start doubles the window while throughput keeps rising and the
+//     RTT stays near the base;
+//   - after that it is AIMD: +1 per epoch, or times 0.7 once the RTT is more
+//     than --window-rtt-tolerance-pct above the base without a throughput
+//     gain to show for it.
+// Below saturation a larger window does not lengthen the RTT; past it extra
+// chunks only queue and the RTT grows with the window. The window settles
+// where queueing adds the tolerated share to the RTT, which is close to peak
+// throughput without hand tuning. Not thread safe: the client feeds it from
+// its io_context thread.
+namespace adaptive_window {
+
+struct Options {
+  std::size_t min_window = 1;
+  std::size_t max_window = config::ADAPTIVE_WINDOW_DEFAULT_MAX;
+  std::size_t initial_window = 1;
+  double rtt_tolerance = config::ADAPTIVE_WINDOW_RTT_TOLERANCE;
+  double decrease_factor = config::ADAPTIVE_WINDOW_DECREASE_FACTOR;
+  double min_gain = config::ADAPTIVE_WINDOW_MIN_GAIN;
+  std::size_t min_epoch_samples = config::ADAPTIVE_WINDOW_MIN_EPOCH_SAMPLES;
+};
+
+// One epoch: the window it ended with and what was done to it.
+struct Sample {
+  double elapsed_s = 0.0;
+  std::size_t window_before = 0;
+  std::size_t window_after = 0;
+  double throughput_mbps = 0.0;
+  double mean_rtt_us = 0.0;
+  double base_rtt_us = 0.0;
+  const char *action = ""; // "grow", "shrink" or "hold"
+};
+
+class Controller {
+public:
+  explicit Controller(const Options &options);
+
+  std::size_t window() const { return m_window; }
+  std::size_t max_window() const { return m_options.max_window; }
+  // A chunk of payload_bytes was answered after rtt_us. Returns true when
+  // the window changed.
+  bool on_completion(uint64_t payload_bytes, int64_t rtt_us);
+
+  const std::vector<Sample> &history() const { return m_history; }
+  // "window 48 (range 1..64, max 1024), 37 epochs: 30 grow, 4 shrink, ..."
+  std::string describe() const;
+  // The window over time, one row per epoch.
+  bool save_csv(const std::string &filename) const;
+
+private:
+  Options m_options;
+  std::size_t m_window;
+  std::size_t m_lowest_window;
+  std::size_t m_highest_window;
+  std::chrono::steady_clock::time_point m_started_at;
+  std::chrono::steady_clock::time_point m_epoch_started_at;
+  uint64_t m_epoch_samples = 0;
+  uint64_t m_epoch_bytes = 0;
+  double m_epoch_rtt_sum_us = 0.0;
+  double m_base_rtt_us = 0.0;
+  double m_last_throughput_mbps = 0.0;
+  bool m_slow_start = true;
+  std::vector<Sample> m_history;
+};
+
+} // namespace adaptive_window
+
+#endif // ADAPTIVE_WINDOW_HPP
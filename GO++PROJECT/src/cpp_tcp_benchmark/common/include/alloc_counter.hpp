@@ -0,0 +1,17 @@
+#ifndef ALLOC_COUNTER_HPP
+#define ALLOC_COUNTER_HPP
+
+#include <cstdint>
+
+// Process-wide heap allocation counter used to compare the per-operation
+// allocation cost of the callback and coroutine builds. Counting replaces the
+// global operator new and is only compiled in with COUNT_ALLOCS=1
+// (TCP_BENCH_COUNT_ALLOCS); otherwise enabled() is false and the count is 0.
+namespace alloc_counter {
+
+bool enabled();
+std::uint64_t allocations();
+
+} // namespace alloc_counter
+
+#endif // ALLOC_COUNTER_HPP
@@ -12,6 +12,9 @@ public:
   ~ChunkReader();
 
   std::vector<char> read_next_chunk();
+  // Reads the next chunk into `buffer`, reusing its capacity. Returns false
+  // (and leaves `buffer` empty) at EOF.
+  bool read_next_chunk(std::vector<char> &buffer);
   bool eof() const;
   std::size_t total_chunks() const;
   std::size_t file_size() const;
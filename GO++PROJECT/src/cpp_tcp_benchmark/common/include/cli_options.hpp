@@ -0,0 +1,96 @@
+#ifndef CLI_OPTIONS_HPP
+#define CLI_OPTIONS_HPP
+
+#include <cstddef> // For size_t
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Minimal command line parsing: "--key=value" options ("--flag" means
+// "--flag=1") plus positional arguments (e.g. the server IP for the client).
+class CliOptions {
+public:
+  CliOptions(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (arg.rfind("--", 0) != 0) {
+        m_positional.push_back(arg);
+        continue;
+      }
+      arg = arg.substr(2);
+      std::size_t eq_pos = arg.find('=');
+      if (eq_pos == std::string::npos) {
+        m_values[arg] = "1";
+      } else {
+        m_values[arg.substr(0, eq_pos)] = arg.substr(eq_pos + 1);
+      }
+    }
+  }
+
+  bool has(const std::string &key) const { return m_values.count(key) != 0; }
+
+  std::string get_string(const std::string &key,
+                         const std::string &default_value) const {
+    auto it = m_values.find(key);
+    return it != m_values.end() ? it->second : default_value;
+  }
+
+  long long get_int(const std::string &key, long long default_value) const {
+    auto it = m_values.find(key);
+    if (it == m_values.end())
+      return default_value;
+    try {
+      return std::stoll(it->second);
+    } catch (const std::exception &) {
+      throw std::invalid_argument("Invalid integer value for --" + key + ": " +
+                                  it->second);
+    }
+  }
+
+  // Accepts K/M/G suffixes (powers of 1024), e.g. --chunk-size=64K.
+  std::size_t get_size(const std::string &key,
+                       std::size_t default_value) const {
+    auto it = m_values.find(key);
+    if (it == m_values.end())
+      return default_value;
+    try {
+      return parse_size(it->second);
+    } catch (const std::exception &) {
+      throw std::invalid_argument("Invalid size value for --" + key + ": " +
+                                  it->second);
+    }
+  }
+
+  bool get_bool(const std::string &key, bool default_value) const {
+    auto it = m_values.find(key);
+    if (it == m_values.end())
+      return default_value;
+    const std::string &v = it->second;
+    return v == "1" || v == "true" || v == "yes" || v == "on";
+  }
+
+  const std::vector<std::string> &positional() const { return m_positional; }
+
+  static std::size_t parse_size(const std::string &text) {
+    std::size_t consumed = 0;
+    unsigned long long value = std::stoull(text, &consumed);
+    std::string suffix = text.substr(consumed);
+    if (suffix.empty() || suffix == "B")
+      return value;
+    if (suffix == "K" || suffix == "KB")
+      return value * 1024ULL;
+    if (suffix == "M" || suffix == "MB")
+      return value * 1024ULL * 1024;
+    if (suffix == "G" || suffix == "GB")
+      return value * 1024ULL * 1024 * 1024;
+    throw std::invalid_argument("Unknown size suffix: " + suffix);
+  }
+
+private:
+  std::map<std::string, std::string> m_values;
+  std::vector<std::string> m_positional;
+};
+
+#endif // CLI_OPTIONS_HPP
@@ -0,0 +1,30 @@
+#ifndef COMPRESSION_HPP
+#define COMPRESSION_HPP
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace compression {
+
+// Block codecs for the optional compressed framing of the TCP protocol.
+// ZSTD is only available when built with `make WITH_ZSTD=1`.
+enum class Codec : uint8_t { NONE = 0, DEFLATE = 1, ZSTD = 2 };
+
+Codec codec_from_string(const std::string &name);
+std::string codec_to_string(Codec codec);
+bool codec_available(Codec codec);
+
+// Compresses [data, data + size) into out (overwritten). Returns false on
+// failure or if the codec was not compiled in.
+bool compress(Codec codec, const char *data, std::size_t size,
+              std::vector<char> &out);
+
+// Decompresses exactly raw_size bytes into out.
+bool decompress(Codec codec, const char *data, std::size_t size, char *out,
+                std::size_t raw_size);
+
+} // namespace compression
+
+#endif // COMPRESSION_HPP
@@ -16,6 +16,33 @@ const std::size_t TOTAL_FILE_SIZE = 10ULL * 1024 * 1024 * 1024; // 10 GB
 // const std::size_t TOTAL_FILE_SIZE = 100 * 1024 * 1024; // 100 MB for faster
 // testing
 const std::size_t CHUNK_SIZE = 64 * 1024; // 64 KB
+// Initial size of the per-connection receive buffer; one socket read can pull
+// in several pipelined frames. Grows only if a single frame does not fit.
+const std::size_t RECEIVE_BUFFER_SIZE = 4 * CHUNK_SIZE;
+// Largest chunk a client may use (--chunk-size, --sweep). Frames up to twice
+// this size are accepted to leave room for compression framing.
+const std::size_t MAX_CHUNK_SIZE = 16 * 1024 * 1024; // 16 MB
+const std::size_t MAX_FRAME_PAYLOAD_SIZE = 2 * MAX_CHUNK_SIZE;
+// Payload a client aims for per batch frame with --batch=auto; small chunks
+// get many entries per frame, large ones only a few.
+const std::size_t BATCH_TARGET_BYTES = 1024 * 1024; // 1 MB
+
+// Chunk-size sweep (--sweep): every power of two in [min, max], each point
+// sending SWEEP_BYTES_PER_POINT of the test file. The knee is the smallest
+// size within SWEEP_KNEE_TOLERANCE of the best throughput.
+const std::size_t SWEEP_MIN_CHUNK_SIZE = 1024; // 1 KB
+const std::size_t SWEEP_MAX_CHUNK_SIZE = MAX_CHUNK_SIZE;
+const std::size_t SWEEP_BYTES_PER_POINT = 256ULL * 1024 * 1024; // 256 MB
+const double SWEEP_KNEE_TOLERANCE = 0.05;
+
+// Adaptive in-flight window (--adaptive-window, adaptive_window.hpp). The
+// window starts at 1 and never exceeds --window-max; an epoch mean RTT more
+// than ADAPTIVE_WINDOW_RTT_TOLERANCE above the base RTT counts as queueing.
+const std::size_t ADAPTIVE_WINDOW_DEFAULT_MAX = 1024;
+const double ADAPTIVE_WINDOW_RTT_TOLERANCE = 1.0; // RTT twice the base
+const double ADAPTIVE_WINDOW_DECREASE_FACTOR = 0.7;
+const double ADAPTIVE_WINDOW_MIN_GAIN = 0.05; // Less is a plateau
+const std::size_t ADAPTIVE_WINDOW_MIN_EPOCH_SAMPLES = 16;
 
 // CSV Output Files
 const std::string RESULTS_DIR = "results"; // Subdirectory for CSV files
@@ -23,11 +50,34 @@ const std::string CPP_OVERALL_METRICS_FILE =
     RESULTS_DIR + "/cpp_overall_metrics.csv";
 const std::string CPP_CHUNK_RTT_METRICS_FILE =
     RESULTS_DIR + "/cpp_chunk_rtt_metrics.csv";
+const std::string CPP_SWEEP_METRICS_FILE =
+    RESULTS_DIR + "/cpp_chunk_size_sweep.csv";
+const std::string CPP_SOCKET_SWEEP_METRICS_FILE =
+    RESULTS_DIR + "/cpp_socket_profile_sweep.csv";
+const std::string CPP_SERVER_STATS_FILE = RESULTS_DIR + "/cpp_server_stats.csv";
+const std::string CPP_TRACE_FILE = RESULTS_DIR + "/cpp_trace_breakdown.csv";
+const std::string CPP_PROGRESS_FILE = RESULTS_DIR + "/cpp_progress.csv";
+const std::string CPP_ADAPTIVE_WINDOW_FILE =
+    RESULTS_DIR + "/cpp_adaptive_window.csv";
+const std::string CPP_SERVER_PROGRESS_FILE =
+    RESULTS_DIR + "/cpp_server_progress.csv";
 const std::string GO_OVERALL_METRICS_FILE =
     RESULTS_DIR + "/go_overall_metrics.csv"; // Placeholder for Go
 const std::string GO_CHUNK_RTT_METRICS_FILE =
     RESULTS_DIR + "/go_chunk_rtt_metrics.csv"; // Placeholder for Go
 
+// Server-side stage timing (server_stats.hpp): histograms cover 1 ns to
+// 60 s at 3 significant digits. --stats-interval=N on the server also prints
+// the stats every N seconds while requests are coming in.
+const long long SERVER_STATS_HISTOGRAM_MAX_NS = 60LL * 1000 * 1000 * 1000;
+const int SERVER_STATS_HISTOGRAM_DIGITS = 3;
+const int DEFAULT_SERVER_STATS_INTERVAL_S = 0; // 0: report per run only
+
+// Progress time series (progress.hpp): one row per interval, p99 over the
+// last DEFAULT_PROGRESS_WINDOW_INTERVALS rows.
+const int DEFAULT_PROGRESS_INTERVAL_MS = 1000; // 0: off
+const int DEFAULT_PROGRESS_WINDOW_INTERVALS = 5;
+
 // CPU/Memory Monitoring (Client-side, Linux specific)
 const bool ENABLE_CLIENT_RESOURCE_MONITORING = true; // Set to false to disable
 const unsigned int CPU_SAMPLING_INTERVAL_MS =
@@ -0,0 +1,113 @@
+#ifndef EVENT_TRACE_HPP
+#define EVENT_TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <string>
+
+// Hot-path event tracing (--event-trace=file.json): what every thread was
+// doing during a run. Each thread appends to its own fixed-size ring, with
+// no locks and no allocation; the rings are dumped in the Chrome trace JSON
+// format, which chrome://tracing and ui.perfetto.dev open directly. With
+// tracing off an event costs one relaxed atomic load. Event names and
+// categories must be string literals: only the pointer is kept.
+namespace event_trace {
+
+struct Event {
+  const char *name;
+  const char *category;
+  int64_t start_ns;    // steady_clock
+  int64_t duration_ns; // -1 for an instant event
+};
+
+// Per-thread ring capacity; the oldest events are overwritten past it.
+constexpr std::size_t RING_EVENTS = 1 << 16;
+
+namespace detail {
+extern std::atomic<bool> g_enabled;
+
+inline int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void append(const Event &event);
+} // namespace detail
+
+inline bool enabled() {
+  return detail::g_enabled.load(std::memory_order_relaxed);
+}
+
+// Starts recording; an empty path leaves tracing off.
+void start(const std::string &output_path);
+// Writes every ring to the start() file and clears them; recording goes on
+// (the server saves after each client run). Call it while the recording
+// threads are idle.
+bool save();
+// Stops recording and writes what was collected.
+bool stop();
+
+// Name of the calling thread in the trace ("thread-N" by default).
+void set_thread_name(const std::string &name);
+
+inline void instant(const char *name, const char *category) {
+  if (!enabled())
+    return;
+  detail::append(Event{name, category, detail::now_ns(), -1});
+}
+
+// An interval measured by the caller, for asynchronous operations that do
+// not fit in one block.
+inline void interval(const char *name, const char *category,
+                     std::chrono::steady_clock::time_point start,
+                     std::chrono::steady_clock::time_point end) {
+  if (!enabled())
+    return;
+  detail::append(Event{
+      name, category,
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          start.time_since_epoch())
+          .count(),
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+          .count()});
+}
+
+// An interval from construction to destruction.
+class Scope {
+public:
+  Scope(const char *name, const char *category)
+      : m_name(name), m_category(category),
+        m_start_ns(enabled() ? detail::now_ns() : 0) {}
+  ~Scope() {
+    if (m_start_ns == 0)
+      return;
+    detail::append(
+        Event{m_name, m_category, m_start_ns, detail::now_ns() - m_start_ns});
+  }
+
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+private:
+  const char *m_name;
+  const char *m_category;
+  int64_t m_start_ns;
+};
+
+} // namespace event_trace
+
+#define TCP_BENCH_TRACE_CONCAT_INNER(a, b) a##b
+#define TCP_BENCH_TRACE_CONCAT(a, b) TCP_BENCH_TRACE_CONCAT_INNER(a, b)
+
+// TCP_BENCH_TRACE_SCOPE("respond", "server"): an interval to the end of the
+// enclosing block.
+#define TCP_BENCH_TRACE_SCOPE(name, category)                                  \
+  ::event_trace::Scope TCP_BENCH_TRACE_CONCAT(tcp_bench_trace_scope_,         \
+                                              __LINE__)(name, category)
+#define TCP_BENCH_TRACE_INSTANT(name, category)                                \
+  ::event_trace::instant(name, category)
+
+#endif // EVENT_TRACE_HPP
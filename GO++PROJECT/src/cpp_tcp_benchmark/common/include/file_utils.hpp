@@ -5,7 +5,21 @@
 #include <string>
 #include <vector>
 
-void generate_test_file_if_not_exists(const std::string &filename,
-                                      std::size_t target_size);
+// How compressible the generated test file is: random (incompressible, the
+// original behaviour), text (log-like lines), zeros, or mixed (alternating
+// 32 KB blocks of random and text).
+enum class ContentProfile { RANDOM, TEXT, ZEROS, MIXED };
+
+ContentProfile content_profile_from_string(const std::string &name);
+std::string content_profile_to_string(ContentProfile profile);
+
+// Non-random profiles get a suffixed file name so files of the same size but
+// different content never get mistaken for each other.
+std::string test_file_name_for_profile(const std::string &base_name,
+                                       ContentProfile profile);
+
+void generate_test_file_if_not_exists(
+    const std::string &filename, std::size_t target_size,
+    ContentProfile profile = ContentProfile::RANDOM);
 
 #endif // FILE_UTILS_HPP
@@ -0,0 +1,106 @@
+#ifndef HANDLER_ALLOCATOR_HPP
+#define HANDLER_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace handler_alloc {
+
+// Recycling storage for the handler of one kind of operation (e.g. "the
+// socket read of this connection"). At most one such operation is pending at
+// a time, so a single slot is reused for every completion instead of going
+// through the heap; anything that does not fit falls back to operator new.
+class HandlerMemory {
+public:
+  HandlerMemory() = default;
+  HandlerMemory(const HandlerMemory &) = delete;
+  HandlerMemory &operator=(const HandlerMemory &) = delete;
+
+  void *allocate(std::size_t size) {
+    if (!m_in_use && size <= sizeof(m_storage)) {
+      m_in_use = true;
+      return &m_storage;
+    }
+    return ::operator new(size);
+  }
+
+  void deallocate(void *pointer) {
+    if (pointer == &m_storage) {
+      m_in_use = false;
+    } else {
+      ::operator delete(pointer);
+    }
+  }
+
+private:
+  // Large enough for Asio's read/write ops wrapping a composed async_write.
+  typename std::aligned_storage<1024>::type m_storage;
+  bool m_in_use = false;
+};
+
+// Minimal allocator over a HandlerMemory, picked up by Asio through
+// associated_allocator for every intermediate operation of the handler.
+template <typename T> class HandlerAllocator {
+public:
+  using value_type = T;
+
+  explicit HandlerAllocator(HandlerMemory &memory) : m_memory(&memory) {}
+
+  template <typename U>
+  HandlerAllocator(const HandlerAllocator<U> &other) noexcept
+      : m_memory(other.m_memory) {}
+
+  T *allocate(std::size_t n) const {
+    return static_cast<T *>(m_memory->allocate(sizeof(T) * n));
+  }
+
+  void deallocate(T *pointer, std::size_t /*n*/) const {
+    m_memory->deallocate(pointer);
+  }
+
+  bool operator==(const HandlerAllocator &other) const noexcept {
+    return m_memory == other.m_memory;
+  }
+  bool operator!=(const HandlerAllocator &other) const noexcept {
+    return m_memory != other.m_memory;
+  }
+
+private:
+  template <typename> friend class HandlerAllocator;
+  HandlerMemory *m_memory;
+};
+
+// Wraps a completion handler so that Asio allocates its operation state from
+// `memory`. The memory must outlive the operation, so it normally lives in
+// the same object the handler keeps alive.
+template <typename Handler> class CustomAllocHandler {
+public:
+  using allocator_type = HandlerAllocator<Handler>;
+
+  CustomAllocHandler(HandlerMemory &memory, Handler handler)
+      : m_memory(memory), m_handler(std::move(handler)) {}
+
+  allocator_type get_allocator() const noexcept {
+    return allocator_type(m_memory);
+  }
+
+  template <typename... Args> void operator()(Args &&...args) {
+    m_handler(std::forward<Args>(args)...);
+  }
+
+private:
+  HandlerMemory &m_memory;
+  Handler m_handler;
+};
+
+template <typename Handler>
+inline CustomAllocHandler<Handler>
+make_custom_alloc_handler(HandlerMemory &memory, Handler handler) {
+  return CustomAllocHandler<Handler>(memory, std::move(handler));
+}
+
+} // namespace handler_alloc
+
+#endif // HANDLER_ALLOCATOR_HPP
@@ -0,0 +1,51 @@
+#ifndef HDR_HISTOGRAM_HPP
+#define HDR_HISTOGRAM_HPP
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <vector>
+
+// Log-linear histogram in the style of HdrHistogram: values between lowest
+// and highest are kept to `significant_digits` decimal digits of relative
+// precision (3 digits = at most 0.1% error) in a fixed array of counters.
+// Recording is O(1) and never allocates, so it can sit on the hot path; a
+// run of any length costs the same memory. Values above highest are recorded
+// as highest and counted in overflow_count().
+class HdrHistogram {
+public:
+  HdrHistogram(int64_t lowest_trackable, int64_t highest_trackable,
+               int significant_digits);
+
+  void record(int64_t value);
+  void reset();
+
+  uint64_t total_count() const { return m_total_count; }
+  uint64_t overflow_count() const { return m_overflow_count; }
+  int64_t min() const { return m_total_count == 0 ? 0 : m_min_value; }
+  int64_t max() const { return m_max_value; }
+  double mean() const;
+  // Largest value not exceeded by `percentile` percent of the records
+  // (percentile in [0, 100]).
+  int64_t value_at_percentile(double percentile) const;
+
+private:
+  std::size_t counts_index_for(int64_t value) const;
+  int64_t value_from_index(std::size_t index) const;
+  int64_t highest_equivalent_value(int64_t value) const;
+
+  int64_t m_highest_trackable;
+  int m_unit_magnitude;
+  int m_sub_bucket_half_count_magnitude;
+  int64_t m_sub_bucket_count;
+  int64_t m_sub_bucket_half_count;
+  int64_t m_sub_bucket_mask;
+
+  std::vector<uint64_t> m_counts;
+  uint64_t m_total_count = 0;
+  uint64_t m_overflow_count = 0;
+  int64_t m_min_value = 0;
+  int64_t m_max_value = 0;
+  double m_sum = 0.0;
+};
+
+#endif // HDR_HISTOGRAM_HPP
@@ -0,0 +1,67 @@
+#ifndef LATENCY_TRACE_HPP
+#define LATENCY_TRACE_HPP
+
+#include "hdr_histogram.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <string>
+
+// Per-stage split of the chunk RTT (--trace). Frames carry monotonic
+// timestamps from both ends; client and server run on the same host in our
+// tests, so the steady_clock (CLOCK_MONOTONIC) readings of the two processes
+// are comparable. Across machines the network stages are meaningless.
+namespace latency_trace {
+
+// Nanoseconds of steady_clock; 0 means the stamp was never set.
+struct Stamps {
+  int64_t client_send_ns = 0;         // Client, right before the write
+  int64_t server_recv_ns = 0;         // Server, read that completed the frame
+  int64_t server_process_done_ns = 0; // Server, payload handled
+  int64_t server_send_ns = 0;         // Server, response handed to the socket
+};
+
+inline int64_t to_ns(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             t.time_since_epoch())
+      .count();
+}
+
+inline int64_t now_ns() { return to_ns(std::chrono::steady_clock::now()); }
+
+enum class Stage {
+  REQUEST_NETWORK,  // client_send -> server_recv
+  SERVER_PROCESS,   // server_recv -> server_process_done
+  SERVER_SEND,      // server_process_done -> server_send
+  RESPONSE_NETWORK, // server_send -> response read by the client
+  TOTAL             // client_send -> response read by the client
+};
+constexpr std::size_t STAGE_COUNT = 5;
+
+std::string stage_to_string(Stage stage);
+
+// Stage histograms built from the stamps of every traced chunk. Not thread
+// safe: the client records from its io_context thread.
+class Collector {
+public:
+  Collector();
+
+  // Incomplete stamps (a server without trace support) and negative stages
+  // are counted as rejected instead of recorded.
+  void record(const Stamps &stamps, int64_t client_recv_ns);
+
+  uint64_t samples() const { return m_samples; }
+  void print_summary() const;
+  bool save_csv(const std::string &filename) const;
+
+private:
+  std::array<HdrHistogram, STAGE_COUNT> m_stages_ns;
+  uint64_t m_samples = 0;
+  uint64_t m_rejected = 0;
+};
+
+} // namespace latency_trace
+
+#endif // LATENCY_TRACE_HPP
@@ -4,6 +4,7 @@
 #include <chrono>
 #include <cstddef> // For size_t
 #include <string>
+#include <utility>
 #include <vector>
 
 #ifdef __linux__
@@ -29,6 +30,9 @@ public:
 
   void start_chunk_rtt_timer();
   void stop_and_record_chunk_rtt(std::size_t chunk_size_bytes, bool verified);
+  // For pipelined clients that time each chunk themselves.
+  void record_chunk_rtt(std::size_t chunk_size_bytes,
+                        std::chrono::microseconds rtt, bool verified);
 
   void record_chunk_processed(
       std::size_t
@@ -36,6 +40,18 @@ public:
   void record_chunk_verified(
       bool success); // Legacy, might be replaced by RTT recording
 
+  // Results of a finished run (e.g. one point of a chunk-size sweep)
+  double throughput_mbps() const;
+  double avg_rtt_ms() const;
+  double percentile_rtt_ms(double percentile) const; // percentile in [0, 100]
+  std::size_t failed_chunks() const {
+    return m_processed_chunks_count - m_verified_chunks_count;
+  }
+
+  // Settings of the run (e.g. the socket profile) that are reported with the
+  // results, so CSV files from differently tuned runs stay distinguishable.
+  void set_run_parameter(const std::string &name, const std::string &value);
+
   void print_summary() const;
   void save_to_csv(const std::string &overall_metrics_file,
                    const std::string &chunk_rtt_file) const;
@@ -71,6 +87,7 @@ private:
       0; // Tracks how many chunks had RTT recorded
 
   std::vector<ChunkRTTInfo> m_chunk_rtt_data;
+  std::vector<std::pair<std::string, std::string>> m_run_parameters;
 
   // Client resource usage
   bool m_resource_monitoring_enabled;
@@ -0,0 +1,76 @@
+#ifndef PROGRESS_HPP
+#define PROGRESS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <string>
+
+// Run progress over time (--progress-interval-ms=N, once a second by default;
+// 0 turns it off). The hot path only bumps relaxed atomic counters: no
+// branches, locks or output per chunk. A background thread samples them once
+// per interval and prints, and appends to a CSV, one row of a time series:
+// the throughput of that interval, the requests in flight and the p99
+// latency over a sliding window of the last --progress-window intervals.
+// Warm-up, stalls and pauses show up there instead of being averaged into
+// the final summary. Idle intervals (nothing completed, nothing in flight)
+// are skipped. One set of counters per process, like the event trace.
+namespace progress {
+
+namespace detail {
+
+// Log-linear latency buckets in microseconds: 16 sub-buckets per power of
+// two (about 6% precision) up to about 2^40 us.
+constexpr int SUB_BUCKET_BITS = 4;
+constexpr std::size_t SUB_BUCKETS = std::size_t{1} << SUB_BUCKET_BITS;
+constexpr std::size_t LATENCY_BUCKETS = SUB_BUCKETS * 38;
+
+struct Counters {
+  std::atomic<uint64_t> sent{0};
+  std::atomic<uint64_t> completed{0};
+  std::atomic<uint64_t> bytes{0};
+  std::array<std::atomic<uint64_t>, LATENCY_BUCKETS> latency{};
+};
+extern Counters g_counters;
+
+inline std::size_t latency_bucket(int64_t latency_us) {
+  uint64_t v = latency_us > 0 ? static_cast<uint64_t>(latency_us) : 0;
+  if (v < SUB_BUCKETS)
+    return static_cast<std::size_t>(v);
+  const int exponent = 63 - __builtin_clzll(v);
+  const std::size_t index =
+      SUB_BUCKETS * static_cast<std::size_t>(exponent - SUB_BUCKET_BITS + 1) +
+      static_cast<std::size_t>((v >> (exponent - SUB_BUCKET_BITS)) &
+                               (SUB_BUCKETS - 1));
+  return index < LATENCY_BUCKETS ? index : LATENCY_BUCKETS - 1;
+}
+
+} // namespace detail
+
+// A request went out (or, on the server, came in). In flight is sent minus
+// completed; where on_sent() is never called it stays 0.
+inline void on_sent() {
+  detail::g_counters.sent.fetch_add(1, std::memory_order_relaxed);
+}
+
+// A request completed: payload_bytes of payload after latency_us (the RTT on
+// the client, the service time on the server).
+inline void on_completed(uint64_t payload_bytes, int64_t latency_us) {
+  detail::g_counters.completed.fetch_add(1, std::memory_order_relaxed);
+  detail::g_counters.bytes.fetch_add(payload_bytes, std::memory_order_relaxed);
+  detail::g_counters.latency[detail::latency_bucket(latency_us)].fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+// Starts the sampling thread; interval_ms <= 0 leaves it off. An empty
+// csv_filename only prints the series.
+void start(const std::string &label, int interval_ms, int window_intervals,
+           const std::string &csv_filename);
+// Takes a last sample for the tail of the run, stops the thread and closes
+// the CSV. Does nothing if start() did not start it.
+void stop();
+
+} // namespace progress
+
+#endif // PROGRESS_HPP
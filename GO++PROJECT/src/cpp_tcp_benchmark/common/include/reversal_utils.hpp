@@ -2,6 +2,7 @@
 #define REVERSAL_UTILS_HPP
 
 #include <algorithm> // For std::reverse
+#include <cstddef>
 #include <vector>
 
 namespace utils {
@@ -11,6 +12,11 @@ inline void reverse_vector_content(std::vector<char> &data) {
   std::reverse(data.begin(), data.end());
 }
 
+// Reverses a byte range in-place (e.g. a frame inside a receive buffer)
+inline void reverse_bytes(char *data, std::size_t size) {
+  std::reverse(data, data + size);
+}
+
 // Returns a new vector with reversed content
 inline std::vector<char>
 get_reversed_vector_content(const std::vector<char> &data) {
@@ -0,0 +1,98 @@
+#ifndef SERVER_STATS_HPP
+#define SERVER_STATS_HPP
+
+#include "hdr_histogram.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Server-side timing of every request, so a client RTT can be split into
+// time spent in the server and time spent on the network.
+namespace server_stats {
+
+// Stages of one request. QUEUE_WAIT runs from the read that completed the
+// frame to the start of its handling, so with pipelining it includes the
+// handling of the frames ahead of it.
+enum class Stage { QUEUE_WAIT, DESERIALIZE, REVERSE, SERIALIZE, WRITE };
+constexpr std::size_t STAGE_COUNT = 5;
+
+std::string stage_to_string(Stage stage);
+
+// Stage times of one request. lap(stage) charges the time since the previous
+// mark to `stage`, so handling code only marks where each stage ends.
+// Stages never lapped stay unmeasured.
+class RequestTiming {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  void start_at(Clock::time_point t) {
+    m_stage_ns.fill(-1);
+    m_started = m_last = t;
+  }
+  void lap(Stage stage) {
+    Clock::time_point now = Clock::now();
+    int64_t &slot = m_stage_ns[static_cast<std::size_t>(stage)];
+    slot = (slot < 0 ? 0 : slot) +
+           std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_last)
+               .count();
+    m_last = now;
+  }
+  // -1 when the stage was not measured.
+  int64_t stage_ns(Stage stage) const {
+    return m_stage_ns[static_cast<std::size_t>(stage)];
+  }
+  Clock::time_point started_at() const { return m_started; }
+
+private:
+  std::array<int64_t, STAGE_COUNT> m_stage_ns{{-1, -1, -1, -1, -1}};
+  Clock::time_point m_started;
+  Clock::time_point m_last;
+};
+
+// Stage histograms, the per-request service time (sum of the stages), bytes
+// in both directions and sessions of one server. Not thread safe: the server
+// records from its single io_context thread. When the last session closes
+// the report is printed and saved and the stats start over, so every client
+// run gets a report of its own.
+class Stats {
+public:
+  explicit Stats(std::string csv_filename);
+
+  void record(const RequestTiming &timing);
+  void add_bytes_in(uint64_t bytes) { m_bytes_in += bytes; }
+  void add_bytes_out(uint64_t bytes) { m_bytes_out += bytes; }
+
+  void session_opened();
+  void session_closed();
+  int active_sessions() const { return m_active_sessions; }
+
+  // Requests recorded since the last report() (periodic dumps skip idle
+  // intervals).
+  uint64_t requests_since_report() const {
+    return m_requests - m_requests_at_last_report;
+  }
+  void report(std::ostream &out);
+  bool save_csv(const std::string &filename) const;
+
+private:
+  void reset();
+
+  std::string m_csv_filename;
+  std::array<HdrHistogram, STAGE_COUNT> m_stages_ns;
+  HdrHistogram m_service_ns;
+  uint64_t m_requests = 0;
+  uint64_t m_requests_at_last_report = 0;
+  uint64_t m_bytes_in = 0;
+  uint64_t m_bytes_out = 0;
+  int m_active_sessions = 0;
+  uint64_t m_sessions_total = 0;
+  std::chrono::steady_clock::time_point m_since;
+};
+
+} // namespace server_stats
+
+#endif // SERVER_STATS_HPP
@@ -0,0 +1,68 @@
+#ifndef SOCKET_TUNING_HPP
+#define SOCKET_TUNING_HPP
+
+#include <string>
+#include <vector>
+
+class CliOptions;
+
+namespace socket_tuning {
+
+// Socket options that can be switched on per run (--socket-profile and the
+// individual overrides below) so their effect shows up in the results
+// instead of being guessed at. Zero/false leaves the kernel default.
+struct Profile {
+  std::string name = "default"; // Reported in the summary and CSV files
+  bool no_delay = false;         // TCP_NODELAY
+  int send_buffer_bytes = 0;     // SO_SNDBUF
+  int receive_buffer_bytes = 0;  // SO_RCVBUF
+  // TCP_QUICKACK is not sticky: the kernel drops back to delayed ACKs, so the
+  // sessions re-arm it after every read while this is set.
+  bool quick_ack = false;
+  int busy_poll_us = 0; // SO_BUSY_POLL; above net.core.busy_read needs CAP_NET_ADMIN
+
+  bool is_default() const;
+};
+
+// default, nodelay, quickack, buffers (4 MB each way), busypoll (50 us),
+// latency (nodelay + quickack + busypoll) and throughput (nodelay + buffers).
+// Throws std::invalid_argument for an unknown name.
+Profile preset(const std::string &name);
+
+// The profiles a --socket-sweep runs through: each option on its own, then
+// the combinations.
+std::vector<std::string> sweep_presets();
+
+// --socket-profile=<name>, then --nodelay, --quickack, --sndbuf=4M,
+// --rcvbuf=4M and --busy-poll=<us> on top of it. Any override renames the
+// profile to "custom".
+Profile from_options(const CliOptions &options);
+
+// e.g. "latency(nodelay=1 sndbuf=0 rcvbuf=0 quickack=1 busy_poll_us=50)"
+std::string to_string(const Profile &profile);
+
+// Applies every option of the profile to the socket. Failures (e.g.
+// SO_BUSY_POLL without privileges) are logged and skipped so the run goes
+// on. Returns the number of options applied.
+int apply(int fd, const Profile &profile, const std::string &log_prefix);
+
+// Re-enables TCP_QUICKACK after a read; a no-op where it does not exist.
+void rearm_quick_ack(int fd);
+
+// Opens an Asio socket for `endpoint` and applies the profile before
+// connect(), so the buffer sizes shape the window advertised in the
+// handshake. Returns false (with `ec` set) if the socket could not be opened.
+template <typename Socket, typename Endpoint, typename ErrorCode>
+bool open_tuned(Socket &socket, const Endpoint &endpoint,
+                const Profile &profile, const std::string &log_prefix,
+                ErrorCode &ec) {
+  socket.open(endpoint.protocol(), ec);
+  if (ec)
+    return false;
+  apply(socket.native_handle(), profile, log_prefix);
+  return true;
+}
+
+} // namespace socket_tuning
+
+#endif // SOCKET_TUNING_HPP
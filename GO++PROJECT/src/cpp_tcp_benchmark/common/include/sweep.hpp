@@ -0,0 +1,56 @@
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include <cstddef> // For size_t
+#include <string>
+#include <vector>
+
+namespace sweep {
+
+// One run of the chunk-size sweep (--sweep): the same client over a range of
+// chunk sizes, to see where per-message costs stop mattering.
+struct SweepPoint {
+  std::size_t chunk_size_bytes = 0;
+  double throughput_mbps = 0.0;
+  double avg_rtt_ms = 0.0;
+  double p99_rtt_ms = 0.0;
+  std::size_t failed_chunks = 0;
+  bool completed = false;
+};
+
+// Powers of two from min_bytes (rounded up) to max_bytes inclusive.
+std::vector<std::size_t> chunk_sizes(std::size_t min_bytes,
+                                     std::size_t max_bytes);
+
+// The knee of the curve: the smallest chunk size whose throughput is within
+// `tolerance` (e.g. 0.05) of the best completed point. Returns points.size()
+// if no point completed.
+std::size_t find_knee(const std::vector<SweepPoint> &points, double tolerance);
+
+void print_report(const std::string &protocol_name,
+                  const std::vector<SweepPoint> &points,
+                  std::size_t knee_index);
+
+void save_to_csv(const std::string &file_path,
+                 const std::string &protocol_name,
+                 const std::vector<SweepPoint> &points,
+                 std::size_t knee_index);
+
+// One run of a sweep over named settings (e.g. --socket-sweep) at a fixed
+// chunk size; the first point is the baseline the others are compared to.
+struct LabeledPoint {
+  std::string label;
+  SweepPoint result;
+};
+
+void print_labeled_report(const std::string &title,
+                          const std::string &protocol_name,
+                          const std::vector<LabeledPoint> &points);
+
+void save_labeled_csv(const std::string &file_path,
+                      const std::string &protocol_name,
+                      const std::vector<LabeledPoint> &points);
+
+} // namespace sweep
+
+#endif // SWEEP_HPP
@@ -6,8 +6,12 @@
 #include <boost/asio.hpp>
 #include <cstdint> // For uint32_t
 #include <cstring> // For memcpy
+#include <utility>
 #include <vector>
 
+#include "compression.hpp"
+#include "latency_trace.hpp"
+
 // It's good practice to ensure network byte order (Big Endian)
 // For portable code, prefer boost/asio/detail/socket_ops.hpp for htonl/ntohl
 // or implement manually if Boost version is too old or for no Boost dependency
@@ -23,21 +27,388 @@ namespace tcp_messaging {
 
 const std::size_t HEADER_SIZE = sizeof(uint32_t);
 
+// The top bit of the length header marks a compressed frame whose body is
+// [raw_size u32 (network order)][codec u8][compressed bytes]. Plain frames are
+// unchanged, so peers that never compress (e.g. the Go client) still work.
+const uint32_t COMPRESSED_FLAG = 0x80000000u;
+// The next bit marks a batch frame whose body is [count u32] followed by
+// `count` entries, each encoded like a frame: [header u32][body]. Entry
+// headers may carry COMPRESSED_FLAG but never BATCH_FLAG.
+const uint32_t BATCH_FLAG = 0x40000000u;
+// Workload flags (--mode), on a frame or a batch entry; echo requests carry
+// neither. ACK_FLAG asks for an ack instead of the reversed payload: an
+// ACK_BODY_SIZE body of [size u32][crc32 u32] (network order) for the
+// uncompressed payload. DOWNLOAD_FLAG marks a request whose body is
+// [size u32]; the reply body is [crc32 u32] followed by that many bytes of
+// the server's download file.
+const uint32_t ACK_FLAG = 0x20000000u;
+const uint32_t DOWNLOAD_FLAG = 0x10000000u;
+// --trace: the body starts with a TRACE_EXTENSION_SIZE extension of four u64
+// timestamps (network order, see latency_trace::Stamps), followed by the body
+// the other flags describe; the length covers both. Only whole frames carry
+// it, never batch entries, and servers answer a traced frame with a traced
+// frame.
+const uint32_t TRACE_FLAG = 0x08000000u;
+const uint32_t LENGTH_MASK = 0x07FFFFFFu;
+const std::size_t TRACE_EXTENSION_SIZE = 4 * sizeof(uint64_t);
+const std::size_t ACK_BODY_SIZE = 2 * sizeof(uint32_t);
+const std::size_t DOWNLOAD_REQUEST_SIZE = sizeof(uint32_t);
+const std::size_t DOWNLOAD_CHECKSUM_SIZE = sizeof(uint32_t);
+const std::size_t COMPRESSED_PREFIX_SIZE = sizeof(uint32_t) + 1;
+const std::size_t BATCH_COUNT_SIZE = sizeof(uint32_t);
+const std::size_t MAX_BATCH_ENTRIES = 1024;
+
+inline bool is_compressed(uint32_t header_value) {
+  return (header_value & COMPRESSED_FLAG) != 0;
+}
+
+inline bool is_batch(uint32_t header_value) {
+  return (header_value & BATCH_FLAG) != 0;
+}
+
+inline bool is_ack_request(uint32_t header_value) {
+  return (header_value & ACK_FLAG) != 0;
+}
+
+inline bool is_download_request(uint32_t header_value) {
+  return (header_value & DOWNLOAD_FLAG) != 0;
+}
+
+inline bool is_traced(uint32_t header_value) {
+  return (header_value & TRACE_FLAG) != 0;
+}
+
+// Upper bound for a batch frame body whose entries are at most
+// max_entry_length bytes each.
+inline std::size_t max_batch_frame_length(std::size_t max_entry_length) {
+  return std::min<std::size_t>(
+      LENGTH_MASK, TRACE_EXTENSION_SIZE + BATCH_COUNT_SIZE +
+                       MAX_BATCH_ENTRIES * (HEADER_SIZE + max_entry_length));
+}
+
+inline uint32_t frame_length(uint32_t header_value) {
+  return header_value & LENGTH_MASK;
+}
+
+// Builds a compressed frame body. Returns false (body untouched) if the codec
+// is unavailable or the data does not shrink, in which case the caller should
+// send a plain frame instead.
+inline bool encode_compressed_body(compression::Codec codec,
+                                   const std::vector<char> &raw,
+                                   std::vector<char> &body) {
+  std::vector<char> packed;
+  if (codec == compression::Codec::NONE ||
+      !compression::compress(codec, raw.data(), raw.size(), packed) ||
+      packed.size() + COMPRESSED_PREFIX_SIZE >= raw.size()) {
+    return false;
+  }
+  body.resize(COMPRESSED_PREFIX_SIZE + packed.size());
+  uint32_t raw_size_net = htonl(static_cast<uint32_t>(raw.size()));
+  std::memcpy(body.data(), &raw_size_net, sizeof(uint32_t));
+  body[sizeof(uint32_t)] = static_cast<char>(codec);
+  std::memcpy(body.data() + COMPRESSED_PREFIX_SIZE, packed.data(),
+              packed.size());
+  return true;
+}
+
+// Decodes a compressed frame body into raw. Returns the codec that was used
+// (so a server can answer in kind) via codec_out.
+inline bool decode_compressed_body(const char *body, std::size_t body_size,
+                                   std::vector<char> &raw,
+                                   compression::Codec &codec_out,
+                                   std::size_t max_raw_size) {
+  if (body_size < COMPRESSED_PREFIX_SIZE)
+    return false;
+  uint32_t raw_size_net;
+  std::memcpy(&raw_size_net, body, sizeof(uint32_t));
+  uint32_t raw_size = ntohl(raw_size_net);
+  if (raw_size > max_raw_size)
+    return false;
+  codec_out = static_cast<compression::Codec>(body[sizeof(uint32_t)]);
+  raw.resize(raw_size);
+  return compression::decompress(codec_out, body + COMPRESSED_PREFIX_SIZE,
+                                 body_size - COMPRESSED_PREFIX_SIZE, raw.data(),
+                                 raw_size);
+}
+
+// Fixed two-element buffer sequence for a header + payload write; no heap
+// allocation per message (an empty payload is simply a zero-length buffer).
+using FrameBuffers = std::array<boost::asio::const_buffer, 2>;
+
 // Prepares a message with a 4-byte length_prefix header (network byte order)
-inline std::vector<boost::asio::const_buffer>
-prepare_message(const std::vector<char> &payload,
-                std::array<char, HEADER_SIZE> &header_buffer) {
-  uint32_t payload_size_net = htonl(static_cast<uint32_t>(payload.size()));
+inline FrameBuffers prepare_message(const char *payload,
+                                    std::size_t payload_size,
+                                    std::array<char, HEADER_SIZE> &header_buffer,
+                                    uint32_t header_flags = 0) {
+  uint32_t payload_size_net =
+      htonl(static_cast<uint32_t>(payload_size) | header_flags);
   std::memcpy(header_buffer.data(), &payload_size_net, HEADER_SIZE);
+  return FrameBuffers{boost::asio::buffer(header_buffer.data(), HEADER_SIZE),
+                      boost::asio::buffer(payload, payload_size)};
+}
+
+inline FrameBuffers prepare_message(const std::vector<char> &payload,
+                                    std::array<char, HEADER_SIZE> &header_buffer,
+                                    uint32_t header_flags = 0) {
+  return prepare_message(payload.data(), payload.size(), header_buffer,
+                         header_flags);
+}
+
+// Helper to parse header (assumes network byte order)
+inline uint32_t parse_header(const char *data) {
+  uint32_t msg_len_net;
+  std::memcpy(&msg_len_net, data, HEADER_SIZE);
+  return ntohl(msg_len_net);
+}
+
+// Stores a u32 in network byte order (the inverse of parse_header).
+inline void write_u32(char *out, uint32_t value) {
+  uint32_t value_net = htonl(value);
+  std::memcpy(out, &value_net, sizeof(uint32_t));
+}
+
+// A complete frame inside a FrameReader's buffer. `data` stays valid (and may
+// be modified in place, e.g. reversed) until the frame is consumed or the
+// reader is asked to read more.
+struct Frame {
+  uint32_t header_value; // Raw header, including flags
+  char *data;
+  std::size_t length;
+};
+
+// Takes the trace extension off a traced frame: `frame` is narrowed to the
+// body after it and loses TRACE_FLAG. Consume the frame as the reader handed
+// it out, not the narrowed copy. False if the frame is too short.
+inline bool strip_trace(Frame &frame, latency_trace::Stamps &stamps) {
+  if (frame.length < TRACE_EXTENSION_SIZE)
+    return false;
+  int64_t *fields[] = {&stamps.client_send_ns, &stamps.server_recv_ns,
+                       &stamps.server_process_done_ns, &stamps.server_send_ns};
+  for (std::size_t i = 0; i < 4; ++i) {
+    uint64_t high = parse_header(frame.data + i * sizeof(uint64_t));
+    uint64_t low = parse_header(frame.data + i * sizeof(uint64_t) + 4);
+    *fields[i] = static_cast<int64_t>((high << 32) | low);
+  }
+  frame.header_value &= ~TRACE_FLAG;
+  frame.header_value -= TRACE_EXTENSION_SIZE;
+  frame.data += TRACE_EXTENSION_SIZE;
+  frame.length -= TRACE_EXTENSION_SIZE;
+  return true;
+}
+
+// Header plus trace extension of an outgoing traced frame.
+using TracePrefix = std::array<char, HEADER_SIZE + TRACE_EXTENSION_SIZE>;
 
-  std::vector<boost::asio::const_buffer> buffers;
-  buffers.push_back(boost::asio::buffer(header_buffer.data(), HEADER_SIZE));
-  if (!payload.empty()) { // Only add payload buffer if payload is not empty
-    buffers.push_back(boost::asio::buffer(payload.data(), payload.size()));
+inline void write_trace_stamps(TracePrefix &prefix,
+                               const latency_trace::Stamps &stamps) {
+  const int64_t fields[] = {stamps.client_send_ns, stamps.server_recv_ns,
+                            stamps.server_process_done_ns,
+                            stamps.server_send_ns};
+  char *out = prefix.data() + HEADER_SIZE;
+  for (std::size_t i = 0; i < 4; ++i) {
+    uint64_t value = static_cast<uint64_t>(fields[i]);
+    write_u32(out + i * sizeof(uint64_t), static_cast<uint32_t>(value >> 32));
+    write_u32(out + i * sizeof(uint64_t) + 4, static_cast<uint32_t>(value));
   }
-  return buffers;
 }
 
+// Turns an already framed gather list ([header][body...], as built by
+// prepare_message or BatchWriter) into a traced frame: the header moves into
+// `prefix`, which gains TRACE_FLAG and the extension, and leads the list.
+// The stamps can still be rewritten in `prefix` until the write starts.
+inline void add_trace(std::vector<boost::asio::const_buffer> &buffers,
+                      TracePrefix &prefix,
+                      const latency_trace::Stamps &stamps) {
+  const char *first = static_cast<const char *>(buffers.front().data());
+  uint32_t header_value = parse_header(first);
+  write_u32(prefix.data(), (header_value | TRACE_FLAG) + TRACE_EXTENSION_SIZE);
+  write_trace_stamps(prefix, stamps);
+  if (buffers.front().size() == HEADER_SIZE) {
+    buffers.front() = boost::asio::buffer(prefix);
+  } else {
+    buffers.front() += HEADER_SIZE;
+    buffers.insert(buffers.begin(), boost::asio::buffer(prefix));
+  }
+}
+
+// Splits the body of a batch frame into its entries (pointing into the
+// frame). `entries` is reused across calls. Returns false if the batch is
+// malformed: bad count, nested batch, oversize entry or trailing bytes.
+inline bool parse_batch(const Frame &frame, std::vector<Frame> &entries,
+                        std::size_t max_entry_length) {
+  entries.clear();
+  if (frame.length < BATCH_COUNT_SIZE)
+    return false;
+  uint32_t count = parse_header(frame.data);
+  if (count == 0 || count > MAX_BATCH_ENTRIES)
+    return false;
+  std::size_t offset = BATCH_COUNT_SIZE;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (frame.length - offset < HEADER_SIZE)
+      return false;
+    uint32_t header_value = parse_header(frame.data + offset);
+    std::size_t length = frame_length(header_value);
+    offset += HEADER_SIZE;
+    if (is_batch(header_value) || length > max_entry_length ||
+        frame.length - offset < length)
+      return false;
+    entries.push_back(Frame{header_value, frame.data + offset, length});
+    offset += length;
+  }
+  return offset == frame.length;
+}
+
+// Non-owning view of a gather list. Composed writes keep a copy of the buffer
+// sequence they are given, so passing this instead of the std::vector itself
+// keeps every write free of heap allocations. The vector must not change
+// until the write completes.
+class BufferSpan {
+public:
+  using value_type = boost::asio::const_buffer;
+  using const_iterator = const boost::asio::const_buffer *;
+
+  explicit BufferSpan(const std::vector<boost::asio::const_buffer> &buffers)
+      : m_begin(buffers.data()), m_end(buffers.data() + buffers.size()) {}
+
+  const_iterator begin() const { return m_begin; }
+  const_iterator end() const { return m_end; }
+
+private:
+  const_iterator m_begin;
+  const_iterator m_end;
+};
+
+// Gathers several payloads into one batch frame that goes out in a single
+// write. Headers live in one reused buffer and the payloads are referenced,
+// not copied, so they must stay alive until the write completes.
+class BatchWriter {
+public:
+  BatchWriter() { clear(); }
+
+  void clear() {
+    m_headers.resize(2 * HEADER_SIZE); // Frame header + entry count
+    m_payloads.clear();
+    m_body_length = BATCH_COUNT_SIZE;
+  }
+
+  void add(const char *data, std::size_t size, uint32_t entry_flags = 0) {
+    uint32_t header_net = htonl(static_cast<uint32_t>(size) | entry_flags);
+    const char *header_bytes = reinterpret_cast<const char *>(&header_net);
+    m_headers.insert(m_headers.end(), header_bytes, header_bytes + HEADER_SIZE);
+    m_payloads.emplace_back(data, size);
+    m_body_length += HEADER_SIZE + size;
+  }
+
+  std::size_t entries() const { return m_payloads.size(); }
+  std::size_t wire_size() const { return HEADER_SIZE + m_body_length; }
+
+  // Finalizes the frame and entry-count headers and returns the gather list.
+  const std::vector<boost::asio::const_buffer> &buffers() {
+    uint32_t frame_header_net =
+        htonl(static_cast<uint32_t>(m_body_length) | BATCH_FLAG);
+    uint32_t count_net = htonl(static_cast<uint32_t>(m_payloads.size()));
+    std::memcpy(m_headers.data(), &frame_header_net, HEADER_SIZE);
+    std::memcpy(m_headers.data() + HEADER_SIZE, &count_net, BATCH_COUNT_SIZE);
+
+    m_buffers.clear();
+    m_buffers.push_back(boost::asio::buffer(m_headers.data(), 2 * HEADER_SIZE));
+    for (std::size_t i = 0; i < m_payloads.size(); ++i) {
+      m_buffers.push_back(boost::asio::buffer(
+          m_headers.data() + (2 + i) * HEADER_SIZE, HEADER_SIZE));
+      if (m_payloads[i].second > 0) {
+        m_buffers.push_back(
+            boost::asio::buffer(m_payloads[i].first, m_payloads[i].second));
+      }
+    }
+    return m_buffers;
+  }
+
+private:
+  std::vector<char> m_headers;
+  std::vector<std::pair<const char *, std::size_t>> m_payloads;
+  std::vector<boost::asio::const_buffer> m_buffers;
+  std::size_t m_body_length = BATCH_COUNT_SIZE;
+};
+
+// Receive side of the framing: pulls as much as the socket has into one
+// buffer with a single read_some and hands out every complete frame it
+// contains, so pipelined responses cost one syscall instead of two per frame.
+// Frames must be contiguous, so instead of wrapping around, the unread tail is
+// moved to the front when the free space at the end runs short; the buffer
+// only grows when a single frame does not fit.
+class FrameReader {
+public:
+  enum class Status { NEED_MORE, FRAME_READY, FRAME_TOO_LARGE };
+
+  FrameReader(std::size_t capacity, std::size_t max_frame_length)
+      : m_buffer(capacity), m_max_frame_length(max_frame_length) {}
+
+  // Looks at the buffered bytes; on FRAME_READY fills `frame`.
+  Status peek(Frame &frame) {
+    std::size_t buffered = m_write_pos - m_read_pos;
+    if (buffered < HEADER_SIZE)
+      return Status::NEED_MORE;
+    uint32_t header_value = parse_header(m_buffer.data() + m_read_pos);
+    std::size_t length = frame_length(header_value);
+    if (length > m_max_frame_length)
+      return Status::FRAME_TOO_LARGE;
+    if (buffered < HEADER_SIZE + length)
+      return Status::NEED_MORE;
+    frame.header_value = header_value;
+    frame.data = m_buffer.data() + m_read_pos + HEADER_SIZE;
+    frame.length = length;
+    return Status::FRAME_READY;
+  }
+
+  void consume(const Frame &frame) {
+    m_read_pos += HEADER_SIZE + frame.length;
+    if (m_read_pos == m_write_pos) {
+      m_read_pos = m_write_pos = 0;
+    }
+  }
+
+  // Free space for the next read_some; at least enough to complete the
+  // pending frame. The caller issues the read itself so that its handler (and
+  // whatever allocator is associated with it) reaches the socket unwrapped.
+  boost::asio::mutable_buffer prepare() {
+    make_room();
+    return boost::asio::buffer(m_buffer.data() + m_write_pos,
+                               m_buffer.size() - m_write_pos);
+  }
+
+  // Marks `bytes_read` bytes of the prepared space as received.
+  void commit(std::size_t bytes_read) { m_write_pos += bytes_read; }
+
+  std::size_t buffered_bytes() const { return m_write_pos - m_read_pos; }
+
+private:
+  // Ensures the next read can at least complete the pending frame.
+  void make_room() {
+    std::size_t buffered = m_write_pos - m_read_pos;
+    std::size_t needed = HEADER_SIZE;
+    if (buffered >= HEADER_SIZE) {
+      needed += frame_length(parse_header(m_buffer.data() + m_read_pos));
+    }
+    std::size_t missing = needed > buffered ? needed - buffered : 0;
+    std::size_t free_tail = m_buffer.size() - m_write_pos;
+    if (free_tail > 0 && free_tail >= missing)
+      return;
+    if (m_read_pos > 0) {
+      std::memmove(m_buffer.data(), m_buffer.data() + m_read_pos, buffered);
+      m_read_pos = 0;
+      m_write_pos = buffered;
+    }
+    if (m_buffer.size() < needed) {
+      m_buffer.resize(needed);
+    }
+  }
+
+  std::vector<char> m_buffer;
+  std::size_t m_max_frame_length;
+  std::size_t m_read_pos = 0;
+  std::size_t m_write_pos = 0;
+};
+
 // Helper to read header
 template <typename AsyncReadStream, typename Handler>
 void async_read_header(AsyncReadStream &socket,
@@ -55,12 +426,9 @@ void async_read_header(AsyncReadStream &socket,
   );
 }
 
-// Helper to parse header (assumes network byte order)
 inline uint32_t
 parse_header(const std::array<char, HEADER_SIZE> &header_buffer) {
-  uint32_t msg_len_net;
-  std::memcpy(&msg_len_net, header_buffer.data(), HEADER_SIZE);
-  return ntohl(msg_len_net);
+  return parse_header(header_buffer.data());
 }
 
 } // namespace tcp_messaging
@@ -0,0 +1,51 @@
+#ifndef WORKLOAD_HPP
+#define WORKLOAD_HPP
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace workload {
+
+// What a run measures (--mode). ROUND_TRIP ("echo") is the original
+// behaviour: the chunk goes to the server and comes back reversed, so the
+// throughput mixes both directions with the reversal. (Not ECHO, which
+// <termios.h> defines as a macro.) UPLOAD sends chunks and gets back only an
+// ack with their size and checksum; DOWNLOAD sends small requests and gets
+// chunks of the server's --download-file back.
+enum class Mode { ROUND_TRIP, UPLOAD, DOWNLOAD };
+
+// Throws std::invalid_argument for an unknown name.
+Mode mode_from_string(const std::string &name);
+std::string mode_to_string(Mode mode);
+
+// CRC32 (zlib) of a payload, used in upload acks and download replies.
+uint32_t checksum(const char *data, std::size_t size);
+
+// Server side of DOWNLOAD: hands out the file in the sizes the client asks
+// for. The file is read in a loop, so any number of bytes can be served
+// whatever its size. Opened on first use.
+class DownloadSource {
+public:
+  explicit DownloadSource(std::string filename);
+
+  // Fills `out` with the next `size` bytes. Returns false if the file cannot
+  // be opened or is empty.
+  bool read(std::size_t size, char *out);
+
+  const std::string &filename() const { return m_filename; }
+
+private:
+  bool open();
+
+  std::string m_filename;
+  std::ifstream m_file;
+  std::size_t m_file_size = 0;
+  bool m_open_failed = false;
+};
+
+} // namespace workload
+
+#endif // WORKLOAD_HPP
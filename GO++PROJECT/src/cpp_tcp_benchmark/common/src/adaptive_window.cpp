@@ -0,0 +1,120 @@
+#include "adaptive_window.hpp"
+
+#include <algorithm> // For std::clamp, std::max, std::min
+#include <cmath>     // For std::floor
+#include <fstream>
+#include <iomanip> // For std::setprecision
+#include <iostream>
+#include <sstream>
+
+namespace adaptive_window {
+
+Controller::Controller(const Options &options)
+    : m_options(options), m_started_at(std::chrono::steady_clock::now()),
+      m_epoch_started_at(m_started_at) {
+  m_options.min_window = std::max<std::size_t>(1, m_options.min_window);
+  m_options.max_window = std::max(m_options.min_window, m_options.max_window);
+  m_window = std::clamp(m_options.initial_window, m_options.min_window,
+                        m_options.max_window);
+  m_lowest_window = m_highest_window = m_window;
+}
+
+bool Controller::on_completion(uint64_t payload_bytes, int64_t rtt_us) {
+  m_epoch_samples++;
+  m_epoch_bytes += payload_bytes;
+  m_epoch_rtt_sum_us += static_cast<double>(std::max<int64_t>(rtt_us, 0));
+  if (m_epoch_samples <
+      std::max<uint64_t>(m_window, m_options.min_epoch_samples))
+    return false;
+
+  auto now = std::chrono::steady_clock::now();
+  double epoch_s =
+      std::chrono::duration<double>(now - m_epoch_started_at).count();
+  Sample sample;
+  sample.elapsed_s = std::chrono::duration<double>(now - m_started_at).count();
+  sample.window_before = m_window;
+  sample.throughput_mbps =
+      epoch_s > 0.0 ? static_cast<double>(m_epoch_bytes) * 8.0 / 1e6 / epoch_s
+                    : 0.0;
+  sample.mean_rtt_us = m_epoch_rtt_sum_us / static_cast<double>(m_epoch_samples);
+  if (m_base_rtt_us == 0.0 || sample.mean_rtt_us < m_base_rtt_us)
+    m_base_rtt_us = sample.mean_rtt_us;
+  sample.base_rtt_us = m_base_rtt_us;
+
+  bool queueing =
+      sample.mean_rtt_us > m_base_rtt_us * (1.0 + m_options.rtt_tolerance);
+  bool gained = sample.throughput_mbps >
+                m_last_throughput_mbps * (1.0 + m_options.min_gain);
+  std::size_t shrunk = std::max(
+      m_options.min_window,
+      static_cast<std::size_t>(std::floor(m_window * m_options.decrease_factor)));
+  std::size_t next = m_window;
+  if (m_slow_start) {
+    if (queueing && !gained) {
+      m_slow_start = false;
+      next = shrunk;
+    } else if (!gained) {
+      m_slow_start = false; // A plateau without queueing: go on by one
+    } else {
+      next = std::min(m_options.max_window, m_window * 2);
+    }
+  } else if (queueing && !gained) {
+    next = shrunk;
+  } else {
+    next = std::min(m_options.max_window, m_window + 1);
+  }
+  sample.window_after = next;
+  sample.action = next > m_window ? "grow" : next < m_window ? "shrink" : "hold";
+  m_history.push_back(sample);
+
+  m_last_throughput_mbps = sample.throughput_mbps;
+  m_epoch_started_at = now;
+  m_epoch_samples = 0;
+  m_epoch_bytes = 0;
+  m_epoch_rtt_sum_us = 0.0;
+  m_lowest_window = std::min(m_lowest_window, next);
+  m_highest_window = std::max(m_highest_window, next);
+  bool changed = next != m_window;
+  m_window = next;
+  return changed;
+}
+
+std::string Controller::describe() const {
+  std::size_t grows = 0;
+  std::size_t shrinks = 0;
+  for (const Sample &s : m_history) {
+    if (s.window_after > s.window_before)
+      grows++;
+    if (s.window_after < s.window_before)
+      shrinks++;
+  }
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1) << "window " << m_window
+      << " (range " << m_lowest_window << ".." << m_highest_window << ", max "
+      << m_options.max_window << "), " << m_history.size() << " epochs: "
+      << grows << " grow, " << shrinks << " shrink, "
+      << m_history.size() - grows - shrinks << " hold, base RTT "
+      << m_base_rtt_us << " us";
+  return out.str();
+}
+
+bool Controller::save_csv(const std::string &filename) const {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    std::cerr << "Adaptive window: Could not open " << filename
+              << " for writing." << std::endl;
+    return false;
+  }
+  file << "Elapsed_s,Window_Before,Window_After,Action,Throughput_Mbps,"
+          "Mean_RTT_us,Base_RTT_us\n";
+  file << std::fixed << std::setprecision(3);
+  for (const Sample &s : m_history) {
+    file << s.elapsed_s << "," << s.window_before << "," << s.window_after
+         << "," << s.action << "," << s.throughput_mbps << ","
+         << s.mean_rtt_us << "," << s.base_rtt_us << "\n";
+  }
+  std::cout << "Adaptive window: History saved to " << filename << std::endl;
+  return true;
+}
+
+} // namespace adaptive_window
@@ -0,0 +1,56 @@
+#include "alloc_counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace alloc_counter {
+
+#ifdef TCP_BENCH_COUNT_ALLOCS
+
+namespace {
+std::atomic<std::uint64_t> g_allocations{0};
+} // namespace
+
+bool enabled() { return true; }
+std::uint64_t allocations() {
+  return g_allocations.load(std::memory_order_relaxed);
+}
+
+void *counted_allocate(std::size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+#else
+
+bool enabled() { return false; }
+std::uint64_t allocations() { return 0; }
+
+#endif // TCP_BENCH_COUNT_ALLOCS
+
+} // namespace alloc_counter
+
+#ifdef TCP_BENCH_COUNT_ALLOCS
+
+// Aligned and nothrow forms funnel into these in libstdc++, except the
+// over-aligned ones, which nothing in the benchmark uses.
+void *operator new(std::size_t size) {
+  return alloc_counter::counted_allocate(size);
+}
+void *operator new[](std::size_t size) {
+  return alloc_counter::counted_allocate(size);
+}
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+#endif // TCP_BENCH_COUNT_ALLOCS
@@ -35,18 +35,26 @@ ChunkReader::~ChunkReader() {
 }
 
 std::vector<char> ChunkReader::read_next_chunk() {
+  std::vector<char> buffer;
+  read_next_chunk(buffer);
+  return buffer;
+}
+
+bool ChunkReader::read_next_chunk(std::vector<char> &buffer) {
   if (m_eof || !m_file_stream.is_open() || m_file_stream.eof()) {
     m_eof = true;
-    return {};
+    buffer.clear();
+    return false;
   }
 
-  std::vector<char> buffer(m_chunk_size);
+  buffer.resize(m_chunk_size);
   m_file_stream.read(buffer.data(), static_cast<std::streamsize>(m_chunk_size));
   std::streamsize bytes_read = m_file_stream.gcount();
 
   if (bytes_read == 0) { // No bytes read, could be EOF or error
     m_eof = true;        // Assume EOF if no bytes read
-    return {};
+    buffer.clear();
+    return false;
   }
 
   if (bytes_read < static_cast<std::streamsize>(m_chunk_size)) {
@@ -56,7 +64,7 @@ std::vector<char> ChunkReader::read_next_chunk() {
   buffer.resize(
       static_cast<std::size_t>(bytes_read)); // Resize to actual bytes read
   m_chunks_read_count++;
-  return buffer;
+  return true;
 }
 
 bool ChunkReader::eof() const { return m_eof; }
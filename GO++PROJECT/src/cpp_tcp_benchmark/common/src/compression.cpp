@@ -0,0 +1,105 @@
+#include "compression.hpp"
+#include <cstring>
+#include <stdexcept>
+
+#include <zlib.h>
+#ifdef TCP_BENCH_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace compression {
+
+Codec codec_from_string(const std::string &name) {
+  if (name == "none")
+    return Codec::NONE;
+  if (name == "deflate" || name == "zlib")
+    return Codec::DEFLATE;
+  if (name == "zstd")
+    return Codec::ZSTD;
+  throw std::invalid_argument("Unknown codec: " + name +
+                              " (expected none|deflate|zstd)");
+}
+
+std::string codec_to_string(Codec codec) {
+  switch (codec) {
+  case Codec::NONE:
+    return "none";
+  case Codec::DEFLATE:
+    return "deflate";
+  case Codec::ZSTD:
+    return "zstd";
+  }
+  return "unknown";
+}
+
+bool codec_available(Codec codec) {
+#ifdef TCP_BENCH_WITH_ZSTD
+  (void)codec;
+  return true;
+#else
+  return codec != Codec::ZSTD;
+#endif
+}
+
+bool compress(Codec codec, const char *data, std::size_t size,
+              std::vector<char> &out) {
+  switch (codec) {
+  case Codec::NONE:
+    out.assign(data, data + size);
+    return true;
+  case Codec::DEFLATE: {
+    uLongf bound = compressBound(static_cast<uLong>(size));
+    out.resize(bound);
+    if (compress2(reinterpret_cast<Bytef *>(out.data()), &bound,
+                  reinterpret_cast<const Bytef *>(data),
+                  static_cast<uLong>(size), Z_BEST_SPEED) != Z_OK)
+      return false;
+    out.resize(bound);
+    return true;
+  }
+  case Codec::ZSTD:
+#ifdef TCP_BENCH_WITH_ZSTD
+  {
+    out.resize(ZSTD_compressBound(size));
+    std::size_t written = ZSTD_compress(out.data(), out.size(), data, size, 1);
+    if (ZSTD_isError(written))
+      return false;
+    out.resize(written);
+    return true;
+  }
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+bool decompress(Codec codec, const char *data, std::size_t size, char *out,
+                std::size_t raw_size) {
+  switch (codec) {
+  case Codec::NONE:
+    if (size != raw_size)
+      return false;
+    std::memcpy(out, data, size);
+    return true;
+  case Codec::DEFLATE: {
+    uLongf dest_len = static_cast<uLongf>(raw_size);
+    int rc = uncompress(reinterpret_cast<Bytef *>(out), &dest_len,
+                        reinterpret_cast<const Bytef *>(data),
+                        static_cast<uLong>(size));
+    return rc == Z_OK && dest_len == raw_size;
+  }
+  case Codec::ZSTD:
+#ifdef TCP_BENCH_WITH_ZSTD
+  {
+    std::size_t got = ZSTD_decompress(out, raw_size, data, size);
+    return !ZSTD_isError(got) && got == raw_size;
+  }
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+} // namespace compression
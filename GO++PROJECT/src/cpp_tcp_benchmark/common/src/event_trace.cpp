@@ -0,0 +1,163 @@
+#include "event_trace.hpp"
+
+#include <algorithm> // For std::min
+#include <fstream>
+#include <iomanip> // For std::setprecision
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <unistd.h> // For getpid
+
+namespace event_trace {
+
+namespace detail {
+std::atomic<bool> g_enabled{false};
+} // namespace detail
+
+namespace {
+
+// One thread's ring. Only the owner writes; `written` is published with
+// release, so a dump sees every event up to the last published one.
+struct ThreadRing {
+  std::vector<Event> events = std::vector<Event>(RING_EVENTS);
+  std::atomic<uint64_t> written{0};
+  std::string name; // Guarded by registry_mutex
+  uint32_t tid = 0;
+};
+
+// Rings outlive their threads: a thread may exit before the dump.
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<ThreadRing>> registry;
+std::string output_path;
+int64_t trace_start_ns = 0;
+
+thread_local ThreadRing *t_ring = nullptr;
+
+ThreadRing &thread_ring() {
+  if (t_ring)
+    return *t_ring;
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  registry.push_back(std::make_unique<ThreadRing>());
+  t_ring = registry.back().get();
+  t_ring->tid = static_cast<uint32_t>(registry.size());
+  t_ring->name = "thread-" + std::to_string(t_ring->tid);
+  return *t_ring;
+}
+
+void write_json_string(std::ostream &out, const std::string &text) {
+  out << '"';
+  for (char c : text) {
+    if (c == '"' || c == '\\')
+      out << '\\';
+    if (static_cast<unsigned char>(c) >= 0x20)
+      out << c;
+  }
+  out << '"';
+}
+
+// Under registry_mutex: writes the rings to output_path and clears them.
+bool save_locked() {
+  std::ofstream file(output_path);
+  if (!file.is_open()) {
+    std::cerr << "Event trace: Could not open " << output_path
+              << " for writing." << std::endl;
+    return false;
+  }
+  const int pid = static_cast<int>(::getpid());
+  file << std::fixed << std::setprecision(3);
+  file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  bool first = true;
+  std::size_t total_events = 0;
+  uint64_t dropped_events = 0;
+  for (const auto &ring : registry) {
+    file << (first ? "" : ",\n")
+         << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid
+         << ",\"tid\":" << ring->tid << ",\"args\":{\"name\":";
+    write_json_string(file, ring->name);
+    file << "}}";
+    first = false;
+
+    const uint64_t written = ring->written.load(std::memory_order_acquire);
+    const uint64_t count = std::min<uint64_t>(written, RING_EVENTS);
+    dropped_events += written - count;
+    for (uint64_t i = written - count; i < written; ++i) {
+      const Event &event = ring->events[i % RING_EVENTS];
+      // Chrome trace timestamps are microseconds, here relative to start()
+      file << ",\n{\"name\":";
+      write_json_string(file, event.name);
+      file << ",\"cat\":";
+      write_json_string(file, event.category);
+      file << ",\"pid\":" << pid << ",\"tid\":" << ring->tid
+           << ",\"ts\":" << (event.start_ns - trace_start_ns) / 1000.0;
+      if (event.duration_ns < 0) {
+        file << ",\"ph\":\"i\",\"s\":\"t\"}";
+      } else {
+        file << ",\"ph\":\"X\",\"dur\":" << event.duration_ns / 1000.0 << "}";
+      }
+    }
+    total_events += count;
+  }
+  file << "\n]}\n";
+  std::cout << "Event trace: Saved " << total_events << " events from "
+            << registry.size() << " threads to " << output_path;
+  if (dropped_events > 0) {
+    std::cout << " (" << dropped_events
+              << " oldest events overwritten in the per-thread rings)";
+  }
+  std::cout << std::endl;
+  for (auto &ring : registry)
+    ring->written.store(0, std::memory_order_relaxed);
+  trace_start_ns = detail::now_ns();
+  return true;
+}
+
+} // namespace
+
+namespace detail {
+
+void append(const Event &event) {
+  ThreadRing &ring = thread_ring();
+  const uint64_t index = ring.written.load(std::memory_order_relaxed);
+  ring.events[index % RING_EVENTS] = event;
+  ring.written.store(index + 1, std::memory_order_release);
+}
+
+} // namespace detail
+
+void start(const std::string &path) {
+  if (path.empty())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    output_path = path;
+    for (auto &ring : registry)
+      ring->written.store(0, std::memory_order_relaxed);
+    trace_start_ns = detail::now_ns();
+  }
+  detail::g_enabled.store(true, std::memory_order_release);
+  std::cout << "Event trace: Enabled, output: " << path << std::endl;
+}
+
+void set_thread_name(const std::string &name) {
+  ThreadRing &ring = thread_ring();
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  ring.name = name;
+}
+
+bool stop() {
+  if (!detail::g_enabled.exchange(false))
+    return false;
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  return save_locked();
+}
+
+bool save() {
+  if (!enabled())
+    return false;
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  return save_locked();
+}
+
+} // namespace event_trace
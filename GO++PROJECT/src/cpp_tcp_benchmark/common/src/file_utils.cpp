@@ -1,14 +1,113 @@
 #include "file_utils.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <filesystem> // Requires C++17. Link with -lstdc++fs or -lboost_filesystem if compiler needs it
 #include <fstream>
 #include <iostream>
 #include <random>
+#include <stdexcept>
 #include <vector>
 
 namespace fs = std::filesystem;
 
+ContentProfile content_profile_from_string(const std::string &name) {
+  if (name == "random")
+    return ContentProfile::RANDOM;
+  if (name == "text")
+    return ContentProfile::TEXT;
+  if (name == "zeros")
+    return ContentProfile::ZEROS;
+  if (name == "mixed")
+    return ContentProfile::MIXED;
+  throw std::invalid_argument("Unknown content profile: " + name +
+                              " (expected random|text|zeros|mixed)");
+}
+
+std::string content_profile_to_string(ContentProfile profile) {
+  switch (profile) {
+  case ContentProfile::RANDOM:
+    return "random";
+  case ContentProfile::TEXT:
+    return "text";
+  case ContentProfile::ZEROS:
+    return "zeros";
+  case ContentProfile::MIXED:
+    return "mixed";
+  }
+  return "unknown";
+}
+
+std::string test_file_name_for_profile(const std::string &base_name,
+                                       ContentProfile profile) {
+  if (profile == ContentProfile::RANDOM)
+    return base_name;
+  std::string suffix = "_" + content_profile_to_string(profile);
+  std::size_t dot_pos = base_name.rfind('.');
+  if (dot_pos == std::string::npos)
+    return base_name + suffix;
+  return base_name.substr(0, dot_pos) + suffix + base_name.substr(dot_pos);
+}
+
+namespace {
+
+// Log-like lines: repetitive structure with varying numbers (~4-5x deflate).
+void fill_text(char *dst, std::size_t size, std::mt19937 &gen) {
+  static const char *const levels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN"};
+  static const char *const actions[] = {"processed request", "cache hit",
+                                        "cache miss", "flushed batch"};
+  std::uniform_int_distribution<int> small(0, 63);
+  std::uniform_int_distribution<int> big(0, 999999);
+  std::size_t pos = 0;
+  char line[160];
+  while (pos < size) {
+    int len = std::snprintf(
+        line, sizeof(line),
+        "2024-05-%02d 12:%02d:%02d %s worker-%d %s id=%d status=OK "
+        "latency_us=%d\n",
+        1 + small(gen) % 28, small(gen) % 60, small(gen) % 60,
+        levels[small(gen) % 5], small(gen), actions[small(gen) % 4], big(gen),
+        big(gen) % 5000);
+    std::size_t to_copy = std::min(static_cast<std::size_t>(len), size - pos);
+    std::memcpy(dst + pos, line, to_copy);
+    pos += to_copy;
+  }
+}
+
+void fill_buffer(char *dst, std::size_t size, ContentProfile profile,
+                 std::mt19937 &gen) {
+  std::uniform_int_distribution<> distrib(0, 255);
+  switch (profile) {
+  case ContentProfile::RANDOM:
+    for (std::size_t i = 0; i < size; ++i) {
+      dst[i] = static_cast<char>(distrib(gen));
+    }
+    break;
+  case ContentProfile::TEXT:
+    fill_text(dst, size, gen);
+    break;
+  case ContentProfile::ZEROS:
+    std::memset(dst, 0, size);
+    break;
+  case ContentProfile::MIXED: {
+    const std::size_t block = 32 * 1024;
+    for (std::size_t off = 0; off < size; off += block) {
+      std::size_t len = std::min(block, size - off);
+      fill_buffer(dst + off, len,
+                  (off / block) % 2 == 0 ? ContentProfile::RANDOM
+                                         : ContentProfile::TEXT,
+                  gen);
+    }
+    break;
+  }
+  }
+}
+
+} // namespace
+
 void generate_test_file_if_not_exists(const std::string &filename,
-                                      std::size_t target_size) {
+                                      std::size_t target_size,
+                                      ContentProfile profile) {
   bool regenerate = false;
   if (!fs::exists(filename)) {
     std::cout << "Test file '" << filename << "' does not exist. Generating..."
@@ -40,7 +139,6 @@ void generate_test_file_if_not_exists(const std::string &filename,
 
     std::random_device rd;
     std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(0, 255);
 
     std::size_t buffer_size = 1 * 1024 * 1024; // 1MB buffer
     std::vector<char> buffer(buffer_size);
@@ -53,9 +151,7 @@ void generate_test_file_if_not_exists(const std::string &filename,
     while (bytes_written < target_size) {
       std::size_t bytes_to_write =
           std::min(buffer_size, target_size - bytes_written);
-      for (std::size_t i = 0; i < bytes_to_write; ++i) {
-        buffer[i] = static_cast<char>(distrib(gen));
-      }
+      fill_buffer(buffer.data(), bytes_to_write, profile, gen);
       outfile.write(buffer.data(), bytes_to_write);
       if (!outfile) {
         std::cerr << "Error writing to file " << filename << ". Disk full?"
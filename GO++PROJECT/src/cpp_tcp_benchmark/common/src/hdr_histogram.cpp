@@ -0,0 +1,137 @@
+#include "hdr_histogram.hpp"
+
+#include <algorithm> // For std::min, std::max, std::fill
+#include <cmath>     // For std::ceil, std::log2, std::pow
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+int floor_log2(uint64_t value) { return 63 - __builtin_clzll(value); }
+
+} // namespace
+
+HdrHistogram::HdrHistogram(int64_t lowest_trackable, int64_t highest_trackable,
+                           int significant_digits)
+    : m_highest_trackable(highest_trackable) {
+  if (lowest_trackable < 1 || highest_trackable < 2 * lowest_trackable ||
+      significant_digits < 1 || significant_digits > 5) {
+    throw std::invalid_argument("HdrHistogram: invalid range or precision");
+  }
+  // Linear sub-buckets per bucket needed for a step of at most
+  // 10^-digits of the value.
+  const double largest_single_unit = 2.0 * std::pow(10.0, significant_digits);
+  const int sub_bucket_count_magnitude =
+      static_cast<int>(std::ceil(std::log2(largest_single_unit)));
+  m_sub_bucket_half_count_magnitude =
+      std::max(sub_bucket_count_magnitude, 1) - 1;
+  m_unit_magnitude = floor_log2(static_cast<uint64_t>(lowest_trackable));
+  m_sub_bucket_count = int64_t{1} << (m_sub_bucket_half_count_magnitude + 1);
+  m_sub_bucket_half_count = m_sub_bucket_count / 2;
+  m_sub_bucket_mask = (m_sub_bucket_count - 1) << m_unit_magnitude;
+
+  // Every further bucket covers twice the range with the same sub-buckets.
+  int64_t smallest_untrackable = m_sub_bucket_count << m_unit_magnitude;
+  int bucket_count = 1;
+  while (smallest_untrackable <= highest_trackable) {
+    if (smallest_untrackable > std::numeric_limits<int64_t>::max() / 2) {
+      ++bucket_count;
+      break;
+    }
+    smallest_untrackable <<= 1;
+    ++bucket_count;
+  }
+  m_counts.assign(
+      static_cast<std::size_t>((bucket_count + 1) * m_sub_bucket_half_count),
+      0);
+}
+
+std::size_t HdrHistogram::counts_index_for(int64_t value) const {
+  const int bucket_index =
+      floor_log2(static_cast<uint64_t>(value | m_sub_bucket_mask)) -
+      m_unit_magnitude - m_sub_bucket_half_count_magnitude;
+  const int64_t sub_bucket_index =
+      value >> (bucket_index + m_unit_magnitude);
+  return static_cast<std::size_t>(
+      (static_cast<int64_t>(bucket_index + 1)
+       << m_sub_bucket_half_count_magnitude) +
+      (sub_bucket_index - m_sub_bucket_half_count));
+}
+
+int64_t HdrHistogram::value_from_index(std::size_t index) const {
+  int bucket_index =
+      static_cast<int>(index >> m_sub_bucket_half_count_magnitude) - 1;
+  int64_t sub_bucket_index =
+      static_cast<int64_t>(index & (m_sub_bucket_half_count - 1)) +
+      m_sub_bucket_half_count;
+  if (bucket_index < 0) {
+    sub_bucket_index -= m_sub_bucket_half_count;
+    bucket_index = 0;
+  }
+  return sub_bucket_index << (bucket_index + m_unit_magnitude);
+}
+
+// Upper edge of the sub-bucket holding `value`, so percentiles are never
+// reported low.
+int64_t HdrHistogram::highest_equivalent_value(int64_t value) const {
+  const int bucket_index =
+      floor_log2(static_cast<uint64_t>(value | m_sub_bucket_mask)) -
+      m_unit_magnitude - m_sub_bucket_half_count_magnitude;
+  const int64_t sub_bucket_index =
+      value >> (bucket_index + m_unit_magnitude);
+  const int adjusted_bucket = sub_bucket_index >= m_sub_bucket_count
+                                  ? bucket_index + 1
+                                  : bucket_index;
+  const int64_t range = int64_t{1} << (m_unit_magnitude + adjusted_bucket);
+  const int64_t lowest_equivalent = sub_bucket_index
+                                    << (bucket_index + m_unit_magnitude);
+  return lowest_equivalent + range - 1;
+}
+
+void HdrHistogram::record(int64_t value) {
+  if (value < 0)
+    value = 0;
+  if (value > m_highest_trackable) {
+    value = m_highest_trackable;
+    ++m_overflow_count;
+  }
+  ++m_counts[counts_index_for(value)];
+  if (m_total_count == 0 || value < m_min_value)
+    m_min_value = value;
+  if (value > m_max_value)
+    m_max_value = value;
+  ++m_total_count;
+  m_sum += static_cast<double>(value);
+}
+
+void HdrHistogram::reset() {
+  std::fill(m_counts.begin(), m_counts.end(), 0);
+  m_total_count = 0;
+  m_overflow_count = 0;
+  m_min_value = 0;
+  m_max_value = 0;
+  m_sum = 0.0;
+}
+
+double HdrHistogram::mean() const {
+  return m_total_count == 0 ? 0.0
+                            : m_sum / static_cast<double>(m_total_count);
+}
+
+int64_t HdrHistogram::value_at_percentile(double percentile) const {
+  if (m_total_count == 0)
+    return 0;
+  percentile = std::min(std::max(percentile, 0.0), 100.0);
+  const uint64_t count_at_percentile = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(
+             percentile / 100.0 * static_cast<double>(m_total_count))));
+  uint64_t running = 0;
+  for (std::size_t i = 0; i < m_counts.size(); ++i) {
+    running += m_counts[i];
+    if (running >= count_at_percentile) {
+      return std::min(highest_equivalent_value(value_from_index(i)),
+                      m_max_value);
+    }
+  }
+  return m_max_value;
+}
@@ -0,0 +1,121 @@
+#include "latency_trace.hpp"
+
+#include "config.hpp"
+
+#include <algorithm> // For std::any_of, std::max
+#include <fstream>
+#include <iomanip> // For std::setprecision, std::setw
+#include <iostream>
+
+namespace latency_trace {
+
+namespace {
+
+HdrHistogram make_stage_histogram() {
+  return HdrHistogram(1, config::SERVER_STATS_HISTOGRAM_MAX_NS,
+                      config::SERVER_STATS_HISTOGRAM_DIGITS);
+}
+
+double ns_to_us(double ns) { return ns / 1000.0; }
+
+} // namespace
+
+std::string stage_to_string(Stage stage) {
+  switch (stage) {
+  case Stage::REQUEST_NETWORK:
+    return "request_network";
+  case Stage::SERVER_PROCESS:
+    return "server_process";
+  case Stage::SERVER_SEND:
+    return "server_send";
+  case Stage::RESPONSE_NETWORK:
+    return "response_network";
+  case Stage::TOTAL:
+    return "total";
+  }
+  return "unknown";
+}
+
+Collector::Collector()
+    : m_stages_ns{make_stage_histogram(), make_stage_histogram(),
+                  make_stage_histogram(), make_stage_histogram(),
+                  make_stage_histogram()} {}
+
+void Collector::record(const Stamps &stamps, int64_t client_recv_ns) {
+  const std::array<int64_t, STAGE_COUNT> stage_ns = {
+      stamps.server_recv_ns - stamps.client_send_ns,
+      stamps.server_process_done_ns - stamps.server_recv_ns,
+      stamps.server_send_ns - stamps.server_process_done_ns,
+      client_recv_ns - stamps.server_send_ns,
+      client_recv_ns - stamps.client_send_ns};
+  const bool complete = stamps.client_send_ns != 0 &&
+                        stamps.server_recv_ns != 0 &&
+                        stamps.server_process_done_ns != 0 &&
+                        stamps.server_send_ns != 0;
+  if (!complete || std::any_of(stage_ns.begin(), stage_ns.end(),
+                               [](int64_t ns) { return ns < 0; })) {
+    m_rejected++;
+    return;
+  }
+  for (std::size_t i = 0; i < STAGE_COUNT; ++i) {
+    m_stages_ns[i].record(std::max<int64_t>(stage_ns[i], 1));
+  }
+  m_samples++;
+}
+
+void Collector::print_summary() const {
+  std::cout << "\n--- CPP_TCP Latency Trace Breakdown ---" << std::endl;
+  std::cout << "Traced chunks: " << m_samples << ", rejected: " << m_rejected
+            << std::endl;
+  if (m_samples == 0) {
+    std::cout << "No complete traces (does the server support TRACE_FLAG?)"
+              << std::endl;
+    return;
+  }
+  const double total_mean =
+      m_stages_ns[static_cast<std::size_t>(Stage::TOTAL)].mean();
+  auto flags = std::cout.flags();
+  std::cout << std::fixed << std::setprecision(2);
+  for (std::size_t i = 0; i < STAGE_COUNT; ++i) {
+    const HdrHistogram &h = m_stages_ns[i];
+    std::cout << "  " << std::left << std::setw(18)
+              << stage_to_string(static_cast<Stage>(i)) << std::right
+              << " mean " << ns_to_us(h.mean()) << " us, p50 "
+              << ns_to_us(static_cast<double>(h.value_at_percentile(50.0)))
+              << " us, p99 "
+              << ns_to_us(static_cast<double>(h.value_at_percentile(99.0)))
+              << " us, max " << ns_to_us(static_cast<double>(h.max()))
+              << " us";
+    if (static_cast<Stage>(i) != Stage::TOTAL && total_mean > 0) {
+      std::cout << " (" << h.mean() * 100.0 / total_mean << "% of RTT)";
+    }
+    std::cout << std::endl;
+  }
+  std::cout.flags(flags);
+}
+
+bool Collector::save_csv(const std::string &filename) const {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    std::cerr << "TCP Client: Could not open " << filename
+              << " for writing." << std::endl;
+    return false;
+  }
+  file << "Stage,Samples,Mean_us,P50_us,P90_us,P99_us,P99_9_us,Max_us,"
+          "Rejected\n";
+  file << std::fixed << std::setprecision(3);
+  for (std::size_t i = 0; i < STAGE_COUNT; ++i) {
+    const HdrHistogram &h = m_stages_ns[i];
+    file << stage_to_string(static_cast<Stage>(i)) << "," << h.total_count()
+         << "," << ns_to_us(h.mean()) << ","
+         << ns_to_us(static_cast<double>(h.value_at_percentile(50.0))) << ","
+         << ns_to_us(static_cast<double>(h.value_at_percentile(90.0))) << ","
+         << ns_to_us(static_cast<double>(h.value_at_percentile(99.0))) << ","
+         << ns_to_us(static_cast<double>(h.value_at_percentile(99.9))) << ","
+         << ns_to_us(static_cast<double>(h.max())) << "," << m_rejected
+         << "\n";
+  }
+  return true;
+}
+
+} // namespace latency_trace
@@ -52,9 +52,14 @@ void MetricsAggregator::stop_and_record_chunk_rtt(std::size_t chunk_size_bytes,
   auto rtt_end_time = std::chrono::steady_clock::now();
   auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
       rtt_end_time - m_current_chunk_rtt_start_time);
+  record_chunk_rtt(chunk_size_bytes, duration, verified);
+}
 
+void MetricsAggregator::record_chunk_rtt(std::size_t chunk_size_bytes,
+                                         std::chrono::microseconds rtt,
+                                         bool verified) {
   m_chunk_rtt_data.push_back(
-      {m_processed_chunks_count + 1, duration, chunk_size_bytes, verified});
+      {m_processed_chunks_count + 1, rtt, chunk_size_bytes, verified});
   m_processed_chunks_count++; // Increment after adding to keep index 1-based
   m_total_bytes_processed += chunk_size_bytes;
   if (verified) {
@@ -163,9 +168,64 @@ void MetricsAggregator::stop_resource_monitoring() { /* Do nothing */ }
 long MetricsAggregator::get_peak_memory_kb() const { return -1; }
 #endif
 
+double MetricsAggregator::throughput_mbps() const {
+  if (m_timer_running ||
+      m_start_time == std::chrono::steady_clock::time_point()) {
+    return 0.0;
+  }
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      m_end_time - m_start_time);
+  double duration_sec = duration.count() / 1000.0;
+  return duration_sec > 0 ? (static_cast<double>(m_total_bytes_processed) * 8) /
+                                (duration_sec * 1024 * 1024)
+                          : 0.0;
+}
+
+double MetricsAggregator::avg_rtt_ms() const {
+  if (m_chunk_rtt_data.empty())
+    return 0.0;
+  auto sum_rtt = std::accumulate(
+      m_chunk_rtt_data.begin(), m_chunk_rtt_data.end(),
+      std::chrono::microseconds(0),
+      [](std::chrono::microseconds sum, const ChunkRTTInfo &item) {
+        return sum + item.rtt;
+      });
+  return static_cast<double>(sum_rtt.count()) / m_chunk_rtt_data.size() /
+         1000.0;
+}
+
+double MetricsAggregator::percentile_rtt_ms(double percentile) const {
+  if (m_chunk_rtt_data.empty())
+    return 0.0;
+  std::vector<std::chrono::microseconds> rtts;
+  rtts.reserve(m_chunk_rtt_data.size());
+  for (const auto &item : m_chunk_rtt_data) {
+    rtts.push_back(item.rtt);
+  }
+  std::size_t rank =
+      static_cast<std::size_t>(percentile / 100.0 * (rtts.size() - 1) + 0.5);
+  std::nth_element(rtts.begin(), rtts.begin() + rank, rtts.end());
+  return static_cast<double>(rtts[rank].count()) / 1000.0;
+}
+
+void MetricsAggregator::set_run_parameter(const std::string &name,
+                                          const std::string &value) {
+  for (auto &parameter : m_run_parameters) {
+    if (parameter.first == name) {
+      parameter.second = value;
+      return;
+    }
+  }
+  m_run_parameters.emplace_back(name, value);
+}
+
 void MetricsAggregator::print_summary() const {
   std::cout << "\n--- " << m_protocol_name << " Benchmark Summary ---"
             << std::endl;
+  for (const auto &parameter : m_run_parameters) {
+    std::cout << "Param " << parameter.first << ": " << parameter.second
+              << std::endl;
+  }
   if (!m_timer_running &&
       m_start_time != std::chrono::steady_clock::time_point()) {
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -270,7 +330,8 @@ void MetricsAggregator::save_to_csv(
 
   overall_file
       << "Protocol,TotalTime_s,TotalBytesProcessed,Throughput_Mbps,TotalChunks,"
-         "VerifiedChunks,ClientAvgCPU_percent,ClientPeakMemory_KB\n";
+         "VerifiedChunks,ClientAvgCPU_percent,ClientPeakMemory_KB,"
+         "RunParameters\n";
   if (!m_timer_running &&
       m_start_time != std::chrono::steady_clock::time_point()) {
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -287,7 +348,13 @@ void MetricsAggregator::save_to_csv(
                  << std::fixed << std::setprecision(6) << throughput_mbps << ","
                  << m_processed_chunks_count << "," << m_verified_chunks_count
                  << "," << std::fixed << std::setprecision(2)
-                 << m_avg_cpu_usage_percent << "," << m_peak_memory_kb << "\n";
+                 << m_avg_cpu_usage_percent << "," << m_peak_memory_kb << ",\"";
+    // name=value pairs separated by ';', quoted because values contain spaces
+    for (std::size_t i = 0; i < m_run_parameters.size(); ++i) {
+      overall_file << (i ? ";" : "") << m_run_parameters[i].first << "="
+                   << m_run_parameters[i].second;
+    }
+    overall_file << "\"\n";
   }
   overall_file.close();
   std::cout << "Overall metrics saved to " << overall_metrics_file_path
@@ -0,0 +1,216 @@
+#include "progress.hpp"
+
+#include <algorithm> // For std::max, std::min
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip> // For std::setprecision
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace progress {
+
+namespace detail {
+Counters g_counters;
+} // namespace detail
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using LatencySnapshot = std::array<uint64_t, detail::LATENCY_BUCKETS>;
+
+int64_t bucket_upper_us(std::size_t index) {
+  if (index < detail::SUB_BUCKETS)
+    return static_cast<int64_t>(index);
+  const int exponent = static_cast<int>(index / detail::SUB_BUCKETS) +
+                       detail::SUB_BUCKET_BITS - 1;
+  const int64_t sub_bucket = static_cast<int64_t>(index % detail::SUB_BUCKETS);
+  const int64_t step = int64_t{1} << (exponent - detail::SUB_BUCKET_BITS);
+  return (static_cast<int64_t>(detail::SUB_BUCKETS) + sub_bucket) * step +
+         step - 1;
+}
+
+void snapshot_latency(LatencySnapshot &out) {
+  for (std::size_t i = 0; i < detail::LATENCY_BUCKETS; ++i)
+    out[i] = detail::g_counters.latency[i].load(std::memory_order_relaxed);
+}
+
+// State of the sampling thread; stop() touches it only after the join.
+class Sampler {
+public:
+  Sampler(std::string label, int interval_ms, int window_intervals,
+          const std::string &csv_filename)
+      : m_label(std::move(label)), m_csv_filename(csv_filename),
+        m_interval_ms(interval_ms),
+        m_window(static_cast<std::size_t>(std::max(window_intervals, 1)) + 1),
+        m_window_at(m_window.size()) {
+    m_started_at = m_last_sample_at = m_window_at[0] = Clock::now();
+    m_last_completed =
+        detail::g_counters.completed.load(std::memory_order_relaxed);
+    m_last_bytes = detail::g_counters.bytes.load(std::memory_order_relaxed);
+    snapshot_latency(m_window[0]);
+    if (!m_csv_filename.empty()) {
+      m_csv.open(m_csv_filename);
+      if (m_csv.is_open()) {
+        m_csv << "Elapsed_s,Completed,Throughput_Mbps,Completed_per_s,"
+                 "In_Flight,Window_s,Window_Samples,Window_P50_ms,"
+                 "Window_P99_ms\n";
+      } else {
+        std::cerr << "Progress: Could not open " << m_csv_filename
+                  << " for writing." << std::endl;
+      }
+    }
+    m_thread = std::thread(&Sampler::loop, this);
+  }
+
+  ~Sampler() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stopping = true;
+    }
+    m_stop_cv.notify_all();
+    m_thread.join();
+    sample(Clock::now()); // The tail of the run is shorter than an interval
+    if (m_csv.is_open()) {
+      m_csv.close();
+      std::cout << "Progress: Time series saved to " << m_csv_filename
+                << std::endl;
+    }
+  }
+
+private:
+  void loop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto next_sample_at = m_started_at + std::chrono::milliseconds(m_interval_ms);
+    while (!m_stop_cv.wait_until(lock, next_sample_at,
+                                 [this] { return m_stopping; })) {
+      lock.unlock();
+      sample(Clock::now());
+      lock.lock();
+      next_sample_at += std::chrono::milliseconds(m_interval_ms);
+    }
+  }
+
+  void sample(Clock::time_point now) {
+    const double interval_s =
+        std::chrono::duration<double>(now - m_last_sample_at).count();
+    if (interval_s <= 0.0)
+      return;
+    // Completed is read before sent, so in flight can never go negative
+    const uint64_t completed =
+        detail::g_counters.completed.load(std::memory_order_relaxed);
+    const uint64_t bytes =
+        detail::g_counters.bytes.load(std::memory_order_relaxed);
+    const uint64_t sent =
+        detail::g_counters.sent.load(std::memory_order_relaxed);
+    const uint64_t in_flight = sent > completed ? sent - completed : 0;
+    if (completed == m_last_completed && in_flight == 0) {
+      // Idle (a server between runs); a stall with requests in flight is
+      // still reported
+      m_last_sample_at = now;
+      return;
+    }
+
+    m_samples_taken++;
+    LatencySnapshot &current = m_window[m_samples_taken % m_window.size()];
+    snapshot_latency(current);
+    m_window_at[m_samples_taken % m_window.size()] = now;
+    // Oldest snapshot of the window; early in the run the window is shorter
+    const std::size_t window_samples =
+        std::min(m_samples_taken, m_window.size() - 1);
+    const std::size_t oldest_index =
+        (m_samples_taken - window_samples) % m_window.size();
+    const LatencySnapshot &oldest = m_window[oldest_index];
+    uint64_t window_count = 0;
+    for (std::size_t i = 0; i < detail::LATENCY_BUCKETS; ++i)
+      window_count += current[i] - oldest[i];
+    auto window_percentile_ms = [&](double percentile) {
+      if (window_count == 0)
+        return 0.0;
+      const uint64_t rank = std::max<uint64_t>(
+          1, static_cast<uint64_t>(percentile / 100.0 *
+                                       static_cast<double>(window_count) +
+                                   0.5));
+      uint64_t seen = 0;
+      for (std::size_t i = 0; i < detail::LATENCY_BUCKETS; ++i) {
+        seen += current[i] - oldest[i];
+        if (seen >= rank)
+          return static_cast<double>(bucket_upper_us(i)) / 1000.0;
+      }
+      return static_cast<double>(
+                 bucket_upper_us(detail::LATENCY_BUCKETS - 1)) /
+             1000.0;
+    };
+
+    const double elapsed_s =
+        std::chrono::duration<double>(now - m_started_at).count();
+    const double throughput_mbps = static_cast<double>(bytes - m_last_bytes) *
+                                   8.0 / (1024.0 * 1024.0) / interval_s;
+    const double completed_per_s =
+        static_cast<double>(completed - m_last_completed) / interval_s;
+    const double window_s =
+        std::chrono::duration<double>(now - m_window_at[oldest_index]).count();
+    const double p50_ms = window_percentile_ms(50.0);
+    const double p99_ms = window_percentile_ms(99.0);
+    m_last_sample_at = now;
+    m_last_completed = completed;
+    m_last_bytes = bytes;
+
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2) << "Progress: " << m_label << " "
+         << elapsed_s << " s: " << throughput_mbps << " Mbps, "
+         << completed_per_s << " req/s, in flight " << in_flight << ", p99 "
+         << std::setprecision(3) << p99_ms << " ms (last "
+         << std::setprecision(1) << window_s << " s, " << window_count
+         << " req), completed " << completed << "\n";
+    std::cout << line.str() << std::flush;
+
+    if (m_csv.is_open()) {
+      // Written right away: a server never ends a run, the file grows until
+      // it is stopped
+      m_csv << std::fixed << std::setprecision(3) << elapsed_s << ","
+            << completed << "," << throughput_mbps << "," << completed_per_s
+            << "," << in_flight << "," << window_s << "," << window_count
+            << "," << p50_ms << "," << p99_ms << "\n"
+            << std::flush;
+    }
+  }
+
+  std::string m_label;
+  std::string m_csv_filename;
+  int m_interval_ms;
+  Clock::time_point m_started_at;
+  Clock::time_point m_last_sample_at;
+  uint64_t m_last_completed = 0;
+  uint64_t m_last_bytes = 0;
+  // Cumulative latency buckets of the latest samples, used as a ring
+  std::vector<LatencySnapshot> m_window;
+  std::vector<Clock::time_point> m_window_at; // When each was taken
+  std::size_t m_samples_taken = 0;
+  std::ofstream m_csv;
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_stop_cv;
+  bool m_stopping = false; // Guarded by m_mutex
+};
+
+std::unique_ptr<Sampler> g_sampler;
+
+} // namespace
+
+void start(const std::string &label, int interval_ms, int window_intervals,
+           const std::string &csv_filename) {
+  if (interval_ms <= 0 || g_sampler)
+    return;
+  g_sampler = std::make_unique<Sampler>(label, interval_ms, window_intervals,
+                                        csv_filename);
+}
+
+void stop() { g_sampler.reset(); }
+
+} // namespace progress
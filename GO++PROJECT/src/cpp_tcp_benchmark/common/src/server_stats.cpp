@@ -0,0 +1,153 @@
+#include "server_stats.hpp"
+
+#include "config.hpp"
+#include "event_trace.hpp"
+
+#include <algorithm> // For std::max
+#include <fstream>
+#include <iomanip> // For std::setprecision, std::setw
+#include <iostream>
+
+namespace server_stats {
+
+namespace {
+
+HdrHistogram make_stage_histogram() {
+  return HdrHistogram(1, config::SERVER_STATS_HISTOGRAM_MAX_NS,
+                      config::SERVER_STATS_HISTOGRAM_DIGITS);
+}
+
+double ns_to_us(double ns) { return ns / 1000.0; }
+
+} // namespace
+
+std::string stage_to_string(Stage stage) {
+  switch (stage) {
+  case Stage::QUEUE_WAIT:
+    return "queue_wait";
+  case Stage::DESERIALIZE:
+    return "deserialize";
+  case Stage::REVERSE:
+    return "reverse";
+  case Stage::SERIALIZE:
+    return "serialize";
+  case Stage::WRITE:
+    return "write";
+  }
+  return "unknown";
+}
+
+Stats::Stats(std::string csv_filename)
+    : m_csv_filename(std::move(csv_filename)),
+      m_stages_ns{{make_stage_histogram(), make_stage_histogram(),
+                   make_stage_histogram(), make_stage_histogram(),
+                   make_stage_histogram()}},
+      m_service_ns(make_stage_histogram()),
+      m_since(std::chrono::steady_clock::now()) {}
+
+void Stats::record(const RequestTiming &timing) {
+  int64_t service_ns = 0;
+  bool measured = false;
+  for (std::size_t i = 0; i < STAGE_COUNT; ++i) {
+    int64_t ns = timing.stage_ns(static_cast<Stage>(i));
+    if (ns < 0)
+      continue;
+    m_stages_ns[i].record(std::max<int64_t>(ns, 1));
+    service_ns += ns;
+    measured = true;
+  }
+  if (measured)
+    m_service_ns.record(std::max<int64_t>(service_ns, 1));
+  m_requests++;
+}
+
+void Stats::session_opened() {
+  m_active_sessions++;
+  m_sessions_total++;
+}
+
+void Stats::session_closed() {
+  if (--m_active_sessions > 0 || m_requests == 0)
+    return;
+  // The last client left: report the run, then start the next one clean.
+  report(std::cout);
+  if (save_csv(m_csv_filename)) {
+    std::cout << "TCP Server: Stats saved to " << m_csv_filename << std::endl;
+  }
+  event_trace::save();
+  reset();
+}
+
+void Stats::reset() {
+  for (auto &histogram : m_stages_ns)
+    histogram.reset();
+  m_service_ns.reset();
+  m_requests = 0;
+  m_requests_at_last_report = 0;
+  m_bytes_in = 0;
+  m_bytes_out = 0;
+  m_sessions_total = static_cast<uint64_t>(m_active_sessions);
+  m_since = std::chrono::steady_clock::now();
+}
+
+void Stats::report(std::ostream &out) {
+  m_requests_at_last_report = m_requests;
+  const double elapsed_s = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - m_since)
+                               .count();
+  auto flags = out.flags();
+  out << std::fixed << std::setprecision(2);
+  out << "TCP Server stats: " << m_requests << " requests in " << elapsed_s
+      << " s, bytes in " << m_bytes_in << ", bytes out " << m_bytes_out
+      << ", sessions active " << m_active_sessions << " (total "
+      << m_sessions_total << ")\n";
+  auto print_row = [&out](const std::string &name, const HdrHistogram &h) {
+    out << "  " << std::left << std::setw(12) << name << std::right;
+    if (h.total_count() == 0) {
+      out << " n/a\n";
+      return;
+    }
+    out << " mean " << ns_to_us(h.mean()) << " us, p50 "
+        << ns_to_us(static_cast<double>(h.value_at_percentile(50.0)))
+        << " us, p99 "
+        << ns_to_us(static_cast<double>(h.value_at_percentile(99.0)))
+        << " us, max " << ns_to_us(static_cast<double>(h.max())) << " us\n";
+  };
+  for (std::size_t i = 0; i < STAGE_COUNT; ++i) {
+    print_row(stage_to_string(static_cast<Stage>(i)), m_stages_ns[i]);
+  }
+  print_row("service", m_service_ns);
+  out << std::flush;
+  out.flags(flags);
+}
+
+bool Stats::save_csv(const std::string &filename) const {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    std::cerr << "TCP Server: Could not open " << filename
+              << " for writing." << std::endl;
+    return false;
+  }
+  // The counters repeat on every row so the file reads as a single table.
+  file << "Stage,Samples,Mean_us,P50_us,P90_us,P99_us,P99_9_us,Max_us,"
+          "Requests,BytesIn,BytesOut,Sessions\n";
+  file << std::fixed << std::setprecision(3);
+  auto write_row = [&](const std::string &name, const HdrHistogram &h) {
+    file << name << "," << h.total_count() << "," << ns_to_us(h.mean())
+         << ","
+         << ns_to_us(static_cast<double>(h.value_at_percentile(50.0))) << ","
+         << ns_to_us(static_cast<double>(h.value_at_percentile(90.0))) << ","
+         << ns_to_us(static_cast<double>(h.value_at_percentile(99.0))) << ","
+         << ns_to_us(static_cast<double>(h.value_at_percentile(99.9))) << ","
+         << ns_to_us(static_cast<double>(h.max())) << "," << m_requests << ","
+         << m_bytes_in << "," << m_bytes_out << "," << m_sessions_total
+         << "\n";
+  };
+  for (std::size_t i = 0; i < STAGE_COUNT; ++i) {
+    write_row(stage_to_string(static_cast<Stage>(i)), m_stages_ns[i]);
+  }
+  write_row("service", m_service_ns);
+  return true;
+}
+
+} // namespace server_stats
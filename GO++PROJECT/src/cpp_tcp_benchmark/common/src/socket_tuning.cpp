@@ -0,0 +1,153 @@
+#include "socket_tuning.hpp"
+#include "cli_options.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+
+namespace socket_tuning {
+
+namespace {
+
+struct Option {
+  int level;
+  int name;
+  int value;
+  const char *label;
+};
+
+std::vector<Option> options_of(const Profile &profile) {
+  std::vector<Option> options;
+  if (profile.no_delay)
+    options.push_back({IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY"});
+  if (profile.send_buffer_bytes > 0)
+    options.push_back(
+        {SOL_SOCKET, SO_SNDBUF, profile.send_buffer_bytes, "SO_SNDBUF"});
+  if (profile.receive_buffer_bytes > 0)
+    options.push_back(
+        {SOL_SOCKET, SO_RCVBUF, profile.receive_buffer_bytes, "SO_RCVBUF"});
+#ifdef TCP_QUICKACK
+  if (profile.quick_ack)
+    options.push_back({IPPROTO_TCP, TCP_QUICKACK, 1, "TCP_QUICKACK"});
+#endif
+#ifdef SO_BUSY_POLL
+  if (profile.busy_poll_us > 0)
+    options.push_back(
+        {SOL_SOCKET, SO_BUSY_POLL, profile.busy_poll_us, "SO_BUSY_POLL"});
+#endif
+  return options;
+}
+
+} // namespace
+
+bool Profile::is_default() const {
+  return !no_delay && send_buffer_bytes == 0 && receive_buffer_bytes == 0 &&
+         !quick_ack && busy_poll_us == 0;
+}
+
+Profile preset(const std::string &name) {
+  const int large_buffer = 4 * 1024 * 1024;
+  Profile profile;
+  profile.name = name;
+  if (name == "default")
+    return profile;
+  if (name == "nodelay") {
+    profile.no_delay = true;
+  } else if (name == "quickack") {
+    profile.quick_ack = true;
+  } else if (name == "buffers") {
+    profile.send_buffer_bytes = large_buffer;
+    profile.receive_buffer_bytes = large_buffer;
+  } else if (name == "busypoll") {
+    profile.busy_poll_us = 50;
+  } else if (name == "latency") {
+    profile.no_delay = true;
+    profile.quick_ack = true;
+    profile.busy_poll_us = 50;
+  } else if (name == "throughput") {
+    profile.no_delay = true;
+    profile.send_buffer_bytes = large_buffer;
+    profile.receive_buffer_bytes = large_buffer;
+  } else {
+    throw std::invalid_argument("Unknown socket profile: " + name +
+                                " (expected default|nodelay|quickack|buffers|"
+                                "busypoll|latency|throughput)");
+  }
+  return profile;
+}
+
+std::vector<std::string> sweep_presets() {
+  return {"default",  "nodelay", "quickack",  "buffers",
+          "busypoll", "latency", "throughput"};
+}
+
+Profile from_options(const CliOptions &options) {
+  Profile profile = preset(options.get_string("socket-profile", "default"));
+  bool overridden = false;
+  if (options.has("nodelay")) {
+    profile.no_delay = options.get_bool("nodelay", false);
+    overridden = true;
+  }
+  if (options.has("quickack")) {
+    profile.quick_ack = options.get_bool("quickack", false);
+    overridden = true;
+  }
+  if (options.has("sndbuf")) {
+    profile.send_buffer_bytes =
+        static_cast<int>(options.get_size("sndbuf", 0));
+    overridden = true;
+  }
+  if (options.has("rcvbuf")) {
+    profile.receive_buffer_bytes =
+        static_cast<int>(options.get_size("rcvbuf", 0));
+    overridden = true;
+  }
+  if (options.has("busy-poll")) {
+    profile.busy_poll_us = static_cast<int>(options.get_int("busy-poll", 0));
+    overridden = true;
+  }
+  if (overridden)
+    profile.name = "custom";
+  return profile;
+}
+
+std::string to_string(const Profile &profile) {
+  std::ostringstream out;
+  out << profile.name << "(nodelay=" << profile.no_delay
+      << " sndbuf=" << profile.send_buffer_bytes
+      << " rcvbuf=" << profile.receive_buffer_bytes
+      << " quickack=" << profile.quick_ack
+      << " busy_poll_us=" << profile.busy_poll_us << ")";
+  return out.str();
+}
+
+int apply(int fd, const Profile &profile, const std::string &log_prefix) {
+  int applied = 0;
+  for (const auto &option : options_of(profile)) {
+    if (::setsockopt(fd, option.level, option.name, &option.value,
+                     sizeof(option.value)) == 0) {
+      ++applied;
+    } else {
+      std::cerr << log_prefix << " setsockopt(" << option.label << "="
+                << option.value << ") failed: " << std::strerror(errno)
+                << std::endl;
+    }
+  }
+  return applied;
+}
+
+void rearm_quick_ack(int fd) {
+#ifdef TCP_QUICKACK
+  int one = 1;
+  ::setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+#else
+  (void)fd;
+#endif
+}
+
+} // namespace socket_tuning
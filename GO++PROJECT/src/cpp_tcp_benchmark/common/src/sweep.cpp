@@ -0,0 +1,178 @@
+#include "sweep.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iomanip> // For std::fixed, std::setprecision, std::setw
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace sweep {
+
+namespace {
+
+std::string format_size(std::size_t bytes) {
+  if (bytes >= 1024 * 1024 && bytes % (1024 * 1024) == 0)
+    return std::to_string(bytes / (1024 * 1024)) + "M";
+  if (bytes >= 1024 && bytes % 1024 == 0)
+    return std::to_string(bytes / 1024) + "K";
+  return std::to_string(bytes);
+}
+
+double gain_percent(const std::vector<SweepPoint> &points, std::size_t i) {
+  if (i == 0 || points[i - 1].throughput_mbps <= 0.0)
+    return 0.0;
+  return (points[i].throughput_mbps / points[i - 1].throughput_mbps - 1.0) *
+         100.0;
+}
+
+double vs_baseline_percent(const std::vector<LabeledPoint> &points,
+                           std::size_t i) {
+  if (points.empty() || points.front().result.throughput_mbps <= 0.0)
+    return 0.0;
+  return (points[i].result.throughput_mbps /
+              points.front().result.throughput_mbps -
+          1.0) *
+         100.0;
+}
+
+void ensure_parent_dir(const std::string &file_path) {
+  fs::path dir_path = fs::path(file_path).parent_path();
+  if (!dir_path.empty() && !fs::exists(dir_path)) {
+    fs::create_directories(dir_path);
+  }
+}
+
+} // namespace
+
+std::vector<std::size_t> chunk_sizes(std::size_t min_bytes,
+                                     std::size_t max_bytes) {
+  std::vector<std::size_t> sizes;
+  std::size_t size = 1;
+  while (size < min_bytes)
+    size <<= 1;
+  for (; size <= max_bytes; size <<= 1) {
+    sizes.push_back(size);
+  }
+  return sizes;
+}
+
+std::size_t find_knee(const std::vector<SweepPoint> &points,
+                      double tolerance) {
+  double best = 0.0;
+  for (const auto &point : points) {
+    if (point.completed && point.throughput_mbps > best)
+      best = point.throughput_mbps;
+  }
+  if (best <= 0.0)
+    return points.size();
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    if (points[i].completed &&
+        points[i].throughput_mbps >= best * (1.0 - tolerance))
+      return i;
+  }
+  return points.size();
+}
+
+void print_report(const std::string &protocol_name,
+                  const std::vector<SweepPoint> &points,
+                  std::size_t knee_index) {
+  std::cout << "\n--- " << protocol_name << " Chunk Size Sweep ---"
+            << std::endl;
+  std::cout << std::setw(8) << "Chunk" << std::setw(16) << "Throughput_Mbps"
+            << std::setw(10) << "Gain_%" << std::setw(12) << "AvgRTT_ms"
+            << std::setw(12) << "P99RTT_ms" << std::setw(8) << "Failed"
+            << std::endl;
+  std::cout << std::fixed << std::setprecision(3);
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    const auto &point = points[i];
+    std::cout << std::setw(8) << format_size(point.chunk_size_bytes)
+              << std::setw(16) << point.throughput_mbps << std::setw(10)
+              << gain_percent(points, i) << std::setw(12) << point.avg_rtt_ms
+              << std::setw(12) << point.p99_rtt_ms << std::setw(8)
+              << point.failed_chunks << (point.completed ? "" : "   (failed)")
+              << (i == knee_index ? "   <-- knee" : "") << std::endl;
+  }
+  if (knee_index < points.size()) {
+    std::cout << "Throughput stops improving at chunk size "
+              << format_size(points[knee_index].chunk_size_bytes) << " ("
+              << points[knee_index].throughput_mbps << " Mbps)." << std::endl;
+  } else {
+    std::cout << "No knee found: no sweep point completed." << std::endl;
+  }
+  std::cout << "--- End of Sweep ---" << std::endl;
+}
+
+void save_to_csv(const std::string &file_path,
+                 const std::string &protocol_name,
+                 const std::vector<SweepPoint> &points,
+                 std::size_t knee_index) {
+  ensure_parent_dir(file_path);
+
+  std::ofstream file(file_path);
+  if (!file.is_open()) {
+    std::cerr << "Error: Could not open file " << file_path
+              << " for writing sweep results." << std::endl;
+    return;
+  }
+  file << "Protocol,ChunkSizeBytes,Throughput_Mbps,GainVsPrevious_percent,"
+          "AvgRTT_ms,P99RTT_ms,FailedChunks,Completed,IsKnee\n";
+  file << std::fixed << std::setprecision(6);
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    const auto &point = points[i];
+    file << protocol_name << "," << point.chunk_size_bytes << ","
+         << point.throughput_mbps << "," << gain_percent(points, i) << ","
+         << point.avg_rtt_ms << "," << point.p99_rtt_ms << ","
+         << point.failed_chunks << "," << (point.completed ? 1 : 0) << ","
+         << (i == knee_index ? 1 : 0) << "\n";
+  }
+  std::cout << "Sweep results saved to " << file_path << std::endl;
+}
+
+void print_labeled_report(const std::string &title,
+                          const std::string &protocol_name,
+                          const std::vector<LabeledPoint> &points) {
+  std::cout << "\n--- " << protocol_name << " " << title << " ---"
+            << std::endl;
+  std::cout << std::setw(12) << "Setting" << std::setw(16) << "Throughput_Mbps"
+            << std::setw(14) << "VsBaseline_%" << std::setw(12) << "AvgRTT_ms"
+            << std::setw(12) << "P99RTT_ms" << std::setw(8) << "Failed"
+            << std::endl;
+  std::cout << std::fixed << std::setprecision(3);
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    const auto &point = points[i].result;
+    std::cout << std::setw(12) << points[i].label << std::setw(16)
+              << point.throughput_mbps << std::setw(14)
+              << vs_baseline_percent(points, i) << std::setw(12)
+              << point.avg_rtt_ms << std::setw(12) << point.p99_rtt_ms
+              << std::setw(8) << point.failed_chunks
+              << (point.completed ? "" : "   (failed)") << std::endl;
+  }
+  std::cout << "--- End of Sweep ---" << std::endl;
+}
+
+void save_labeled_csv(const std::string &file_path,
+                      const std::string &protocol_name,
+                      const std::vector<LabeledPoint> &points) {
+  ensure_parent_dir(file_path);
+
+  std::ofstream file(file_path);
+  if (!file.is_open()) {
+    std::cerr << "Error: Could not open file " << file_path
+              << " for writing sweep results." << std::endl;
+    return;
+  }
+  file << "Protocol,Setting,ChunkSizeBytes,Throughput_Mbps,"
+          "VsBaseline_percent,AvgRTT_ms,P99RTT_ms,FailedChunks,Completed\n";
+  file << std::fixed << std::setprecision(6);
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    const auto &point = points[i].result;
+    file << protocol_name << "," << points[i].label << ","
+         << point.chunk_size_bytes << "," << point.throughput_mbps << ","
+         << vs_baseline_percent(points, i) << "," << point.avg_rtt_ms << ","
+         << point.p99_rtt_ms << "," << point.failed_chunks << ","
+         << (point.completed ? 1 : 0) << "\n";
+  }
+  std::cout << "Sweep results saved to " << file_path << std::endl;
+}
+
+} // namespace sweep
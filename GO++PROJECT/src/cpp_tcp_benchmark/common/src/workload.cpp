@@ -0,0 +1,93 @@
+#include "workload.hpp"
+
+#include <algorithm> // For std::min
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <zlib.h>
+
+namespace workload {
+
+Mode mode_from_string(const std::string &name) {
+  if (name == "echo")
+    return Mode::ROUND_TRIP;
+  if (name == "upload")
+    return Mode::UPLOAD;
+  if (name == "download")
+    return Mode::DOWNLOAD;
+  throw std::invalid_argument("Unknown workload mode: " + name +
+                              " (expected echo|upload|download)");
+}
+
+std::string mode_to_string(Mode mode) {
+  switch (mode) {
+  case Mode::ROUND_TRIP:
+    return "echo";
+  case Mode::UPLOAD:
+    return "upload";
+  case Mode::DOWNLOAD:
+    return "download";
+  }
+  return "unknown";
+}
+
+uint32_t checksum(const char *data, std::size_t size) {
+  uLong crc = crc32(0L, Z_NULL, 0);
+  // crc32() takes a uInt length, so very large payloads go in pieces.
+  while (size > 0) {
+    uInt part = static_cast<uInt>(std::min<std::size_t>(size, 1u << 30));
+    crc = crc32(crc, reinterpret_cast<const Bytef *>(data), part);
+    data += part;
+    size -= part;
+  }
+  return static_cast<uint32_t>(crc);
+}
+
+DownloadSource::DownloadSource(std::string filename)
+    : m_filename(std::move(filename)) {}
+
+bool DownloadSource::open() {
+  if (m_file.is_open())
+    return true;
+  if (m_open_failed)
+    return false;
+  m_file.open(m_filename, std::ios::binary | std::ios::in);
+  if (m_file) {
+    m_file.seekg(0, std::ios::end);
+    m_file_size = static_cast<std::size_t>(m_file.tellg());
+    m_file.seekg(0, std::ios::beg);
+  }
+  if (!m_file || m_file_size == 0) {
+    std::cerr << "DownloadSource: Cannot serve '" << m_filename
+              << "' (missing or empty)." << std::endl;
+    m_file.close();
+    m_open_failed = true;
+    return false;
+  }
+  std::cout << "DownloadSource: Serving '" << m_filename << "' ("
+            << m_file_size << " bytes)." << std::endl;
+  return true;
+}
+
+bool DownloadSource::read(std::size_t size, char *out) {
+  if (!open())
+    return false;
+  bool rewound = false;
+  while (size > 0) {
+    m_file.read(out, static_cast<std::streamsize>(size));
+    std::size_t got = static_cast<std::size_t>(m_file.gcount());
+    if (got == 0 && rewound)
+      return false; // The file shrank under us
+    out += got;
+    size -= got;
+    rewound = false;
+    if (size > 0) { // End of file: start over
+      m_file.clear();
+      m_file.seekg(0, std::ios::beg);
+      rewound = true;
+    }
+  }
+  return true;
+}
+
+} // namespace workload
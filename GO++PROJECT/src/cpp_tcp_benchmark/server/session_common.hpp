@@ -0,0 +1,329 @@
+// benchmark/server/session_common.hpp
+// Protocol side of a server session, shared by the callback TCPSession and
+// the coroutine session: turning request frames into response buffers and
+// reporting how a connection ended.
+#ifndef SESSION_COMMON_HPP
+#define SESSION_COMMON_HPP
+
+#include "alloc_counter.hpp"
+#include "config.hpp"
+#include "event_trace.hpp"
+#include "latency_trace.hpp"
+#include "progress.hpp"
+#include "reversal_utils.hpp"
+#include "server_stats.hpp"
+#include "tcp_messaging.hpp"
+#include "workload.hpp"
+
+#include <algorithm> // For std::max
+#include <array>
+#include <boost/asio.hpp>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+class FrameResponder {
+public:
+  // download_file backs DOWNLOAD requests; it is opened on the first one.
+  // count_progress is off when the responder runs inside the client
+  // (--transport=inproc), whose progress counters already see every request.
+  explicit FrameResponder(const std::string &download_file,
+                          bool count_progress = true)
+      : m_downloads(download_file), m_count_progress(count_progress) {}
+
+  // Builds the response to `frame` into buffers(). Plain echo payloads are
+  // reversed where they landed in the receive buffer, so the frame has to stay
+  // buffered until the response is written. Returns false, after logging why,
+  // when the session has to be closed. The deserialize, reverse and serialize
+  // stages are lapped on `timing` as they finish.
+  bool respond(tcp_messaging::Frame &frame,
+               server_stats::RequestTiming &timing) {
+    TCP_BENCH_TRACE_SCOPE("respond", "server");
+    if (m_count_progress)
+      progress::on_sent();
+
+    if (tcp_messaging::is_traced(frame.header_value)) {
+      return respond_traced(frame, timing);
+    }
+    return respond_body(frame, timing);
+  }
+
+  tcp_messaging::BufferSpan buffers() const {
+    return tcp_messaging::BufferSpan(m_buffers);
+  }
+
+private:
+  // Answers the frame inside a traced one and sends the client's stamps back
+  // with the server's. The handling stages are lapped back to back from the
+  // read that completed the frame, so processing ends at the read plus the
+  // queue wait, deserialize and reverse laps; what serialize adds on top is
+  // the send stage.
+  bool respond_traced(const tcp_messaging::Frame &frame,
+                      server_stats::RequestTiming &timing) {
+    tcp_messaging::Frame body = frame;
+    latency_trace::Stamps stamps;
+    if (!tcp_messaging::strip_trace(body, stamps)) {
+      std::cerr << "TCP Session: Traced frame of length " << frame.length
+                << " is too short. Closing." << std::endl;
+      return false;
+    }
+    if (!respond_body(body, timing)) {
+      return false;
+    }
+    stamps.server_recv_ns = latency_trace::to_ns(timing.started_at());
+    stamps.server_process_done_ns = stamps.server_recv_ns;
+    for (server_stats::Stage stage :
+         {server_stats::Stage::QUEUE_WAIT, server_stats::Stage::DESERIALIZE,
+          server_stats::Stage::REVERSE}) {
+      stamps.server_process_done_ns +=
+          std::max<int64_t>(timing.stage_ns(stage), 0);
+    }
+    stamps.server_send_ns = latency_trace::now_ns();
+    tcp_messaging::add_trace(m_buffers, m_trace_prefix, stamps);
+    return true;
+  }
+
+  bool respond_body(tcp_messaging::Frame &frame,
+                    server_stats::RequestTiming &timing) {
+    if (tcp_messaging::is_batch(frame.header_value)) {
+      return respond_batch(frame, timing);
+    }
+    if (frame.length > config::MAX_FRAME_PAYLOAD_SIZE) {
+      std::cerr << "TCP Session: Excessive body length received: "
+                << frame.length << ". Max expected around: "
+                << config::MAX_FRAME_PAYLOAD_SIZE << ". Closing session."
+                << std::endl;
+      return false;
+    }
+
+    if (!echoed_in_place(frame.header_value)) {
+      uint32_t flags = 0;
+      if (!answer_into(frame, m_encoded_buffer, flags, timing)) {
+        std::cerr << "TCP Session: Failed to answer frame. Closing."
+                  << std::endl;
+        return false;
+      }
+      set_single(m_encoded_buffer.data(), m_encoded_buffer.size(), flags);
+      timing.lap(server_stats::Stage::SERIALIZE);
+      return true;
+    }
+
+    timing.lap(server_stats::Stage::DESERIALIZE);
+    utils::reverse_bytes(frame.data, frame.length);
+    timing.lap(server_stats::Stage::REVERSE);
+    set_single(frame.data, frame.length, 0);
+    timing.lap(server_stats::Stage::SERIALIZE);
+    return true;
+  }
+
+  // Plain echo requests are answered by reversing them in place; everything
+  // else (compressed, ack, download) is answered from a separate buffer.
+  static bool echoed_in_place(uint32_t header_value) {
+    return (header_value &
+            (tcp_messaging::COMPRESSED_FLAG | tcp_messaging::ACK_FLAG |
+             tcp_messaging::DOWNLOAD_FLAG)) == 0;
+  }
+
+  // Answers every entry of a batch with one batch frame, entries in request
+  // order.
+  bool respond_batch(tcp_messaging::Frame &frame,
+                     server_stats::RequestTiming &timing) {
+    if (!tcp_messaging::parse_batch(frame, m_entries,
+                                    config::MAX_FRAME_PAYLOAD_SIZE)) {
+      std::cerr << "TCP Session: Malformed batch frame of length "
+                << frame.length << ". Closing." << std::endl;
+      return false;
+    }
+    timing.lap(server_stats::Stage::DESERIALIZE);
+
+    bool all_in_place = true;
+    for (const auto &entry : m_entries) {
+      all_in_place &= echoed_in_place(entry.header_value);
+    }
+
+    if (all_in_place) {
+      // Reversing each entry in place keeps the batch layout intact, so the
+      // request bytes go straight back out as the response.
+      for (const auto &entry : m_entries) {
+        utils::reverse_bytes(entry.data, entry.length);
+      }
+      timing.lap(server_stats::Stage::REVERSE);
+      set_single(frame.data, frame.length, tcp_messaging::BATCH_FLAG);
+      timing.lap(server_stats::Stage::SERIALIZE);
+      return true;
+    }
+
+    if (m_entry_buffers.size() < m_entries.size()) {
+      m_entry_buffers.resize(m_entries.size());
+    }
+    m_batch_writer.clear();
+    for (std::size_t i = 0; i < m_entries.size(); ++i) {
+      const auto &entry = m_entries[i];
+      if (!echoed_in_place(entry.header_value)) {
+        uint32_t entry_flags = 0;
+        if (!answer_into(entry, m_entry_buffers[i], entry_flags, timing)) {
+          std::cerr << "TCP Session: Failed to answer batch entry " << i
+                    << ". Closing." << std::endl;
+          return false;
+        }
+        m_batch_writer.add(m_entry_buffers[i].data(),
+                           m_entry_buffers[i].size(), entry_flags);
+      } else {
+        utils::reverse_bytes(entry.data, entry.length);
+        timing.lap(server_stats::Stage::REVERSE);
+        m_batch_writer.add(entry.data, entry.length);
+      }
+      timing.lap(server_stats::Stage::SERIALIZE);
+    }
+    const auto &batch_buffers = m_batch_writer.buffers();
+    m_buffers.assign(batch_buffers.begin(), batch_buffers.end());
+    timing.lap(server_stats::Stage::SERIALIZE);
+    return true;
+  }
+
+  // Builds the body of the reply to a request that is not a plain echo into
+  // `out`: a download chunk, an ack, or the reversed payload re-encoded with
+  // the client's codec (falling back to a plain body, flags 0, if it does not
+  // shrink). Reading a download chunk is left to the caller's serialize lap.
+  bool answer_into(const tcp_messaging::Frame &request,
+                   std::vector<char> &out, uint32_t &out_flags,
+                   server_stats::RequestTiming &timing) {
+    out_flags = 0;
+    if (tcp_messaging::is_download_request(request.header_value)) {
+      return serve_download(request, out);
+    }
+
+    const char *payload = request.data;
+    std::size_t payload_size = request.length;
+    compression::Codec codec = compression::Codec::NONE;
+    if (tcp_messaging::is_compressed(request.header_value)) {
+      if (!tcp_messaging::decode_compressed_body(
+              request.data, request.length, m_raw_buffer, codec,
+              config::MAX_FRAME_PAYLOAD_SIZE)) {
+        std::cerr << "TCP Session: Failed to decode compressed body."
+                  << std::endl;
+        return false;
+      }
+      payload = m_raw_buffer.data();
+      payload_size = m_raw_buffer.size();
+    }
+    timing.lap(server_stats::Stage::DESERIALIZE);
+
+    if (tcp_messaging::is_ack_request(request.header_value)) {
+      out.resize(tcp_messaging::ACK_BODY_SIZE);
+      tcp_messaging::write_u32(out.data(),
+                               static_cast<uint32_t>(payload_size));
+      tcp_messaging::write_u32(out.data() + sizeof(uint32_t),
+                               workload::checksum(payload, payload_size));
+      timing.lap(server_stats::Stage::REVERSE);
+      return true;
+    }
+
+    utils::reverse_vector_content(m_raw_buffer);
+    timing.lap(server_stats::Stage::REVERSE);
+    if (tcp_messaging::encode_compressed_body(codec, m_raw_buffer, out)) {
+      out_flags = tcp_messaging::COMPRESSED_FLAG;
+    } else {
+      out.swap(m_raw_buffer);
+    }
+    return true;
+  }
+
+  // [crc32][size bytes of the download file] for a [size] request.
+  bool serve_download(const tcp_messaging::Frame &request,
+                      std::vector<char> &out) {
+    if (request.length != tcp_messaging::DOWNLOAD_REQUEST_SIZE) {
+      std::cerr << "TCP Session: Malformed download request of length "
+                << request.length << "." << std::endl;
+      return false;
+    }
+    std::size_t size = tcp_messaging::parse_header(request.data);
+    if (size == 0 || size > config::MAX_CHUNK_SIZE) {
+      std::cerr << "TCP Session: Download request for " << size
+                << " bytes is out of range." << std::endl;
+      return false;
+    }
+    out.resize(tcp_messaging::DOWNLOAD_CHECKSUM_SIZE + size);
+    char *payload = out.data() + tcp_messaging::DOWNLOAD_CHECKSUM_SIZE;
+    if (!m_downloads.read(size, payload)) {
+      return false;
+    }
+    tcp_messaging::write_u32(out.data(), workload::checksum(payload, size));
+    return true;
+  }
+
+  void set_single(const char *payload, std::size_t payload_size,
+                  uint32_t flags) {
+    auto frame_buffers = tcp_messaging::prepare_message(
+        payload, payload_size, m_header_buffer, flags);
+    m_buffers.assign(frame_buffers.begin(), frame_buffers.end());
+  }
+
+  workload::DownloadSource m_downloads;
+  std::vector<char> m_raw_buffer;     // Decompressed payload of compressed frames
+  std::vector<char> m_encoded_buffer; // Reply body of a non-echo single frame
+  std::vector<tcp_messaging::Frame> m_entries;    // Entries of a batch
+  std::vector<std::vector<char>> m_entry_buffers; // Non-echo entry replies
+  tcp_messaging::BatchWriter m_batch_writer;
+  std::array<char, tcp_messaging::HEADER_SIZE> m_header_buffer;
+  tcp_messaging::TracePrefix m_trace_prefix; // Header of a traced response
+  std::vector<boost::asio::const_buffer> m_buffers;
+  bool m_count_progress;
+};
+
+inline void log_frame_too_large() {
+  std::cerr << "TCP Session: Excessive body length received. Max "
+               "expected around: "
+            << config::MAX_FRAME_PAYLOAD_SIZE << ". Closing session."
+            << std::endl;
+}
+
+inline void log_read_error(const boost::system::error_code &ec,
+                           std::size_t buffered_bytes) {
+  if (ec == boost::asio::error::eof) {
+    if (buffered_bytes == 0) {
+      std::cout << "TCP Session: Client disconnected gracefully "
+                   "(EOF on header read)."
+                << std::endl;
+    } else {
+      std::cout << "TCP Session: Client disconnected while reading "
+                   "body."
+                << std::endl;
+    }
+  } else if (ec == boost::asio::error::operation_aborted) {
+    std::cout << "TCP Session: Operation aborted (likely server shutdown)."
+              << std::endl;
+  } else {
+    std::cerr << "TCP Session: Error reading from socket: " << ec.message()
+              << std::endl;
+  }
+}
+
+// Successful writes are not logged: the progress sampler reports them.
+inline void log_write_error(const boost::system::error_code &ec) {
+  if (ec == boost::asio::error::operation_aborted) {
+    std::cout << "TCP Session: Operation aborted (likely server "
+                 "shutdown) while writing."
+              << std::endl;
+  } else {
+    std::cerr << "TCP Session: Error writing response: " << ec.message()
+              << std::endl;
+  }
+}
+
+// Reports the heap allocations made while the session was open (process
+// wide, so concurrent sessions are counted together).
+inline void log_session_allocations(std::uint64_t allocations_at_start,
+                                    std::size_t frames_served) {
+  if (!alloc_counter::enabled() || frames_served == 0)
+    return;
+  std::uint64_t allocations =
+      alloc_counter::allocations() - allocations_at_start;
+  std::cout << "TCP Session: " << allocations << " heap allocations for "
+            << frames_served << " frames ("
+            << static_cast<double>(allocations) / frames_served
+            << " per frame)." << std::endl;
+}
+
+#endif // SESSION_COMMON_HPP
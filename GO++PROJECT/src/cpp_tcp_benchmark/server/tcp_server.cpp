@@ -1,160 +1,162 @@
 // benchmark/server/tcp_server.cpp
+#include "alloc_counter.hpp"
+#include "cli_options.hpp"
 #include "config.hpp"
-#include "reversal_utils.hpp"
+#include "event_trace.hpp"
+#include "handler_allocator.hpp"
+#include "progress.hpp"
+#include "server_stats.hpp"
+#include "session_common.hpp"
+#include "socket_tuning.hpp"
 #include "tcp_messaging.hpp"
 
-#include <array>
 #include <boost/asio.hpp>
+#include <chrono>
+#include <cstdint>
 #include <iostream>
 #include <memory>
-#include <vector>
+#include <string>
+
+#ifdef TCP_BENCH_COROUTINES
+#include "tcp_session_coro.hpp"
+#endif
 
 using boost::asio::ip::tcp;
 
 class TCPSession : public std::enable_shared_from_this<TCPSession> {
 public:
-  TCPSession(tcp::socket socket) : m_socket(std::move(socket)) {
+  TCPSession(tcp::socket socket, bool quick_ack,
+             const std::string &download_file, server_stats::Stats &stats)
+      : m_socket(std::move(socket)), m_quick_ack(quick_ack),
+        m_reader(config::RECEIVE_BUFFER_SIZE,
+                 tcp_messaging::max_batch_frame_length(
+                     config::MAX_FRAME_PAYLOAD_SIZE)),
+        m_responder(download_file), m_stats(stats),
+        m_allocations_at_start(alloc_counter::allocations()) {
     std::cout << "TCP Session: New connection from "
               << m_socket.remote_endpoint().address().to_string() << ":"
               << m_socket.remote_endpoint().port() << std::endl;
+    m_stats.session_opened();
   }
 
   ~TCPSession() {
+     log_session_allocations(m_allocations_at_start, m_frames_served);
      std::cout << "TCP Session: Connection closed with "
                << m_socket.remote_endpoint().address().to_string()
                << std::endl;
+     m_stats.session_closed();
   }
 
-  void start() { do_read_header(); }
+  void start() { do_read(); }
 
 private:
-  void do_read_header() {
-    auto self = shared_from_this();
-    tcp_messaging::async_read_header(
-        m_socket, m_read_header_buffer,
-        [this,
-         self](const boost::system::error_code &ec,
-               std::size_t /*length - not provided by this handler variant */) {
-          if (!ec) {
-            uint32_t body_length =
-                tcp_messaging::parse_header(m_read_header_buffer);
-            std::cout << "TCP Session: Received header for body of length: "
-            << body_length << std::endl;
-
-            if (body_length ==
-                0) {
-              m_read_body_buffer.clear();
-              do_write();
-              return;
-            }
-
-            if (body_length > config::CHUNK_SIZE * 2) {
-              std::cerr << "TCP Session: Excessive body length received: "
-                        << body_length
-                        << ". Max expected around: " << config::CHUNK_SIZE
-                        << ". Closing session." << std::endl;
-
-              return;
-            }
-            m_read_body_buffer.resize(body_length);
-            do_read_body();
-          } else {
-            if (ec == boost::asio::error::eof) {
-              std::cout << "TCP Session: Client disconnected gracefully (EOF "
-                           "on header read)."
-                        << std::endl;
-            } else if (ec == boost::asio::error::operation_aborted) {
-              std::cout
-                  << "TCP Session: Operation aborted (likely server shutdown)."
-                  << std::endl;
-            } else {
-              std::cerr << "TCP Session: Error reading header: " << ec.message()
-                        << std::endl;
-            }
-
-          }
-        });
-  }
+  // Serves every complete frame already buffered, one response at a time, and
+  // only goes back to the socket once the buffer holds a partial frame.
+  void do_read() {
+    switch (m_reader.peek(m_frame)) {
+    case tcp_messaging::FrameReader::Status::FRAME_READY:
+      m_timing.start_at(m_received_at);
+      m_timing.lap(server_stats::Stage::QUEUE_WAIT);
+      if (m_responder.respond(m_frame, m_timing)) {
+        do_write();
+      }
+      return;
+    case tcp_messaging::FrameReader::Status::FRAME_TOO_LARGE:
+      log_frame_too_large();
+      return;
+    case tcp_messaging::FrameReader::Status::NEED_MORE:
+      break;
+    }
 
-  void do_read_body() {
     auto self = shared_from_this();
-    boost::asio::async_read(
-        m_socket,
-        boost::asio::buffer(m_read_body_buffer.data(),
-                            m_read_body_buffer.size()),
-        boost::asio::transfer_exactly(
-            m_read_body_buffer.size()),
-        [this, self](const boost::system::error_code &ec,
-                     std::size_t length_read) {
-          if (!ec) {
-            std::cout << "TCP Session: Read body of size " << length_read <<
-            std::endl;
-            if (length_read != m_read_body_buffer.size()) {
-              std::cerr << "TCP Session: Incomplete body read. Expected "
-                        << m_read_body_buffer.size() << ", got " << length_read
-                        << ". Closing." << std::endl;
-              return;
-            }
-
-            utils::reverse_vector_content(m_read_body_buffer);
-            do_write();
-          } else {
-            if (ec == boost::asio::error::eof) {
-              std::cout
-                  << "TCP Session: Client disconnected while reading body."
-                  << std::endl;
-            } else if (ec == boost::asio::error::operation_aborted) {
-              std::cout << "TCP Session: Operation aborted (likely server "
-                           "shutdown) while reading body."
-                        << std::endl;
-            } else {
-              std::cerr << "TCP Session: Error reading body: " << ec.message()
-                        << std::endl;
-            }
-          }
-        });
+    m_socket.async_read_some(
+        m_reader.prepare(),
+        handler_alloc::make_custom_alloc_handler(
+            m_read_memory, [this, self](const boost::system::error_code &ec,
+                                        std::size_t bytes_read) {
+              m_reader.commit(bytes_read);
+              m_received_at = std::chrono::steady_clock::now();
+              TCP_BENCH_TRACE_INSTANT("read_done", "server");
+              m_stats.add_bytes_in(bytes_read);
+              if (!ec) {
+                if (m_quick_ack)
+                  socket_tuning::rearm_quick_ack(m_socket.native_handle());
+                do_read();
+              } else {
+                log_read_error(ec, m_reader.buffered_bytes());
+              }
+            }));
   }
 
   void do_write() {
     auto self = shared_from_this();
-
-    auto buffers_to_send = tcp_messaging::prepare_message(
-        m_read_body_buffer, m_write_header_buffer);
-
+    m_write_started_at = std::chrono::steady_clock::now();
     boost::asio::async_write(
-        m_socket, buffers_to_send,
-        [this, self](const boost::system::error_code &ec,
-                     std::size_t bytes_transferred) {
-          if (!ec) {
-             std::cout << "TCP Session: Wrote response of "
-                       << (bytes_transferred - tcp_messaging::HEADER_SIZE) <<
-                       " payload bytes." << std::endl;
-            do_read_header(); // Ready for the next message from this client
-          } else {
-            if (ec == boost::asio::error::operation_aborted) {
-              std::cout << "TCP Session: Operation aborted (likely server "
-                           "shutdown) while writing."
-                        << std::endl;
-            } else {
-              std::cerr << "TCP Session: Error writing response: "
-                        << ec.message() << std::endl;
-            }
-          }
-        });
+        m_socket, m_responder.buffers(),
+        handler_alloc::make_custom_alloc_handler(
+            m_write_memory, [this, self](const boost::system::error_code &ec,
+                                         std::size_t bytes_transferred) {
+              event_trace::interval("socket_write", "server",
+                                    m_write_started_at,
+                                    std::chrono::steady_clock::now());
+              if (!ec) {
+                m_timing.lap(server_stats::Stage::WRITE);
+                m_stats.record(m_timing);
+                m_stats.add_bytes_out(bytes_transferred);
+                progress::on_completed(
+                    m_frame.length,
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() -
+                        m_timing.started_at())
+                        .count());
+                m_frames_served++;
+                m_reader.consume(m_frame);
+                do_read(); // Ready for the next message from this client
+              } else {
+                log_write_error(ec);
+              }
+            }));
   }
 
   tcp::socket m_socket;
-  std::array<char, tcp_messaging::HEADER_SIZE> m_read_header_buffer;
-  std::vector<char> m_read_body_buffer;
-  std::array<char, tcp_messaging::HEADER_SIZE> m_write_header_buffer;
+  bool m_quick_ack; // Re-arm TCP_QUICKACK after every read
+  tcp_messaging::FrameReader m_reader;
+  tcp_messaging::Frame m_frame{}; // Frame currently being answered
+  FrameResponder m_responder;
+  server_stats::Stats &m_stats;
+  // Completion of the latest read: frames become ready there, so their queue
+  // wait is counted from it.
+  std::chrono::steady_clock::time_point m_received_at =
+      std::chrono::steady_clock::now();
+  server_stats::RequestTiming m_timing; // Stages of m_frame
+  std::chrono::steady_clock::time_point m_write_started_at;
+  // Reads and writes alternate, but each gets its own slot so a handler is
+  // never released and reacquired inside one completion.
+  handler_alloc::HandlerMemory m_read_memory;
+  handler_alloc::HandlerMemory m_write_memory;
+  std::uint64_t m_allocations_at_start;
+  std::size_t m_frames_served = 0;
 };
 
 class TCPServer {
 public:
-  TCPServer(boost::asio::io_context &io_context, unsigned short port)
-      : m_io_context(io_context),
-        m_acceptor(io_context, tcp::endpoint(tcp::v4(), port)) {
-    std::cout << "TCP Server listening on port " << port << std::endl;
+  TCPServer(boost::asio::io_context &io_context, unsigned short port,
+            const socket_tuning::Profile &socket_profile,
+            std::string download_file, server_stats::Stats &stats)
+      : m_io_context(io_context), m_acceptor(io_context),
+        m_socket_profile(socket_profile),
+        m_download_file(std::move(download_file)), m_stats(stats) {
+    // Options set on the listening socket before listen() are inherited by
+    // accepted connections, buffer sizes included.
+    tcp::endpoint endpoint(tcp::v4(), port);
+    m_acceptor.open(endpoint.protocol());
+    m_acceptor.set_option(tcp::acceptor::reuse_address(true));
+    socket_tuning::apply(m_acceptor.native_handle(), m_socket_profile,
+                         "TCP Server:");
+    m_acceptor.bind(endpoint);
+    m_acceptor.listen();
+    std::cout << "TCP Server listening on port " << port << ", socket profile "
+              << socket_tuning::to_string(m_socket_profile) << std::endl;
     do_accept();
   }
 
@@ -163,7 +165,23 @@ private:
     m_acceptor.async_accept([this](const boost::system::error_code &ec,
                                    tcp::socket socket) {
       if (!ec) {
-        std::make_shared<TCPSession>(std::move(socket))->start();
+        // Not every option is inherited (TCP_QUICKACK, SO_BUSY_POLL), so the
+        // accepted socket gets the whole profile again.
+        if (!m_socket_profile.is_default())
+          socket_tuning::apply(socket.native_handle(), m_socket_profile,
+                               "TCP Server:");
+#ifdef TCP_BENCH_COROUTINES
+        boost::asio::co_spawn(
+            m_io_context,
+            serve_session(std::move(socket), m_socket_profile.quick_ack,
+                          m_download_file, m_stats),
+            boost::asio::detached);
+#else
+        std::make_shared<TCPSession>(std::move(socket),
+                                     m_socket_profile.quick_ack,
+                                     m_download_file, m_stats)
+            ->start();
+#endif
       } else {
         if (ec == boost::asio::error::operation_aborted) {
           std::cout
@@ -185,12 +203,59 @@ private:
 
   boost::asio::io_context &m_io_context;
   tcp::acceptor m_acceptor;
+  socket_tuning::Profile m_socket_profile;
+  std::string m_download_file; // Served to --mode=download clients
+  server_stats::Stats &m_stats;
 };
 
-int main() {
+// --stats-interval: prints the stats every `interval` while requests keep
+// coming in (the per-run report on the last disconnect is always printed).
+void schedule_stats_dump(boost::asio::steady_timer &timer,
+                         server_stats::Stats &stats,
+                         std::chrono::seconds interval) {
+  timer.expires_after(interval);
+  timer.async_wait(
+      [&timer, &stats, interval](const boost::system::error_code &ec) {
+        if (ec)
+          return;
+        if (stats.requests_since_report() > 0)
+          stats.report(std::cout);
+        schedule_stats_dump(timer, stats, interval);
+      });
+}
+
+int main(int argc, char *argv[]) {
   try {
+    CliOptions options(argc, argv);
+    // Declared before the io_context: sessions still queued in it report
+    // their close while it is destroyed.
+    server_stats::Stats stats(config::CPP_SERVER_STATS_FILE);
     boost::asio::io_context io_context;
-    TCPServer server(io_context, config::TCP_SERVER_PORT);
+    // --download-file: what --mode=download clients receive (by default the
+    // test file a client generates in the same directory).
+    TCPServer server(
+        io_context, config::TCP_SERVER_PORT,
+        socket_tuning::from_options(options),
+        options.get_string("download-file", config::TEST_FILE_NAME), stats);
+
+    boost::asio::steady_timer stats_timer(io_context);
+    long long stats_interval = options.get_int(
+        "stats-interval", config::DEFAULT_SERVER_STATS_INTERVAL_S);
+    if (stats_interval > 0)
+      schedule_stats_dump(stats_timer, stats,
+                          std::chrono::seconds(stats_interval));
+    // --event-trace=file.json: saved with the stats after every client run
+    event_trace::start(options.get_string("event-trace", ""));
+    event_trace::set_thread_name("io_context");
+    // --progress-interval-ms / --progress-window: throughput and p99 over
+    // time, appended to the CSV until the server stops
+    progress::start(
+        "TCP server",
+        static_cast<int>(options.get_int("progress-interval-ms",
+                                         config::DEFAULT_PROGRESS_INTERVAL_MS)),
+        static_cast<int>(options.get_int(
+            "progress-window", config::DEFAULT_PROGRESS_WINDOW_INTERVALS)),
+        config::CPP_SERVER_PROGRESS_FILE);
 
 
     boost::asio::signal_set signals(io_context, SIGINT, SIGTERM);
@@ -204,6 +269,7 @@ int main() {
     });
 
     io_context.run();
+    progress::stop();
     std::cout << "TCP Server: io_context.run() finished. Server has shut down."
               << std::endl;
 
@@ -0,0 +1,109 @@
+// benchmark/server/tcp_session_coro.hpp
+// C++20 coroutine version of TCPSession, built with ASIO_API=coroutine.
+// The protocol work is the same FrameResponder; only the control flow
+// differs: one loop per connection instead of a chain of handlers. Coroutine
+// frames come from Asio's per-thread recycling allocator, so a steady-state
+// read/write costs no heap allocation here either.
+#ifndef TCP_SESSION_CORO_HPP
+#define TCP_SESSION_CORO_HPP
+
+#include "alloc_counter.hpp"
+#include "config.hpp"
+#include "progress.hpp"
+#include "event_trace.hpp"
+#include "server_stats.hpp"
+#include "session_common.hpp"
+#include "socket_tuning.hpp"
+#include "tcp_messaging.hpp"
+
+#include <boost/asio.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+inline boost::asio::awaitable<void>
+serve_session(boost::asio::ip::tcp::socket socket, bool quick_ack,
+              std::string download_file, server_stats::Stats &stats) {
+  using boost::asio::redirect_error;
+  using boost::asio::use_awaitable;
+
+  boost::system::error_code ec;
+  auto remote = socket.remote_endpoint(ec);
+  std::cout << "TCP Session: New connection from "
+            << remote.address().to_string() << ":" << remote.port()
+            << std::endl;
+
+  tcp_messaging::FrameReader reader(
+      config::RECEIVE_BUFFER_SIZE,
+      tcp_messaging::max_batch_frame_length(config::MAX_FRAME_PAYLOAD_SIZE));
+  tcp_messaging::Frame frame{};
+  FrameResponder responder(download_file);
+  std::uint64_t allocations_at_start = alloc_counter::allocations();
+  std::size_t frames_served = 0;
+  // Frames become ready when a read completes; queue wait counts from there.
+  auto received_at = std::chrono::steady_clock::now();
+  server_stats::RequestTiming timing;
+  stats.session_opened();
+
+  // Every complete frame already buffered is answered before the socket is
+  // read again, exactly like the callback session.
+  for (;;) {
+    auto status = reader.peek(frame);
+    if (status == tcp_messaging::FrameReader::Status::FRAME_TOO_LARGE) {
+      log_frame_too_large();
+      break;
+    }
+    if (status == tcp_messaging::FrameReader::Status::FRAME_READY) {
+      timing.start_at(received_at);
+      timing.lap(server_stats::Stage::QUEUE_WAIT);
+      if (!responder.respond(frame, timing))
+        break;
+      auto write_started_at = std::chrono::steady_clock::now();
+      std::size_t bytes_transferred = co_await boost::asio::async_write(
+          socket, responder.buffers(), redirect_error(use_awaitable, ec));
+      event_trace::interval("socket_write", "server", write_started_at,
+                            std::chrono::steady_clock::now());
+      if (ec) {
+        log_write_error(ec);
+        break;
+      }
+      timing.lap(server_stats::Stage::WRITE);
+      stats.record(timing);
+      stats.add_bytes_out(bytes_transferred);
+      progress::on_completed(
+          frame.length, std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() -
+                            timing.started_at())
+                            .count());
+      frames_served++;
+      reader.consume(frame);
+      continue;
+    }
+
+    std::size_t bytes_read = co_await socket.async_read_some(
+        reader.prepare(), redirect_error(use_awaitable, ec));
+    reader.commit(bytes_read);
+    received_at = std::chrono::steady_clock::now();
+    TCP_BENCH_TRACE_INSTANT("read_done", "server");
+    stats.add_bytes_in(bytes_read);
+    if (ec) {
+      log_read_error(ec, reader.buffered_bytes());
+      break;
+    }
+    if (quick_ack)
+      socket_tuning::rearm_quick_ack(socket.native_handle());
+  }
+
+  log_session_allocations(allocations_at_start, frames_served);
+  std::cout << "TCP Session: Connection closed with "
+            << remote.address().to_string() << std::endl;
+  stats.session_closed();
+}
+
+#endif // TCP_SESSION_CORO_HPP
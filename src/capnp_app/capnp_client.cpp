@@ -6,6 +6,8 @@
 #include <algorithm> // Для std::equal
 #include <chrono>    // Для замера времени
 #include <iomanip>   // Для std::fixed, std::setprecision при выводе метрик вручную
+#include <functional>
+#include <memory>
 
 // KJ includes
 #include <kj/async-io.h>
@@ -23,30 +25,431 @@
 #include "common/include/reversal_utils.hpp"
 #include "common/include/file_utils.hpp"
 #include "common/include/metrics_aggregator.hpp" // Включаем, но используем осторожно
+#include "common/include/cli_options.hpp"
+#include "common/include/sweep.hpp"
+#include "common/include/workload.hpp"
+#include "common/include/latency_trace.hpp"
+#include "common/include/event_tracer.hpp"
+#include "common/include/progress_reporter.hpp"
+#include "common/include/inflight_budget.hpp"
+#include "common/include/adaptive_window.hpp"
+#include "capnp_app/shm_ring_stream.hpp"
+#include "capnp_app/compressed_stream.hpp"
+#include "capnp_app/kj_socket_tuning.hpp"
+#include "capnp_app/message_sizing.hpp"
+#include "capnp_app/capnp_service.hpp"
+#include "common/include/socket_tuning.hpp"
+#include "common/include/server_stats.hpp"
+#include "common/include/worker_pool.hpp"
 
 #ifndef UNUSED_PARAM
 #define UNUSED_PARAM(x) (void)(x)
 #endif
 
-int main(int argc, char* argv[]) {
-    UNUSED_PARAM(argc);
-    UNUSED_PARAM(argv);
+static benchmark_common::TraceStamps toTraceStamps(TraceTimestamps::Reader trace) {
+    benchmark_common::TraceStamps stamps;
+    stamps.client_send_ns = trace.getClientSendNs();
+    stamps.server_recv_ns = trace.getServerRecvNs();
+    stamps.server_process_done_ns = trace.getServerProcessDoneNs();
+    stamps.server_send_ns = trace.getServerSendNs();
+    return stamps;
+}
+
+// Режим download: забирает у сервера чанки его файла (по одному запросу в полете), пока не
+// наберется requested_bytes или файл не закончится. Каждый чанк проверяется по CRC32 из ответа.
+// Возвращает объем проверенной полезной нагрузки.
+static size_t downloadFileChunks(FileProcessor::ChunkHandler::Client& chunkHandler,
+                                 kj::WaitScope& waitScope,
+                                 size_t chunk_size_bytes,
+                                 size_t requested_bytes,
+                                 benchmark_common::MetricsAggregator& metrics,
+                                 benchmark_common::ProgressReporter& progress) {
+    size_t chunks_received = 0;
+    size_t total_bytes_received = 0;
+    size_t total_bytes_verified_payload = 0;
+    auto overall_start_time = std::chrono::high_resolution_clock::now();
+
+    while (total_bytes_received < requested_bytes) {
+        auto dcRequest = chunkHandler.downloadChunkRequest();
+        dcRequest.setSize(static_cast<uint32_t>(std::min(chunk_size_bytes, requested_bytes - total_bytes_received)));
+
+        auto chunk_rtt_start_time = std::chrono::high_resolution_clock::now();
+        progress.on_sent();
+        auto dcResponse = [&] {
+            BENCHMARK_TRACE_SCOPE("download_chunk_rtt", "capnp_client");
+            return dcRequest.send().wait(waitScope);
+        }();
+        auto rtt_duration_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - chunk_rtt_start_time);
+
+        capnp::Data::Reader data = dcResponse.getResponse().getData();
+        if (data.size() == 0) {
+            break; // Файл сервера закончился
+        }
+        metrics.record_chunk_rtt_us(rtt_duration_us.count());
+        metrics.record_chunk_sent(data.size(), data.size());
+        progress.on_completed(data.size(), rtt_duration_us.count());
+        total_bytes_received += data.size();
+        chunks_received++;
+
+        if (benchmark_common::chunk_checksum(reinterpret_cast<const char*>(data.begin()), data.size()) !=
+            dcResponse.getChecksum()) {
+            std::string error_msg = "Verification FAILED for download chunk " + std::to_string(chunks_received) +
+                                    ": Checksum mismatch.";
+            std::cerr << "[CLIENT ERROR] " << error_msg << std::endl;
+            metrics.log_error(error_msg);
+            break;
+        }
+        total_bytes_verified_payload += data.size();
+    }
+
+    auto total_duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - overall_start_time);
+    metrics.set_total_transaction_time_ms(total_duration_ms.count());
+    return total_bytes_verified_payload;
+}
+
+// Отправляет файл по чанкам через chunkHandler и проверяет ответы. В полете до window запросов
+// (--window); с adaptive_window (--adaptive-window) окно подбирается по ходу прогона, а window
+// не используется. Ответы проверяются в продолжениях промисов, то есть в момент, когда цикл
+// событий KJ их разобрал, - RTT не включает ожидание очереди за более старыми запросами.
+// Сервер с --parallel-chunks завершает вызовы не по порядку: место в окне освобождает любой
+// пришедший ответ, а его ID сверяется с ID запроса.
+// byte_limit != 0 - только первые ~byte_limit байт файла (целыми чанками), для --sweep.
+// mode: echo - ответ сверяется с перевернутым чанком, upload - с размером и CRC32 из подтверждения,
+// download - файл клиента не читается, столько же байт забирается с сервера (по одному запросу).
+// trace != nullptr (--trace) - запросы несут отметку отправки, отметки из ответов идут в коллектор.
+// progress получает каждый запрос и ответ; отчеты печатает, только если запущен.
+// Возвращает объем проверенной полезной нагрузки.
+static size_t streamFileChunks(FileProcessor::ChunkHandler::Client& chunkHandler,
+                               kj::WaitScope& waitScope,
+                               const std::string& filename,
+                               size_t chunk_size_bytes,
+                               size_t byte_limit,
+                               capnp_benchmark::CompressedStream* compressed_stream,
+                               benchmark_common::MetricsAggregator& metrics,
+                               benchmark_common::ProgressReporter& progress,
+                               benchmark_common::WorkloadMode mode,
+                               size_t window,
+                               benchmark_common::AdaptiveWindow* adaptive_window,
+                               benchmark_common::TraceCollector* trace = nullptr) {
+    if (mode == benchmark_common::WorkloadMode::DOWNLOAD) {
+        return downloadFileChunks(chunkHandler, waitScope, chunk_size_bytes,
+                                  byte_limit != 0 ? byte_limit : benchmark_common::ACTUAL_FILE_SIZE_BYTES, metrics,
+                                  progress);
+    }
+    // --- Чтение и отправка файла по чанкам ---
+    benchmark_common::ChunkReader reader(filename, chunk_size_bytes);
+    // Открытие происходит в конструкторе ChunkReader в вашей реализации
+
+    // Запрос от отправки до проверки ответа. Запросы не копируют чанк в сообщение, а ссылаются
+    // на buffer внешним сегментом (referenceExternalChunk), поэтому слот и его буфер
+    // переиспользуются только после ответа. Буферы сохраняют емкость между чанками.
+    struct InflightChunk {
+        std::string buffer;
+        size_t chunk_number = 0; // Он же ID чанка в запросе
+        uint32_t checksum = 0; // Только upload
+        std::chrono::steady_clock::time_point sent_at;
+    };
+    const size_t max_window = std::max<size_t>(1, adaptive_window ? adaptive_window->max_window() : window);
+    std::vector<InflightChunk> slots(max_window);
+    std::vector<InflightChunk*> free_slots; // Слоты без запроса в полете
+    for (auto& slot : slots) free_slots.push_back(&slot);
+    size_t chunks_sent = 0;
+    size_t total_bytes_verified_payload = 0; // Только полезная нагрузка
+    size_t total_bytes_sent_payload = 0;
+    bool failed = false;
+    // Без сжатия размер на проводе не измеряется (УПРОЩЕНИЕ!); со сжатием каждому ответу
+    // приписываются кадры, записанные с предыдущего ответа.
+    uint64_t encoded_out_accounted = compressed_stream ? compressed_stream->stats().encoded_bytes_out : 0;
+    // Место в общем бюджете (--inflight-bytes) запрос занимает до проверки ответа
+    benchmark_common::InflightBudget& budget = benchmark_common::shared_inflight_budget();
+    const benchmark_common::InflightBudget::Stats budget_stats_at_start = budget.begin_run();
+
+    // Общая часть проверки ответа: RTT, метрики, окно.
+    auto recordCompletion = [&](const InflightChunk& chunk, std::chrono::steady_clock::time_point received_at) {
+        const size_t payload_size = chunk.buffer.size();
+        auto rtt_duration_us = std::chrono::duration_cast<std::chrono::microseconds>(received_at - chunk.sent_at);
+        benchmark_common::trace_interval("chunk_rtt", "capnp_client", chunk.sent_at, received_at);
+        metrics.record_chunk_rtt_us(rtt_duration_us.count());
+        progress.on_completed(payload_size, rtt_duration_us.count());
+        if (adaptive_window) adaptive_window->on_completion(payload_size, rtt_duration_us.count());
+        size_t on_wire_bytes = payload_size;
+        if (compressed_stream) {
+            const uint64_t encoded_out = compressed_stream->stats().encoded_bytes_out;
+            on_wire_bytes = static_cast<size_t>(encoded_out - encoded_out_accounted);
+            encoded_out_accounted = encoded_out;
+        }
+        metrics.record_chunk_sent(payload_size, on_wire_bytes);
+    };
+    auto reportFailure = [&](const std::string& error_msg) {
+        std::cerr << "[CLIENT ERROR] " << error_msg << std::endl;
+        metrics.log_error(error_msg);
+        failed = true; // Новые запросы не отправляются, отправленные дожидаются
+    };
+    auto checkResponseId = [&](const InflightChunk& chunk, uint64_t response_id) {
+        if (response_id == chunk.chunk_number) return true;
+        reportFailure("Verification FAILED for chunk " + std::to_string(chunk.chunk_number)
+                      + ": Response carries ID " + std::to_string(response_id) + ".");
+        return false;
+    };
+
+    // Ответ, освободивший слот, будит цикл отправки, если тот ждет места в окне
+    kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> slot_waiter;
+    auto releaseSlot = [&](InflightChunk* chunk) {
+        free_slots.push_back(chunk);
+        KJ_IF_MAYBE(waiter, slot_waiter) {
+            (*waiter)->fulfill();
+            slot_waiter = nullptr;
+        }
+    };
+    struct RequestErrorHandler final : public kj::TaskSet::ErrorHandler {
+        std::function<void(const std::string&)> report;
+        void taskFailed(kj::Exception&& exception) override {
+            report(std::string("RPC failed: ") + exception.getDescription().cStr());
+        }
+    };
+    RequestErrorHandler request_errors;
+    request_errors.report = reportFailure;
+    // Объявлены после всего, что захватывают продолжения: разрушаются первыми
+    kj::TaskSet pending(request_errors);
+    auto waitForSlot = [&] {
+        auto paf = kj::newPromiseAndFulfiller<void>();
+        slot_waiter = kj::mv(paf.fulfiller);
+        paf.promise.wait(waitScope);
+    };
+
+    auto overall_start_time = std::chrono::high_resolution_clock::now();
+
+    while (!failed) {
+        const size_t current_window = adaptive_window ? adaptive_window->window() : max_window;
+        const size_t in_flight = slots.size() - free_slots.size();
+        if (in_flight > 0 && (in_flight >= current_window || budget.would_block(chunk_size_bytes))) {
+            // Окно или бюджет заняты: ждем любой ответ (продолжение проверит его и вернет слот)
+            waitForSlot();
+            continue;
+        }
+        if (byte_limit != 0 && total_bytes_sent_payload >= byte_limit) {
+            break;
+        }
+        InflightChunk& chunk = *free_slots.back();
+        free_slots.pop_back();
+        if (chunk.buffer.capacity() == 0) {
+            chunk.buffer.reserve(capnp_benchmark::externalChunkCapacity(chunk_size_bytes));
+        }
+        reader.next_chunk_into(chunk.buffer);
+        if (chunk.buffer.empty() && reader.eof()) {
+            free_slots.push_back(&chunk);
+            break;
+        }
+        if (chunk.buffer.empty() && !reader.eof()) {
+            std::string error_msg = "Read empty chunk but not EOF.";
+            std::cerr << "[CLIENT ERROR] " << error_msg << " Aborting." << std::endl;
+            metrics.log_error(error_msg);
+            free_slots.push_back(&chunk);
+            break;
+        }
+
+        const size_t current_payload_size = chunk.buffer.size();
+        const uint64_t chunk_offset = total_bytes_sent_payload;
+        total_bytes_sent_payload += current_payload_size;
+        chunk.chunk_number = ++chunks_sent;
+        // Бюджет уже проверен выше, так что место выделяется без ожидания; освобождается вместе
+        // с продолжением, в том числе если запрос завершился исключением
+        auto reservation = kj::heap<benchmark_common::InflightReservation>(budget, current_payload_size);
+        InflightChunk* sent_chunk = &chunk;
+        // Слот возвращается и при исключении (ошибку сообщает RequestErrorHandler): после сбоя
+        // новых запросов нет, так что буфер уже не переиспользуется
+        auto slot_release = kj::defer([&releaseSlot, sent_chunk] { releaseSlot(sent_chunk); });
+
+        if (mode == benchmark_common::WorkloadMode::UPLOAD) {
+            auto ucRequest = chunkHandler.uploadChunkRequest(capnp_benchmark::chunkMessageSize(0));
+            ucRequest.getRequest().adoptData(capnp_benchmark::referenceExternalChunk(ucRequest.getRequest(), chunk.buffer));
+            chunk.checksum = benchmark_common::chunk_checksum(chunk.buffer.data(), chunk.buffer.size());
+            ucRequest.getRequest().setId(chunk.chunk_number);
+            auto meta = ucRequest.getRequest().initMeta();
+            meta.setSequence(chunk.chunk_number);
+            meta.setOffset(chunk_offset);
+            meta.setChecksum(chunk.checksum);
+
+            chunk.sent_at = std::chrono::steady_clock::now();
+            if (trace) ucRequest.getRequest().initTrace().setClientSendNs(benchmark_common::trace_now_ns());
+            progress.on_sent();
+            pending.add(ucRequest.send().then([&, sent_chunk](auto&& ucResponse) {
+                const int64_t client_recv_ns = benchmark_common::trace_now_ns();
+                recordCompletion(*sent_chunk, std::chrono::steady_clock::now());
+                auto ack = ucResponse.getAck();
+                if (trace && ack.hasTrace()) trace->record(toTraceStamps(ack.getTrace()), client_recv_ns);
+                if (!checkResponseId(*sent_chunk, ack.getId())) return;
+                if (ack.getSize() != sent_chunk->buffer.size() || ack.getChecksum() != sent_chunk->checksum) {
+                    reportFailure("Verification FAILED for chunk " + std::to_string(sent_chunk->chunk_number)
+                                  + ": Upload ack mismatch (server got " + std::to_string(ack.getSize()) + " bytes).");
+                    return;
+                }
+                total_bytes_verified_payload += sent_chunk->buffer.size();
+            }).attach(kj::mv(reservation), kj::mv(slot_release)));
+            continue;
+        }
+
+        auto pcRequest = chunkHandler.processChunkRequest(capnp_benchmark::chunkMessageSize(0));
+        pcRequest.getRequest().adoptData(capnp_benchmark::referenceExternalChunk(pcRequest.getRequest(), chunk.buffer));
+        pcRequest.getRequest().setId(chunk.chunk_number);
+        auto meta = pcRequest.getRequest().initMeta();
+        meta.setSequence(chunk.chunk_number);
+        meta.setOffset(chunk_offset);
+
+        chunk.sent_at = std::chrono::steady_clock::now();
+        if (trace) pcRequest.getRequest().initTrace().setClientSendNs(benchmark_common::trace_now_ns());
+        progress.on_sent();
+        // Цикл событий KJ крутится внутри wait(): отправка, ожидание и разбор ответов
+        pending.add(pcRequest.send().then([&, sent_chunk](auto&& pcResponse) {
+            const int64_t client_recv_ns = benchmark_common::trace_now_ns();
+            recordCompletion(*sent_chunk, std::chrono::steady_clock::now());
+            if (trace && pcResponse.getResponse().hasTrace()) {
+                trace->record(toTraceStamps(pcResponse.getResponse().getTrace()), client_recv_ns);
+            }
+            if (!checkResponseId(*sent_chunk, pcResponse.getResponse().getId())) return;
+
+            const std::string& sent_data = sent_chunk->buffer;
+            capnp::Data::Reader response_data_reader = pcResponse.getResponse().getData();
+            if (response_data_reader.size() != sent_data.size()) {
+                reportFailure("Verification FAILED for chunk " + std::to_string(sent_chunk->chunk_number)
+                              + ": Size mismatch. Expected " + std::to_string(sent_data.size())
+                              + ", Got " + std::to_string(response_data_reader.size()));
+                return;
+            }
 
+            BENCHMARK_TRACE_SCOPE("verify", "capnp_client");
+            // Сравнение прямо с сегментом ответа: перевернутый оригинал без промежуточных копий
+            if (!std::equal(sent_data.rbegin(), sent_data.rend(),
+                            reinterpret_cast<const char*>(response_data_reader.begin()))) {
+                reportFailure("Verification FAILED for chunk " + std::to_string(sent_chunk->chunk_number) +
+                              ": Content mismatch.");
+                return;
+            }
+            total_bytes_verified_payload += sent_data.size();
+        }).attach(kj::mv(reservation), kj::mv(slot_release)));
+    }
+    pending.onEmpty().wait(waitScope);
+
+    auto overall_end_time = std::chrono::high_resolution_clock::now();
+    auto total_duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(overall_end_time - overall_start_time);
+    metrics.set_total_transaction_time_ms(total_duration_ms.count());
+    metrics.set_run_parameter("inflight_budget", benchmark_common::InflightBudget::describe(
+        budget_stats_at_start, budget.stats(), budget.max_bytes(), budget.max_requests()));
+    if (adaptive_window) {
+        metrics.set_run_parameter("adaptive_window", adaptive_window->describe());
+        std::cout << "[CLIENT INFO] Adaptive " << adaptive_window->describe() << std::endl;
+    } else {
+        metrics.set_run_parameter("window", std::to_string(max_window));
+    }
+
+    return total_bytes_verified_payload;
+}
+
+int main(int argc, char* argv[]) {
     std::cout << "[CLIENT INFO] Starting Cap'n Proto client." << std::endl;
 
+    benchmark_common::CliOptions options(argc, argv);
+    benchmark_common::Transport transport;
+    try {
+        transport = benchmark_common::transport_from_string(
+            options.get_string("transport", benchmark_common::DEFAULT_TRANSPORT));
+    } catch (const std::exception& e) {
+        std::cerr << "[CLIENT ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    const std::string transport_name = benchmark_common::transport_to_string(transport);
+    // --shm-ring-size: байт в кольце каждого направления (--transport=shm)
+    size_t ring_capacity;
+    try {
+        ring_capacity = options.get_size("shm-ring-size", benchmark_common::SHM_RING_CAPACITY_BYTES);
+    } catch (const std::exception& e) {
+        std::cerr << "[CLIENT ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    if (ring_capacity == 0 || ring_capacity > benchmark_common::SHM_RING_MAX_CAPACITY_BYTES) {
+        std::cerr << "[CLIENT ERROR] --shm-ring-size must be between 1 and "
+                  << benchmark_common::SHM_RING_MAX_CAPACITY_BYTES << " bytes." << std::endl;
+        return 1;
+    }
+    if (transport == benchmark_common::Transport::INPROC && options.get_bool("socket-sweep", false)) {
+        std::cerr << "[CLIENT ERROR] --socket-sweep needs a real connection (--transport=tcp|unix|shm)." << std::endl;
+        return 1;
+    }
+
+    benchmark_common::ContentProfile content_profile;
+    benchmark_common::Codec codec;
+    benchmark_common::SocketTuning socket_tuning;
+    benchmark_common::WorkloadMode workload_mode;
+    try {
+        content_profile = benchmark_common::content_profile_from_string(options.get_string("content", "random"));
+        codec = benchmark_common::codec_from_string(options.get_string("compression", "none"));
+        socket_tuning = benchmark_common::socket_tuning_from_options(options);
+        workload_mode = benchmark_common::workload_mode_from_string(options.get_string("mode", "echo"));
+    } catch (const std::exception& e) {
+        std::cerr << "[CLIENT ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+
     // --- Конфигурация ---
-    const std::string test_filename = benchmark_common::TEST_FILE_NAME;
+    const std::string test_filename =
+        benchmark_common::test_file_name_for_profile(benchmark_common::TEST_FILE_NAME, content_profile);
     const size_t target_file_size_bytes = benchmark_common::ACTUAL_FILE_SIZE_BYTES;
-    const size_t chunk_size_bytes = benchmark_common::CHUNK_SIZE_BYTES;
+    size_t chunk_size_bytes;
+    try {
+        chunk_size_bytes = options.get_size("chunk-size", benchmark_common::CHUNK_SIZE_BYTES);
+    } catch (const std::exception& e) {
+        std::cerr << "[CLIENT ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    if (chunk_size_bytes == 0) {
+        std::cerr << "[CLIENT ERROR] --chunk-size must be positive." << std::endl;
+        return 1;
+    }
+    // --window=N: запросов в полете; --adaptive-window: окно подбирается, --window-max - его предел
+    size_t pipeline_window;
+    const bool adaptive_window_enabled = options.get_bool("adaptive-window", false);
+    benchmark_common::AdaptiveWindowOptions adaptive_window_options;
+    try {
+        benchmark_common::configure_shared_inflight_budget(options);
+        pipeline_window = options.get_size("window", benchmark_common::DEFAULT_CAPNP_WINDOW);
+        if (adaptive_window_enabled) {
+            adaptive_window_options = benchmark_common::adaptive_window_options_from_options(
+                options, benchmark_common::ADAPTIVE_WINDOW_DEFAULT_MAX);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[CLIENT ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    if (pipeline_window == 0) {
+        std::cerr << "[CLIENT ERROR] --window must be positive." << std::endl;
+        return 1;
+    }
+    // Новый подбор окна на каждый прогон (точки свипов - отдельные прогоны)
+    auto makeAdaptiveWindow = [&]() -> std::unique_ptr<benchmark_common::AdaptiveWindow> {
+        if (!adaptive_window_enabled) return nullptr;
+        return std::make_unique<benchmark_common::AdaptiveWindow>(adaptive_window_options);
+    };
+    if (adaptive_window_enabled) {
+        std::cout << "[CLIENT INFO] Adaptive in-flight window, up to " << adaptive_window_options.max_window
+                  << " requests." << std::endl;
+    } else if (pipeline_window > 1) {
+        std::cout << "[CLIENT INFO] Pipelining " << pipeline_window << " requests in flight." << std::endl;
+    }
     const std::string server_connect_to = benchmark_common::CAPNP_CLIENT_CONNECT_TO;
     const int server_port = benchmark_common::CAPNP_SERVER_PORT;
 
     // --- Инициализация MetricsAggregator ---
+    const std::string metrics_name =
+        transport == benchmark_common::Transport::TCP ? "CapnProto" : "CapnProto-" + transport_name;
     benchmark_common::MetricsAggregator metrics(
-        "CapnProto",
+        metrics_name,
         target_file_size_bytes,
         chunk_size_bytes
     );
+    metrics.set_run_parameter("socket_profile", benchmark_common::socket_tuning_to_string(socket_tuning));
+    metrics.set_run_parameter("mode", benchmark_common::workload_mode_to_string(workload_mode));
 
 bool regenerate_new_file = true; // ИСПРАВЛЕНО ИМЯ ПЕРЕМЕННОЙ
     std::ifstream test_file_check(test_filename, std::ios::binary | std::ios::ate);
@@ -68,7 +471,7 @@ bool regenerate_new_file = true; // ИСПРАВЛЕНО ИМЯ ПЕРЕМЕНН
     }
 
     if (regenerate_new_file) {
-        if (!benchmark_common::generate_test_file(test_filename, target_file_size_bytes)) {
+        if (!benchmark_common::generate_test_file(test_filename, target_file_size_bytes, content_profile)) {
             std::cerr << "[CLIENT ERROR] Failed to generate test file '" << test_filename << "'. Exiting." << std::endl;
             metrics.log_error("Failed to generate test file");
             // ... (сохранение метрик при ошибке, если нужно) ...
@@ -78,24 +481,186 @@ bool regenerate_new_file = true; // ИСПРАВЛЕНО ИМЯ ПЕРЕМЕНН
     // --- Конец генерации файла ---
 
     std::string server_address_str = server_connect_to + ":" + std::to_string(server_port);
+    if (transport == benchmark_common::Transport::INPROC) {
+        server_address_str = "in-process server";
+    } else if (transport != benchmark_common::Transport::TCP) {
+        // unix и shm подключаются к одному и тому же Unix domain socket.
+        server_address_str = "unix:" + options.get_string("socket-path", benchmark_common::CAPNP_UNIX_SOCKET_PATH);
+    }
     std::cout << "[CLIENT INFO] Will connect to " << server_address_str << std::endl;
 
+    // --trace: разбивка RTT по этапам из отметок клиента и сервера (download не трассируется)
+    benchmark_common::TraceCollector trace_collector(metrics_name);
+    const bool trace_enabled = options.get_bool("trace", false) &&
+                               workload_mode != benchmark_common::WorkloadMode::DOWNLOAD;
+    if (trace_enabled) {
+        std::cout << "[CLIENT INFO] Per-stage latency tracing enabled." << std::endl;
+    }
+
+    // Счетчики хода прогона; отчеты идут только для основного прогона, не для точек --sweep
+    benchmark_common::ProgressReporter progress("Cap'n Proto client");
+
+    std::string csv_transport_suffix = (transport == benchmark_common::Transport::TCP) ? "" : "_" + transport_name;
+    if (codec != benchmark_common::Codec::NONE) {
+        csv_transport_suffix += "_" + benchmark_common::codec_to_string(codec) + "_"
+                              + benchmark_common::content_profile_to_string(content_profile);
+    }
+    if (workload_mode != benchmark_common::WorkloadMode::ECHO) {
+        csv_transport_suffix += "_" + benchmark_common::workload_mode_to_string(workload_mode);
+        std::cout << "[CLIENT INFO] Workload mode: " << benchmark_common::workload_mode_to_string(workload_mode) << std::endl;
+    }
+
     try {
         kj::AsyncIoContext ioContext = kj::setupAsyncIo();
         kj::Network& network = ioContext.provider->getNetwork();
         kj::WaitScope& waitScope = ioContext.waitScope;
 
-        std::cout << "[CLIENT DEBUG] Connecting to " << server_address_str << "..." << std::endl;
-        kj::Own<kj::AsyncIoStream> stream = network.parseAddress(server_address_str)
-                                                .then([&](kj::Own<kj::NetworkAddress> addr){
-                                                    return addr->connect();
-                                                }).wait(waitScope);
-        std::cout << "[CLIENT DEBUG] Connected." << std::endl;
+        // --transport=inproc: FileProcessor (capnp_service.hpp) работает в этом же цикле событий, а
+        // соединение - kj::newTwoWayPipe(): те же RPC-кадры и сериализация, что по сокету, но без
+        // ядра. Состояние сервера объявлено раньше соединений, чтобы пережить их; --parallel-chunks
+        // и --parallel-min-bytes - как у capnp_server, метрики этапов печатаются после каждого прогона.
+        std::unique_ptr<benchmark_common::ServerStats> inproc_stats;
+        std::unique_ptr<benchmark_common::WorkerPool> inproc_pool;
+        const std::string inproc_download_file = options.get_string("download-file", benchmark_common::TEST_FILE_NAME);
+        const size_t inproc_parallel_min_bytes =
+            options.get_size("parallel-min-bytes", benchmark_common::DEFAULT_CAPNP_PARALLEL_MIN_BYTES);
+        if (transport == benchmark_common::Transport::INPROC) {
+            inproc_stats = std::make_unique<benchmark_common::ServerStats>("Cap'nProto-inproc",
+                                                                           "capnp_inproc_server_stats.csv");
+            const size_t parallel_chunks =
+                options.get_size("parallel-chunks", benchmark_common::DEFAULT_SERVER_PARALLEL_CHUNKS);
+            if (parallel_chunks > 0) {
+                inproc_pool = std::make_unique<benchmark_common::WorkerPool>(
+                    parallel_chunks, benchmark_common::SERVER_WORKER_QUEUE_CAPACITY, "capnp-chunk-worker");
+            }
+        }
+        capnp_benchmark::LoggingTaskErrorHandler inproc_error_handler;
+        kj::TaskSet inproc_server_tasks(inproc_error_handler);
+
+        // Соединение с сервером с заданным профилем сокета. Для tcp с профилем, отличным от default,
+        // сокет открывается вручную (опции до connect(), чтобы буферы повлияли на окно) и
+        // оборачивается в поток KJ; поверх - shm-кольца и сжатие кадров, как выбрано.
+        auto connectToServer = [&](const benchmark_common::SocketTuning& tuning,
+                                   capnp_benchmark::CompressedStream*& compressed_out) -> kj::Own<kj::AsyncIoStream> {
+            std::cout << "[CLIENT DEBUG] Connecting to " << server_address_str << "..." << std::endl;
+            kj::Own<kj::AsyncIoStream> stream;
+            if (transport == benchmark_common::Transport::INPROC) {
+                kj::TwoWayPipe pipe = kj::newTwoWayPipe();
+                kj::Own<kj::AsyncIoStream> server_end = kj::mv(pipe.ends[1]);
+                if (codec != benchmark_common::Codec::NONE) {
+                    server_end = kj::heap<capnp_benchmark::CompressedStream>(kj::mv(server_end), codec);
+                }
+                inproc_server_tasks.add(capnp_benchmark::serveConnection(
+                    kj::mv(server_end), inproc_download_file, *inproc_stats, inproc_pool.get(), inproc_parallel_min_bytes));
+                stream = kj::mv(pipe.ends[0]);
+            } else if (transport == benchmark_common::Transport::TCP && !tuning.is_default()) {
+                int fd = benchmark_common::connect_tuned_tcp_socket(server_connect_to, server_port, tuning, "[CLIENT ERROR]");
+                if (fd < 0) {
+                    throw std::runtime_error("Failed to connect a tuned socket to " + server_address_str);
+                }
+                stream = ioContext.lowLevelProvider->wrapConnectedSocketFd(
+                    fd, kj::LowLevelAsyncIoProvider::TAKE_OWNERSHIP);
+                std::cout << "[CLIENT INFO] Socket profile: " << benchmark_common::socket_tuning_to_string(tuning) << std::endl;
+            } else {
+                stream = network.parseAddress(server_address_str)
+                             .then([&](kj::Own<kj::NetworkAddress> addr){
+                                 return addr->connect();
+                             }).wait(waitScope);
+            }
+            std::cout << "[CLIENT DEBUG] Connected." << std::endl;
+
+            if (transport == benchmark_common::Transport::SHM) {
+                stream = capnp_benchmark::connectShmRingStream(kj::mv(stream), ring_capacity).wait(waitScope);
+                std::cout << "[CLIENT DEBUG] Shared-memory rings established (" << ring_capacity << " bytes per direction)." << std::endl;
+            }
+
+            // Сжатие кадров поверх выбранного транспорта; сервер должен быть запущен с --compression тоже.
+            compressed_out = nullptr;
+            if (codec != benchmark_common::Codec::NONE) {
+                auto wrapped = kj::heap<capnp_benchmark::CompressedStream>(kj::mv(stream), codec);
+                compressed_out = wrapped.get();
+                stream = kj::mv(wrapped);
+                std::cout << "[CLIENT INFO] Frame compression: " << benchmark_common::codec_to_string(codec)
+                          << ", content profile: " << benchmark_common::content_profile_to_string(content_profile) << std::endl;
+            }
+            return stream;
+        };
+
+        if (options.get_bool("socket-sweep", false)) {
+            // Новое соединение на каждый профиль сокета; сервер работает со своим --socket-profile
+            const size_t sweep_bytes = options.get_size("sweep-bytes", benchmark_common::SWEEP_BYTES_PER_POINT);
+            std::vector<benchmark_common::LabeledSweepPoint> points;
+            for (const std::string& preset : benchmark_common::socket_tuning_sweep_presets()) {
+                benchmark_common::SocketTuning point_tuning = benchmark_common::socket_tuning_preset(preset);
+                std::cout << "[CLIENT INFO] Socket sweep: " << benchmark_common::socket_tuning_to_string(point_tuning) << std::endl;
+                benchmark_common::MetricsAggregator point_metrics(metrics_name, sweep_bytes, chunk_size_bytes);
+                capnp_benchmark::CompressedStream* point_compressed = nullptr;
+                kj::Own<kj::AsyncIoStream> point_stream = connectToServer(point_tuning, point_compressed);
+                capnp::TwoPartyClient point_client(*point_stream);
+                FileProcessor::Client pointProcessor = point_client.bootstrap().castAs<FileProcessor>();
+                FileProcessor::ChunkHandler::Client pointHandler =
+                    pointProcessor.startStreamingRequest().send().wait(waitScope).getHandler();
+                auto point_window = makeAdaptiveWindow();
+                streamFileChunks(pointHandler, waitScope, test_filename, chunk_size_bytes, sweep_bytes,
+                                 point_compressed, point_metrics, progress, workload_mode, pipeline_window,
+                                 point_window.get());
+                pointHandler.doneStreamingRequest().send().wait(waitScope);
+
+                benchmark_common::LabeledSweepPoint point;
+                point.label = preset;
+                point.result.chunk_size_bytes = chunk_size_bytes;
+                point.result.throughput_mbps = point_metrics.get_throughput_payload_mbps();
+                point.result.avg_rtt_ms = point_metrics.get_avg_chunk_rtt_ms();
+                point.result.p99_rtt_ms = point_metrics.get_percentile_chunk_rtt_ms(99.0);
+                point.result.errors = point_metrics.get_error_count();
+                points.push_back(point);
+            }
+            benchmark_common::print_labeled_sweep_report("Socket Profile Sweep", metrics_name, points);
+            benchmark_common::save_labeled_sweep_csv("capnp" + csv_transport_suffix + "_socket_sweep.csv", metrics_name, points);
+            std::cout << "[CLIENT INFO] Client finished successfully." << std::endl;
+            return 0;
+        }
+
+        capnp_benchmark::CompressedStream* compressed_stream = nullptr;
+        kj::Own<kj::AsyncIoStream> stream = connectToServer(socket_tuning, compressed_stream);
 
         capnp::TwoPartyClient client(*stream);
         FileProcessor::Client fileProcessor = client.bootstrap().castAs<FileProcessor>();
         std::cout << "[CLIENT DEBUG] Bootstrap interface obtained." << std::endl;
 
+        if (options.get_bool("sweep", false)) {
+            // Каждый размер чанка - отдельная сессия startStreaming/doneStreaming на том же соединении
+            const size_t sweep_bytes = options.get_size("sweep-bytes", benchmark_common::SWEEP_BYTES_PER_POINT);
+            std::vector<benchmark_common::SweepPoint> points;
+            for (size_t sweep_chunk : benchmark_common::sweep_chunk_sizes(
+                     options.get_size("sweep-min", benchmark_common::SWEEP_MIN_CHUNK_BYTES),
+                     options.get_size("sweep-max", benchmark_common::SWEEP_MAX_CHUNK_BYTES))) {
+                std::cout << "[CLIENT INFO] Sweep: chunk size " << sweep_chunk << " bytes." << std::endl;
+                benchmark_common::MetricsAggregator point_metrics(metrics_name, sweep_bytes, sweep_chunk);
+                FileProcessor::ChunkHandler::Client pointHandler =
+                    fileProcessor.startStreamingRequest().send().wait(waitScope).getHandler();
+                auto point_window = makeAdaptiveWindow();
+                streamFileChunks(pointHandler, waitScope, test_filename, sweep_chunk, sweep_bytes,
+                                 compressed_stream, point_metrics, progress, workload_mode, pipeline_window,
+                                 point_window.get());
+                pointHandler.doneStreamingRequest().send().wait(waitScope);
+
+                benchmark_common::SweepPoint point;
+                point.chunk_size_bytes = sweep_chunk;
+                point.throughput_mbps = point_metrics.get_throughput_payload_mbps();
+                point.avg_rtt_ms = point_metrics.get_avg_chunk_rtt_ms();
+                point.p99_rtt_ms = point_metrics.get_percentile_chunk_rtt_ms(99.0);
+                point.errors = point_metrics.get_error_count();
+                points.push_back(point);
+            }
+            size_t knee = benchmark_common::find_throughput_knee(
+                points, options.get_int("knee-tolerance-pct", benchmark_common::SWEEP_KNEE_TOLERANCE_PCT) / 100.0);
+            benchmark_common::print_sweep_report(metrics_name, points, knee);
+            benchmark_common::save_sweep_csv("capnp" + csv_transport_suffix + "_sweep.csv", metrics_name, points, knee);
+            std::cout << "[CLIENT INFO] Client finished successfully." << std::endl;
+            return 0;
+        }
+
         std::cout << "[CLIENT DEBUG] Calling startStreaming..." << std::endl;
         auto ssRequest = fileProcessor.startStreamingRequest();
         auto ssResponse = ssRequest.send().wait(waitScope);
@@ -103,83 +668,44 @@ bool regenerate_new_file = true; // ИСПРАВЛЕНО ИМЯ ПЕРЕМЕНН
         std::cout << "[CLIENT DEBUG] Got ChunkHandler." << std::endl;
 
         // --- Чтение и отправка файла по чанкам ---
-        benchmark_common::ChunkReader reader(test_filename, chunk_size_bytes);
-        // Открытие происходит в конструкторе ChunkReader в вашей реализации
-
-        std::vector<char> chunk_buffer;
-        size_t chunks_sent = 0;
-        size_t total_bytes_verified_payload = 0; // Только полезная нагрузка
-
-        auto overall_start_time = std::chrono::high_resolution_clock::now();
-
-        while (true) {
-            chunk_buffer = reader.next_chunk();
-            if (chunk_buffer.empty() && reader.eof()) {
-                break;
-            }
-            if (chunk_buffer.empty() && !reader.eof()) {
-                std::string error_msg = "Read empty chunk but not EOF.";
-                std::cerr << "[CLIENT ERROR] " << error_msg << " Aborting." << std::endl;
-                metrics.log_error(error_msg);
-                break;
-            }
-
-            size_t current_payload_size = chunk_buffer.size();
-            size_t estimated_on_wire_for_chunk_data = current_payload_size; // УПРОЩЕНИЕ!
-            metrics.record_chunk_sent(current_payload_size, estimated_on_wire_for_chunk_data);
-
-            std::vector<char> expected_reversed_chunk = chunk_buffer;
-            benchmark_common::reverse_bytes(expected_reversed_chunk);
-
-            auto pcRequest = chunkHandler.processChunkRequest();
-            kj::ArrayPtr<const kj::byte> request_bytes_ptr(reinterpret_cast<const kj::byte*>(chunk_buffer.data()), chunk_buffer.size());
-            pcRequest.getRequest().setData(request_bytes_ptr);
-
-            auto chunk_rtt_start_time = std::chrono::high_resolution_clock::now();
-            auto pcPromise = pcRequest.send();
-            auto pcResponse = pcPromise.wait(waitScope);
-            auto chunk_rtt_end_time = std::chrono::high_resolution_clock::now();
-            auto rtt_duration_us = std::chrono::duration_cast<std::chrono::microseconds>(chunk_rtt_end_time - chunk_rtt_start_time);
-            metrics.record_chunk_rtt_us(rtt_duration_us.count());
-
-            capnp::Data::Reader response_data_reader = pcResponse.getResponse().getData();
-            if (response_data_reader.size() != expected_reversed_chunk.size()) {
-                std::string error_msg = "Verification FAILED for chunk " + std::to_string(chunks_sent + 1)
-                                      + ": Size mismatch. Expected " + std::to_string(expected_reversed_chunk.size())
-                                      + ", Got " + std::to_string(response_data_reader.size());
-                std::cerr << "[CLIENT ERROR] " << error_msg << std::endl;
-                metrics.log_error(error_msg);
-                break;
-            }
-
-            std::vector<char> received_reversed_chunk(response_data_reader.size());
-            memcpy(received_reversed_chunk.data(), response_data_reader.begin(), response_data_reader.size());
-
-            if (received_reversed_chunk != expected_reversed_chunk) {
-                 std::string error_msg = "Verification FAILED for chunk " + std::to_string(chunks_sent + 1) + ": Content mismatch.";
-                std::cerr << "[CLIENT ERROR] " << error_msg << std::endl;
-                metrics.log_error(error_msg);
-                break;
-            }
-            total_bytes_verified_payload += current_payload_size;
-            chunks_sent++;
-             if (chunks_sent % 500 == 0 || chunks_sent == 1) { // Логируем прогресс
-                 std::cout << "[CLIENT PROGRESS] Processed " << chunks_sent << " chunks. Verified "
-                           << std::fixed << std::setprecision(2) << (total_bytes_verified_payload / (1024.0*1024.0)) << " MB. Last RTT: "
-                           << rtt_duration_us.count() << " us." << std::endl;
-             }
-        }
-
-        auto overall_end_time = std::chrono::high_resolution_clock::now();
-        auto total_duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(overall_end_time - overall_start_time);
-        metrics.set_total_transaction_time_ms(total_duration_ms.count());
+        benchmark_common::start_event_trace(options.get_string("event-trace", ""));
+        benchmark_common::set_event_trace_thread_name("capnp-event-loop");
+        // --progress-interval-ms / --progress-window: временной ряд пропускной способности и p99
+        progress.start(
+            static_cast<int>(options.get_int("progress-interval-ms", benchmark_common::DEFAULT_PROGRESS_INTERVAL_MS)),
+            static_cast<int>(options.get_int("progress-window", benchmark_common::DEFAULT_PROGRESS_WINDOW_INTERVALS)),
+            "capnp" + csv_transport_suffix + "_progress.csv");
+        std::unique_ptr<benchmark_common::AdaptiveWindow> adaptive_window = makeAdaptiveWindow();
+        size_t total_bytes_verified_payload = streamFileChunks(
+            chunkHandler, waitScope, test_filename, chunk_size_bytes, 0, compressed_stream, metrics, progress,
+            workload_mode, pipeline_window, adaptive_window.get(), trace_enabled ? &trace_collector : nullptr);
+        if (adaptive_window) adaptive_window->save_csv("capnp" + csv_transport_suffix + "_window.csv");
+        progress.stop();
+        benchmark_common::stop_event_trace();
 
         std::cout << "[CLIENT DEBUG] Calling doneStreaming..." << std::endl;
         auto doneRequest = chunkHandler.doneStreamingRequest();
         doneRequest.send().wait(waitScope);
         std::cout << "[CLIENT DEBUG] doneStreaming completed." << std::endl;
+        if (inproc_stats) {
+            // Сервер в процессе печатает метрики этапов, когда видит отключение: закрываем запись
+            // и даем ему дочитать поток (не дольше секунды)
+            stream->shutdownWrite();
+            inproc_server_tasks.onEmpty()
+                .exclusiveJoin(ioContext.provider->getTimer().afterDelay(1 * kj::SECONDS))
+                .wait(waitScope);
+        }
 
         std::cout << "[CLIENT INFO] File transfer processing finished by client." << std::endl;
+        if (compressed_stream) {
+            const auto& st = compressed_stream->stats();
+            std::cout << "[CLIENT INFO] Compression (" << benchmark_common::codec_to_string(codec) << "): sent "
+                      << st.raw_bytes_out << " raw -> " << st.encoded_bytes_out << " on wire (ratio "
+                      << std::fixed << std::setprecision(3)
+                      << (st.encoded_bytes_out ? static_cast<double>(st.raw_bytes_out) / st.encoded_bytes_out : 0.0)
+                      << "), received " << st.encoded_bytes_in << " -> " << st.raw_bytes_in
+                      << ", frames sent uncompressed: " << st.frames_sent_uncompressed << "/" << st.frames_out << std::endl;
+        }
 
         if (total_bytes_verified_payload != target_file_size_bytes) {
              std::string warn_msg = "Not all data was verified! Verified (payload): " + std::to_string(total_bytes_verified_payload) +
@@ -219,8 +745,12 @@ bool regenerate_new_file = true; // ИСПРАВЛЕНО ИМЯ ПЕРЕМЕНН
 
     // Вывод и сохранение метрик при успешном завершении
     metrics.print_summary_to_console();
-    metrics.save_summary_csv("capnp_summary_results.csv");
-    metrics.save_detailed_rtt_csv("capnp_detailed_rtt_results.csv");
+    metrics.save_summary_csv("capnp" + csv_transport_suffix + "_summary_results.csv");
+    metrics.save_detailed_rtt_csv("capnp" + csv_transport_suffix + "_detailed_rtt_results.csv");
+    if (trace_enabled) {
+        trace_collector.print_summary();
+        trace_collector.save_csv("capnp" + csv_transport_suffix + "_trace.csv");
+    }
 
     std::cout << "[CLIENT INFO] Client finished successfully." << std::endl;
     return 0;
@@ -1,5 +1,7 @@
 // capnp_app/capnp_server.cpp
 #include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
 
 // KJ includes
@@ -17,80 +19,102 @@
 // Сгенерированный код и общие утилиты
 #include "benchmark.capnp.h" // Убедитесь, что #include "benchmark.capnp.h", а не "gen_capnp/..."
 #include "common/include/config.hpp"
-#include "common/include/reversal_utils.hpp"
+#include "common/include/cli_options.hpp"
+#include "common/include/file_utils.hpp"
+#include "capnp_app/shm_ring_stream.hpp"
+#include "capnp_app/compressed_stream.hpp"
+#include "capnp_app/kj_socket_tuning.hpp"
+#include "capnp_app/capnp_service.hpp"
+#include "common/include/socket_tuning.hpp"
+#include "common/include/server_stats.hpp"
+#include "common/include/event_tracer.hpp"
+#include "common/include/worker_pool.hpp"
+
+#include <cstdio> // Для std::remove (удаление устаревшего файла сокета)
 
 #ifndef UNUSED_PARAM
 #define UNUSED_PARAM(x) (void)(x)
 #endif
 
-// --- Реализации интерфейсов Cap'n Proto ---
-class ChunkHandlerImpl final : public FileProcessor::ChunkHandler::Server {
-public:
-    kj::Promise<void> processChunk(ProcessChunkContext context) override {
-        KJ_LOG(INFO, "Cap'n Proto Server: processChunk called.");
-        try {
-            capnp::Data::Reader request_data = context.getParams().getRequest().getData();
-            std::vector<char> chunk_vec(request_data.size());
-            if (!chunk_vec.empty()) {
-                memcpy(chunk_vec.data(), request_data.begin(), request_data.size());
-            }
+int main(int argc, char* argv[]) {
 
-            KJ_LOG(INFO, "Cap'n Proto Server: Received chunk of size: ", chunk_vec.size());
-            benchmark_common::reverse_bytes(chunk_vec);
-            KJ_LOG(INFO, "Cap'n Proto Server: Reversed chunk.");
-
-            auto results = context.getResults();
-            auto response_builder = results.initResponse();
-            response_builder.setData(kj::arrayPtr(reinterpret_cast<const kj::byte*>(chunk_vec.data()), chunk_vec.size()));
-            KJ_LOG(INFO, "Cap'n Proto Server: Sending reversed chunk of size: ", chunk_vec.size());
-        } catch (const kj::Exception& e) {
-            KJ_LOG(ERROR, "Cap'n Proto Server: Exception in processChunk: ", e.getDescription().cStr());
-            throw; // Перевыбрасываем исключение, KJ Promise API это обработает
-        }
-        return kj::READY_NOW;
-    }
+    std::cout << "[DEBUG] Server main: Program started." << std::endl;
 
-    kj::Promise<void> doneStreaming(DoneStreamingContext context) override {
-        UNUSED_PARAM(context);
-        KJ_LOG(INFO, "Cap'n Proto Server: doneStreaming called by client.");
-        return kj::READY_NOW;
-    }
-};
-
-class FileProcessorImpl final : public FileProcessor::Server {
-public:
-    kj::Promise<void> startStreaming(StartStreamingContext context) override {
-        KJ_LOG(INFO, "Cap'n Proto Server: startStreaming called.");
-        // Создаем новый экземпляр ChunkHandler для каждого вызова startStreaming
-        FileProcessor::ChunkHandler::Client handler_capability = kj::heap<ChunkHandlerImpl>();
-        context.getResults().setHandler(handler_capability);
-        return kj::READY_NOW;
+    benchmark_common::CliOptions options(argc, argv);
+    benchmark_common::Transport transport;
+    try {
+        transport = benchmark_common::transport_from_string(
+            options.get_string("transport", benchmark_common::DEFAULT_TRANSPORT));
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Server main: " << e.what() << std::endl;
+        return 1;
     }
-};
-
-// Простой обработчик ошибок для TaskSet, который логирует ошибки
-struct LoggingTaskErrorHandler final : public kj::TaskSet::ErrorHandler {
-    void taskFailed(kj::Exception&& exception) override {
-        KJ_LOG(ERROR, "Cap'n Proto Server: Unhandled exception in a Task: ", exception.getDescription().cStr());
-        // В реальном приложении здесь может быть более сложная логика.
-        // Для бенчмарка просто логируем. Можно было бы вызвать kj::throwFatalException(),
-        // если ошибка в задаче должна останавливать весь сервер.
+    if (transport == benchmark_common::Transport::INPROC) {
+        std::cerr << "[ERROR] Server main: Transport 'inproc' runs the server inside the client "
+                     "(capnp_client --transport=inproc)." << std::endl;
+        return 1;
     }
-};
-
-int main(int argc, char* argv[]) {
-
-    UNUSED_PARAM(argc);
-    UNUSED_PARAM(argv);
-
-    std::cout << "[DEBUG] Server main: Program started." << std::endl;
 
     std::string bind_address_str = benchmark_common::CAPNP_SERVER_ADDRESS + ":" + std::to_string(benchmark_common::CAPNP_SERVER_PORT);
     if (benchmark_common::CAPNP_SERVER_ADDRESS == "0.0.0.0") {
         bind_address_str = "*:" + std::to_string(benchmark_common::CAPNP_SERVER_PORT);
     }
+    if (transport != benchmark_common::Transport::TCP) {
+        // unix и shm слушают Unix domain socket; для shm он служит рукопожатием и "звонком".
+        std::string socket_path = options.get_string("socket-path", benchmark_common::CAPNP_UNIX_SOCKET_PATH);
+        std::remove(socket_path.c_str()); // Файл от предыдущего запуска помешает bind()
+        bind_address_str = "unix:" + socket_path;
+    }
+    std::cout << "[DEBUG] Server main: Transport: " << benchmark_common::transport_to_string(transport) << std::endl;
+
+    benchmark_common::Codec codec;
+    benchmark_common::SocketTuning socket_tuning;
+    int stats_interval_s;
+    size_t parallel_chunks;
+    size_t parallel_min_bytes;
+    try {
+        codec = benchmark_common::codec_from_string(options.get_string("compression", "none"));
+        socket_tuning = benchmark_common::socket_tuning_from_options(options);
+        stats_interval_s = static_cast<int>(
+            options.get_int("stats-interval", benchmark_common::DEFAULT_SERVER_STATS_INTERVAL_S));
+        parallel_chunks = options.get_size("parallel-chunks", benchmark_common::DEFAULT_SERVER_PARALLEL_CHUNKS);
+        parallel_min_bytes = options.get_size("parallel-min-bytes", benchmark_common::DEFAULT_CAPNP_PARALLEL_MIN_BYTES);
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Server main: " << e.what() << std::endl;
+        return 1;
+    }
+    if (parallel_min_bytes == 0) {
+        std::cerr << "[ERROR] Server main: --parallel-min-bytes must be positive." << std::endl;
+        return 1;
+    }
+    // Файл, который сервер отдает клиентам в режиме --mode=download
+    const std::string download_file = options.get_string("download-file", benchmark_common::TEST_FILE_NAME);
+    // Профиль сокета имеет смысл только для tcp
+    const bool tuned_tcp = transport == benchmark_common::Transport::TCP && !socket_tuning.is_default();
+    std::cout << "[DEBUG] Server main: Frame compression: " << benchmark_common::codec_to_string(codec) << std::endl;
+    std::cout << "[DEBUG] Server main: Socket profile: " << benchmark_common::socket_tuning_to_string(socket_tuning) << std::endl;
     std::cout << "[DEBUG] Server main: Bind address configured: " << bind_address_str << std::endl;
 
+    // Метрики этапов обработки: итог после каждого прогона, --stats-interval=N - еще и каждые N секунд.
+    // Объявлены до цикла событий, чтобы пережить все соединения.
+    benchmark_common::ServerStats stats("Cap'nProto", "capnp_server_stats.csv");
+    stats.start_periodic_dump(stats_interval_s);
+    // --event-trace=файл.json: трасса цикла событий, сохраняется вместе с отчетом после каждого прогона
+    benchmark_common::start_event_trace(options.get_string("event-trace", ""));
+    benchmark_common::set_event_trace_thread_name("capnp-event-loop");
+
+    // --parallel-chunks=N: processChunk/uploadChunk для чанков от --parallel-min-bytes обрабатываются
+    // в пуле из N потоков, и вызовы завершаются по мере готовности, а не по порядку поступления.
+    // Пул общий для всех соединений.
+    std::unique_ptr<benchmark_common::WorkerPool> chunk_pool;
+    if (parallel_chunks > 0) {
+        chunk_pool = std::make_unique<benchmark_common::WorkerPool>(
+            parallel_chunks, benchmark_common::SERVER_WORKER_QUEUE_CAPACITY, "capnp-chunk-worker");
+        std::cout << "[DEBUG] Server main: Parallel chunks: " << parallel_chunks << " worker threads for chunks of "
+                  << parallel_min_bytes << "+ bytes, calls complete out of order." << std::endl;
+    }
+    benchmark_common::WorkerPool* chunk_pool_ptr = chunk_pool.get();
+
     try { // Внешний try-catch для инициализации
         std::cout << "[DEBUG] Server main: Entering outer try block." << std::endl;
 
@@ -105,11 +129,14 @@ int main(int argc, char* argv[]) {
         std::cout << "[DEBUG] Server main: parseAddress().wait() done." << std::endl;
         kj::Own<kj::ConnectionReceiver> listener = addr->listen();
         std::cout << "[DEBUG] Server main: listen() done." << std::endl;
+        if (tuned_tcp) {
+            capnp_benchmark::applySocketTuning(*listener, socket_tuning, "[WARNING] Server main:");
+        }
 
         KJ_LOG(INFO, "Cap'n Proto Server listening on ", bind_address_str);
         std::cout << "[DEBUG] Server main: KJ_LOG for listening executed." << std::endl;
 
-        LoggingTaskErrorHandler taskErrorHandler;
+        capnp_benchmark::LoggingTaskErrorHandler taskErrorHandler;
         kj::TaskSet tasks(taskErrorHandler);
 
         std::cout << "[DEBUG] Server main: Entering while(true) loop." << std::endl;
@@ -143,53 +170,30 @@ int main(int argc, char* argv[]) {
 
             KJ_LOG(INFO, "Cap'n Proto Server: Accepted connection with a client.");
             std::cout << "[DEBUG] Server loop: Accepted connection." << std::endl;
+            if (tuned_tcp) {
+                // TCP_QUICKACK и SO_BUSY_POLL от слушающего сокета не наследуются
+                capnp_benchmark::applySocketTuning(*current_connection_owner, socket_tuning, "[WARNING] Server loop:");
+            }
 
             // Лямбда для обработки соединения
-            auto handleConnectionLambda = [&ioContext, // Захватываем ioContext для EventLoop (если понадобится)
-                                           conn_param = kj::mv(current_connection_owner) // ЗАХВАТЫВАЕМ ПО ЗНАЧЕНИЮ (перемещаем)
-                                          ]() mutable -> kj::Promise<void> {
-                // Владение соединением теперь у conn_param (переименовал для ясности)
-                kj::Own<kj::AsyncIoStream> conn = kj::mv(conn_param);
-
+            // Лямбда получает готовый поток: сокет напрямую (tcp/unix) или shm-кольца поверх него.
+            auto handleConnectionLambda = [download_file, &stats, chunk_pool_ptr, parallel_min_bytes](kj::Own<kj::AsyncIoStream> raw_conn) -> kj::Promise<void> {
                 KJ_LOG(INFO, "Task started for a connection.");
                 std::cout << "[DEBUG] Task: Started for connection." << std::endl;
-
-
-                auto vatNetwork = kj::heap<capnp::TwoPartyVatNetwork>(
-                    *conn,
-                    capnp::rpc::twoparty::Side::SERVER,
-                    capnp::ReaderOptions()
-                );
-                KJ_LOG(INFO, "Task: VatNetwork created.");
-                std::cout << "[DEBUG] Task: VatNetwork created." << std::endl;
-
-
-                FileProcessor::Client serviceImpl = kj::heap<FileProcessorImpl>();
-                KJ_LOG(INFO, "Task: ServiceImpl created.");
-                std::cout << "[DEBUG] Task: ServiceImpl created." << std::endl;
-
-
-                auto rpcSystem = kj::heap<capnp::RpcSystem<capnp::rpc::twoparty::VatId>>(
-                    *vatNetwork,
-                    kj::Maybe<capnp::Capability::Client>(kj::mv(serviceImpl))
-                );
-                KJ_LOG(INFO, "Task: RpcSystem created.");
-                std::cout << "[DEBUG] Task: RpcSystem created." << std::endl;
-
-
-                kj::Promise<void> disconnectPromise = vatNetwork->onDisconnect();
-                KJ_LOG(INFO, "Task: onDisconnect promise obtained.");
-                std::cout << "[DEBUG] Task: onDisconnect promise obtained." << std::endl;
-
-
-                return disconnectPromise.attach(kj::mv(conn), kj::mv(vatNetwork), kj::mv(rpcSystem))
-                    .then(
-                        [](){ KJ_LOG(INFO, "Task: disconnected cleanly."); std::cout << "[DEBUG] Task: disconnected cleanly." << std::endl; },
-                        [](kj::Exception&& e){ KJ_LOG(ERROR, "Task: disconnected with error: ", e.getDescription().cStr()); std::cout << "[ERROR] Task: disconnected with error: " << e.getDescription().cStr() << std::endl; }
-                    );
+                return capnp_benchmark::serveConnection(kj::mv(raw_conn), download_file, stats, chunk_pool_ptr,
+                                                        parallel_min_bytes);
             };
 
-            tasks.add(handleConnectionLambda());
+            kj::Promise<kj::Own<kj::AsyncIoStream>> streamPromise =
+                (transport == benchmark_common::Transport::SHM)
+                    ? capnp_benchmark::acceptShmRingStream(kj::mv(current_connection_owner))
+                    : kj::Promise<kj::Own<kj::AsyncIoStream>>(kj::mv(current_connection_owner));
+            if (codec != benchmark_common::Codec::NONE) {
+                streamPromise = streamPromise.then([codec](kj::Own<kj::AsyncIoStream> conn) -> kj::Own<kj::AsyncIoStream> {
+                    return kj::heap<capnp_benchmark::CompressedStream>(kj::mv(conn), codec);
+                });
+            }
+            tasks.add(streamPromise.then(kj::mv(handleConnectionLambda)));
             KJ_LOG(INFO, "Cap'n Proto Server: RPC task for new client added to TaskSet. Ready for next client.");
             std::cout << "[DEBUG] Server loop: Task added. Back to waiting for accept()." << std::endl;
         } // конец while(true)
@@ -0,0 +1,323 @@
+// capnp_app/capnp_service.cpp
+#include "capnp_service.hpp"
+
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <memory>
+
+#include <kj/debug.h>
+
+#include <capnp/capability.h>
+#include <capnp/rpc-twoparty.h>
+
+#include "benchmark.capnp.h"
+#include "common/include/event_tracer.hpp"
+#include "common/include/file_utils.hpp"
+#include "common/include/latency_trace.hpp"
+#include "common/include/reversal_utils.hpp"
+#include "common/include/workload.hpp"
+#include "capnp_app/message_sizing.hpp"
+#include "capnp_app/timed_stream.hpp"
+
+#ifndef UNUSED_PARAM
+#define UNUSED_PARAM(x) (void)(x)
+#endif
+
+namespace {
+
+// Выполняет work в пуле (--parallel-chunks); промис разрешается в цикле событий, когда work
+// закончена, - так вызовы Cap'n Proto завершаются не по порядку поступления. Цикл событий не
+// ждет пул: при полной очереди work выполняется сразу на месте.
+// work может работать с сообщениями вызова: они живут, пока жив промис. Задачу делят рабочий и
+// промис (shared_ptr), и отмена вызова при отключении клиента снимает еще не начатую work без
+// ожидания; ждать приходится, только если рабочий уже пишет в сообщения вызова.
+// Нужен kj::newPromiseAndCrossThreadFulfiller (Cap'n Proto 0.9+).
+kj::Promise<void> runOnWorkerPool(benchmark_common::WorkerPool& pool, std::function<void()> work) {
+    struct Offload {
+        enum State : int { QUEUED, RUNNING, DONE, CANCELLED };
+        std::function<void()> work;
+        kj::Own<kj::CrossThreadPromiseFulfiller<void>> fulfiller;
+        std::atomic<int> state{QUEUED};
+    };
+    // Сторона цикла событий: уничтожается вместе с промисом
+    struct Cancel {
+        explicit Cancel(std::shared_ptr<Offload> offload) : offload(std::move(offload)) {}
+        ~Cancel() {
+            int expected = Offload::QUEUED;
+            if (offload->state.compare_exchange_strong(expected, Offload::CANCELLED, std::memory_order_acq_rel)) {
+                return; // Рабочий увидит отмену и work не тронет
+            }
+            int idle_spins = 0;
+            while (offload->state.load(std::memory_order_acquire) != Offload::DONE) {
+                benchmark_common::queue_idle_wait(idle_spins);
+            }
+        }
+        std::shared_ptr<Offload> offload;
+    };
+    auto paf = kj::newPromiseAndCrossThreadFulfiller<void>();
+    auto offload = std::make_shared<Offload>();
+    offload->work = std::move(work);
+    offload->fulfiller = kj::mv(paf.fulfiller);
+    benchmark_common::WorkerPool::Task task = [offload] {
+        int expected = Offload::QUEUED;
+        if (!offload->state.compare_exchange_strong(expected, Offload::RUNNING, std::memory_order_acq_rel)) {
+            return; // Вызов отменен, пока задача ждала рабочего
+        }
+        offload->work();
+        offload->fulfiller->fulfill();
+        offload->state.store(Offload::DONE, std::memory_order_release);
+    };
+    if (!pool.try_submit(task)) {
+        offload->work(); // Пул перегружен - не ждать его в цикле событий
+        return kj::READY_NOW;
+    }
+    return paf.promise.attach(kj::heap<Cancel>(kj::mv(offload)));
+}
+
+// --- Реализации интерфейсов Cap'n Proto ---
+class ChunkHandlerImpl final : public FileProcessor::ChunkHandler::Server {
+public:
+    // download_file - файл, который отдает downloadChunk (--download-file);
+    // stream - поток соединения, по которому обработчик отсчитывает ожидание в очереди;
+    // pool (--parallel-chunks) - чанки от parallel_min_bytes реверсируются в нем, остальные и
+    // все без пула - прямо в цикле событий
+    ChunkHandlerImpl(std::string download_file, benchmark_common::ServerStats& stats,
+                     const capnp_benchmark::TimedStream& stream, benchmark_common::WorkerPool* pool,
+                     size_t parallel_min_bytes)
+        : download_file_(std::move(download_file)), stats_(stats), stream_(stream), pool_(pool),
+          parallel_min_bytes_(parallel_min_bytes) {}
+
+    kj::Promise<void> processChunk(ProcessChunkContext context) override {
+        KJ_LOG(INFO, "Cap'n Proto Server: processChunk called.");
+        try {
+            BENCHMARK_TRACE_SCOPE("process_chunk", "capnp_server");
+            benchmark_common::RequestTiming timing = beginRequest();
+            const int64_t recv_ns = benchmark_common::to_trace_ns(stream_.last_read_completed());
+            Chunk::Reader request = context.getParams().getRequest();
+            capnp::Data::Reader request_data = request.getData();
+            const size_t chunk_size = request_data.size();
+            timing.lap(benchmark_common::ServerStage::DESERIALIZE);
+            KJ_LOG(INFO, "Cap'n Proto Server: Received chunk of size: ", chunk_size);
+
+            // Ответ целиком в первом сегменте, см. message_sizing.hpp
+            auto results = context.getResults(capnp_benchmark::chunkMessageSize(chunk_size));
+            auto response_builder = results.initResponse();
+            response_builder.setId(request.getId());
+            if (request.hasMeta()) response_builder.setMeta(request.getMeta());
+
+            // Реверсируем напрямую из сегмента запроса в сегмент ответа, без промежуточного вектора.
+            capnp::Data::Builder response_data = response_builder.initData(chunk_size);
+            timing.lap(benchmark_common::ServerStage::SERIALIZE);
+            const char* src = reinterpret_cast<const char*>(request_data.begin());
+            char* dst = reinterpret_cast<char*>(response_data.begin());
+            if (pool_ && chunk_size >= parallel_min_bytes_) {
+                // Ответ уже размечен, рабочий только заполняет байты сегмента; в reverse входит
+                // и ожидание рабочего
+                return runOnWorkerPool(*pool_, [src, dst, chunk_size] {
+                    BENCHMARK_TRACE_SCOPE("reverse", "capnp_server");
+                    benchmark_common::reverse_copy_bytes(src, chunk_size, dst);
+                }).then([this, context, timing, recv_ns]() mutable {
+                    timing.lap(benchmark_common::ServerStage::REVERSE);
+                    finishProcessChunk(context, timing, recv_ns);
+                });
+            }
+            benchmark_common::reverse_copy_bytes(src, chunk_size, dst);
+            timing.lap(benchmark_common::ServerStage::REVERSE);
+            finishProcessChunk(context, timing, recv_ns);
+            KJ_LOG(INFO, "Cap'n Proto Server: Sending reversed chunk of size: ", chunk_size);
+        } catch (const kj::Exception& e) {
+            KJ_LOG(ERROR, "Cap'n Proto Server: Exception in processChunk: ", e.getDescription().cStr());
+            throw; // Перевыбрасываем исключение, KJ Promise API это обработает
+        }
+        return kj::READY_NOW;
+    }
+
+    kj::Promise<void> doneStreaming(DoneStreamingContext context) override {
+        UNUSED_PARAM(context);
+        KJ_LOG(INFO, "Cap'n Proto Server: doneStreaming called by client.");
+        return kj::READY_NOW;
+    }
+
+    // Режим upload: данные только проверяются по CRC32, обратно уходит подтверждение.
+    kj::Promise<void> uploadChunk(UploadChunkContext context) override {
+        BENCHMARK_TRACE_SCOPE("upload_chunk", "capnp_server");
+        benchmark_common::RequestTiming timing = beginRequest();
+        const int64_t recv_ns = benchmark_common::to_trace_ns(stream_.last_read_completed());
+        capnp::Data::Reader request_data = context.getParams().getRequest().getData();
+        timing.lap(benchmark_common::ServerStage::DESERIALIZE);
+        if (pool_ && request_data.size() >= parallel_min_bytes_) {
+            // CRC32 большого чанка - в пуле, как и реверс в processChunk
+            auto checksum = kj::heap<uint32_t>(0);
+            uint32_t* checksum_out = checksum.get();
+            return runOnWorkerPool(*pool_, [request_data, checksum_out] {
+                BENCHMARK_TRACE_SCOPE("checksum", "capnp_server");
+                *checksum_out = benchmark_common::chunk_checksum(
+                    reinterpret_cast<const char*>(request_data.begin()), request_data.size());
+            }).then([this, context, timing, recv_ns, checksum = kj::mv(checksum)]() mutable {
+                timing.lap(benchmark_common::ServerStage::REVERSE);
+                finishUploadChunk(context, timing, recv_ns, *checksum);
+            });
+        }
+        const uint32_t checksum = benchmark_common::chunk_checksum(
+            reinterpret_cast<const char*>(request_data.begin()), request_data.size());
+        timing.lap(benchmark_common::ServerStage::REVERSE);
+        finishUploadChunk(context, timing, recv_ns, checksum);
+        return kj::READY_NOW;
+    }
+
+    // Режим download: следующий чанк файла сервера. Файл открывается при первом вызове,
+    // размер чанка задает первый запрос; после конца файла возвращается пустой чанк.
+    kj::Promise<void> downloadChunk(DownloadChunkContext context) override {
+        BENCHMARK_TRACE_SCOPE("download_chunk", "capnp_server");
+        benchmark_common::RequestTiming timing = beginRequest();
+        const size_t chunk_size = context.getParams().getSize();
+        KJ_REQUIRE(chunk_size > 0, "downloadChunk: size must be positive");
+        timing.lap(benchmark_common::ServerStage::DESERIALIZE);
+        if (!download_reader_) {
+            try {
+                download_reader_ = std::make_unique<benchmark_common::ChunkReader>(download_file_, chunk_size);
+            } catch (const std::exception& e) {
+                KJ_FAIL_REQUIRE("Download file is not available on the server", download_file_.c_str(), e.what());
+            }
+            std::cout << "[DEBUG] Download: serving '" << download_file_ << "' in " << chunk_size
+                      << "-byte chunks." << std::endl;
+        }
+        // Буфер чтения общий для всех вызовов: емкость сохраняется, на чанк выделяется только сегмент ответа
+        download_reader_->next_chunk_into(download_buffer_);
+        auto results = context.getResults(capnp_benchmark::chunkMessageSize(download_buffer_.size()));
+        results.initResponse().setData(kj::ArrayPtr<const kj::byte>(
+            reinterpret_cast<const kj::byte*>(download_buffer_.data()), download_buffer_.size()));
+        results.setChecksum(benchmark_common::chunk_checksum(download_buffer_.data(), download_buffer_.size()));
+        // Чтение файла и CRC32 - построение ответа
+        timing.lap(benchmark_common::ServerStage::SERIALIZE);
+        stats_.record(timing);
+        return kj::READY_NOW;
+    }
+
+private:
+    // Конец processChunk после реверса (в цикле событий, в том числе после пула).
+    void finishProcessChunk(ProcessChunkContext& context, benchmark_common::RequestTiming& timing, int64_t recv_ns) {
+        Chunk::Reader request = context.getParams().getRequest();
+        if (request.hasTrace()) {
+            fillTrace(request.getTrace(), context.getResults().getResponse().initTrace(), recv_ns,
+                      benchmark_common::trace_now_ns());
+        }
+        stats_.record(timing);
+    }
+
+    // Конец uploadChunk после CRC32: подтверждение с ID чанка.
+    void finishUploadChunk(UploadChunkContext& context, benchmark_common::RequestTiming& timing, int64_t recv_ns,
+                           uint32_t checksum) {
+        const int64_t process_done_ns = benchmark_common::trace_now_ns();
+        Chunk::Reader request = context.getParams().getRequest();
+        auto ack = context.getResults().initAck();
+        ack.setSize(request.getData().size());
+        ack.setChecksum(checksum);
+        ack.setId(request.getId());
+        if (request.hasTrace()) {
+            fillTrace(request.getTrace(), ack.initTrace(), recv_ns, process_done_ns);
+        }
+        timing.lap(benchmark_common::ServerStage::SERIALIZE);
+        stats_.record(timing);
+    }
+
+    // --trace: отметки запроса плюс серверные. Прием (recv_ns) - чтение, завершившее сообщение,
+    // запоминается при вызове: к завершению в пуле поток успевает прочитать следующие запросы.
+    // Отправка - возврат из обработчика, дальше ответ сериализует и пишет RPC-система.
+    void fillTrace(TraceTimestamps::Reader request_trace, TraceTimestamps::Builder trace,
+                   int64_t recv_ns, int64_t process_done_ns) const {
+        trace.setClientSendNs(request_trace.getClientSendNs());
+        trace.setServerRecvNs(recv_ns);
+        trace.setServerProcessDoneNs(process_done_ns);
+        trace.setServerSendNs(benchmark_common::trace_now_ns());
+    }
+
+    // Начало замера запроса: ожидание в очереди - от чтения, завершившего прием сообщения,
+    // до вызова обработчика (при конвейеризации сюда входит обработка предыдущих запросов).
+    benchmark_common::RequestTiming beginRequest() const {
+        benchmark_common::RequestTiming timing;
+        timing.start_at(stream_.last_read_completed());
+        timing.lap(benchmark_common::ServerStage::QUEUE_WAIT);
+        return timing;
+    }
+
+    std::string download_file_;
+    std::unique_ptr<benchmark_common::ChunkReader> download_reader_;
+    std::string download_buffer_;
+    benchmark_common::ServerStats& stats_;
+    const capnp_benchmark::TimedStream& stream_;
+    benchmark_common::WorkerPool* pool_;
+    size_t parallel_min_bytes_;
+};
+
+class FileProcessorImpl final : public FileProcessor::Server {
+public:
+    FileProcessorImpl(std::string download_file, benchmark_common::ServerStats& stats,
+                      const capnp_benchmark::TimedStream& stream, benchmark_common::WorkerPool* pool,
+                      size_t parallel_min_bytes)
+        : download_file_(std::move(download_file)), stats_(stats), stream_(stream), pool_(pool),
+          parallel_min_bytes_(parallel_min_bytes) {}
+
+    kj::Promise<void> startStreaming(StartStreamingContext context) override {
+        KJ_LOG(INFO, "Cap'n Proto Server: startStreaming called.");
+        // Создаем новый экземпляр ChunkHandler для каждого вызова startStreaming
+        FileProcessor::ChunkHandler::Client handler_capability =
+            kj::heap<ChunkHandlerImpl>(download_file_, stats_, stream_, pool_, parallel_min_bytes_);
+        context.getResults().setHandler(handler_capability);
+        return kj::READY_NOW;
+    }
+
+private:
+    std::string download_file_;
+    benchmark_common::ServerStats& stats_;
+    const capnp_benchmark::TimedStream& stream_;
+    benchmark_common::WorkerPool* pool_;
+    size_t parallel_min_bytes_;
+};
+
+} // namespace
+
+namespace capnp_benchmark {
+
+kj::Promise<void> serveConnection(kj::Own<kj::AsyncIoStream> connection, std::string download_file,
+                                  benchmark_common::ServerStats& stats, benchmark_common::WorkerPool* pool,
+                                  size_t parallel_min_bytes) {
+    // Внешний слой для серверных метрик: байты, время записи, момент приема сообщения
+    auto conn = kj::heap<TimedStream>(kj::mv(connection), stats);
+    const TimedStream& timed_stream = *conn;
+    auto session = kj::heap<benchmark_common::ScopedServerSession>(stats);
+
+    auto vatNetwork = kj::heap<capnp::TwoPartyVatNetwork>(
+        *conn,
+        capnp::rpc::twoparty::Side::SERVER,
+        capnp::ReaderOptions()
+    );
+    KJ_LOG(INFO, "Task: VatNetwork created.");
+
+    FileProcessor::Client serviceImpl =
+        kj::heap<FileProcessorImpl>(kj::mv(download_file), stats, timed_stream, pool, parallel_min_bytes);
+    KJ_LOG(INFO, "Task: ServiceImpl created.");
+
+    auto rpcSystem = kj::heap<capnp::RpcSystem<capnp::rpc::twoparty::VatId>>(
+        *vatNetwork,
+        kj::Maybe<capnp::Capability::Client>(kj::mv(serviceImpl))
+    );
+    KJ_LOG(INFO, "Task: RpcSystem created.");
+
+    kj::Promise<void> disconnectPromise = vatNetwork->onDisconnect();
+    return disconnectPromise.attach(kj::mv(session), kj::mv(conn), kj::mv(vatNetwork), kj::mv(rpcSystem))
+        .then(
+            [](){ KJ_LOG(INFO, "Task: disconnected cleanly."); std::cout << "[DEBUG] Task: disconnected cleanly." << std::endl; },
+            [](kj::Exception&& e){ KJ_LOG(ERROR, "Task: disconnected with error: ", e.getDescription().cStr()); std::cout << "[ERROR] Task: disconnected with error: " << e.getDescription().cStr() << std::endl; }
+        );
+}
+
+void LoggingTaskErrorHandler::taskFailed(kj::Exception&& exception) {
+    KJ_LOG(ERROR, "Cap'n Proto Server: Unhandled exception in a Task: ", exception.getDescription().cStr());
+    // В реальном приложении здесь может быть более сложная логика.
+    // Для бенчмарка просто логируем. Можно было бы вызвать kj::throwFatalException(),
+    // если ошибка в задаче должна останавливать весь сервер.
+}
+
+} // namespace capnp_benchmark
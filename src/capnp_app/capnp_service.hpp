@@ -0,0 +1,32 @@
+// capnp_app/capnp_service.hpp
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <kj/async.h>
+#include <kj/async-io.h>
+#include <kj/memory.h>
+
+#include "common/include/server_stats.hpp"
+#include "common/include/worker_pool.hpp"
+
+namespace capnp_benchmark {
+
+// Обслуживает одно соединение до отключения клиента: поток оборачивается в TimedStream для
+// серверных метрик, FileProcessor отдается клиенту как bootstrap-интерфейс RPC-системы.
+// Общая для capnp_server и для capnp_client --transport=inproc (сервер в процессе клиента).
+// download_file - файл для режима download; pool (--parallel-chunks) - чанки от
+// parallel_min_bytes обрабатываются в нем, остальные, все без пула и все при полной очереди
+// пула - в цикле событий.
+// Промис разрешается при отключении и не отклоняется: ошибка соединения только логируется.
+kj::Promise<void> serveConnection(kj::Own<kj::AsyncIoStream> connection, std::string download_file,
+                                  benchmark_common::ServerStats& stats, benchmark_common::WorkerPool* pool,
+                                  size_t parallel_min_bytes);
+
+// Простой обработчик ошибок для TaskSet, который логирует ошибки
+struct LoggingTaskErrorHandler final : public kj::TaskSet::ErrorHandler {
+    void taskFailed(kj::Exception&& exception) override;
+};
+
+} // namespace capnp_benchmark
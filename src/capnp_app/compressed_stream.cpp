@@ -0,0 +1,140 @@
+// capnp_app/compressed_stream.cpp
+#include "compressed_stream.hpp"
+
+#include <cstring>
+#include <algorithm> // Для std::min
+
+#include <kj/debug.h>
+#include <kj/io.h>
+#include <capnp/serialize-packed.h> // Для capnp::_::PackedOutputStream / PackedInputStream
+
+namespace capnp_benchmark {
+
+using benchmark_common::Codec;
+
+CompressedStream::CompressedStream(kj::Own<kj::AsyncIoStream> inner, Codec codec)
+    : inner_(kj::mv(inner)), codec_(codec) {
+    KJ_REQUIRE(benchmark_common::codec_available(codec), "codec not compiled in (rebuild with WITH_ZSTD=1)",
+               benchmark_common::codec_to_string(codec).c_str());
+}
+
+bool CompressedStream::encode(const std::vector<char>& raw, std::vector<char>& encoded) const {
+    switch (codec_) {
+        case Codec::NONE:
+            return false;
+        case Codec::PACKED: {
+            // Упаковка работает по словам; RPC-сообщения всегда кратны 8 байтам.
+            if (raw.size() % sizeof(capnp::word) != 0) return false;
+            kj::VectorOutputStream output(raw.size() + raw.size() / 8 + 16);
+            capnp::_::PackedOutputStream packed(output);
+            packed.write(raw.data(), raw.size());
+            auto bytes = output.getArray();
+            encoded.assign(reinterpret_cast<const char*>(bytes.begin()), reinterpret_cast<const char*>(bytes.end()));
+            return true;
+        }
+        default:
+            return benchmark_common::compress_buffer(codec_, raw.data(), raw.size(), encoded);
+    }
+}
+
+kj::Promise<void> CompressedStream::write(const void* buffer, size_t size) {
+    kj::ArrayPtr<const kj::byte> piece(static_cast<const kj::byte*>(buffer), size);
+    return write(kj::arrayPtr(&piece, 1));
+}
+
+kj::Promise<void> CompressedStream::write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) {
+    struct OutFrame {
+        FrameHeader header;
+        std::vector<char> raw;
+        std::vector<char> encoded;
+        kj::ArrayPtr<const kj::byte> inner_pieces[2];
+    };
+    auto frame = kj::heap<OutFrame>();
+
+    size_t total = 0;
+    for (auto& piece : pieces) total += piece.size();
+    frame->raw.reserve(total);
+    for (auto& piece : pieces) {
+        frame->raw.insert(frame->raw.end(), reinterpret_cast<const char*>(piece.begin()),
+                          reinterpret_cast<const char*>(piece.end()));
+    }
+
+    Codec used = codec_;
+    if (!encode(frame->raw, frame->encoded) || frame->encoded.size() >= frame->raw.size()) {
+        used = Codec::NONE; // Несжимаемый кадр дешевле отправить как есть
+        stats_.frames_sent_uncompressed++;
+    }
+    const std::vector<char>& payload = (used == Codec::NONE) ? frame->raw : frame->encoded;
+
+    memset(&frame->header, 0, sizeof(FrameHeader));
+    frame->header.raw_size = static_cast<uint32_t>(frame->raw.size());
+    frame->header.encoded_size = static_cast<uint32_t>(payload.size());
+    frame->header.codec = static_cast<uint8_t>(used);
+
+    stats_.raw_bytes_out += frame->raw.size();
+    stats_.encoded_bytes_out += sizeof(FrameHeader) + payload.size();
+    stats_.frames_out++;
+
+    frame->inner_pieces[0] = kj::arrayPtr(reinterpret_cast<const kj::byte*>(&frame->header), sizeof(FrameHeader));
+    frame->inner_pieces[1] = kj::arrayPtr(reinterpret_cast<const kj::byte*>(payload.data()), payload.size());
+    auto promise = inner_->write(kj::arrayPtr(frame->inner_pieces, 2));
+    return promise.attach(kj::mv(frame));
+}
+
+kj::Promise<size_t> CompressedStream::tryRead(void* buffer, size_t minBytes, size_t maxBytes) {
+    return readLoop(static_cast<kj::byte*>(buffer), minBytes, maxBytes, 0);
+}
+
+kj::Promise<size_t> CompressedStream::readLoop(kj::byte* buffer, size_t minBytes, size_t maxBytes, size_t alreadyRead) {
+    size_t available = pending_.size() - pending_pos_;
+    size_t n = std::min(available, maxBytes - alreadyRead);
+    if (n > 0) {
+        memcpy(buffer + alreadyRead, pending_.data() + pending_pos_, n);
+        pending_pos_ += n;
+        alreadyRead += n;
+    }
+    if (alreadyRead >= minBytes) return alreadyRead;
+
+    return readFrame().then([this, buffer, minBytes, maxBytes, alreadyRead](bool got_frame) -> kj::Promise<size_t> {
+        if (!got_frame) return alreadyRead; // EOF
+        return readLoop(buffer, minBytes, maxBytes, alreadyRead);
+    });
+}
+
+kj::Promise<bool> CompressedStream::readFrame() {
+    return inner_->tryRead(&in_header_, sizeof(FrameHeader), sizeof(FrameHeader))
+        .then([this](size_t n) -> kj::Promise<bool> {
+            if (n == 0) return false;
+            KJ_REQUIRE(n == sizeof(FrameHeader), "CompressedStream: truncated frame header");
+            in_encoded_.resize(in_header_.encoded_size);
+            return inner_->read(in_encoded_.data(), in_encoded_.size()).then([this]() {
+                const Codec codec = static_cast<Codec>(in_header_.codec);
+                pending_.resize(in_header_.raw_size);
+                pending_pos_ = 0;
+                if (codec == Codec::PACKED) {
+                    kj::ArrayInputStream input(kj::arrayPtr(reinterpret_cast<const kj::byte*>(in_encoded_.data()),
+                                                            in_encoded_.size()));
+                    capnp::_::PackedInputStream packed(input);
+                    packed.read(pending_.data(), pending_.size());
+                } else {
+                    bool ok = benchmark_common::decompress_buffer(codec, in_encoded_.data(), in_encoded_.size(),
+                                                                  pending_.data(), pending_.size());
+                    KJ_REQUIRE(ok, "CompressedStream: failed to decode frame",
+                               benchmark_common::codec_to_string(codec).c_str());
+                }
+                stats_.raw_bytes_in += in_header_.raw_size;
+                stats_.encoded_bytes_in += sizeof(FrameHeader) + in_header_.encoded_size;
+                return true;
+            });
+        });
+}
+
+kj::Promise<void> CompressedStream::whenWriteDisconnected() {
+    return inner_->whenWriteDisconnected();
+}
+
+void CompressedStream::shutdownWrite() {
+    inner_->shutdownWrite();
+}
+
+} // namespace capnp_benchmark
@@ -0,0 +1,63 @@
+// capnp_app/compressed_stream.hpp
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <kj/async-io.h>
+#include <kj/memory.h>
+
+#include "common/include/compression.hpp"
+
+namespace capnp_benchmark {
+
+// Обертка над AsyncIoStream, сжимающая каждый write() отдельным кадром:
+//   [raw_size u32][encoded_size u32][codec u8][3 байта выравнивания][encoded bytes]
+// Кодек записывается в каждый кадр, поэтому стороны могут использовать разные кодеки,
+// но обертка должна быть включена на обеих сторонах соединения.
+// Если кадр не сжимается (например, случайные данные), он уходит как NONE без распаковки на приеме.
+// Порядок байт - хостовый: транспорт предназначен для бенчмарков на однородных машинах.
+class CompressedStream final : public kj::AsyncIoStream {
+public:
+    struct Stats {
+        uint64_t raw_bytes_out = 0;
+        uint64_t encoded_bytes_out = 0; // Включая заголовки кадров
+        uint64_t raw_bytes_in = 0;
+        uint64_t encoded_bytes_in = 0;
+        uint64_t frames_out = 0;
+        uint64_t frames_sent_uncompressed = 0;
+    };
+
+    CompressedStream(kj::Own<kj::AsyncIoStream> inner, benchmark_common::Codec codec);
+
+    kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override;
+    kj::Promise<void> write(const void* buffer, size_t size) override;
+    kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) override;
+    kj::Promise<void> whenWriteDisconnected() override;
+    void shutdownWrite() override;
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    struct FrameHeader {
+        uint32_t raw_size;
+        uint32_t encoded_size;
+        uint8_t codec;
+        uint8_t reserved[3];
+    };
+
+    kj::Promise<size_t> readLoop(kj::byte* buffer, size_t minBytes, size_t maxBytes, size_t alreadyRead);
+    kj::Promise<bool> readFrame();
+    bool encode(const std::vector<char>& raw, std::vector<char>& encoded) const;
+
+    kj::Own<kj::AsyncIoStream> inner_;
+    benchmark_common::Codec codec_;
+    Stats stats_;
+
+    FrameHeader in_header_;
+    std::vector<char> in_encoded_;
+    std::vector<char> pending_; // Распакованные, но еще не выданные байты
+    size_t pending_pos_ = 0;
+};
+
+} // namespace capnp_benchmark
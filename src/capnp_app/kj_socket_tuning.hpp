@@ -0,0 +1,29 @@
+// capnp_app/kj_socket_tuning.hpp
+#pragma once
+
+#include <iostream>
+
+#include <kj/async-io.h>
+#include <kj/exception.h>
+
+#include "common/include/socket_tuning.hpp"
+
+namespace capnp_benchmark {
+
+// Применяет профиль сокета через setsockopt() объекта KJ: подходит и для kj::AsyncIoStream,
+// и для kj::ConnectionReceiver (от слушающего сокета принятые соединения наследуют
+// SO_SNDBUF/SO_RCVBUF и TCP_NODELAY). Неудавшиеся опции только логируются.
+template <typename SocketLike>
+inline void applySocketTuning(SocketLike& socket, const benchmark_common::SocketTuning& tuning,
+                              const char* log_prefix) {
+    for (const auto& setting : benchmark_common::socket_option_settings(tuning)) {
+        try {
+            socket.setsockopt(setting.level, setting.name, &setting.value, sizeof(setting.value));
+        } catch (const kj::Exception& e) {
+            std::cerr << log_prefix << " setsockopt(" << setting.label << "=" << setting.value
+                      << ") failed: " << e.getDescription().cStr() << std::endl;
+        }
+    }
+}
+
+} // namespace capnp_benchmark
@@ -0,0 +1,45 @@
+// capnp_app/message_sizing.hpp
+#pragma once
+
+#include <cstddef> // Для size_t
+#include <string>
+
+#include <capnp/message.h> // Для capnp::MessageSize, capnp::word
+#include <capnp/orphan.h>  // Для capnp::Orphanage, capnp::Orphan
+
+namespace capnp_benchmark {
+
+// Запас в словах помимо данных чанка: структуры параметров/результатов, Chunk, ChunkMeta, TraceTimestamps
+// и указатели (заголовки Call/Return RPC-система добавляет к подсказке сама).
+constexpr size_t CHUNK_MESSAGE_OVERHEAD_WORDS = 32;
+
+// Подсказка размера первого сегмента RPC-сообщения с чанком payload_bytes. Сообщения запросов
+// и ответов строит RPC-система (MallocMessageBuilder внутри TwoPartyVatNetwork), и подсказка -
+// единственный способ повлиять на их сегменты: без нее первый сегмент берется по умолчанию
+// (1024 слова), а 64 KB Data уходит во второй, так что на чанк выделяются два сегмента и
+// половина первого пропадает. С подсказкой сообщение целиком помещается в один сегмент.
+inline capnp::MessageSize chunkMessageSize(size_t payload_bytes) {
+    return capnp::MessageSize{
+        (payload_bytes + sizeof(capnp::word) - 1) / sizeof(capnp::word) + CHUNK_MESSAGE_OVERHEAD_WORDS, 0};
+}
+
+// Поле Data, которое ссылается на buffer вместо копии: сообщение получает его отдельным
+// сегментом, и при записи в сокет байты идут прямо из buffer. Ограничения referenceExternalData:
+// - buffer не должен меняться и освобождаться, пока жив MessageBuilder запроса, то есть пока
+//   RPC-система не дописала сообщение в поток. Вызывающий не трогает buffer, пока не разрешится
+//   промис send(): ответ приходит только после того, как запрос целиком ушел;
+// - начало buffer выровнено по слову (память из malloc), а байты после конца до границы слова
+//   уходят в сеть как есть, поэтому емкость buffer округляется вверх до слова.
+// Первому сегменту такого сообщения нужна подсказка chunkMessageSize(0): данных в нем нет.
+template <typename StructBuilder>
+inline capnp::Orphan<capnp::Data> referenceExternalChunk(StructBuilder message_part, const std::string& buffer) {
+    return capnp::Orphanage::getForMessageContaining(message_part)
+        .referenceExternalData(capnp::Data::Reader(reinterpret_cast<const capnp::byte*>(buffer.data()), buffer.size()));
+}
+
+// Емкость буфера для referenceExternalChunk(): chunk_size байт, округленные до слова.
+inline size_t externalChunkCapacity(size_t chunk_size) {
+    return (chunk_size + sizeof(capnp::word) - 1) / sizeof(capnp::word) * sizeof(capnp::word);
+}
+
+} // namespace capnp_benchmark
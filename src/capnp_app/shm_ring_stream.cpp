@@ -0,0 +1,377 @@
+// capnp_app/shm_ring_stream.cpp
+#include "shm_ring_stream.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <algorithm> // Для std::min
+#include <new>       // Для placement new
+#include <utility>   // Для std::pair
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <kj/debug.h>
+
+#include "common/include/config.hpp"
+
+namespace capnp_benchmark {
+
+namespace {
+
+// Заголовок одного кольца в разделяемой памяти. Индексы монотонно растут,
+// позиция в буфере = индекс % capacity. head двигает читатель, tail - писатель.
+struct alignas(64) RingHeader {
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint32_t> consumer_waiting; // Читатель ждет данных
+    std::atomic<uint32_t> producer_waiting;             // Писатель ждет места
+    std::atomic<uint32_t> closed;                       // Писатель вызвал shutdownWrite()
+    uint64_t capacity;
+};
+
+// Раскладка региона: [заголовок c2s][заголовок s2c][данные c2s][данные s2c].
+struct RegionLayout {
+    static size_t headers_size() { return 2 * sizeof(RingHeader); }
+    static size_t total_size(size_t capacity) { return headers_size() + 2 * capacity; }
+};
+
+// Емкость из опции или из рукопожатия: ноль сломал бы позицию в кольце (индекс % capacity),
+// а огромная - ftruncate/mmap с переполнением total_size.
+void require_valid_capacity(uint64_t capacity) {
+    KJ_REQUIRE(capacity > 0 && capacity <= benchmark_common::SHM_RING_MAX_CAPACITY_BYTES,
+               "invalid shm ring capacity", capacity, benchmark_common::SHM_RING_MAX_CAPACITY_BYTES);
+}
+
+// Сообщение рукопожатия фиксированного размера: емкость кольца + имя shm-объекта.
+struct Handshake {
+    uint64_t ring_capacity;
+    char shm_name[56];
+};
+
+class Ring {
+public:
+    Ring(RingHeader* header, kj::byte* data) : header_(header), data_(data) {}
+
+    size_t readable() const {
+        return header_->tail.load(std::memory_order_acquire) - header_->head.load(std::memory_order_relaxed);
+    }
+
+    size_t writable() const {
+        return header_->capacity - (header_->tail.load(std::memory_order_relaxed) -
+                                    header_->head.load(std::memory_order_acquire));
+    }
+
+    // Копирует до max_bytes в кольцо, возвращает сколько записано.
+    size_t write(const kj::byte* src, size_t max_bytes) {
+        size_t n = std::min(max_bytes, writable());
+        if (n == 0) return 0;
+        uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+        size_t pos = tail % header_->capacity;
+        size_t first = std::min(n, static_cast<size_t>(header_->capacity - pos));
+        memcpy(data_ + pos, src, first);
+        memcpy(data_, src + first, n - first);
+        header_->tail.store(tail + n, std::memory_order_seq_cst);
+        return n;
+    }
+
+    // Копирует до max_bytes из кольца, возвращает сколько прочитано.
+    size_t read(kj::byte* dst, size_t max_bytes) {
+        size_t n = std::min(max_bytes, readable());
+        if (n == 0) return 0;
+        uint64_t head = header_->head.load(std::memory_order_relaxed);
+        size_t pos = head % header_->capacity;
+        size_t first = std::min(n, static_cast<size_t>(header_->capacity - pos));
+        memcpy(dst, data_ + pos, first);
+        memcpy(dst + first, data_, n - first);
+        header_->head.store(head + n, std::memory_order_seq_cst);
+        return n;
+    }
+
+    RingHeader& header() { return *header_; }
+
+private:
+    RingHeader* header_;
+    kj::byte* data_;
+};
+
+class ShmRingStream final : public kj::AsyncIoStream {
+public:
+    ShmRingStream(kj::Own<kj::AsyncIoStream> doorbell, void* mapping, size_t mapping_size, bool is_client)
+        : doorbell_(kj::mv(doorbell)),
+          mapping_(mapping),
+          mapping_size_(mapping_size),
+          tx_(ring_at(is_client ? 0 : 1)),
+          rx_(ring_at(is_client ? 1 : 0)),
+          pump_task_(pumpDoorbell().eagerlyEvaluate([this](kj::Exception&& e) {
+              KJ_LOG(WARNING, "ShmRingStream: doorbell failed", e.getDescription());
+              peer_gone_ = true;
+              wakeAll();
+          })) {}
+
+    ~ShmRingStream() noexcept(false) {
+        tx_.header().closed.store(1, std::memory_order_seq_cst);
+        munmap(mapping_, mapping_size_);
+    }
+
+    kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+        return readLoop(static_cast<kj::byte*>(buffer), minBytes, maxBytes, 0);
+    }
+
+    kj::Promise<void> write(const void* buffer, size_t size) override {
+        return writeLoop(static_cast<const kj::byte*>(buffer), size);
+    }
+
+    kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) override {
+        // Список кусков копируем: вызывающий гарантирует жизнь только самих буферов.
+        return writePieces(kj::heapArray(pieces), 0);
+    }
+
+    kj::Promise<void> whenWriteDisconnected() override {
+        return doorbell_->whenWriteDisconnected();
+    }
+
+    void shutdownWrite() override {
+        tx_.header().closed.store(1, std::memory_order_seq_cst);
+        ringDoorbell();
+    }
+
+private:
+    Ring ring_at(int index) {
+        auto* headers = static_cast<RingHeader*>(mapping_);
+        auto* data = static_cast<kj::byte*>(mapping_) + RegionLayout::headers_size();
+        return Ring(&headers[index], data + index * headers[index].capacity);
+    }
+
+    kj::Promise<size_t> readLoop(kj::byte* buffer, size_t minBytes, size_t maxBytes, size_t alreadyRead) {
+        for (;;) {
+            size_t n = rx_.read(buffer + alreadyRead, maxBytes - alreadyRead);
+            if (n > 0) {
+                alreadyRead += n;
+                notifyIfWaiting(rx_.header().producer_waiting);
+            }
+            if (alreadyRead >= minBytes) return alreadyRead;
+            if (rx_.readable() == 0 && (rx_.header().closed.load(std::memory_order_seq_cst) || peer_gone_)) {
+                return alreadyRead; // EOF
+            }
+
+            // Публикуем намерение уснуть и перепроверяем, чтобы не пропустить звонок.
+            rx_.header().consumer_waiting.store(1, std::memory_order_seq_cst);
+            if (rx_.readable() > 0 || rx_.header().closed.load(std::memory_order_seq_cst)) {
+                rx_.header().consumer_waiting.store(0, std::memory_order_relaxed);
+                continue;
+            }
+            return waitFor(read_waiter_).then([this, buffer, minBytes, maxBytes, alreadyRead]() {
+                return readLoop(buffer, minBytes, maxBytes, alreadyRead);
+            });
+        }
+    }
+
+    kj::Promise<void> writeLoop(const kj::byte* src, size_t remaining) {
+        for (;;) {
+            KJ_REQUIRE(!peer_gone_, "ShmRingStream: peer disconnected");
+            size_t n = tx_.write(src, remaining);
+            if (n > 0) {
+                src += n;
+                remaining -= n;
+                notifyIfWaiting(tx_.header().consumer_waiting);
+            }
+            if (remaining == 0) return kj::READY_NOW;
+
+            tx_.header().producer_waiting.store(1, std::memory_order_seq_cst);
+            if (tx_.writable() > 0) {
+                tx_.header().producer_waiting.store(0, std::memory_order_relaxed);
+                continue;
+            }
+            return waitFor(write_waiter_).then([this, src, remaining]() {
+                return writeLoop(src, remaining);
+            });
+        }
+    }
+
+    kj::Promise<void> writePieces(kj::Array<kj::ArrayPtr<const kj::byte>> pieces, size_t index) {
+        if (index == pieces.size()) return kj::READY_NOW;
+        auto piece = pieces[index];
+        return writeLoop(piece.begin(), piece.size())
+            .then([this, pieces = kj::mv(pieces), index]() mutable {
+                return writePieces(kj::mv(pieces), index + 1);
+            });
+    }
+
+    void notifyIfWaiting(std::atomic<uint32_t>& waiting_flag) {
+        if (waiting_flag.load(std::memory_order_seq_cst) && waiting_flag.exchange(0, std::memory_order_seq_cst)) {
+            ringDoorbell();
+        }
+    }
+
+    void ringDoorbell() {
+        if (peer_gone_ || doorbell_write_in_progress_) {
+            // Звонок уже в полете: получатель перепроверит оба кольца при пробуждении.
+            doorbell_pending_ = !peer_gone_;
+            return;
+        }
+        doorbell_write_in_progress_ = true;
+        doorbell_tasks_.add(doorbell_->write(&doorbell_out_, 1).then(
+            [this]() {
+                doorbell_write_in_progress_ = false;
+                if (doorbell_pending_) {
+                    doorbell_pending_ = false;
+                    ringDoorbell();
+                }
+            },
+            [this](kj::Exception&&) {
+                doorbell_write_in_progress_ = false;
+                peer_gone_ = true;
+                wakeAll();
+            }));
+    }
+
+    kj::Promise<void> pumpDoorbell() {
+        return doorbell_->tryRead(doorbell_in_, 1, sizeof(doorbell_in_)).then([this](size_t n) -> kj::Promise<void> {
+            if (n == 0) {
+                peer_gone_ = true;
+                wakeAll();
+                return kj::READY_NOW;
+            }
+            wakeAll();
+            return pumpDoorbell();
+        });
+    }
+
+    kj::Promise<void> waitFor(kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>>& slot) {
+        auto paf = kj::newPromiseAndFulfiller<void>();
+        slot = kj::mv(paf.fulfiller);
+        return kj::mv(paf.promise);
+    }
+
+    void wake(kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>>& slot) {
+        KJ_IF_MAYBE(fulfiller, slot) {
+            (*fulfiller)->fulfill();
+        }
+        slot = nullptr;
+    }
+
+    void wakeAll() {
+        wake(read_waiter_);
+        wake(write_waiter_);
+    }
+
+    struct DoorbellErrorHandler final : public kj::TaskSet::ErrorHandler {
+        void taskFailed(kj::Exception&& exception) override {
+            KJ_LOG(WARNING, "ShmRingStream: doorbell write failed", exception.getDescription());
+        }
+    };
+
+    kj::Own<kj::AsyncIoStream> doorbell_;
+    void* mapping_;
+    size_t mapping_size_;
+    Ring tx_;
+    Ring rx_;
+
+    kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> read_waiter_;
+    kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> write_waiter_;
+    bool peer_gone_ = false;
+
+    kj::byte doorbell_in_[64];
+    const kj::byte doorbell_out_ = 1;
+    bool doorbell_write_in_progress_ = false;
+    bool doorbell_pending_ = false;
+    DoorbellErrorHandler doorbell_error_handler_;
+    kj::TaskSet doorbell_tasks_{doorbell_error_handler_};
+
+    kj::Promise<void> pump_task_; // Объявлен последним: стартует, когда все поля готовы
+};
+
+void* map_shm(int fd, size_t size) {
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        KJ_FAIL_SYSCALL("mmap", errno);
+    }
+    return mapping;
+}
+
+} // namespace
+
+kj::Promise<kj::Own<kj::AsyncIoStream>> connectShmRingStream(kj::Own<kj::AsyncIoStream> doorbell,
+                                                             size_t ring_capacity_bytes) {
+    static std::atomic<unsigned> name_counter{0};
+    std::string name = "/capnp_bench_" + std::to_string(getpid()) + "_" + std::to_string(name_counter++);
+    KJ_REQUIRE(name.size() < sizeof(Handshake::shm_name), "shm name too long", name);
+    require_valid_capacity(ring_capacity_bytes);
+
+    const size_t total_size = RegionLayout::total_size(ring_capacity_bytes);
+    int fd;
+    KJ_SYSCALL(fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600), name);
+    KJ_DEFER(close(fd));
+    KJ_SYSCALL(ftruncate(fd, static_cast<off_t>(total_size)));
+    void* mapping = map_shm(fd, total_size);
+
+    auto* headers = static_cast<RingHeader*>(mapping);
+    for (int i = 0; i < 2; ++i) {
+        new (&headers[i]) RingHeader();
+        headers[i].head.store(0);
+        headers[i].tail.store(0);
+        headers[i].consumer_waiting.store(0);
+        headers[i].producer_waiting.store(0);
+        headers[i].closed.store(0);
+        headers[i].capacity = ring_capacity_bytes;
+    }
+
+    auto handshake = kj::heap<Handshake>();
+    memset(handshake.get(), 0, sizeof(Handshake));
+    handshake->ring_capacity = ring_capacity_bytes;
+    strncpy(handshake->shm_name, name.c_str(), sizeof(handshake->shm_name) - 1);
+
+    auto ack = kj::heap<kj::byte>(0);
+    auto& doorbell_ref = *doorbell;
+    auto& handshake_ref = *handshake;
+    auto& ack_ref = *ack;
+    return doorbell_ref.write(&handshake_ref, sizeof(Handshake))
+        .then([&doorbell_ref, &ack_ref]() { return doorbell_ref.read(&ack_ref, 1); })
+        .then([doorbell = kj::mv(doorbell), mapping, total_size, name]() mutable -> kj::Own<kj::AsyncIoStream> {
+            // Сервер уже отобразил регион - имя больше не нужно.
+            shm_unlink(name.c_str());
+            return kj::heap<ShmRingStream>(kj::mv(doorbell), mapping, total_size, true);
+        },
+        [mapping, total_size, name](kj::Exception&& e) -> kj::Own<kj::AsyncIoStream> {
+            shm_unlink(name.c_str());
+            munmap(mapping, total_size);
+            kj::throwFatalException(kj::mv(e));
+        })
+        .attach(kj::mv(handshake), kj::mv(ack));
+}
+
+kj::Promise<kj::Own<kj::AsyncIoStream>> acceptShmRingStream(kj::Own<kj::AsyncIoStream> doorbell) {
+    auto handshake = kj::heap<Handshake>();
+    auto& doorbell_ref = *doorbell;
+    auto& handshake_ref = *handshake;
+    return doorbell_ref.read(&handshake_ref, sizeof(Handshake))
+        .then([&doorbell_ref, &handshake_ref]() {
+            handshake_ref.shm_name[sizeof(handshake_ref.shm_name) - 1] = '\0';
+            require_valid_capacity(handshake_ref.ring_capacity); // Значению клиента не доверяем
+            const size_t total_size = RegionLayout::total_size(handshake_ref.ring_capacity);
+
+            int fd;
+            KJ_SYSCALL(fd = shm_open(handshake_ref.shm_name, O_RDWR, 0600), handshake_ref.shm_name);
+            KJ_DEFER(close(fd));
+            struct stat st;
+            KJ_SYSCALL(fstat(fd, &st));
+            KJ_REQUIRE(static_cast<size_t>(st.st_size) >= total_size, "shm region smaller than announced",
+                       st.st_size, total_size);
+            void* mapping = map_shm(fd, total_size);
+
+            static const kj::byte ack = 1;
+            return doorbell_ref.write(&ack, 1).then([mapping, total_size]() {
+                return std::make_pair(mapping, total_size);
+            });
+        })
+        .then([doorbell = kj::mv(doorbell)](std::pair<void*, size_t> region) mutable -> kj::Own<kj::AsyncIoStream> {
+            return kj::heap<ShmRingStream>(kj::mv(doorbell), region.first, region.second, false);
+        })
+        .attach(kj::mv(handshake));
+}
+
+} // namespace capnp_benchmark
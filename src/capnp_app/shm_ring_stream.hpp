@@ -0,0 +1,27 @@
+// capnp_app/shm_ring_stream.hpp
+#pragma once
+
+#include <cstddef> // Для size_t
+
+#include <kj/async-io.h>
+#include <kj/memory.h>
+
+namespace capnp_benchmark {
+
+// Транспорт для Cap'n Proto RPC между процессами на одном хосте.
+//
+// Данные идут через два SPSC кольцевых буфера в POSIX shared memory (по одному на
+// направление), а Unix domain socket используется только для рукопожатия (передача
+// имени shm-объекта) и как "дверной звонок": 1 байт отправляется лишь тогда, когда
+// противоположная сторона заснула в ожидании данных или свободного места.
+// В устоявшемся потоке полезная нагрузка вообще не проходит через сокеты ядра.
+
+// Клиентская сторона: создает shm-объект с кольцами заданной емкости (на направление),
+// передает его имя серверу через `doorbell` и ждет подтверждения.
+kj::Promise<kj::Own<kj::AsyncIoStream>> connectShmRingStream(kj::Own<kj::AsyncIoStream> doorbell,
+                                                             size_t ring_capacity_bytes);
+
+// Серверная сторона: читает имя shm-объекта из `doorbell`, отображает его и подтверждает.
+kj::Promise<kj::Own<kj::AsyncIoStream>> acceptShmRingStream(kj::Own<kj::AsyncIoStream> doorbell);
+
+} // namespace capnp_benchmark
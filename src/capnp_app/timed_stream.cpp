@@ -0,0 +1,50 @@
+// capnp_app/timed_stream.cpp
+#include "timed_stream.hpp"
+#include "common/include/event_tracer.hpp"
+
+namespace capnp_benchmark {
+
+TimedStream::TimedStream(kj::Own<kj::AsyncIoStream> inner, benchmark_common::ServerStats& stats)
+    : inner_(kj::mv(inner)), stats_(stats), last_read_completed_(std::chrono::steady_clock::now()) {}
+
+kj::Promise<size_t> TimedStream::tryRead(void* buffer, size_t minBytes, size_t maxBytes) {
+    return inner_->tryRead(buffer, minBytes, maxBytes).then([this](size_t n) {
+        last_read_completed_ = std::chrono::steady_clock::now();
+        BENCHMARK_TRACE_INSTANT("read_done", "capnp_server");
+        stats_.add_bytes_in(n);
+        return n;
+    });
+}
+
+kj::Promise<void> TimedStream::write(const void* buffer, size_t size) {
+    const auto started = std::chrono::steady_clock::now();
+    return timeWrite(started, inner_->write(buffer, size), size);
+}
+
+kj::Promise<void> TimedStream::write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) {
+    size_t total = 0;
+    for (auto& piece : pieces) total += piece.size();
+    const auto started = std::chrono::steady_clock::now();
+    return timeWrite(started, inner_->write(pieces), total);
+}
+
+kj::Promise<void> TimedStream::timeWrite(std::chrono::steady_clock::time_point started,
+                                         kj::Promise<void> write, size_t size) {
+    return write.then([this, started, size]() {
+        const auto finished = std::chrono::steady_clock::now();
+        benchmark_common::trace_interval("socket_write", "capnp_server", started, finished);
+        stats_.record_stage(benchmark_common::ServerStage::WRITE,
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(finished - started).count());
+        stats_.add_bytes_out(size);
+    });
+}
+
+kj::Promise<void> TimedStream::whenWriteDisconnected() {
+    return inner_->whenWriteDisconnected();
+}
+
+void TimedStream::shutdownWrite() {
+    inner_->shutdownWrite();
+}
+
+} // namespace capnp_benchmark
@@ -0,0 +1,40 @@
+// capnp_app/timed_stream.hpp
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include <kj/async-io.h>
+#include <kj/memory.h>
+
+#include "common/include/server_stats.hpp"
+
+namespace capnp_benchmark {
+
+// Прозрачная обертка над потоком соединения для серверных метрик: считает байты в обе
+// стороны, время завершения каждой записи (этап write) и момент последнего завершенного
+// чтения. Ответ RPC уходит уже после возврата из processChunk(), поэтому запись видна
+// только здесь; а от момента чтения обработчик отсчитывает ожидание в очереди.
+// Оборачивает самый внешний поток, то есть видит байты RPC-сообщений до сжатия.
+class TimedStream final : public kj::AsyncIoStream {
+public:
+    TimedStream(kj::Own<kj::AsyncIoStream> inner, benchmark_common::ServerStats& stats);
+
+    kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override;
+    kj::Promise<void> write(const void* buffer, size_t size) override;
+    kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) override;
+    kj::Promise<void> whenWriteDisconnected() override;
+    void shutdownWrite() override;
+
+    std::chrono::steady_clock::time_point last_read_completed() const { return last_read_completed_; }
+
+private:
+    kj::Promise<void> timeWrite(std::chrono::steady_clock::time_point started, kj::Promise<void> write,
+                                size_t size);
+
+    kj::Own<kj::AsyncIoStream> inner_;
+    benchmark_common::ServerStats& stats_;
+    std::chrono::steady_clock::time_point last_read_completed_;
+};
+
+} // namespace capnp_benchmark
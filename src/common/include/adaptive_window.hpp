@@ -0,0 +1,91 @@
+// common/include/adaptive_window.hpp
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef> // Для size_t
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+
+namespace benchmark_common {
+
+class CliOptions;
+
+// Адаптивное окно запросов в полете (--adaptive-window): сколько чанков клиент держит
+// отправленными без ответа. Решение принимается раз в эпоху - когда пришло столько ответов,
+// сколько было окно (но не меньше ADAPTIVE_WINDOW_MIN_EPOCH_SAMPLES), - по пропускной
+// способности и среднему RTT эпохи:
+//   - базовый RTT - наименьший средний RTT эпохи за прогон (очереди нет);
+//   - старт: окно удваивается, пока пропускная способность растет, а RTT близок к базовому;
+//   - дальше AIMD: +1 за эпоху, пока RTT не выше базового больше чем на --window-rtt-tolerance-pct;
+//     выше (и пропускная способность при этом не выросла) - окно умножается на 0.7.
+// Пока канал не загружен, RTT не растет с окном; после насыщения лишние запросы только стоят
+// в очереди, и RTT растет пропорционально окну. Окно держится около точки, где очередь
+// удлиняет RTT на заданную долю, - это почти максимум пропускной способности без ручного подбора.
+// on_completion() вызывает поток, получающий ответы; window() можно читать из любого потока.
+struct AdaptiveWindowOptions {
+    size_t min_window = 1;
+    size_t max_window = ADAPTIVE_WINDOW_DEFAULT_MAX;
+    size_t initial_window = 1;
+    double rtt_tolerance = ADAPTIVE_WINDOW_RTT_TOLERANCE_PCT / 100.0; // Доля от базового RTT
+    double decrease_factor = ADAPTIVE_WINDOW_DECREASE_FACTOR;
+    double min_gain = ADAPTIVE_WINDOW_MIN_GAIN;
+    size_t min_epoch_samples = ADAPTIVE_WINDOW_MIN_EPOCH_SAMPLES;
+};
+
+// --window-max, --window-initial, --window-rtt-tolerance-pct поверх значений из config.hpp;
+// default_max - верхняя граница окна, если --window-max не задан.
+AdaptiveWindowOptions adaptive_window_options_from_options(const CliOptions& options, size_t default_max);
+
+class AdaptiveWindow {
+public:
+    // Одна эпоха: окно, с которым она закончилась, и что с ним сделано.
+    struct Sample {
+        double elapsed_s = 0.0;
+        size_t window_before = 0;
+        size_t window_after = 0;
+        double throughput_mbps = 0.0;
+        double mean_rtt_us = 0.0;
+        double base_rtt_us = 0.0;
+        const char* action = ""; // "grow", "shrink", "hold"
+    };
+
+    explicit AdaptiveWindow(const AdaptiveWindowOptions& options);
+
+    AdaptiveWindow(const AdaptiveWindow&) = delete;
+    AdaptiveWindow& operator=(const AdaptiveWindow&) = delete;
+
+    size_t window() const { return window_.load(std::memory_order_acquire); }
+    size_t max_window() const { return options_.max_window; }
+    // Ответ на запрос из payload_bytes байт пришел через rtt_us. true - окно изменилось.
+    bool on_completion(uint64_t payload_bytes, int64_t rtt_us);
+
+    std::vector<Sample> history() const;
+    // "window 48 (range 1..64), 37 epochs: 30 grow, 4 shrink, 3 hold, base RTT 85.2 us"
+    std::string describe() const;
+    // Окно во времени, строка на эпоху.
+    bool save_csv(const std::string& filename) const;
+
+private:
+    AdaptiveWindowOptions options_;
+    std::atomic<size_t> window_;
+
+    mutable std::mutex mutex_;
+    const std::chrono::steady_clock::time_point started_at_;
+    std::chrono::steady_clock::time_point epoch_started_at_;
+    uint64_t epoch_samples_ = 0;
+    uint64_t epoch_bytes_ = 0;
+    double epoch_rtt_sum_us_ = 0.0;
+    double base_rtt_us_ = 0.0;
+    double last_throughput_mbps_ = 0.0;
+    bool slow_start_ = true;
+    size_t lowest_window_;
+    size_t highest_window_;
+    std::vector<Sample> history_;
+};
+
+} // namespace benchmark_common
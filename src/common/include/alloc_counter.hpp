@@ -0,0 +1,17 @@
+// common/include/alloc_counter.hpp
+#pragma once
+
+#include <cstdint>
+
+namespace benchmark_common {
+
+// Счетчик выделений памяти в куче на весь процесс: для сравнения стоимости чанка в
+// выделениях до и после оптимизаций горячего пути. Подменяет глобальный operator new и
+// собирается только с make COUNT_ALLOCS=1 (BENCHMARK_COUNT_ALLOCS); иначе
+// heap_allocations_counted() == false и счетчик всегда 0.
+// Видит только operator new: malloc ядра gRPC (gpr_malloc) и других C-библиотек мимо него,
+// поэтому полное число выделений на чанк больше - его дает счетчик malloc через LD_PRELOAD.
+bool heap_allocations_counted();
+uint64_t heap_allocations();
+
+} // namespace benchmark_common
@@ -0,0 +1,32 @@
+// common/include/cli_options.hpp
+#pragma once
+
+#include <string>
+#include <map>
+#include <cstddef> // Для size_t
+
+namespace benchmark_common {
+
+// Минимальный разбор аргументов командной строки вида --key=value.
+// Флаг без значения (--key) трактуется как --key=1.
+// Значения по умолчанию берутся из config.hpp в месте вызова.
+class CliOptions {
+public:
+    CliOptions(int argc, char* argv[]);
+
+    bool has(const std::string& key) const;
+
+    std::string get_string(const std::string& key, const std::string& default_value) const;
+    long long get_int(const std::string& key, long long default_value) const;
+    // Поддерживает суффиксы K/M/G (степени 1024), например --chunk-size=64K.
+    size_t get_size(const std::string& key, size_t default_value) const;
+    bool get_bool(const std::string& key, bool default_value) const;
+
+    // Разбирает строку размера с суффиксом K/M/G. Бросает std::invalid_argument при ошибке.
+    static size_t parse_size(const std::string& text);
+
+private:
+    std::map<std::string, std::string> values_;
+};
+
+} // namespace benchmark_common
@@ -0,0 +1,31 @@
+// common/include/compression.hpp
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef> // Для size_t
+#include <cstdint>
+
+namespace benchmark_common {
+
+// Кодеки для блочного сжатия полезной нагрузки (используются Cap'n Proto транспортом).
+// ZSTD доступен только при сборке с WITH_ZSTD=1 (определяет BENCHMARK_WITH_ZSTD).
+enum class Codec : uint8_t {
+    NONE = 0,
+    DEFLATE = 1, // zlib
+    ZSTD = 2,
+    PACKED = 3   // Упаковка Cap'n Proto; кодируется на стороне capnp_app, здесь только имя
+};
+
+Codec codec_from_string(const std::string& name);
+std::string codec_to_string(Codec codec);
+bool codec_available(Codec codec);
+
+// Сжимает [data, data+size) в out (out перезаписывается). Уровень: -1 = по умолчанию кодека.
+// Возвращает false, если кодек недоступен или произошла ошибка.
+bool compress_buffer(Codec codec, const char* data, size_t size, std::vector<char>& out, int level = -1);
+
+// Распаковывает [data, data+size) ровно в raw_size байт по адресу out.
+bool decompress_buffer(Codec codec, const char* data, size_t size, char* out, size_t raw_size);
+
+} // namespace benchmark_common
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <cstddef> // Для size_t
+#include <stdexcept>
 
 namespace benchmark_common {
 
@@ -10,7 +11,26 @@ namespace benchmark_common {
 const std::string TEST_FILE_NAME = "test_file.dat";
 const size_t TEST_FILE_SIZE_GB = 10;
 const size_t ACTUAL_FILE_SIZE_BYTES =TEST_FILE_SIZE_GB * 1024 * 1024 * 1024;
-const size_t CHUNK_SIZE_BYTES = 64 * 1024;
+const size_t CHUNK_SIZE_BYTES = 64 * 1024; // По умолчанию; переопределяется --chunk-size
+
+// --- Режим --sweep (прогон по размерам чанка) ---
+const size_t SWEEP_MIN_CHUNK_BYTES = 1024;               // 1 KB
+const size_t SWEEP_MAX_CHUNK_BYTES = 16 * 1024 * 1024;   // 16 MB
+const size_t SWEEP_BYTES_PER_POINT = 256 * 1024 * 1024;  // Сколько данных гонять на каждом размере
+const int SWEEP_KNEE_TOLERANCE_PCT = 5;                    // Колено: в пределах 5% от максимума
+
+// Бюджет данных "в полете" у потоковых клиентов (inflight_budget.hpp), по умолчанию для
+// --inflight-bytes и --inflight-requests: при больших чанках одновременно отправленных
+// запросов меньше, чтобы не держать гигабайты копий.
+const size_t MAX_INFLIGHT_BYTES = 256 * 1024 * 1024;
+const size_t MAX_INFLIGHT_REQUESTS = 2000;
+
+// --- Адаптивное окно запросов (--adaptive-window, adaptive_window.hpp) ---
+const size_t ADAPTIVE_WINDOW_DEFAULT_MAX = 1024;         // --window-max (у gRPC не выше --inflight-requests)
+const int ADAPTIVE_WINDOW_RTT_TOLERANCE_PCT = 100;       // --window-rtt-tolerance-pct: RTT вдвое выше базового - очередь
+const double ADAPTIVE_WINDOW_DECREASE_FACTOR = 0.7;      // Во сколько раз сжимается окно при росте очереди
+const double ADAPTIVE_WINDOW_MIN_GAIN = 0.05;            // Прирост пропускной способности меньше 5% - плато
+const size_t ADAPTIVE_WINDOW_MIN_EPOCH_SAMPLES = 16;     // Эпоха - окно ответов, но не меньше стольких
 
 // ВОТ ЭТА КОНСТАНТА ДОЛЖНА БЫТЬ ТАКОЙ:
 const std::string CSV_OUTPUT_FILE_PREFIX = "benchmark"; // <--- ПРОВЕРЬТЕ ЭТО ИМЯ
@@ -19,13 +39,94 @@ const std::string CSV_OUTPUT_FILE_PREFIX = "benchmark"; // <--- ПРОВЕРЬТ
 const std::string GRPC_SERVER_ADDRESS = "127.0.0.1";
 const int GRPC_SERVER_PORT = 50051;
 
+// --- Окна HTTP/2 для gRPC (--http2-profile=bdp и --window-sweep) ---
+const long long HTTP2_DEFAULT_LINK_MBPS = 10000;  // --link-mbps: пропускная способность канала
+const long long HTTP2_DEFAULT_LINK_RTT_US = 1000; // --link-rtt-us: RTT канала
+const size_t HTTP2_WINDOW_SWEEP_MIN_BYTES = 64 * 1024;
+const size_t HTTP2_WINDOW_SWEEP_MAX_BYTES = 64 * 1024 * 1024;
+
+// --- Склейка записей в потоке gRPC (--write-batch, --write-flush-us, --write-batch-sweep) ---
+const size_t DEFAULT_GRPC_WRITE_BATCH = 1;          // 1 - каждая запись уходит сразу
+const long long DEFAULT_GRPC_WRITE_FLUSH_US = 200;  // Дольше запись в буфере не задерживается
+const size_t GRPC_WRITE_BATCH_SWEEP_MAX = 64;
+
 // --- Настройки сервера Cap'n Proto ---
 const std::string CAPNP_SERVER_ADDRESS = "0.0.0.0";
 const int CAPNP_SERVER_PORT = 50052;
 const std::string CAPNP_CLIENT_CONNECT_TO ="127.0.0.1";
+const size_t DEFAULT_CAPNP_WINDOW = 1; // --window: запросов processChunk/uploadChunk в полете
+// --parallel-chunks у сервера: чанки от стольких байт обрабатываются в пуле, меньшие - в цикле событий
+const size_t DEFAULT_CAPNP_PARALLEL_MIN_BYTES = 16 * 1024;
+
+// --- Сервер tcp_server (Boost.Asio, GO++PROJECT/src/cpp_tcp_benchmark) ---
+const int TCP_SERVER_PORT = 12345;
+
+// --- Генератор нагрузки (load_generator) ---
+const int LOADGEN_DEFAULT_CLIENTS = 16;
+const double LOADGEN_DEFAULT_RATE = 1000.0;        // Запросов в секунду на всех клиентов; 0 - closed loop
+const int LOADGEN_DEFAULT_DURATION_S = 10;
+const size_t LOADGEN_DEFAULT_PAYLOAD_BYTES = 4096;
+const long long LOADGEN_LATE_SEND_THRESHOLD_US = 1000; // Позже этого запрос считается отправленным с опозданием
+const int LOADGEN_DRAIN_TIMEOUT_S = 5;             // Сколько дослать запланированное после --duration
+const long long LATENCY_HISTOGRAM_MAX_US = 60LL * 1000 * 1000; // Верх гистограмм задержки (60 с)
+const int LATENCY_HISTOGRAM_DIGITS = 3;            // Точность гистограмм: 3 знака (0.1%)
+
+// --- Серверные метрики (server_stats.hpp) ---
+const long long SERVER_STATS_HISTOGRAM_MAX_NS = 60LL * 1000 * 1000 * 1000; // Верх гистограмм этапов (60 с)
+const int DEFAULT_SERVER_STATS_INTERVAL_S = 0;      // --stats-interval: 0 - отчет только по окончании прогона
+
+// --- Параллельная обработка чанков на сервере (worker_pool.hpp; --parallel-chunks, --response-order) ---
+const size_t DEFAULT_SERVER_PARALLEL_CHUNKS = 0;     // Потоков пула; 0 - чанк обрабатывает поток соединения
+const size_t DEFAULT_SERVER_PARALLEL_INFLIGHT = 64;  // --parallel-inflight: чанков одного соединения в пуле
+const size_t SERVER_WORKER_QUEUE_CAPACITY = 1024;    // Задач, ждущих рабочего, на весь сервер
+
+// --- Ход прогона во времени (progress_reporter.hpp) ---
+const int DEFAULT_PROGRESS_INTERVAL_MS = 1000;      // --progress-interval-ms: 0 - выключено
+const int DEFAULT_PROGRESS_WINDOW_INTERVALS = 5;    // --progress-window: окно p99 в интервалах
+const int MAX_PROGRESS_WINDOW_INTERVALS = 3600;     // Час при интервале в секунду; снимок ~5 KB на интервал
 
 // --- Настройки клиента ---
 const std::string TARGET_SERVER_IP = "127.0.0.1";
+// --verify-threads: потоки проверки эхо-ответов gRPC-клиента (verification_pool.hpp);
+// 0 - проверка в потоке чтения, как раньше
+const size_t DEFAULT_VERIFY_THREADS = 2;
+
+// --- Транспорт (выбирается через --transport=tcp|unix|shm|inproc) ---
+// tcp  - loopback/сетевой TCP (по умолчанию);
+// unix - Unix domain socket, только для одного хоста;
+// shm  - кольцевые буферы в разделяемой памяти + UDS для рукопожатия и "звонков" (только Cap'n Proto);
+// inproc - сервер в процессе клиента, без сокетов (только клиенты): та же обработка, что и на
+//          сервере, поэтому разница с tcp/unix - стоимость сетевого стека.
+enum class Transport {
+    TCP,
+    UNIX,
+    SHM,
+    INPROC
+};
+
+const std::string DEFAULT_TRANSPORT = "tcp";
+const std::string GRPC_UNIX_SOCKET_PATH = "/tmp/grpc_benchmark.sock";
+const std::string CAPNP_UNIX_SOCKET_PATH = "/tmp/capnp_benchmark.sock";
+const size_t SHM_RING_CAPACITY_BYTES = 8 * 1024 * 1024; // На каждое направление
+const size_t SHM_RING_MAX_CAPACITY_BYTES = 1024 * 1024 * 1024; // Предел --shm-ring-size и рукопожатия
+
+inline Transport transport_from_string(const std::string& name) {
+    if (name == "tcp") return Transport::TCP;
+    if (name == "unix") return Transport::UNIX;
+    if (name == "shm") return Transport::SHM;
+    if (name == "inproc") return Transport::INPROC;
+    throw std::invalid_argument("Unknown transport: " + name + " (expected tcp|unix|shm|inproc)");
+}
+
+inline std::string transport_to_string(Transport t) {
+    switch (t) {
+        case Transport::TCP: return "tcp";
+        case Transport::UNIX: return "unix";
+        case Transport::SHM: return "shm";
+        case Transport::INPROC: return "inproc";
+        default: return "unknown";
+    }
+}
 
 
 // --- Настройки для метрик ---
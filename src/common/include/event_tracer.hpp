@@ -0,0 +1,101 @@
+// common/include/event_tracer.hpp
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef> // Для size_t
+#include <string>
+
+namespace benchmark_common {
+
+// Трассировка событий горячего пути (--event-trace=файл.json): что делал каждый поток во время
+// прогона. Каждый поток пишет в свое кольцо фиксированного размера без блокировок и выделений
+// памяти; в конце прогона кольца выгружаются в формат Chrome trace (JSON), который открывают
+// chrome://tracing и ui.perfetto.dev.
+// Выключенная трассировка стоит одной проверки атомарного флага на событие.
+// Имена событий и категорий должны быть строковыми литералами: хранится только указатель.
+
+struct TraceEvent {
+    const char* name;
+    const char* category;
+    int64_t start_ns; // steady_clock
+    int64_t duration_ns; // -1 - мгновенное событие
+};
+
+// Емкость кольца одного потока; при переполнении затираются самые старые события.
+constexpr size_t EVENT_TRACE_RING_EVENTS = 1 << 16;
+
+namespace event_trace_detail {
+extern std::atomic<bool> g_enabled;
+
+inline int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void append(const TraceEvent& event);
+} // namespace event_trace_detail
+
+inline bool event_tracing_enabled() {
+    return event_trace_detail::g_enabled.load(std::memory_order_relaxed);
+}
+
+// Включает запись; события до вызова не сохраняются. Пустой путь - трассировка остается выключенной.
+void start_event_trace(const std::string& output_path);
+// Сохраняет все кольца в файл из start_event_trace() и очищает их, запись продолжается
+// (серверы сохраняют трассу после каждого прогона клиента). Вызывать, когда рабочие потоки
+// простаивают: кольцо потока, который продолжает писать, может выгрузиться частично.
+bool save_event_trace();
+// Выключает запись и сохраняет то, что накоплено.
+bool stop_event_trace();
+
+// Имя текущего потока в трассе (по умолчанию "thread-N").
+void set_event_trace_thread_name(const std::string& name);
+
+inline void trace_instant(const char* name, const char* category) {
+    if (!event_tracing_enabled()) return;
+    event_trace_detail::append(TraceEvent{name, category, event_trace_detail::now_ns(), -1});
+}
+
+// Интервал, замеренный вызывающим: для асинхронных операций, которые не укладываются в блок.
+inline void trace_interval(const char* name, const char* category,
+                           std::chrono::steady_clock::time_point start,
+                           std::chrono::steady_clock::time_point end) {
+    if (!event_tracing_enabled()) return;
+    const int64_t start_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+    event_trace_detail::append(TraceEvent{
+        name, category, start_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()});
+}
+
+// Интервал от конструктора до деструктора.
+class TraceScope {
+public:
+    TraceScope(const char* name, const char* category)
+        : name_(name), category_(category),
+          start_ns_(event_tracing_enabled() ? event_trace_detail::now_ns() : 0) {}
+    ~TraceScope() {
+        if (start_ns_ == 0) return;
+        event_trace_detail::append(
+            TraceEvent{name_, category_, start_ns_, event_trace_detail::now_ns() - start_ns_});
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    const char* category_;
+    int64_t start_ns_;
+};
+
+} // namespace benchmark_common
+
+#define BENCHMARK_TRACE_CONCAT_INNER(a, b) a##b
+#define BENCHMARK_TRACE_CONCAT(a, b) BENCHMARK_TRACE_CONCAT_INNER(a, b)
+
+// BENCHMARK_TRACE_SCOPE("reverse", "server") - интервал до конца текущего блока.
+#define BENCHMARK_TRACE_SCOPE(name, category) \
+    ::benchmark_common::TraceScope BENCHMARK_TRACE_CONCAT(benchmark_trace_scope_, __LINE__)(name, category)
+#define BENCHMARK_TRACE_INSTANT(name, category) ::benchmark_common::trace_instant(name, category)
@@ -9,7 +9,25 @@
 
 namespace benchmark_common {
 
-bool generate_test_file(const std::string& filename, size_t size_bytes);
+// Профиль содержимого тестового файла - определяет, насколько он сжимаем.
+// random - несжимаемые данные (исходное поведение), text - строки лога (сжатие ~5x),
+// zeros - нули (вырожденный лучший случай), mixed - чередование random/text блоками по 32 KB.
+enum class ContentProfile {
+    RANDOM,
+    TEXT,
+    ZEROS,
+    MIXED
+};
+
+ContentProfile content_profile_from_string(const std::string& name);
+std::string content_profile_to_string(ContentProfile profile);
+
+// Имя файла для профиля: для random совпадает с TEST_FILE_NAME, для остальных добавляется суффикс,
+// чтобы файлы разных профилей одного размера не подменяли друг друга.
+std::string test_file_name_for_profile(const std::string& base_name, ContentProfile profile);
+
+bool generate_test_file(const std::string& filename, size_t size_bytes,
+                        ContentProfile profile = ContentProfile::RANDOM);
 
 class ChunkReader {
 public:
@@ -23,6 +41,11 @@ public:
     // Возвращает пустой вектор, если достигнут конец файла или произошла ошибка.
     std::vector<char> next_chunk();
 
+    // То же, но читает в buffer, сохраняя его емкость между вызовами: в цикле отправки
+    // чанк читается прямо в поле переиспользуемого сообщения без выделения памяти.
+    // Возвращает прочитанный размер (0 - конец файла или ошибка), buffer обрезается до него.
+    size_t next_chunk_into(std::string& buffer);
+
     // Проверяет, достигнут ли конец файла.
     bool eof() const;
 
@@ -37,6 +60,9 @@ public:
     size_t get_file_size_from_impl() const { return file_size_; } // Если нужен доступ к file_size_
 
 private:
+    // Читает до chunk_size_ байт в destination, обновляет счетчики и флаг EOF.
+    size_t read_chunk(char* destination);
+
     std::string filename_;
     size_t chunk_size_;
     std::ifstream file_stream_;
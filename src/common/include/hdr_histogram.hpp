@@ -0,0 +1,71 @@
+// common/include/hdr_histogram.hpp
+#pragma once
+
+#include <cstdint>
+#include <cstddef> // Для size_t
+#include <string>
+#include <vector>
+
+namespace benchmark_common {
+
+// Гистограмма с динамическим диапазоном в духе HdrHistogram: значения от lowest до highest
+// хранятся с относительной точностью significant_digits десятичных знаков (3 знака - ошибка
+// не больше 0.1%) в массиве счетчиков фиксированного размера. Запись - O(1) без аллокаций,
+// поэтому годится для горячего пути; гистограммы потоков сливаются через merge().
+// Значения выше highest записываются как highest и считаются в overflow_count().
+class HdrHistogram {
+public:
+    HdrHistogram(int64_t lowest_trackable, int64_t highest_trackable, int significant_digits);
+
+    void record(int64_t value);
+    // Прибавляет счетчики other; параметры диапазона должны совпадать.
+    void merge(const HdrHistogram& other);
+    void reset();
+
+    uint64_t total_count() const { return total_count_; }
+    uint64_t overflow_count() const { return overflow_count_; }
+    int64_t min() const { return total_count_ == 0 ? 0 : min_value_; }
+    int64_t max() const { return max_value_; }
+    double mean() const;
+    // Наибольшее значение, не превышаемое percentile процентами записей (percentile в [0, 100]).
+    int64_t value_at_percentile(double percentile) const;
+
+    // Одна строка распределения: значение, процентиль, накопленный счетчик.
+    struct PercentileRow {
+        int64_t value;
+        double percentile;
+        uint64_t total_count;
+    };
+    // Процентили 0, 50, 75, 87.5, ... (ticks_per_half_distance шагов на каждую половину
+    // оставшегося расстояния до 100) и 100 - формат, который понимают плоттеры HdrHistogram.
+    std::vector<PercentileRow> percentile_distribution(int ticks_per_half_distance) const;
+
+    // CSV Value,Percentile,TotalCount,1/(1-Percentile); значения делятся на value_divisor
+    // (например, 1000.0 для мкс -> мс).
+    bool save_distribution_csv(const std::string& filename, double value_divisor,
+                               int ticks_per_half_distance = 5) const;
+
+private:
+    size_t counts_index_for(int64_t value) const;
+    int64_t value_from_index(size_t index) const;
+    int64_t highest_equivalent_value(int64_t value) const;
+
+    int64_t lowest_trackable_;
+    int64_t highest_trackable_;
+    int significant_digits_;
+    int unit_magnitude_;
+    int sub_bucket_half_count_magnitude_;
+    int64_t sub_bucket_count_;
+    int64_t sub_bucket_half_count_;
+    int64_t sub_bucket_mask_;
+    int bucket_count_;
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_count_ = 0;
+    uint64_t overflow_count_ = 0;
+    int64_t min_value_ = 0;
+    int64_t max_value_ = 0;
+    double sum_ = 0.0;
+};
+
+} // namespace benchmark_common
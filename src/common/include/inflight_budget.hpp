@@ -0,0 +1,108 @@
+// common/include/inflight_budget.hpp
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef> // Для size_t
+#include <mutex>
+#include <string>
+
+namespace benchmark_common {
+
+class CliOptions;
+
+// Бюджет данных "в полете" (--inflight-bytes, --inflight-requests): сколько байт полезной
+// нагрузки и сколько запросов может быть отправлено, но еще не завершено - то есть не получен
+// и не проверен ответ, пока клиент держит копию чанка для проверки. В отличие от фиксированного
+// окна в запросах, память под чанки ограничена независимо от их размера, поэтому свипы с
+// чанками в мегабайты не упираются в OOM. Лимит по числу запросов остается страховкой для
+// крошечных чанков, где байтовый бюджет пропустил бы миллионы запросов.
+// Один бюджет делится всеми клиентами процесса (shared_inflight_budget()), так что несколько
+// потоков вместе не превышают лимит. Запрос, который больше всего бюджета, пропускается,
+// когда в полете ничего нет, - иначе он ждал бы вечно.
+class InflightBudget {
+public:
+    struct Stats {
+        uint64_t acquired = 0;       // Сколько запросов прошло через бюджет
+        uint64_t blocked_waits = 0;  // Сколько из них ждали места
+        int64_t blocked_ns = 0;      // Сколько всего ждали
+        uint64_t peak_bytes = 0;     // Пик с последнего begin_run()
+        uint64_t peak_requests = 0;
+    };
+
+    InflightBudget(uint64_t max_bytes, uint64_t max_requests);
+
+    InflightBudget(const InflightBudget&) = delete;
+    InflightBudget& operator=(const InflightBudget&) = delete;
+
+    void set_limits(uint64_t max_bytes, uint64_t max_requests);
+    uint64_t max_bytes() const;
+    uint64_t max_requests() const;
+
+    // Ждет места под запрос из bytes байт. false - abandon стал true (поток запросов
+    // закончился, ответов больше не будет): места не выделено. После установки abandon
+    // ожидающих будит wake_waiters().
+    bool acquire(uint64_t bytes, const std::atomic<bool>& abandon);
+    // Для синхронных клиентов: место держат только запросы, ответ на которые уже ждут, так что
+    // ожидание всегда закончится.
+    void acquire(uint64_t bytes);
+    // Место под запрос, только если оно есть прямо сейчас, без ожидания. Склейка записей
+    // занимает место под следующий чанк до записи текущего: не вышло - писатель заснет в
+    // acquire(), и пачка закрывается текущей записью.
+    bool try_acquire(uint64_t bytes);
+    // Меняет размер занятого запросом места с reserved на actual байт (место заняли заранее под
+    // полный чанк, а чанк оказался короче).
+    void adjust(uint64_t reserved, uint64_t actual);
+    void release(uint64_t bytes);
+    void wake_waiters();
+    // Пришлось бы следующему запросу из bytes байт ждать прямо сейчас.
+    bool would_block(uint64_t bytes) const;
+
+    Stats stats() const;
+    // Начало прогона: пик сбрасывается до текущей занятости, возвращается снимок для describe().
+    // Бюджет общий, поэтому в пик входят и запросы параллельных прогонов.
+    Stats begin_run();
+    // Отчет о бюджете за прогон: разность снимков begin_run() и stats() в конце, пик - за прогон.
+    static std::string describe(const Stats& before, const Stats& after, uint64_t max_bytes, uint64_t max_requests);
+
+private:
+    bool fits_locked(uint64_t bytes) const;
+    void take_locked(uint64_t bytes);
+    bool acquire_impl(uint64_t bytes, const std::atomic<bool>* abandon);
+
+    mutable std::mutex mutex_;
+    std::condition_variable space_freed_;
+    uint64_t max_bytes_;
+    uint64_t max_requests_;
+    uint64_t bytes_ = 0;
+    uint64_t requests_ = 0;
+    Stats stats_;
+};
+
+// Место в бюджете на время блока: запрос синхронного клиента от отправки до проверки ответа.
+class InflightReservation {
+public:
+    InflightReservation(InflightBudget& budget, uint64_t bytes) : budget_(budget), bytes_(bytes) {
+        budget_.acquire(bytes_);
+    }
+    ~InflightReservation() { budget_.release(bytes_); }
+
+    InflightReservation(const InflightReservation&) = delete;
+    InflightReservation& operator=(const InflightReservation&) = delete;
+
+private:
+    InflightBudget& budget_;
+    uint64_t bytes_;
+};
+
+// Бюджет, общий для всех клиентов процесса. Лимиты по умолчанию - MAX_INFLIGHT_BYTES и
+// MAX_INFLIGHT_REQUESTS из config.hpp, клиенты переопределяют их из командной строки.
+InflightBudget& shared_inflight_budget();
+
+// --inflight-bytes=64M, --inflight-requests=N: лимиты общего бюджета. Бросает
+// std::invalid_argument для нулевых значений.
+void configure_shared_inflight_budget(const CliOptions& options);
+
+} // namespace benchmark_common
@@ -0,0 +1,68 @@
+// common/include/latency_trace.hpp
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstddef> // Для size_t
+#include <mutex>
+#include <string>
+
+#include "hdr_histogram.hpp"
+
+namespace benchmark_common {
+
+// Отметки времени одного чанка (--trace), в наносекундах steady_clock (CLOCK_MONOTONIC).
+// Клиент и сервер в тестах работают на одном хосте, поэтому отметки двух процессов сравнимы;
+// между разными машинами разности сетевых этапов смысла не имеют.
+// 0 - отметка не поставлена (сервер без поддержки трассировки).
+struct TraceStamps {
+    int64_t client_send_ns = 0;         // Клиент: непосредственно перед отправкой запроса
+    int64_t server_recv_ns = 0;         // Сервер: запрос получен
+    int64_t server_process_done_ns = 0; // Сервер: обработка (реверс/CRC32) закончена
+    int64_t server_send_ns = 0;         // Сервер: ответ передается на отправку
+};
+
+inline int64_t to_trace_ns(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+inline int64_t trace_now_ns() {
+    return to_trace_ns(std::chrono::steady_clock::now());
+}
+
+// Этапы, на которые раскладывается RTT чанка
+enum class TraceStage {
+    REQUEST_NETWORK,  // client_send -> server_recv: стек клиента, сеть, стек сервера
+    SERVER_PROCESS,   // server_recv -> server_process_done
+    SERVER_SEND,      // server_process_done -> server_send: построение ответа
+    RESPONSE_NETWORK, // server_send -> прием ответа клиентом
+    TOTAL             // client_send -> прием ответа клиентом
+};
+constexpr size_t TRACE_STAGE_COUNT = 5;
+
+std::string trace_stage_to_string(TraceStage stage);
+
+// Собирает отметки чанков в гистограммы этапов (в наносекундах) и выводит разбивку RTT.
+// Потокобезопасна: у gRPC-клиента ответы принимает отдельный поток.
+class TraceCollector {
+public:
+    explicit TraceCollector(std::string protocol_name);
+
+    // client_recv_ns - момент приема ответа клиентом. Неполные отметки и отрицательные
+    // этапы (сервер без --trace, разные часы) не записываются, а считаются отброшенными.
+    void record(const TraceStamps& stamps, int64_t client_recv_ns);
+
+    uint64_t samples() const;
+    void print_summary() const;
+    bool save_csv(const std::string& filename) const;
+
+private:
+    std::string protocol_name_;
+    mutable std::mutex mutex_;
+    std::array<HdrHistogram, TRACE_STAGE_COUNT> stages_ns_;
+    uint64_t samples_ = 0;
+    uint64_t rejected_ = 0;
+};
+
+} // namespace benchmark_common
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <utility> // Для std::pair
 #include <chrono>
 #include <cstddef> // For size_t
 
@@ -18,11 +19,20 @@ public:
     void record_chunk_rtt_us(long long rtt_us); // RTT в микросекундах
     void set_total_transaction_time_ms(long long time_ms);
     void log_error(const std::string& error_message);
+    // Параметры прогона (профиль сокета, окна HTTP/2 и т.п.): печатаются в сводке и пишутся
+    // в summary CSV строками Param_<name>, чтобы результаты можно было сравнивать между прогонами.
+    void set_run_parameter(const std::string& name, const std::string& value);
 
     void print_summary_to_console() const;
     bool save_summary_csv(const std::string& filename) const;
     bool save_detailed_rtt_csv(const std::string& filename) const;
 
+    // Итоговые показатели (используются, например, режимом --sweep)
+    double get_throughput_payload_mbps() const; // Payload в один конец
+    double get_avg_chunk_rtt_ms() const;
+    double get_percentile_chunk_rtt_ms(double percentile) const; // percentile в [0, 100]
+    size_t get_error_count() const { return errors_.size(); }
+
 private:
     std::string protocol_name_;
     size_t total_payload_to_transfer_bytes_; // Сколько всего данных мы намеревались передать (один путь)
@@ -33,15 +43,14 @@ private:
 
     std::vector<long long> chunk_rtt_us_; // Храним все RTT для детальной статистики
     std::vector<std::string> errors_;
+    std::vector<std::pair<std::string, std::string>> run_parameters_;
 
     // Приватные методы для расчетов
     double get_total_payload_sent_mb() const;
     double get_total_data_on_wire_mb() const;
     double get_protocol_overhead_percentage() const;
-    double get_throughput_payload_mbps() const; // Payload в один конец
     double get_throughput_on_wire_mbps() const; // On-wire в один конец
 
-    double get_avg_chunk_rtt_ms() const;
     double get_min_chunk_rtt_ms() const;
     double get_max_chunk_rtt_ms() const;
     double get_std_dev_chunk_rtt_ms() const;
@@ -0,0 +1,109 @@
+// common/include/mpmc_queue.hpp
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef> // Для size_t
+#include <cstdint> // Для intptr_t
+#include <memory>
+#include <thread>
+#include <utility> // Для std::move
+
+namespace benchmark_common {
+
+// Ожидание у пустой или полной очереди: сколько попыток поток крутится на yield(), прежде
+// чем начать засыпать. Под нагрузкой задачи идут подряд, а в простое ожидающие не должны
+// занимать ядра.
+constexpr int QUEUE_IDLE_SPINS_BEFORE_SLEEP = 64;
+constexpr auto QUEUE_IDLE_SLEEP = std::chrono::microseconds(50);
+
+inline void queue_idle_wait(int& idle_spins) {
+    if (++idle_spins < QUEUE_IDLE_SPINS_BEFORE_SLEEP) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(QUEUE_IDLE_SLEEP);
+    }
+}
+
+// Ограниченная очередь без блокировок для нескольких писателей и читателей (схема Вьюкова):
+// у каждой ячейки свой номер последовательности, писатель и читатель захватывают позицию одним
+// CAS и дальше работают со своей ячейкой, не мешая друг другу. Емкость округляется вверх до
+// степени двойки. Ожидания нет: полная/пустая очередь сразу возвращает false, как ждать -
+// решает вызывающий.
+template <typename T>
+class BoundedMpmcQueue {
+public:
+    explicit BoundedMpmcQueue(size_t capacity)
+        : capacity_(round_up_to_power_of_two(capacity)),
+          mask_(capacity_ - 1),
+          cells_(new Cell[capacity_]) {
+        for (size_t i = 0; i < capacity_; ++i) cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedMpmcQueue(const BoundedMpmcQueue&) = delete;
+    BoundedMpmcQueue& operator=(const BoundedMpmcQueue&) = delete;
+
+    // Забирает value (перемещением) только при успехе; при полной очереди value не трогается.
+    bool try_push(T& value) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Ячейку еще не освободил читатель прошлого круга - очередь полна
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& out) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(cell.value);
+                    cell.sequence.store(pos + capacity_, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Писатель этой позиции еще не дописал - очередь пуста
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence{0};
+        T value;
+    };
+
+    static size_t round_up_to_power_of_two(size_t n) {
+        size_t result = 2;
+        while (result < n) result <<= 1;
+        return result;
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    // Позиции писателей и читателей в разных кэш-линиях
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<size_t> dequeue_pos_{0};
+};
+
+} // namespace benchmark_common
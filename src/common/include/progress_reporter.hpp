@@ -0,0 +1,96 @@
+// common/include/progress_reporter.hpp
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef> // Для size_t
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace benchmark_common {
+
+// Прогресс прогона во времени (--progress-interval-ms=N, по умолчанию раз в секунду; 0 - выключено).
+// Горячий путь только увеличивает атомарные счетчики - без ветвлений, блокировок и вывода.
+// Фоновый поток раз в интервал снимает их и печатает/пишет в CSV строку временного ряда:
+// мгновенную пропускную способность, число запросов в полете и p99 задержки в скользящем окне
+// из последних --progress-window интервалов. По ряду видны разогрев, простои и паузы,
+// которые итоговая сводка усредняет. Интервалы простоя (ничего не завершено и ничего в полете)
+// пропускаются.
+class ProgressReporter {
+public:
+    explicit ProgressReporter(std::string label);
+    ~ProgressReporter();
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+    // Запускает фоновый поток; interval_ms <= 0 - отчетов нет, счетчики просто копятся.
+    // csv_filename пустой - ряд только печатается.
+    void start(int interval_ms, int window_intervals, const std::string& csv_filename);
+    // Снимает последний отсчет, останавливает поток и закрывает CSV. Повторный вызов ничего не делает.
+    void stop();
+
+    // Запрос отправлен (или принят сервером). В полете = отправленные - завершенные; у кого
+    // on_sent не вызывается, в полете всегда 0.
+    void on_sent() { sent_.fetch_add(1, std::memory_order_relaxed); }
+    // Запрос завершен: payload_bytes полезной нагрузки, задержка latency_us (RTT у клиента,
+    // время обслуживания у сервера).
+    void on_completed(uint64_t payload_bytes, int64_t latency_us) {
+        completed_.fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_add(payload_bytes, std::memory_order_relaxed);
+        latency_counts_[latency_bucket(latency_us)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    // Лог-линейные корзины задержки в мкс: 16 подкорзин на каждую степень двойки (точность ~6%),
+    // до ~2^40 мкс. Атомарный массив вместо HdrHistogram, чтобы писать без мьютекса из любого потока.
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr size_t SUB_BUCKETS = size_t{1} << SUB_BUCKET_BITS;
+    static constexpr size_t LATENCY_BUCKETS = SUB_BUCKETS * 38;
+
+    static size_t latency_bucket(int64_t latency_us) {
+        uint64_t v = latency_us > 0 ? static_cast<uint64_t>(latency_us) : 0;
+        if (v < SUB_BUCKETS) return static_cast<size_t>(v);
+        const int exponent = 63 - __builtin_clzll(v);
+        const size_t index = SUB_BUCKETS * static_cast<size_t>(exponent - SUB_BUCKET_BITS + 1) +
+                             static_cast<size_t>((v >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+        return index < LATENCY_BUCKETS ? index : LATENCY_BUCKETS - 1;
+    }
+    static int64_t bucket_upper_us(size_t index);
+
+    using LatencySnapshot = std::array<uint64_t, LATENCY_BUCKETS>;
+    void sample_loop();
+    void take_sample(std::chrono::steady_clock::time_point now);
+
+    std::string label_;
+    std::string csv_filename_;
+
+    std::atomic<uint64_t> sent_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::array<std::atomic<uint64_t>, LATENCY_BUCKETS> latency_counts_{};
+
+    // Дальше - только поток отчетов (и stop() после его остановки)
+    int interval_ms_ = 0;
+    std::chrono::steady_clock::time_point started_at_;
+    std::chrono::steady_clock::time_point last_sample_at_;
+    uint64_t last_completed_ = 0;
+    uint64_t last_bytes_ = 0;
+    std::vector<LatencySnapshot> window_; // Накопленные корзины последних отсчетов, по кругу
+    std::vector<std::chrono::steady_clock::time_point> window_at_; // Когда снят каждый
+    size_t samples_taken_ = 0;
+    std::ofstream csv_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable stop_cv_;
+    bool stopping_ = false; // Под mutex_
+};
+
+} // namespace benchmark_common
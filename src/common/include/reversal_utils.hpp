@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include <algorithm> // Для std::reverse
+#include <cstddef>   // Для size_t
 
 namespace benchmark_common {
 
@@ -16,4 +17,10 @@ inline void reverse_string(std::string& data) {
     std::reverse(data.begin(), data.end());
 }
 
+// Записывает src[0..size) в dst в обратном порядке за один проход.
+// Буферы не должны пересекаться; позволяет избежать промежуточной копии.
+inline void reverse_copy_bytes(const char* src, size_t size, char* dst) {
+    std::reverse_copy(src, src + size, dst);
+}
+
 } // namespace benchmark_common
@@ -0,0 +1,128 @@
+// common/include/server_stats.hpp
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef> // Для size_t
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "hdr_histogram.hpp"
+
+namespace benchmark_common {
+
+// Этапы обработки одного запроса на сервере. Сервер замеряет те, что видны из его API;
+// остальные остаются пустыми и в отчете показываются как n/a.
+enum class ServerStage {
+    QUEUE_WAIT,  // Запрос уже получен, но обработка еще не началась
+    DESERIALIZE, // Разбор запроса / извлечение данных
+    REVERSE,     // Сама работа: реверс байт (или CRC32 в режиме upload)
+    SERIALIZE,   // Построение ответа
+    WRITE        // От начала отправки ответа до завершения записи
+};
+constexpr size_t SERVER_STAGE_COUNT = 5;
+
+std::string server_stage_to_string(ServerStage stage);
+
+// Времена этапов одного запроса. lap(stage) относит время с предыдущей отметки к этапу,
+// поэтому этапы можно размечать по ходу обработки, не заводя переменную на каждый.
+class RequestTiming {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    RequestTiming() { stage_ns_.fill(-1); }
+
+    void start() { last_ = Clock::now(); }
+    void start_at(Clock::time_point t) { last_ = t; }
+    void lap(ServerStage stage) {
+        Clock::time_point now = Clock::now();
+        add(stage, now - last_);
+        last_ = now;
+    }
+    void add(ServerStage stage, Clock::duration d) {
+        int64_t& slot = stage_ns_[static_cast<size_t>(stage)];
+        slot = (slot < 0 ? 0 : slot) + std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    }
+    // -1 - этап не замерялся
+    int64_t stage_ns(ServerStage stage) const { return stage_ns_[static_cast<size_t>(stage)]; }
+
+private:
+    std::array<int64_t, SERVER_STAGE_COUNT> stage_ns_;
+    Clock::time_point last_;
+};
+
+// Серверные метрики одного процесса: гистограммы этапов и суммарного времени обслуживания
+// запроса (сумма замеренных этапов), байты в обе стороны, активные сессии.
+// Потокобезопасна: гистограммы под мьютексом, счетчики атомарные.
+// Когда закрывается последняя сессия, отчет печатается, сохраняется в CSV и метрики
+// обнуляются - так каждый прогон клиента получает свой отчет. --stats-interval=N
+// дополнительно печатает накопленное каждые N секунд, пока есть запросы.
+// Разность RTT клиента и времени обслуживания здесь - сеть плюс стек gRPC/KJ.
+class ServerStats {
+public:
+    ServerStats(std::string protocol_name, std::string csv_filename);
+    ~ServerStats();
+
+    ServerStats(const ServerStats&) = delete;
+    ServerStats& operator=(const ServerStats&) = delete;
+
+    void record(const RequestTiming& timing);
+    // Этап, замеренный отдельно от запроса (например, запись ответа транспортом KJ).
+    void record_stage(ServerStage stage, int64_t ns);
+    void add_bytes_in(uint64_t bytes) { bytes_in_.fetch_add(bytes, std::memory_order_relaxed); }
+    void add_bytes_out(uint64_t bytes) { bytes_out_.fetch_add(bytes, std::memory_order_relaxed); }
+
+    void session_opened();
+    void session_closed();
+    int active_sessions() const { return active_sessions_.load(); }
+
+    std::string report() const;
+    bool save_csv(const std::string& filename) const;
+
+    // Периодическая печать отчета в фоновом потоке; 0 - выключено.
+    void start_periodic_dump(int interval_seconds);
+
+private:
+    void reset_locked();
+    std::string report_locked() const;
+    bool save_csv_locked(const std::string& filename) const;
+    void dump_loop(int interval_seconds);
+
+    std::string protocol_name_;
+    std::string csv_filename_;
+
+    mutable std::mutex mutex_;
+    std::array<HdrHistogram, SERVER_STAGE_COUNT> stages_ns_;
+    HdrHistogram service_ns_;
+    uint64_t requests_ = 0;
+    uint64_t requests_at_last_dump_ = 0;
+    uint64_t sessions_total_ = 0;
+    std::chrono::steady_clock::time_point since_;
+
+    std::atomic<uint64_t> bytes_in_{0};
+    std::atomic<uint64_t> bytes_out_{0};
+    std::atomic<int> active_sessions_{0};
+
+    std::thread dump_thread_;
+    std::condition_variable stop_cv_;
+    bool stopping_ = false; // Под mutex_
+};
+
+// Сессия считается активной, пока жив объект: удобно для ранних return и для attach() в KJ.
+class ScopedServerSession {
+public:
+    explicit ScopedServerSession(ServerStats& stats) : stats_(stats) { stats_.session_opened(); }
+    ~ScopedServerSession() { stats_.session_closed(); }
+
+    ScopedServerSession(const ScopedServerSession&) = delete;
+    ScopedServerSession& operator=(const ScopedServerSession&) = delete;
+
+private:
+    ServerStats& stats_;
+};
+
+} // namespace benchmark_common
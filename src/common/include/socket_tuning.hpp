@@ -0,0 +1,61 @@
+// common/include/socket_tuning.hpp
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace benchmark_common {
+
+class CliOptions;
+
+// Профиль настроек TCP-сокета, общий для gRPC и Cap'n Proto (и того же набора в Asio-бенчмарке).
+// Нулевые/ложные значения означают "оставить значение ядра".
+struct SocketTuning {
+    std::string name = "default";  // Имя профиля, попадает в отчеты
+    bool no_delay = false;         // TCP_NODELAY: отключить алгоритм Нейгла
+    int send_buffer_bytes = 0;     // SO_SNDBUF
+    int receive_buffer_bytes = 0;  // SO_RCVBUF
+    bool quick_ack = false;        // TCP_QUICKACK: ядро сбрасывает его само, держится до следующей паузы в ACK
+    int busy_poll_us = 0;          // SO_BUSY_POLL, мкс; выше net.core.busy_read может потребовать CAP_NET_ADMIN
+
+    bool is_default() const;
+};
+
+// Одна опция setsockopt() в виде, пригодном для любого стека (fd, kj::AsyncIoStream, Asio).
+struct SocketOptionSetting {
+    int level;
+    int name;
+    int value;
+    const char* label;
+};
+
+// Готовые профили: default, nodelay, quickack, buffers, busypoll, latency (nodelay+quickack+busypoll),
+// throughput (nodelay + буферы 4 MB). Бросает std::invalid_argument для неизвестного имени.
+SocketTuning socket_tuning_preset(const std::string& name);
+
+// Профили для --socket-sweep: по одной опции поверх default, затем сочетания.
+std::vector<std::string> socket_tuning_sweep_presets();
+
+// --socket-profile=<профиль>, поверх него отдельные --nodelay, --sndbuf=4M, --rcvbuf=4M,
+// --quickack, --busy-poll=<мкс>. Любая отдельная опция переименовывает профиль в "custom".
+SocketTuning socket_tuning_from_options(const CliOptions& options);
+
+// "latency(nodelay=1 sndbuf=0 rcvbuf=0 quickack=1 busy_poll_us=50)" - для логов и CSV.
+std::string socket_tuning_to_string(const SocketTuning& tuning);
+
+std::vector<SocketOptionSetting> socket_option_settings(const SocketTuning& tuning);
+
+// Применяет профиль к сокету. Неудавшиеся опции (например, SO_BUSY_POLL без прав) только
+// логируются с префиксом log_prefix, чтобы прогон не срывался. Возвращает число примененных опций.
+int apply_socket_tuning(int fd, const SocketTuning& tuning, const std::string& log_prefix);
+
+// Открывает TCP-соединение с host:port и применяет профиль до connect(), чтобы размеры буферов
+// повлияли на окно. Возвращает дескриптор или -1 (ошибка уже выведена).
+int connect_tuned_tcp_socket(const std::string& host, int port, const SocketTuning& tuning,
+                             const std::string& log_prefix);
+
+// Слушающий сокет на host:port; принятые соединения наследуют SO_SNDBUF/SO_RCVBUF и TCP_NODELAY.
+int listen_tuned_tcp_socket(const std::string& host, int port, const SocketTuning& tuning,
+                            const std::string& log_prefix);
+
+} // namespace benchmark_common
@@ -0,0 +1,49 @@
+// common/include/sweep.hpp
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef> // Для size_t
+
+namespace benchmark_common {
+
+// Режим --sweep: один и тот же клиент прогоняется по ряду размеров чанка, чтобы увидеть,
+// где перестают окупаться накладные расходы на сообщение (syscall, фрейминг, аллокации).
+struct SweepPoint {
+    size_t chunk_size_bytes = 0;
+    double throughput_mbps = 0.0; // Полезная нагрузка в один конец
+    double avg_rtt_ms = 0.0;
+    double p99_rtt_ms = 0.0;
+    size_t errors = 0;
+};
+
+// Степени двойки от min_bytes до max_bytes включительно (min округляется вверх до степени двойки).
+std::vector<size_t> sweep_chunk_sizes(size_t min_bytes, size_t max_bytes);
+
+// "Колено" кривой: наименьший размер чанка, пропускная способность которого не ниже
+// (1 - tolerance) от максимальной по всему прогону. Дальше рост чанка дает меньше tolerance.
+// Точки с ошибками не учитываются. Возвращает индекс в points или points.size(), если точек нет.
+size_t find_throughput_knee(const std::vector<SweepPoint>& points, double tolerance);
+
+// Печатает таблицу кривой (размер, пропускная способность, прирост к предыдущей точке, RTT)
+// с пометкой колена.
+void print_sweep_report(const std::string& protocol_name, const std::vector<SweepPoint>& points,
+                        size_t knee_index);
+
+bool save_sweep_csv(const std::string& filename, const std::string& protocol_name,
+                    const std::vector<SweepPoint>& points, size_t knee_index);
+
+// Прогон по набору именованных конфигураций (профили сокета и т.п.) при фиксированном размере
+// чанка. Первая точка считается базовой, остальные сравниваются с ней.
+struct LabeledSweepPoint {
+    std::string label;
+    SweepPoint result;
+};
+
+void print_labeled_sweep_report(const std::string& title, const std::string& protocol_name,
+                                const std::vector<LabeledSweepPoint>& points);
+
+bool save_labeled_sweep_csv(const std::string& filename, const std::string& protocol_name,
+                            const std::vector<LabeledSweepPoint>& points);
+
+} // namespace benchmark_common
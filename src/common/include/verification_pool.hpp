@@ -0,0 +1,71 @@
+// common/include/verification_pool.hpp
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef> // Для size_t
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "inflight_budget.hpp"
+#include "mpmc_queue.hpp"
+
+namespace benchmark_common {
+
+// Проверка эхо-ответов вне потока чтения (--verify-threads=N): поток чтения только отмечает
+// RTT и кладет пару "оригинал + полученные байты" в очередь без блокировок, а N рабочих
+// потоков сверяют ответ с перевернутым оригиналом и копят итоги. Так проверка 64 KB чанка
+// не задерживает следующий Read() и не искажает RTT следующих ответов.
+// Буферы проверенных ответов возвращаются потоку чтения (take_spare_buffer), чтобы разбор
+// следующего ответа шел в готовую емкость, а не в новую строку.
+class VerificationPool {
+public:
+    struct Task {
+        uint64_t chunk_id = 0;
+        std::vector<char> original; // Отправленный чанк
+        std::string received;       // Ответ сервера: должен быть перевернутым original
+        uint64_t budget_bytes = 0;  // Возвращается в budget после проверки
+    };
+
+    // queue_capacity ограничивает память под непроверенные чанки: при полной очереди
+    // submit() ждет рабочих. budget (если задан) - бюджет данных в полете: чанк занимает его,
+    // пока его копия не проверена, поэтому место освобождает рабочий поток.
+    VerificationPool(size_t threads, size_t queue_capacity, const std::string& thread_name,
+                     InflightBudget* budget = nullptr);
+    ~VerificationPool();
+
+    VerificationPool(const VerificationPool&) = delete;
+    VerificationPool& operator=(const VerificationPool&) = delete;
+
+    void submit(Task&& task);
+    // Пустая строка с емкостью проверенного ответа, если такая есть (иначе buffer не меняется).
+    bool take_spare_buffer(std::string& buffer) { return spare_buffers_.try_pop(buffer); }
+    // Ждет, пока будут проверены все отданные задачи.
+    void drain();
+
+    uint64_t verified_bytes() const { return verified_bytes_.load(std::memory_order_acquire); }
+    uint64_t verified_chunks() const { return verified_chunks_.load(std::memory_order_acquire); }
+    // Сообщения о несовпадениях с последнего вызова (MetricsAggregator не потокобезопасен,
+    // поэтому ошибки переносит в него поток, который им владеет).
+    std::vector<std::string> take_errors();
+
+private:
+    void worker_loop(const std::string& thread_name);
+    void verify(Task& task);
+
+    InflightBudget* budget_;
+    BoundedMpmcQueue<Task> tasks_;
+    BoundedMpmcQueue<std::string> spare_buffers_;
+    std::vector<std::thread> workers_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> verified_bytes_{0};
+    std::atomic<uint64_t> verified_chunks_{0};
+    std::mutex errors_mutex_; // Только на пути ошибки
+    std::vector<std::string> errors_;
+};
+
+} // namespace benchmark_common
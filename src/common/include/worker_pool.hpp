@@ -0,0 +1,49 @@
+// common/include/worker_pool.hpp
+#pragma once
+
+#include <atomic>
+#include <cstddef> // Для size_t
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mpmc_queue.hpp"
+
+namespace benchmark_common {
+
+// Пул потоков для обработки чанков на сервере вне потока, который их принял
+// (--parallel-chunks): задачи идут через очередь без блокировок, простаивающие рабочие
+// засыпают так же, как у VerificationPool. Порядок выполнения задач не гарантируется -
+// порядок ответов, если он нужен, восстанавливает вызывающий.
+class WorkerPool {
+public:
+    using Task = std::function<void()>;
+
+    // queue_capacity ограничивает задачи, ждущие рабочего: при полной очереди submit() ждет,
+    // а try_submit() сразу возвращает false.
+    WorkerPool(size_t threads, size_t queue_capacity, const std::string& thread_name);
+    // Дожидается всех отданных задач.
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void submit(Task task);
+    // Для потоков, которым ждать нельзя (цикл событий Cap'n Proto): задачу забирает только при
+    // успехе, при полной очереди task остается у вызывающего.
+    bool try_submit(Task& task);
+    size_t threads() const { return workers_.size(); }
+
+private:
+    void worker_loop(const std::string& thread_name);
+
+    BoundedMpmcQueue<Task> tasks_;
+    std::vector<std::thread> workers_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> completed_{0};
+};
+
+} // namespace benchmark_common
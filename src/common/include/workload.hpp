@@ -0,0 +1,26 @@
+// common/include/workload.hpp
+#pragma once
+
+#include <string>
+#include <cstddef> // Для size_t
+#include <cstdint>
+
+namespace benchmark_common {
+
+// Режим нагрузки (--mode). echo - исходное поведение: чанк к серверу и перевернутый обратно,
+// пропускная способность смешивает оба направления и реверс. upload - чанк к серверу, обратно
+// только подтверждение с размером и контрольной суммой. download - сервер отдает свой файл
+// (--download-file) чанками, от клиента идут лишь короткие запросы.
+enum class WorkloadMode {
+    ECHO,
+    UPLOAD,
+    DOWNLOAD
+};
+
+WorkloadMode workload_mode_from_string(const std::string& name);
+std::string workload_mode_to_string(WorkloadMode mode);
+
+// CRC32 (zlib) полезной нагрузки: подтверждение в upload и проверка чанков в download.
+uint32_t chunk_checksum(const char* data, size_t size);
+
+} // namespace benchmark_common
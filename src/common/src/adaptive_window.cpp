@@ -0,0 +1,124 @@
+#include "../include/adaptive_window.hpp"
+#include "../include/config.hpp"
+#include "../include/cli_options.hpp"
+#include <algorithm> // For std::min, std::max, std::clamp
+#include <cmath>     // For std::floor
+#include <fstream>
+#include <iomanip>   // For std::fixed, std::setprecision
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace benchmark_common {
+
+AdaptiveWindowOptions adaptive_window_options_from_options(const CliOptions& options, size_t default_max) {
+    AdaptiveWindowOptions o;
+    o.max_window = options.get_size("window-max", default_max);
+    o.initial_window = options.get_size("window-initial", 1);
+    o.rtt_tolerance = options.get_int("window-rtt-tolerance-pct", ADAPTIVE_WINDOW_RTT_TOLERANCE_PCT) / 100.0;
+    if (o.max_window == 0 || o.initial_window == 0 || o.rtt_tolerance <= 0.0) {
+        throw std::invalid_argument("--window-max, --window-initial and --window-rtt-tolerance-pct must be positive");
+    }
+    return o;
+}
+
+AdaptiveWindow::AdaptiveWindow(const AdaptiveWindowOptions& options)
+    : options_(options),
+      window_(std::clamp(options.initial_window, options.min_window, std::max(options.min_window, options.max_window))),
+      started_at_(std::chrono::steady_clock::now()),
+      epoch_started_at_(started_at_) {
+    options_.max_window = std::max(options_.min_window, options_.max_window);
+    lowest_window_ = highest_window_ = window_.load();
+}
+
+bool AdaptiveWindow::on_completion(uint64_t payload_bytes, int64_t rtt_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    epoch_samples_++;
+    epoch_bytes_ += payload_bytes;
+    epoch_rtt_sum_us_ += static_cast<double>(std::max<int64_t>(rtt_us, 0));
+
+    const size_t window = window_.load(std::memory_order_relaxed);
+    if (epoch_samples_ < std::max<uint64_t>(window, options_.min_epoch_samples)) return false;
+
+    const auto now = std::chrono::steady_clock::now();
+    const double epoch_s = std::chrono::duration<double>(now - epoch_started_at_).count();
+    Sample sample;
+    sample.elapsed_s = std::chrono::duration<double>(now - started_at_).count();
+    sample.window_before = window;
+    sample.throughput_mbps = epoch_s > 0.0 ? static_cast<double>(epoch_bytes_) * 8.0 / 1e6 / epoch_s : 0.0;
+    sample.mean_rtt_us = epoch_rtt_sum_us_ / static_cast<double>(epoch_samples_);
+    if (base_rtt_us_ == 0.0 || sample.mean_rtt_us < base_rtt_us_) base_rtt_us_ = sample.mean_rtt_us;
+    sample.base_rtt_us = base_rtt_us_;
+
+    const bool queueing = sample.mean_rtt_us > base_rtt_us_ * (1.0 + options_.rtt_tolerance);
+    const bool gained = sample.throughput_mbps > last_throughput_mbps_ * (1.0 + options_.min_gain);
+    const size_t shrunk = std::max(options_.min_window,
+                                   static_cast<size_t>(std::floor(window * options_.decrease_factor)));
+    size_t next = window;
+    if (slow_start_) {
+        if (queueing && !gained) {
+            slow_start_ = false;
+            next = shrunk;
+        } else if (!gained) {
+            slow_start_ = false; // Плато без очереди: дальше по одному
+        } else {
+            next = std::min(options_.max_window, window * 2);
+        }
+    } else if (queueing && !gained) {
+        next = shrunk;
+    } else {
+        next = std::min(options_.max_window, window + 1);
+    }
+    sample.window_after = next;
+    sample.action = next > window ? "grow" : next < window ? "shrink" : "hold";
+    history_.push_back(sample);
+
+    last_throughput_mbps_ = sample.throughput_mbps;
+    epoch_started_at_ = now;
+    epoch_samples_ = 0;
+    epoch_bytes_ = 0;
+    epoch_rtt_sum_us_ = 0.0;
+    lowest_window_ = std::min(lowest_window_, next);
+    highest_window_ = std::max(highest_window_, next);
+    window_.store(next, std::memory_order_release);
+    return next != window;
+}
+
+std::vector<AdaptiveWindow::Sample> AdaptiveWindow::history() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return history_;
+}
+
+std::string AdaptiveWindow::describe() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t grows = 0, shrinks = 0;
+    for (const Sample& s : history_) {
+        if (s.window_after > s.window_before) grows++;
+        if (s.window_after < s.window_before) shrinks++;
+    }
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1)
+        << "window " << window_.load() << " (range " << lowest_window_ << ".." << highest_window_
+        << ", max " << options_.max_window << "), " << history_.size() << " epochs: " << grows << " grow, "
+        << shrinks << " shrink, " << history_.size() - grows - shrinks << " hold, base RTT " << base_rtt_us_ << " us";
+    return out.str();
+}
+
+bool AdaptiveWindow::save_csv(const std::string& filename) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << filename << " for writing." << std::endl;
+        return false;
+    }
+    file << "Elapsed_s,Window_Before,Window_After,Action,Throughput_Mbps,Mean_RTT_us,Base_RTT_us\n";
+    file << std::fixed << std::setprecision(3);
+    for (const Sample& s : history_) {
+        file << s.elapsed_s << "," << s.window_before << "," << s.window_after << "," << s.action << ","
+             << s.throughput_mbps << "," << s.mean_rtt_us << "," << s.base_rtt_us << "\n";
+    }
+    std::cout << "Adaptive window history saved to " << filename << std::endl;
+    return true;
+}
+
+} // namespace benchmark_common
@@ -0,0 +1,43 @@
+#include "../include/alloc_counter.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace benchmark_common {
+
+#ifdef BENCHMARK_COUNT_ALLOCS
+
+namespace {
+std::atomic<uint64_t> g_heap_allocations{0};
+} // namespace
+
+bool heap_allocations_counted() { return true; }
+uint64_t heap_allocations() { return g_heap_allocations.load(std::memory_order_relaxed); }
+
+void* counted_allocate(std::size_t size) {
+    g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) return pointer;
+    throw std::bad_alloc();
+}
+
+#else
+
+bool heap_allocations_counted() { return false; }
+uint64_t heap_allocations() { return 0; }
+
+#endif // BENCHMARK_COUNT_ALLOCS
+
+} // namespace benchmark_common
+
+#ifdef BENCHMARK_COUNT_ALLOCS
+
+// nothrow-формы в libstdc++ сводятся к этим; выровненные (align_val_t) бенчмарк не использует.
+// Выделения внутри gRPC core идут через malloc напрямую и здесь не учитываются.
+void* operator new(std::size_t size) { return benchmark_common::counted_allocate(size); }
+void* operator new[](std::size_t size) { return benchmark_common::counted_allocate(size); }
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+
+#endif // BENCHMARK_COUNT_ALLOCS
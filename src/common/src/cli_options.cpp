@@ -0,0 +1,71 @@
+#include "cli_options.hpp"
+#include <iostream>
+#include <stdexcept>
+
+namespace benchmark_common {
+
+CliOptions::CliOptions(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            std::cerr << "[WARNING] Ignoring unrecognized argument: " << arg << std::endl;
+            continue;
+        }
+        arg = arg.substr(2);
+        size_t eq_pos = arg.find('=');
+        if (eq_pos == std::string::npos) {
+            values_[arg] = "1";
+        } else {
+            values_[arg.substr(0, eq_pos)] = arg.substr(eq_pos + 1);
+        }
+    }
+}
+
+bool CliOptions::has(const std::string& key) const {
+    return values_.count(key) != 0;
+}
+
+std::string CliOptions::get_string(const std::string& key, const std::string& default_value) const {
+    auto it = values_.find(key);
+    return it != values_.end() ? it->second : default_value;
+}
+
+long long CliOptions::get_int(const std::string& key, long long default_value) const {
+    auto it = values_.find(key);
+    if (it == values_.end()) return default_value;
+    try {
+        return std::stoll(it->second);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("Invalid integer value for --" + key + ": " + it->second);
+    }
+}
+
+size_t CliOptions::get_size(const std::string& key, size_t default_value) const {
+    auto it = values_.find(key);
+    if (it == values_.end()) return default_value;
+    try {
+        return parse_size(it->second);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("Invalid size value for --" + key + ": " + it->second);
+    }
+}
+
+bool CliOptions::get_bool(const std::string& key, bool default_value) const {
+    auto it = values_.find(key);
+    if (it == values_.end()) return default_value;
+    const std::string& v = it->second;
+    return v == "1" || v == "true" || v == "yes" || v == "on";
+}
+
+size_t CliOptions::parse_size(const std::string& text) {
+    size_t consumed = 0;
+    unsigned long long value = std::stoull(text, &consumed);
+    std::string suffix = text.substr(consumed);
+    if (suffix.empty() || suffix == "B") return value;
+    if (suffix == "K" || suffix == "KB") return value * 1024ULL;
+    if (suffix == "M" || suffix == "MB") return value * 1024ULL * 1024;
+    if (suffix == "G" || suffix == "GB") return value * 1024ULL * 1024 * 1024;
+    throw std::invalid_argument("Unknown size suffix: " + suffix);
+}
+
+} // namespace benchmark_common
@@ -0,0 +1,94 @@
+#include "compression.hpp"
+#include <cstring>
+#include <stdexcept>
+
+#include <zlib.h>
+#ifdef BENCHMARK_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace benchmark_common {
+
+Codec codec_from_string(const std::string& name) {
+    if (name == "none") return Codec::NONE;
+    if (name == "deflate" || name == "zlib") return Codec::DEFLATE;
+    if (name == "zstd") return Codec::ZSTD;
+    if (name == "packed") return Codec::PACKED;
+    throw std::invalid_argument("Unknown codec: " + name + " (expected none|packed|deflate|zstd)");
+}
+
+std::string codec_to_string(Codec codec) {
+    switch (codec) {
+        case Codec::NONE: return "none";
+        case Codec::DEFLATE: return "deflate";
+        case Codec::ZSTD: return "zstd";
+        case Codec::PACKED: return "packed";
+        default: return "unknown";
+    }
+}
+
+bool codec_available(Codec codec) {
+#ifdef BENCHMARK_WITH_ZSTD
+    return true;
+#else
+    return codec != Codec::ZSTD;
+#endif
+}
+
+bool compress_buffer(Codec codec, const char* data, size_t size, std::vector<char>& out, int level) {
+    switch (codec) {
+        case Codec::NONE:
+            out.assign(data, data + size);
+            return true;
+        case Codec::DEFLATE: {
+            uLongf bound = compressBound(static_cast<uLong>(size));
+            out.resize(bound);
+            int rc = compress2(reinterpret_cast<Bytef*>(out.data()), &bound,
+                               reinterpret_cast<const Bytef*>(data), static_cast<uLong>(size),
+                               level < 0 ? Z_BEST_SPEED : level);
+            if (rc != Z_OK) return false;
+            out.resize(bound);
+            return true;
+        }
+        case Codec::ZSTD: {
+#ifdef BENCHMARK_WITH_ZSTD
+            out.resize(ZSTD_compressBound(size));
+            size_t written = ZSTD_compress(out.data(), out.size(), data, size, level < 0 ? 1 : level);
+            if (ZSTD_isError(written)) return false;
+            out.resize(written);
+            return true;
+#else
+            return false;
+#endif
+        }
+        default:
+            return false;
+    }
+}
+
+bool decompress_buffer(Codec codec, const char* data, size_t size, char* out, size_t raw_size) {
+    switch (codec) {
+        case Codec::NONE:
+            if (size != raw_size) return false;
+            memcpy(out, data, size);
+            return true;
+        case Codec::DEFLATE: {
+            uLongf dest_len = static_cast<uLongf>(raw_size);
+            int rc = uncompress(reinterpret_cast<Bytef*>(out), &dest_len,
+                                reinterpret_cast<const Bytef*>(data), static_cast<uLong>(size));
+            return rc == Z_OK && dest_len == raw_size;
+        }
+        case Codec::ZSTD: {
+#ifdef BENCHMARK_WITH_ZSTD
+            size_t got = ZSTD_decompress(out, raw_size, data, size);
+            return !ZSTD_isError(got) && got == raw_size;
+#else
+            return false;
+#endif
+        }
+        default:
+            return false;
+    }
+}
+
+} // namespace benchmark_common
@@ -0,0 +1,189 @@
+#include "../include/event_tracer.hpp"
+#include <algorithm> // For std::min
+#include <fstream>
+#include <iomanip>   // For std::fixed, std::setprecision
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <unistd.h> // getpid
+
+namespace benchmark_common {
+
+namespace event_trace_detail {
+std::atomic<bool> g_enabled{false};
+} // namespace event_trace_detail
+
+namespace {
+
+// Кольцо одного потока. Пишет только владелец; written публикуется с release, поэтому после
+// остановки записи выгрузка видит все события до последнего опубликованного.
+struct ThreadRing {
+    std::vector<TraceEvent> events = std::vector<TraceEvent>(EVENT_TRACE_RING_EVENTS);
+    std::atomic<uint64_t> written{0};
+    std::string name;    // Под registry_mutex
+    uint32_t tid = 0;
+    bool owned = false;  // Под registry_mutex: поток жив; иначе кольцо ждет выгрузки или свободно
+};
+
+// Кольцо (около 2 МБ) создается только на первое событие при включенной трассировке. Кольцо
+// завершившегося потока хранит события до следующей выгрузки, затем переиспользуется новым
+// потоком, поэтому колец не больше, чем потоков, писавших события со времени выгрузки.
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<ThreadRing>> registry;
+std::vector<ThreadRing*> free_rings; // Под registry_mutex: пустые кольца без владельца
+std::string output_path;
+int64_t trace_start_ns = 0;
+
+// Состояние потока: имя живет здесь, чтобы set_event_trace_thread_name() не создавал кольцо.
+struct ThreadState {
+    std::string name;
+    ThreadRing* ring = nullptr;
+
+    ~ThreadState() {
+        if (!ring) return;
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        ring->owned = false;
+        // Пустое кольцо освобождается сразу, с событиями - после выгрузки
+        if (ring->written.load(std::memory_order_relaxed) == 0) free_rings.push_back(ring);
+    }
+};
+
+thread_local ThreadState t_state;
+
+ThreadRing& thread_ring() {
+    if (t_state.ring) return *t_state.ring;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    ThreadRing* ring;
+    if (!free_rings.empty()) {
+        ring = free_rings.back();
+        free_rings.pop_back();
+    } else {
+        registry.push_back(std::make_unique<ThreadRing>());
+        ring = registry.back().get();
+        ring->tid = static_cast<uint32_t>(registry.size());
+    }
+    ring->owned = true;
+    ring->name = t_state.name.empty() ? "thread-" + std::to_string(ring->tid) : t_state.name;
+    t_state.ring = ring;
+    return *ring;
+}
+
+void write_json_string(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out << '\\';
+        if (static_cast<unsigned char>(c) >= 0x20) out << c;
+    }
+    out << '"';
+}
+
+// Под registry_mutex: очищает кольца; кольца завершившихся потоков становятся свободными.
+void reset_rings_locked() {
+    for (auto& ring : registry) {
+        if (!ring->owned && ring->written.load(std::memory_order_relaxed) > 0) free_rings.push_back(ring.get());
+        ring->written.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Под registry_mutex: записывает кольца в output_path и очищает их.
+bool save_locked() {
+    std::ofstream file(output_path);
+    if (!file.is_open()) {
+        std::cerr << "[TRACE] Error: Could not open file " << output_path << " for writing." << std::endl;
+        return false;
+    }
+    const int pid = static_cast<int>(::getpid());
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    size_t total_events = 0;
+    uint64_t dropped_events = 0;
+    size_t threads = 0;
+    for (const auto& ring : registry) {
+        const uint64_t written = ring->written.load(std::memory_order_acquire);
+        if (!ring->owned && written == 0) continue; // Свободное кольцо
+        threads++;
+        file << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid
+             << ",\"tid\":" << ring->tid << ",\"args\":{\"name\":";
+        write_json_string(file, ring->name);
+        file << "}}";
+        first = false;
+
+        const uint64_t count = std::min<uint64_t>(written, EVENT_TRACE_RING_EVENTS);
+        dropped_events += written - count;
+        for (uint64_t i = written - count; i < written; ++i) {
+            const TraceEvent& event = ring->events[i % EVENT_TRACE_RING_EVENTS];
+            // Chrome trace ждет микросекунды; отсчет от start_event_trace()
+            file << ",\n{\"name\":";
+            write_json_string(file, event.name);
+            file << ",\"cat\":";
+            write_json_string(file, event.category);
+            file << ",\"pid\":" << pid << ",\"tid\":" << ring->tid
+                 << ",\"ts\":" << (event.start_ns - trace_start_ns) / 1000.0;
+            if (event.duration_ns < 0) {
+                file << ",\"ph\":\"i\",\"s\":\"t\"}";
+            } else {
+                file << ",\"ph\":\"X\",\"dur\":" << event.duration_ns / 1000.0 << "}";
+            }
+        }
+        total_events += count;
+    }
+    file << "\n]}\n";
+    std::cout << "[TRACE] Saved " << total_events << " events from " << threads << " threads to "
+              << output_path;
+    if (dropped_events > 0) {
+        std::cout << " (" << dropped_events << " oldest events overwritten in the per-thread rings)";
+    }
+    std::cout << std::endl;
+    reset_rings_locked();
+    trace_start_ns = event_trace_detail::now_ns();
+    return true;
+}
+
+} // namespace
+
+namespace event_trace_detail {
+
+void append(const TraceEvent& event) {
+    ThreadRing& ring = thread_ring();
+    const uint64_t index = ring.written.load(std::memory_order_relaxed);
+    ring.events[index % EVENT_TRACE_RING_EVENTS] = event;
+    ring.written.store(index + 1, std::memory_order_release);
+}
+
+} // namespace event_trace_detail
+
+void start_event_trace(const std::string& path) {
+    if (path.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        output_path = path;
+        reset_rings_locked();
+        trace_start_ns = event_trace_detail::now_ns();
+    }
+    event_trace_detail::g_enabled.store(true, std::memory_order_release);
+    std::cout << "[TRACE] Event tracing enabled, output: " << path << std::endl;
+}
+
+void set_event_trace_thread_name(const std::string& name) {
+    t_state.name = name;
+    if (!t_state.ring) return;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    t_state.ring->name = name;
+}
+
+bool stop_event_trace() {
+    if (!event_trace_detail::g_enabled.exchange(false)) return false;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    return save_locked();
+}
+
+bool save_event_trace() {
+    if (!event_tracing_enabled()) return false;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    return save_locked();
+}
+
+} // namespace benchmark_common
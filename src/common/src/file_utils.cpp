@@ -2,10 +2,71 @@
 #include <iostream>
 #include <vector>
 #include <random> // Для генерации случайных данных
+#include <algorithm>
+#include <cstdio>   // Для std::snprintf
+#include <cstring>
+#include <stdexcept>
 
 namespace benchmark_common {
 
-bool generate_test_file(const std::string& filename, size_t size_bytes) {
+ContentProfile content_profile_from_string(const std::string& name) {
+    if (name == "random") return ContentProfile::RANDOM;
+    if (name == "text") return ContentProfile::TEXT;
+    if (name == "zeros") return ContentProfile::ZEROS;
+    if (name == "mixed") return ContentProfile::MIXED;
+    throw std::invalid_argument("Unknown content profile: " + name + " (expected random|text|zeros|mixed)");
+}
+
+std::string content_profile_to_string(ContentProfile profile) {
+    switch (profile) {
+        case ContentProfile::RANDOM: return "random";
+        case ContentProfile::TEXT: return "text";
+        case ContentProfile::ZEROS: return "zeros";
+        case ContentProfile::MIXED: return "mixed";
+        default: return "unknown";
+    }
+}
+
+std::string test_file_name_for_profile(const std::string& base_name, ContentProfile profile) {
+    if (profile == ContentProfile::RANDOM) return base_name;
+    size_t dot_pos = base_name.rfind('.');
+    std::string suffix = "_" + content_profile_to_string(profile);
+    if (dot_pos == std::string::npos) return base_name + suffix;
+    return base_name.substr(0, dot_pos) + suffix + base_name.substr(dot_pos);
+}
+
+namespace {
+
+void fill_random(char* dst, size_t size, std::mt19937& rng) {
+    std::uniform_int_distribution<int> dist(0, 255);
+    for (size_t i = 0; i < size; ++i) {
+        dst[i] = static_cast<char>(dist(rng));
+    }
+}
+
+// Заполняет буфер строками, похожими на лог сервиса: повторяющаяся структура, варьирующиеся числа.
+void fill_text(char* dst, size_t size, std::mt19937& rng) {
+    static const char* const levels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN"};
+    static const char* const actions[] = {"processed request", "cache hit", "cache miss", "flushed batch"};
+    std::uniform_int_distribution<int> small(0, 63);
+    std::uniform_int_distribution<int> big(0, 999999);
+    size_t pos = 0;
+    char line[160];
+    while (pos < size) {
+        int len = std::snprintf(line, sizeof(line),
+                                "2024-05-%02d 12:%02d:%02d %s worker-%d %s id=%d status=OK latency_us=%d\n",
+                                1 + small(rng) % 28, small(rng) % 60, small(rng) % 60,
+                                levels[small(rng) % 5], small(rng), actions[small(rng) % 4],
+                                big(rng), big(rng) % 5000);
+        size_t to_copy = std::min(static_cast<size_t>(len), size - pos);
+        memcpy(dst + pos, line, to_copy);
+        pos += to_copy;
+    }
+}
+
+} // namespace
+
+bool generate_test_file(const std::string& filename, size_t size_bytes, ContentProfile profile) {
     std::ofstream outfile(filename, std::ios::binary | std::ios::trunc);
     if (!outfile) {
         std::cerr << "Error: Could not open file " << filename << " for writing." << std::endl;
@@ -13,17 +74,34 @@ bool generate_test_file(const std::string& filename, size_t size_bytes) {
     }
 
     std::cout << "Generating test file '" << filename << "' of size "
-              << (size_bytes / (1024.0 * 1024.0 * 1024.0)) << " GB..." << std::endl;
+              << (size_bytes / (1024.0 * 1024.0 * 1024.0)) << " GB (profile: "
+              << content_profile_to_string(profile) << ")..." << std::endl;
 
     const size_t buffer_size = 1 * 1024 * 1024; // 1 MB buffer
     std::vector<char> buffer(buffer_size);
 
     // Генератор случайных чисел
     std::mt19937 rng(std::random_device{}());
-    std::uniform_int_distribution<int> dist(0, 255);
 
-    for (size_t i = 0; i < buffer_size; ++i) {
-        buffer[i] = static_cast<char>(dist(rng));
+    switch (profile) {
+        case ContentProfile::RANDOM:
+            fill_random(buffer.data(), buffer_size, rng);
+            break;
+        case ContentProfile::TEXT:
+            fill_text(buffer.data(), buffer_size, rng);
+            break;
+        case ContentProfile::ZEROS:
+            std::fill(buffer.begin(), buffer.end(), 0);
+            break;
+        case ContentProfile::MIXED: {
+            const size_t block = 32 * 1024;
+            for (size_t off = 0; off < buffer_size; off += block) {
+                size_t len = std::min(block, buffer_size - off);
+                if ((off / block) % 2 == 0) fill_random(buffer.data() + off, len, rng);
+                else fill_text(buffer.data() + off, len, rng);
+            }
+            break;
+        }
     }
 
     size_t bytes_written = 0;
@@ -76,23 +154,39 @@ std::vector<char> ChunkReader::next_chunk() {
     }
 
     std::vector<char> buffer(chunk_size_);
-    file_stream_.read(buffer.data(), chunk_size_);
+    const size_t bytes_read_this_call = read_chunk(buffer.data());
+    buffer.resize(bytes_read_this_call); // Обрезаем до фактически прочитанного размера
+    return buffer;
+}
+
+size_t ChunkReader::next_chunk_into(std::string& buffer) {
+    if (eof_flag_ || !file_stream_.is_open()) {
+        buffer.clear();
+        return 0;
+    }
+
+    buffer.resize(chunk_size_); // В пределах емкости не выделяет память
+    const size_t bytes_read_this_call = read_chunk(&buffer[0]);
+    buffer.resize(bytes_read_this_call);
+    return bytes_read_this_call;
+}
+
+size_t ChunkReader::read_chunk(char* destination) {
+    file_stream_.read(destination, chunk_size_);
     std::streamsize bytes_read_this_call = file_stream_.gcount();
 
     if (bytes_read_this_call > 0) {
-        buffer.resize(bytes_read_this_call); // Обрезаем до фактически прочитанного размера
         total_bytes_read_ += bytes_read_this_call;
-        return buffer;
-    } else {
-        eof_flag_ = true;
-        if (file_stream_.eof()) {
-            // Достигнут конец файла
-        } else if (file_stream_.fail()) {
-            // Ошибка чтения, не EOF
-            std::cerr << "Error: File read failed for " << filename_ << std::endl;
-        }
-        return {};
+        return static_cast<size_t>(bytes_read_this_call);
+    }
+    eof_flag_ = true;
+    if (file_stream_.eof()) {
+        // Достигнут конец файла
+    } else if (file_stream_.fail()) {
+        // Ошибка чтения, не EOF
+        std::cerr << "Error: File read failed for " << filename_ << std::endl;
     }
+    return 0;
 }
 
 bool ChunkReader::eof() const {
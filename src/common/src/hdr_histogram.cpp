@@ -0,0 +1,174 @@
+#include "../include/hdr_histogram.hpp"
+#include <algorithm> // For std::min, std::max
+#include <cmath>     // For std::ceil, std::log2, std::pow
+#include <fstream>
+#include <iomanip>   // For std::fixed, std::setprecision
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+namespace benchmark_common {
+
+namespace {
+
+int floor_log2(uint64_t value) {
+    return 63 - __builtin_clzll(value);
+}
+
+} // namespace
+
+HdrHistogram::HdrHistogram(int64_t lowest_trackable, int64_t highest_trackable, int significant_digits)
+    : lowest_trackable_(lowest_trackable),
+      highest_trackable_(highest_trackable),
+      significant_digits_(significant_digits) {
+    if (lowest_trackable < 1 || highest_trackable < 2 * lowest_trackable ||
+        significant_digits < 1 || significant_digits > 5) {
+        throw std::invalid_argument("HdrHistogram: invalid range or precision");
+    }
+    // Сколько линейных ячеек нужно в каждом "ведре", чтобы шаг был не больше 10^-digits от значения
+    const double largest_single_unit = 2.0 * std::pow(10.0, significant_digits);
+    const int sub_bucket_count_magnitude = static_cast<int>(std::ceil(std::log2(largest_single_unit)));
+    sub_bucket_half_count_magnitude_ = std::max(sub_bucket_count_magnitude, 1) - 1;
+    unit_magnitude_ = floor_log2(static_cast<uint64_t>(lowest_trackable));
+    sub_bucket_count_ = int64_t{1} << (sub_bucket_half_count_magnitude_ + 1);
+    sub_bucket_half_count_ = sub_bucket_count_ / 2;
+    sub_bucket_mask_ = (sub_bucket_count_ - 1) << unit_magnitude_;
+
+    // Каждое следующее ведро покрывает вдвое больший диапазон с тем же числом ячеек
+    int64_t smallest_untrackable = sub_bucket_count_ << unit_magnitude_;
+    bucket_count_ = 1;
+    while (smallest_untrackable <= highest_trackable) {
+        if (smallest_untrackable > std::numeric_limits<int64_t>::max() / 2) {
+            ++bucket_count_;
+            break;
+        }
+        smallest_untrackable <<= 1;
+        ++bucket_count_;
+    }
+    counts_.assign(static_cast<size_t>((bucket_count_ + 1) * sub_bucket_half_count_), 0);
+}
+
+size_t HdrHistogram::counts_index_for(int64_t value) const {
+    const int bucket_index = floor_log2(static_cast<uint64_t>(value | sub_bucket_mask_)) -
+                             unit_magnitude_ - sub_bucket_half_count_magnitude_;
+    const int64_t sub_bucket_index = value >> (bucket_index + unit_magnitude_);
+    return static_cast<size_t>((static_cast<int64_t>(bucket_index + 1) << sub_bucket_half_count_magnitude_) +
+                               (sub_bucket_index - sub_bucket_half_count_));
+}
+
+int64_t HdrHistogram::value_from_index(size_t index) const {
+    int bucket_index = static_cast<int>(index >> sub_bucket_half_count_magnitude_) - 1;
+    int64_t sub_bucket_index = static_cast<int64_t>(index & (sub_bucket_half_count_ - 1)) + sub_bucket_half_count_;
+    if (bucket_index < 0) {
+        sub_bucket_index -= sub_bucket_half_count_;
+        bucket_index = 0;
+    }
+    return sub_bucket_index << (bucket_index + unit_magnitude_);
+}
+
+// Верхняя граница ячейки, в которую попадает value: так процентиль не занижается.
+int64_t HdrHistogram::highest_equivalent_value(int64_t value) const {
+    const int bucket_index = floor_log2(static_cast<uint64_t>(value | sub_bucket_mask_)) -
+                             unit_magnitude_ - sub_bucket_half_count_magnitude_;
+    const int64_t sub_bucket_index = value >> (bucket_index + unit_magnitude_);
+    const int adjusted_bucket = sub_bucket_index >= sub_bucket_count_ ? bucket_index + 1 : bucket_index;
+    const int64_t range = int64_t{1} << (unit_magnitude_ + adjusted_bucket);
+    const int64_t lowest_equivalent = sub_bucket_index << (bucket_index + unit_magnitude_);
+    return lowest_equivalent + range - 1;
+}
+
+void HdrHistogram::record(int64_t value) {
+    if (value < 0) value = 0;
+    if (value > highest_trackable_) {
+        value = highest_trackable_;
+        ++overflow_count_;
+    }
+    ++counts_[counts_index_for(value)];
+    if (total_count_ == 0 || value < min_value_) min_value_ = value;
+    if (value > max_value_) max_value_ = value;
+    ++total_count_;
+    sum_ += static_cast<double>(value);
+}
+
+void HdrHistogram::merge(const HdrHistogram& other) {
+    if (other.counts_.size() != counts_.size() || other.unit_magnitude_ != unit_magnitude_ ||
+        other.sub_bucket_half_count_magnitude_ != sub_bucket_half_count_magnitude_) {
+        throw std::invalid_argument("HdrHistogram::merge: histograms have different layouts");
+    }
+    if (other.total_count_ == 0) return;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    if (total_count_ == 0 || other.min_value_ < min_value_) min_value_ = other.min_value_;
+    max_value_ = std::max(max_value_, other.max_value_);
+    total_count_ += other.total_count_;
+    overflow_count_ += other.overflow_count_;
+    sum_ += other.sum_;
+}
+
+void HdrHistogram::reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    total_count_ = 0;
+    overflow_count_ = 0;
+    min_value_ = 0;
+    max_value_ = 0;
+    sum_ = 0.0;
+}
+
+double HdrHistogram::mean() const {
+    return total_count_ == 0 ? 0.0 : sum_ / static_cast<double>(total_count_);
+}
+
+int64_t HdrHistogram::value_at_percentile(double percentile) const {
+    if (total_count_ == 0) return 0;
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+    const uint64_t count_at_percentile = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(total_count_))));
+    uint64_t running = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        running += counts_[i];
+        if (running >= count_at_percentile) {
+            return std::min(highest_equivalent_value(value_from_index(i)), max_value_);
+        }
+    }
+    return max_value_;
+}
+
+std::vector<HdrHistogram::PercentileRow> HdrHistogram::percentile_distribution(int ticks_per_half_distance) const {
+    std::vector<PercentileRow> rows;
+    if (total_count_ == 0) return rows;
+    ticks_per_half_distance = std::max(ticks_per_half_distance, 1);
+    // Дальше последней записи процентили неразличимы: 1 - 1/N
+    const double last_meaningful = 100.0 * (1.0 - 1.0 / static_cast<double>(total_count_));
+    for (int tick = 0;; ++tick) {
+        const double percentile =
+            100.0 * (1.0 - std::pow(0.5, static_cast<double>(tick) / ticks_per_half_distance));
+        if (percentile > last_meaningful || tick > 64 * ticks_per_half_distance) break;
+        const uint64_t count = std::max<uint64_t>(
+            1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(total_count_))));
+        rows.push_back({value_at_percentile(percentile), percentile, count});
+    }
+    rows.push_back({max_value_, 100.0, total_count_});
+    return rows;
+}
+
+bool HdrHistogram::save_distribution_csv(const std::string& filename, double value_divisor,
+                                         int ticks_per_half_distance) const {
+    std::ofstream outfile(filename);
+    if (!outfile) {
+        std::cerr << "[ERROR] Failed to open histogram CSV file for writing: " << filename << std::endl;
+        return false;
+    }
+    outfile << "Value,Percentile,TotalCount,1/(1-Percentile)\n";
+    outfile << std::fixed << std::setprecision(6);
+    for (const auto& row : percentile_distribution(ticks_per_half_distance)) {
+        const double fraction = row.percentile / 100.0;
+        outfile << static_cast<double>(row.value) / value_divisor << "," << fraction << "," << row.total_count << ",";
+        if (fraction < 1.0) outfile << 1.0 / (1.0 - fraction);
+        outfile << "\n";
+    }
+    std::cout << "[INFO] Latency distribution saved to " << filename << std::endl;
+    return true;
+}
+
+} // namespace benchmark_common
@@ -0,0 +1,146 @@
+#include "../include/inflight_budget.hpp"
+#include "../include/config.hpp"
+#include "../include/cli_options.hpp"
+#include <algorithm> // For std::max
+#include <iomanip>   // For std::fixed, std::setprecision
+#include <sstream>
+#include <stdexcept>
+
+namespace benchmark_common {
+
+InflightBudget::InflightBudget(uint64_t max_bytes, uint64_t max_requests)
+    : max_bytes_(max_bytes), max_requests_(max_requests) {}
+
+void InflightBudget::set_limits(uint64_t max_bytes, uint64_t max_requests) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        max_bytes_ = max_bytes;
+        max_requests_ = max_requests;
+    }
+    space_freed_.notify_all();
+}
+
+uint64_t InflightBudget::max_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_bytes_;
+}
+
+uint64_t InflightBudget::max_requests() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_requests_;
+}
+
+bool InflightBudget::fits_locked(uint64_t bytes) const {
+    if (requests_ == 0) return true;
+    return bytes_ + bytes <= max_bytes_ && requests_ < max_requests_;
+}
+
+bool InflightBudget::acquire(uint64_t bytes, const std::atomic<bool>& abandon) {
+    return acquire_impl(bytes, &abandon);
+}
+
+void InflightBudget::acquire(uint64_t bytes) {
+    acquire_impl(bytes, nullptr);
+}
+
+bool InflightBudget::acquire_impl(uint64_t bytes, const std::atomic<bool>* abandon) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!fits_locked(bytes)) {
+        const auto wait_started_at = std::chrono::steady_clock::now();
+        space_freed_.wait(lock, [&] {
+            return fits_locked(bytes) || (abandon && abandon->load(std::memory_order_acquire));
+        });
+        stats_.blocked_waits++;
+        stats_.blocked_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now() - wait_started_at).count();
+        if (!fits_locked(bytes)) return false;
+    }
+    take_locked(bytes);
+    return true;
+}
+
+bool InflightBudget::try_acquire(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!fits_locked(bytes)) return false;
+    take_locked(bytes);
+    return true;
+}
+
+void InflightBudget::take_locked(uint64_t bytes) {
+    bytes_ += bytes;
+    requests_++;
+    stats_.acquired++;
+    stats_.peak_bytes = std::max(stats_.peak_bytes, bytes_);
+    stats_.peak_requests = std::max(stats_.peak_requests, requests_);
+}
+
+void InflightBudget::adjust(uint64_t reserved, uint64_t actual) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bytes_ -= std::min(reserved, bytes_);
+        bytes_ += actual;
+        stats_.peak_bytes = std::max(stats_.peak_bytes, bytes_);
+    }
+    if (actual < reserved) space_freed_.notify_all();
+}
+
+void InflightBudget::release(uint64_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bytes_ -= std::min(bytes, bytes_);
+        if (requests_ > 0) requests_--;
+    }
+    space_freed_.notify_all();
+}
+
+void InflightBudget::wake_waiters() {
+    // Пустая критическая секция: ожидающий либо еще не проверил условие, либо уже спит
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    space_freed_.notify_all();
+}
+
+bool InflightBudget::would_block(uint64_t bytes) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !fits_locked(bytes);
+}
+
+InflightBudget::Stats InflightBudget::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+InflightBudget::Stats InflightBudget::begin_run() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.peak_bytes = bytes_;
+    stats_.peak_requests = requests_;
+    return stats_;
+}
+
+std::string InflightBudget::describe(const Stats& before, const Stats& after, uint64_t max_bytes,
+                                     uint64_t max_requests) {
+    const uint64_t acquired = after.acquired - before.acquired;
+    const uint64_t waits = after.blocked_waits - before.blocked_waits;
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2)
+        << "budget " << max_bytes / (1024.0 * 1024.0) << " MB / " << max_requests << " requests, "
+        << "blocked " << (after.blocked_ns - before.blocked_ns) / 1e6 << " ms in " << waits << " of "
+        << acquired << " requests (" << (acquired ? 100.0 * waits / acquired : 0.0) << "%), "
+        << "peak " << after.peak_bytes / (1024.0 * 1024.0) << " MB / " << after.peak_requests << " requests";
+    return out.str();
+}
+
+InflightBudget& shared_inflight_budget() {
+    static InflightBudget budget(MAX_INFLIGHT_BYTES, MAX_INFLIGHT_REQUESTS);
+    return budget;
+}
+
+void configure_shared_inflight_budget(const CliOptions& options) {
+    const uint64_t max_bytes = options.get_size("inflight-bytes", MAX_INFLIGHT_BYTES);
+    const uint64_t max_requests = options.get_size("inflight-requests", MAX_INFLIGHT_REQUESTS);
+    if (max_bytes == 0 || max_requests == 0) {
+        throw std::invalid_argument("--inflight-bytes and --inflight-requests must be positive");
+    }
+    shared_inflight_budget().set_limits(max_bytes, max_requests);
+}
+
+} // namespace benchmark_common
@@ -0,0 +1,115 @@
+#include "../include/latency_trace.hpp"
+#include "../include/config.hpp"
+#include <algorithm> // For std::max
+#include <fstream>
+#include <iomanip>   // For std::fixed, std::setprecision
+#include <iostream>
+
+namespace benchmark_common {
+
+namespace {
+
+HdrHistogram make_trace_histogram() {
+    return HdrHistogram(1, SERVER_STATS_HISTOGRAM_MAX_NS, LATENCY_HISTOGRAM_DIGITS);
+}
+
+double ns_to_us(double ns) {
+    return ns / 1000.0;
+}
+
+} // namespace
+
+std::string trace_stage_to_string(TraceStage stage) {
+    switch (stage) {
+        case TraceStage::REQUEST_NETWORK: return "request_network";
+        case TraceStage::SERVER_PROCESS: return "server_process";
+        case TraceStage::SERVER_SEND: return "server_send";
+        case TraceStage::RESPONSE_NETWORK: return "response_network";
+        case TraceStage::TOTAL: return "total";
+        default: return "unknown";
+    }
+}
+
+TraceCollector::TraceCollector(std::string protocol_name)
+    : protocol_name_(std::move(protocol_name)),
+      stages_ns_{make_trace_histogram(), make_trace_histogram(), make_trace_histogram(),
+                 make_trace_histogram(), make_trace_histogram()} {}
+
+void TraceCollector::record(const TraceStamps& stamps, int64_t client_recv_ns) {
+    const std::array<int64_t, TRACE_STAGE_COUNT> stage_ns = {
+        stamps.server_recv_ns - stamps.client_send_ns,
+        stamps.server_process_done_ns - stamps.server_recv_ns,
+        stamps.server_send_ns - stamps.server_process_done_ns,
+        client_recv_ns - stamps.server_send_ns,
+        client_recv_ns - stamps.client_send_ns};
+    const bool complete = stamps.client_send_ns != 0 && stamps.server_recv_ns != 0 &&
+                          stamps.server_process_done_ns != 0 && stamps.server_send_ns != 0;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!complete || std::any_of(stage_ns.begin(), stage_ns.end(), [](int64_t ns) { return ns < 0; })) {
+        rejected_++;
+        return;
+    }
+    for (size_t i = 0; i < TRACE_STAGE_COUNT; ++i) {
+        stages_ns_[i].record(std::max<int64_t>(stage_ns[i], 1));
+    }
+    samples_++;
+}
+
+uint64_t TraceCollector::samples() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return samples_;
+}
+
+void TraceCollector::print_summary() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::cout << "\n--- Latency Trace Breakdown (" << protocol_name_ << ") ---" << std::endl;
+    std::cout << "Traced chunks: " << samples_ << ", rejected: " << rejected_ << std::endl;
+    if (samples_ == 0) {
+        std::cout << "No complete traces (is the server running a build with --trace support?)" << std::endl;
+        std::cout << "--------------------------------------" << std::endl;
+        return;
+    }
+    const double total_mean = stages_ns_[static_cast<size_t>(TraceStage::TOTAL)].mean();
+    std::cout << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < TRACE_STAGE_COUNT; ++i) {
+        const HdrHistogram& h = stages_ns_[i];
+        std::cout << std::left << std::setw(18) << trace_stage_to_string(static_cast<TraceStage>(i)) << std::right
+                  << " mean " << ns_to_us(h.mean()) << " us"
+                  << ", p50 " << ns_to_us(static_cast<double>(h.value_at_percentile(50.0))) << " us"
+                  << ", p99 " << ns_to_us(static_cast<double>(h.value_at_percentile(99.0))) << " us"
+                  << ", max " << ns_to_us(static_cast<double>(h.max())) << " us";
+        if (static_cast<TraceStage>(i) != TraceStage::TOTAL && total_mean > 0) {
+            std::cout << " (" << h.mean() * 100.0 / total_mean << "% of mean RTT)";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "--------------------------------------" << std::endl;
+}
+
+bool TraceCollector::save_csv(const std::string& filename) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << filename << " for writing." << std::endl;
+        return false;
+    }
+    file << "Protocol,Stage,Samples,Mean_us,P50_us,P90_us,P99_us,P99_9_us,Max_us,Rejected\n";
+    file << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < TRACE_STAGE_COUNT; ++i) {
+        const HdrHistogram& h = stages_ns_[i];
+        file << protocol_name_ << "," << trace_stage_to_string(static_cast<TraceStage>(i)) << ","
+             << h.total_count() << ","
+             << ns_to_us(h.mean()) << ","
+             << ns_to_us(static_cast<double>(h.value_at_percentile(50.0))) << ","
+             << ns_to_us(static_cast<double>(h.value_at_percentile(90.0))) << ","
+             << ns_to_us(static_cast<double>(h.value_at_percentile(99.0))) << ","
+             << ns_to_us(static_cast<double>(h.value_at_percentile(99.9))) << ","
+             << ns_to_us(static_cast<double>(h.max())) << ","
+             << rejected_ << "\n";
+    }
+    std::cout << "Latency trace breakdown saved to " << filename << std::endl;
+    return true;
+}
+
+} // namespace benchmark_common
@@ -97,11 +97,29 @@ double MetricsAggregator::get_std_dev_chunk_rtt_ms() const {
     return std::sqrt(sq_sum / (chunk_rtt_us_.size() -1) ) / 1000.0; // в мс
 }
 
+double MetricsAggregator::get_percentile_chunk_rtt_ms(double percentile) const {
+    if (chunk_rtt_us_.empty()) return 0.0;
+    std::vector<long long> sorted = chunk_rtt_us_;
+    size_t rank = static_cast<size_t>(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return static_cast<double>(sorted[rank]) / 1000.0;
+}
+
 size_t MetricsAggregator::get_num_chunks() const {
     return chunk_rtt_us_.size(); // Или по actual_payload_transferred_bytes_ / chunk_size_bytes_
 }
 
 
+void MetricsAggregator::set_run_parameter(const std::string& name, const std::string& value) {
+    for (auto& param : run_parameters_) {
+        if (param.first == name) {
+            param.second = value;
+            return;
+        }
+    }
+    run_parameters_.emplace_back(name, value);
+}
+
 void MetricsAggregator::print_summary_to_console() const {
     std::cout << "\n--- Benchmark Summary (" << protocol_name_ << ") ---" << std::endl;
     std::cout << std::fixed << std::setprecision(6);
@@ -120,6 +138,9 @@ void MetricsAggregator::print_summary_to_console() const {
         std::cout << "StdDevChunkRTT:              " << get_std_dev_chunk_rtt_ms() << " ms" << std::endl;
     }
     std::cout << "NumChunks:                   " << get_num_chunks() << std::endl;
+    for (const auto& param : run_parameters_) {
+        std::cout << "Param " << param.first << ": " << param.second << std::endl;
+    }
     if (!errors_.empty()) {
         std::cout << "Errors (" << errors_.size() << "):" << std::endl;
         for (const auto& err : errors_) {
@@ -155,6 +176,9 @@ bool MetricsAggregator::save_summary_csv(const std::string& filename) const {
     }
     outfile << "NumChunks," << get_num_chunks() << ",\n";
     outfile << "ErrorsEncountered," << errors_.size() << ",\n";
+    for (const auto& param : run_parameters_) {
+        outfile << "Param_" << param.first << ",\"" << param.second << "\",\n";
+    }
 
     outfile.close();
     std::cout << "[INFO] Summary metrics saved to " << filename << std::endl;
@@ -0,0 +1,145 @@
+#include "../include/progress_reporter.hpp"
+#include <algorithm> // For std::max
+#include <iomanip>   // For std::fixed, std::setprecision
+#include <iostream>
+#include <sstream>
+
+namespace benchmark_common {
+
+ProgressReporter::ProgressReporter(std::string label)
+    : label_(std::move(label)) {}
+
+ProgressReporter::~ProgressReporter() {
+    stop();
+}
+
+int64_t ProgressReporter::bucket_upper_us(size_t index) {
+    if (index < SUB_BUCKETS) return static_cast<int64_t>(index);
+    const int exponent = static_cast<int>(index / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+    const int64_t sub_bucket = static_cast<int64_t>(index % SUB_BUCKETS);
+    const int64_t step = int64_t{1} << (exponent - SUB_BUCKET_BITS);
+    return (static_cast<int64_t>(SUB_BUCKETS) + sub_bucket) * step + step - 1;
+}
+
+void ProgressReporter::start(int interval_ms, int window_intervals, const std::string& csv_filename) {
+    if (interval_ms <= 0 || thread_.joinable()) return;
+    interval_ms_ = interval_ms;
+    csv_filename_ = csv_filename;
+    window_.assign(static_cast<size_t>(std::max(window_intervals, 1)) + 1, LatencySnapshot{});
+    window_at_.assign(window_.size(), std::chrono::steady_clock::time_point{});
+    samples_taken_ = 0;
+    started_at_ = last_sample_at_ = window_at_[0] = std::chrono::steady_clock::now();
+    last_completed_ = completed_.load(std::memory_order_relaxed);
+    last_bytes_ = bytes_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+        window_[0][i] = latency_counts_[i].load(std::memory_order_relaxed);
+    }
+
+    if (!csv_filename_.empty()) {
+        csv_.open(csv_filename_);
+        if (csv_.is_open()) {
+            csv_ << "Elapsed_s,Completed,Throughput_Mbps,Completed_per_s,In_Flight,"
+                    "Window_s,Window_Samples,Window_P50_ms,Window_P99_ms\n";
+        } else {
+            std::cerr << "Error: Could not open file " << csv_filename_ << " for writing." << std::endl;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = false;
+    }
+    thread_ = std::thread(&ProgressReporter::sample_loop, this);
+}
+
+void ProgressReporter::stop() {
+    if (!thread_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    stop_cv_.notify_all();
+    thread_.join();
+    take_sample(std::chrono::steady_clock::now()); // Хвост прогона короче интервала
+    if (csv_.is_open()) {
+        csv_.close();
+        std::cout << "Progress time series saved to " << csv_filename_ << std::endl;
+    }
+}
+
+void ProgressReporter::sample_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto next_sample_at = started_at_ + std::chrono::milliseconds(interval_ms_);
+    while (!stop_cv_.wait_until(lock, next_sample_at, [this] { return stopping_; })) {
+        lock.unlock();
+        take_sample(std::chrono::steady_clock::now());
+        lock.lock();
+        next_sample_at += std::chrono::milliseconds(interval_ms_);
+    }
+}
+
+void ProgressReporter::take_sample(std::chrono::steady_clock::time_point now) {
+    const double interval_s = std::chrono::duration<double>(now - last_sample_at_).count();
+    if (interval_s <= 0.0) return;
+    // Завершенные читаются раньше отправленных: иначе "в полете" могло бы уйти в минус
+    const uint64_t completed = completed_.load(std::memory_order_relaxed);
+    const uint64_t bytes = bytes_.load(std::memory_order_relaxed);
+    const uint64_t sent = sent_.load(std::memory_order_relaxed);
+    const uint64_t in_flight = sent > completed ? sent - completed : 0;
+    if (completed == last_completed_ && in_flight == 0) {
+        // Простой (сервер между прогонами) - не засоряем вывод; остановка с запросами в полете
+        // при нуле завершенных за интервал, наоборот, попадает в ряд
+        last_sample_at_ = now;
+        return;
+    }
+
+    samples_taken_++;
+    LatencySnapshot& current = window_[samples_taken_ % window_.size()];
+    for (size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+        current[i] = latency_counts_[i].load(std::memory_order_relaxed);
+    }
+    window_at_[samples_taken_ % window_.size()] = now;
+    // Самый старый снимок окна; в начале прогона окно короче
+    const size_t window_samples = std::min(samples_taken_, window_.size() - 1);
+    const size_t oldest_index = (samples_taken_ - window_samples) % window_.size();
+    const LatencySnapshot& oldest = window_[oldest_index];
+    uint64_t window_count = 0;
+    for (size_t i = 0; i < LATENCY_BUCKETS; ++i) window_count += current[i] - oldest[i];
+    auto window_percentile_ms = [&](double percentile) {
+        if (window_count == 0) return 0.0;
+        const uint64_t rank = std::max<uint64_t>(
+            1, static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(window_count) + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+            seen += current[i] - oldest[i];
+            if (seen >= rank) return static_cast<double>(bucket_upper_us(i)) / 1000.0;
+        }
+        return static_cast<double>(bucket_upper_us(LATENCY_BUCKETS - 1)) / 1000.0;
+    };
+
+    const double elapsed_s = std::chrono::duration<double>(now - started_at_).count();
+    const double throughput_mbps = static_cast<double>(bytes - last_bytes_) * 8.0 / (1024.0 * 1024.0) / interval_s;
+    const double completed_per_s = static_cast<double>(completed - last_completed_) / interval_s;
+    const double window_s = std::chrono::duration<double>(now - window_at_[oldest_index]).count();
+    const double p50_ms = window_percentile_ms(50.0);
+    const double p99_ms = window_percentile_ms(99.0);
+    last_sample_at_ = now;
+    last_completed_ = completed;
+    last_bytes_ = bytes;
+
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2)
+         << "[PROGRESS] " << label_ << " " << elapsed_s << " s: " << throughput_mbps << " Mbps, "
+         << completed_per_s << " req/s, in flight " << in_flight
+         << ", p99 " << std::setprecision(3) << p99_ms << " ms (last " << std::setprecision(1) << window_s
+         << " s, " << window_count << " req), completed " << completed << "\n";
+    std::cout << line.str() << std::flush;
+
+    if (csv_.is_open()) {
+        // Строка пишется сразу: у серверов прогон не заканчивается, файл растет до их остановки
+        csv_ << std::fixed << std::setprecision(3) << elapsed_s << "," << completed << "," << throughput_mbps << ","
+             << completed_per_s << "," << in_flight << "," << window_s << "," << window_count << ","
+             << p50_ms << "," << p99_ms << "\n" << std::flush;
+    }
+}
+
+} // namespace benchmark_common
@@ -0,0 +1,179 @@
+#include "../include/server_stats.hpp"
+#include "../include/config.hpp"
+#include "../include/event_tracer.hpp"
+#include <algorithm> // For std::max
+#include <fstream>
+#include <iomanip>   // For std::fixed, std::setprecision
+#include <iostream>
+#include <sstream>
+
+namespace benchmark_common {
+
+namespace {
+
+HdrHistogram make_stage_histogram() {
+    return HdrHistogram(1, SERVER_STATS_HISTOGRAM_MAX_NS, LATENCY_HISTOGRAM_DIGITS);
+}
+
+double ns_to_us(double ns) {
+    return ns / 1000.0;
+}
+
+} // namespace
+
+std::string server_stage_to_string(ServerStage stage) {
+    switch (stage) {
+        case ServerStage::QUEUE_WAIT: return "queue_wait";
+        case ServerStage::DESERIALIZE: return "deserialize";
+        case ServerStage::REVERSE: return "reverse";
+        case ServerStage::SERIALIZE: return "serialize";
+        case ServerStage::WRITE: return "write";
+        default: return "unknown";
+    }
+}
+
+ServerStats::ServerStats(std::string protocol_name, std::string csv_filename)
+    : protocol_name_(std::move(protocol_name)),
+      csv_filename_(std::move(csv_filename)),
+      stages_ns_{make_stage_histogram(), make_stage_histogram(), make_stage_histogram(),
+                 make_stage_histogram(), make_stage_histogram()},
+      service_ns_(make_stage_histogram()),
+      since_(std::chrono::steady_clock::now()) {}
+
+ServerStats::~ServerStats() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    stop_cv_.notify_all();
+    if (dump_thread_.joinable()) dump_thread_.join();
+}
+
+void ServerStats::record(const RequestTiming& timing) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t service_ns = 0;
+    bool measured = false;
+    for (size_t i = 0; i < SERVER_STAGE_COUNT; ++i) {
+        int64_t ns = timing.stage_ns(static_cast<ServerStage>(i));
+        if (ns < 0) continue;
+        stages_ns_[i].record(std::max<int64_t>(ns, 1));
+        service_ns += ns;
+        measured = true;
+    }
+    if (measured) service_ns_.record(std::max<int64_t>(service_ns, 1));
+    requests_++;
+}
+
+void ServerStats::record_stage(ServerStage stage, int64_t ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stages_ns_[static_cast<size_t>(stage)].record(std::max<int64_t>(ns, 1));
+}
+
+void ServerStats::session_opened() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_sessions_++;
+    sessions_total_++;
+}
+
+void ServerStats::session_closed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--active_sessions_ > 0 || requests_ == 0) return;
+    // Последний клиент ушел: итог прогона, затем чистый лист для следующего
+    std::cout << report_locked();
+    if (save_csv_locked(csv_filename_)) {
+        std::cout << "[STATS] Server stats saved to " << csv_filename_ << std::endl;
+    }
+    save_event_trace(); // --event-trace: потоки сервера как раз простаивают
+    reset_locked();
+}
+
+void ServerStats::reset_locked() {
+    for (auto& histogram : stages_ns_) histogram.reset();
+    service_ns_.reset();
+    requests_ = 0;
+    requests_at_last_dump_ = 0;
+    sessions_total_ = static_cast<uint64_t>(active_sessions_.load());
+    bytes_in_ = 0;
+    bytes_out_ = 0;
+    since_ = std::chrono::steady_clock::now();
+}
+
+std::string ServerStats::report() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return report_locked();
+}
+
+std::string ServerStats::report_locked() const {
+    const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - since_).count();
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    out << "[STATS] " << protocol_name_ << " server: " << requests_ << " requests in " << elapsed_s << " s, "
+        << "bytes in " << bytes_in_.load() << ", bytes out " << bytes_out_.load()
+        << ", sessions active " << active_sessions_.load() << " (total " << sessions_total_ << ")\n";
+    auto print_row = [&out](const std::string& name, const HdrHistogram& h) {
+        out << "[STATS]   " << std::left << std::setw(12) << name << std::right;
+        if (h.total_count() == 0) {
+            out << " n/a\n";
+            return;
+        }
+        out << " mean " << ns_to_us(h.mean()) << " us"
+            << ", p50 " << ns_to_us(static_cast<double>(h.value_at_percentile(50.0))) << " us"
+            << ", p99 " << ns_to_us(static_cast<double>(h.value_at_percentile(99.0))) << " us"
+            << ", max " << ns_to_us(static_cast<double>(h.max())) << " us"
+            << " (" << h.total_count() << " samples)\n";
+    };
+    for (size_t i = 0; i < SERVER_STAGE_COUNT; ++i) {
+        print_row(server_stage_to_string(static_cast<ServerStage>(i)), stages_ns_[i]);
+    }
+    print_row("service", service_ns_);
+    return out.str();
+}
+
+bool ServerStats::save_csv(const std::string& filename) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return save_csv_locked(filename);
+}
+
+bool ServerStats::save_csv_locked(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "[STATS] Error: Could not open file " << filename << " for writing." << std::endl;
+        return false;
+    }
+    // Счетчики повторяются в каждой строке, чтобы файл читался как одна таблица
+    file << "Protocol,Stage,Samples,Mean_us,P50_us,P90_us,P99_us,P99_9_us,Max_us,"
+         << "Requests,BytesIn,BytesOut,Sessions\n";
+    file << std::fixed << std::setprecision(3);
+    auto write_row = [&](const std::string& name, const HdrHistogram& h) {
+        file << protocol_name_ << "," << name << "," << h.total_count() << ","
+             << ns_to_us(h.mean()) << ","
+             << ns_to_us(static_cast<double>(h.value_at_percentile(50.0))) << ","
+             << ns_to_us(static_cast<double>(h.value_at_percentile(90.0))) << ","
+             << ns_to_us(static_cast<double>(h.value_at_percentile(99.0))) << ","
+             << ns_to_us(static_cast<double>(h.value_at_percentile(99.9))) << ","
+             << ns_to_us(static_cast<double>(h.max())) << ","
+             << requests_ << "," << bytes_in_.load() << "," << bytes_out_.load() << ","
+             << sessions_total_ << "\n";
+    };
+    for (size_t i = 0; i < SERVER_STAGE_COUNT; ++i) {
+        write_row(server_stage_to_string(static_cast<ServerStage>(i)), stages_ns_[i]);
+    }
+    write_row("service", service_ns_);
+    return true;
+}
+
+void ServerStats::start_periodic_dump(int interval_seconds) {
+    if (interval_seconds <= 0 || dump_thread_.joinable()) return;
+    dump_thread_ = std::thread(&ServerStats::dump_loop, this, interval_seconds);
+}
+
+void ServerStats::dump_loop(int interval_seconds) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_cv_.wait_for(lock, std::chrono::seconds(interval_seconds), [this] { return stopping_; })) {
+        if (requests_ == requests_at_last_dump_) continue; // Простой - не засоряем вывод
+        requests_at_last_dump_ = requests_;
+        std::cout << report_locked() << std::flush;
+    }
+}
+
+} // namespace benchmark_common
@@ -0,0 +1,159 @@
+#include "../include/socket_tuning.hpp"
+#include "../include/cli_options.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace benchmark_common {
+
+bool SocketTuning::is_default() const {
+    return !no_delay && send_buffer_bytes == 0 && receive_buffer_bytes == 0 && !quick_ack && busy_poll_us == 0;
+}
+
+SocketTuning socket_tuning_preset(const std::string& name) {
+    const int large_buffer = 4 * 1024 * 1024;
+    SocketTuning t;
+    t.name = name;
+    if (name == "default") return t;
+    if (name == "nodelay") {
+        t.no_delay = true;
+    } else if (name == "quickack") {
+        t.quick_ack = true;
+    } else if (name == "buffers") {
+        t.send_buffer_bytes = large_buffer;
+        t.receive_buffer_bytes = large_buffer;
+    } else if (name == "busypoll") {
+        t.busy_poll_us = 50;
+    } else if (name == "latency") {
+        t.no_delay = true;
+        t.quick_ack = true;
+        t.busy_poll_us = 50;
+    } else if (name == "throughput") {
+        t.no_delay = true;
+        t.send_buffer_bytes = large_buffer;
+        t.receive_buffer_bytes = large_buffer;
+    } else {
+        throw std::invalid_argument("Unknown socket profile: " + name +
+                                    " (expected default|nodelay|quickack|buffers|busypoll|latency|throughput)");
+    }
+    return t;
+}
+
+std::vector<std::string> socket_tuning_sweep_presets() {
+    return {"default", "nodelay", "quickack", "buffers", "busypoll", "latency", "throughput"};
+}
+
+SocketTuning socket_tuning_from_options(const CliOptions& options) {
+    SocketTuning t = socket_tuning_preset(options.get_string("socket-profile", "default"));
+    bool overridden = false;
+    if (options.has("nodelay")) { t.no_delay = options.get_bool("nodelay", false); overridden = true; }
+    if (options.has("quickack")) { t.quick_ack = options.get_bool("quickack", false); overridden = true; }
+    if (options.has("sndbuf")) { t.send_buffer_bytes = static_cast<int>(options.get_size("sndbuf", 0)); overridden = true; }
+    if (options.has("rcvbuf")) { t.receive_buffer_bytes = static_cast<int>(options.get_size("rcvbuf", 0)); overridden = true; }
+    if (options.has("busy-poll")) { t.busy_poll_us = static_cast<int>(options.get_int("busy-poll", 0)); overridden = true; }
+    if (overridden) t.name = "custom";
+    return t;
+}
+
+std::string socket_tuning_to_string(const SocketTuning& t) {
+    std::ostringstream out;
+    out << t.name << "(nodelay=" << t.no_delay << " sndbuf=" << t.send_buffer_bytes
+        << " rcvbuf=" << t.receive_buffer_bytes << " quickack=" << t.quick_ack
+        << " busy_poll_us=" << t.busy_poll_us << ")";
+    return out.str();
+}
+
+std::vector<SocketOptionSetting> socket_option_settings(const SocketTuning& t) {
+    std::vector<SocketOptionSetting> settings;
+    if (t.no_delay) settings.push_back({IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY"});
+    if (t.send_buffer_bytes > 0) settings.push_back({SOL_SOCKET, SO_SNDBUF, t.send_buffer_bytes, "SO_SNDBUF"});
+    if (t.receive_buffer_bytes > 0) settings.push_back({SOL_SOCKET, SO_RCVBUF, t.receive_buffer_bytes, "SO_RCVBUF"});
+#ifdef TCP_QUICKACK
+    if (t.quick_ack) settings.push_back({IPPROTO_TCP, TCP_QUICKACK, 1, "TCP_QUICKACK"});
+#endif
+#ifdef SO_BUSY_POLL
+    if (t.busy_poll_us > 0) settings.push_back({SOL_SOCKET, SO_BUSY_POLL, t.busy_poll_us, "SO_BUSY_POLL"});
+#endif
+    return settings;
+}
+
+int apply_socket_tuning(int fd, const SocketTuning& tuning, const std::string& log_prefix) {
+    int applied = 0;
+    for (const auto& s : socket_option_settings(tuning)) {
+        if (::setsockopt(fd, s.level, s.name, &s.value, sizeof(s.value)) == 0) {
+            ++applied;
+        } else {
+            std::cerr << log_prefix << " setsockopt(" << s.label << "=" << s.value
+                      << ") failed: " << std::strerror(errno) << std::endl;
+        }
+    }
+    return applied;
+}
+
+namespace {
+
+bool fill_ipv4_address(const std::string& host, int port, sockaddr_in& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    return ::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) == 1;
+}
+
+} // namespace
+
+int connect_tuned_tcp_socket(const std::string& host, int port, const SocketTuning& tuning,
+                             const std::string& log_prefix) {
+    sockaddr_in addr;
+    if (!fill_ipv4_address(host, port, addr)) {
+        std::cerr << log_prefix << " Invalid IPv4 address: " << host << std::endl;
+        return -1;
+    }
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << log_prefix << " socket() failed: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    apply_socket_tuning(fd, tuning, log_prefix);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::cerr << log_prefix << " connect(" << host << ":" << port << ") failed: "
+                  << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int listen_tuned_tcp_socket(const std::string& host, int port, const SocketTuning& tuning,
+                            const std::string& log_prefix) {
+    sockaddr_in addr;
+    if (!fill_ipv4_address(host, port, addr)) {
+        std::cerr << log_prefix << " Invalid IPv4 address: " << host << std::endl;
+        return -1;
+    }
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << log_prefix << " socket() failed: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    int reuse = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    apply_socket_tuning(fd, tuning, log_prefix);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        std::cerr << log_prefix << " bind/listen on " << host << ":" << port << " failed: "
+                  << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace benchmark_common
@@ -0,0 +1,133 @@
+#include "../include/sweep.hpp"
+#include <fstream>
+#include <iostream>
+#include <iomanip> // For std::fixed, std::setprecision, std::setw
+
+namespace benchmark_common {
+
+namespace {
+
+std::string format_size(size_t bytes) {
+    if (bytes >= 1024 * 1024 && bytes % (1024 * 1024) == 0) return std::to_string(bytes / (1024 * 1024)) + "M";
+    if (bytes >= 1024 && bytes % 1024 == 0) return std::to_string(bytes / 1024) + "K";
+    return std::to_string(bytes);
+}
+
+double gain_vs_previous_percent(const std::vector<SweepPoint>& points, size_t i) {
+    if (i == 0 || points[i - 1].throughput_mbps <= 0.0) return 0.0;
+    return (points[i].throughput_mbps / points[i - 1].throughput_mbps - 1.0) * 100.0;
+}
+
+double gain_vs_baseline_percent(const std::vector<LabeledSweepPoint>& points, size_t i) {
+    if (i == 0 || points[0].result.throughput_mbps <= 0.0) return 0.0;
+    return (points[i].result.throughput_mbps / points[0].result.throughput_mbps - 1.0) * 100.0;
+}
+
+} // namespace
+
+std::vector<size_t> sweep_chunk_sizes(size_t min_bytes, size_t max_bytes) {
+    std::vector<size_t> sizes;
+    size_t size = 1;
+    while (size < min_bytes) size <<= 1;
+    for (; size <= max_bytes; size <<= 1) {
+        sizes.push_back(size);
+    }
+    return sizes;
+}
+
+size_t find_throughput_knee(const std::vector<SweepPoint>& points, double tolerance) {
+    double best = 0.0;
+    for (const auto& p : points) {
+        if (p.errors == 0 && p.throughput_mbps > best) best = p.throughput_mbps;
+    }
+    if (best <= 0.0) return points.size();
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (points[i].errors == 0 && points[i].throughput_mbps >= best * (1.0 - tolerance)) return i;
+    }
+    return points.size();
+}
+
+void print_sweep_report(const std::string& protocol_name, const std::vector<SweepPoint>& points,
+                        size_t knee_index) {
+    std::cout << "\n--- Chunk Size Sweep (" << protocol_name << ") ---" << std::endl;
+    std::cout << std::setw(10) << "Chunk" << std::setw(16) << "Payload_Mbps" << std::setw(12) << "Gain_%"
+              << std::setw(14) << "AvgRTT_ms" << std::setw(14) << "P99RTT_ms" << std::setw(8) << "Errors" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < points.size(); ++i) {
+        const auto& p = points[i];
+        std::cout << std::setw(10) << format_size(p.chunk_size_bytes)
+                  << std::setw(16) << p.throughput_mbps
+                  << std::setw(12) << gain_vs_previous_percent(points, i)
+                  << std::setw(14) << p.avg_rtt_ms
+                  << std::setw(14) << p.p99_rtt_ms
+                  << std::setw(8) << p.errors
+                  << (i == knee_index ? "   <-- knee" : "") << std::endl;
+    }
+    if (knee_index < points.size()) {
+        std::cout << "Throughput stops improving at chunk size " << format_size(points[knee_index].chunk_size_bytes)
+                  << " (" << points[knee_index].throughput_mbps << " Mbps)." << std::endl;
+    } else {
+        std::cout << "No knee found: no successful sweep points." << std::endl;
+    }
+    std::cout << "-----------------------------------\n" << std::endl;
+}
+
+bool save_sweep_csv(const std::string& filename, const std::string& protocol_name,
+                    const std::vector<SweepPoint>& points, size_t knee_index) {
+    std::ofstream outfile(filename);
+    if (!outfile) {
+        std::cerr << "[ERROR] Failed to open sweep CSV file for writing: " << filename << std::endl;
+        return false;
+    }
+    outfile << "Protocol,ChunkSizeBytes,ThroughputPayload_Mbps,GainVsPrevious_%,AvgChunkRTT_ms,P99ChunkRTT_ms,Errors,IsKnee\n";
+    outfile << std::fixed << std::setprecision(6);
+    for (size_t i = 0; i < points.size(); ++i) {
+        const auto& p = points[i];
+        outfile << protocol_name << "," << p.chunk_size_bytes << "," << p.throughput_mbps << ","
+                << gain_vs_previous_percent(points, i) << "," << p.avg_rtt_ms << "," << p.p99_rtt_ms << ","
+                << p.errors << "," << (i == knee_index ? 1 : 0) << "\n";
+    }
+    outfile.close();
+    std::cout << "[INFO] Sweep results saved to " << filename << std::endl;
+    return true;
+}
+
+void print_labeled_sweep_report(const std::string& title, const std::string& protocol_name,
+                                const std::vector<LabeledSweepPoint>& points) {
+    std::cout << "\n--- " << title << " (" << protocol_name << ") ---" << std::endl;
+    std::cout << std::setw(14) << "Config" << std::setw(16) << "Payload_Mbps" << std::setw(14) << "VsBase_%"
+              << std::setw(14) << "AvgRTT_ms" << std::setw(14) << "P99RTT_ms" << std::setw(8) << "Errors" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < points.size(); ++i) {
+        const auto& p = points[i].result;
+        std::cout << std::setw(14) << points[i].label
+                  << std::setw(16) << p.throughput_mbps
+                  << std::setw(14) << gain_vs_baseline_percent(points, i)
+                  << std::setw(14) << p.avg_rtt_ms
+                  << std::setw(14) << p.p99_rtt_ms
+                  << std::setw(8) << p.errors << std::endl;
+    }
+    std::cout << "-----------------------------------\n" << std::endl;
+}
+
+bool save_labeled_sweep_csv(const std::string& filename, const std::string& protocol_name,
+                            const std::vector<LabeledSweepPoint>& points) {
+    std::ofstream outfile(filename);
+    if (!outfile) {
+        std::cerr << "[ERROR] Failed to open sweep CSV file for writing: " << filename << std::endl;
+        return false;
+    }
+    outfile << "Protocol,Config,ChunkSizeBytes,ThroughputPayload_Mbps,VsBaseline_%,AvgChunkRTT_ms,P99ChunkRTT_ms,Errors\n";
+    outfile << std::fixed << std::setprecision(6);
+    for (size_t i = 0; i < points.size(); ++i) {
+        const auto& p = points[i].result;
+        outfile << protocol_name << "," << points[i].label << "," << p.chunk_size_bytes << ","
+                << p.throughput_mbps << "," << gain_vs_baseline_percent(points, i) << ","
+                << p.avg_rtt_ms << "," << p.p99_rtt_ms << "," << p.errors << "\n";
+    }
+    outfile.close();
+    std::cout << "[INFO] Sweep results saved to " << filename << std::endl;
+    return true;
+}
+
+} // namespace benchmark_common
@@ -0,0 +1,88 @@
+#include "../include/verification_pool.hpp"
+#include "../include/event_tracer.hpp"
+#include <algorithm> // For std::equal, std::mismatch
+#include <iostream>
+
+namespace benchmark_common {
+
+VerificationPool::VerificationPool(size_t threads, size_t queue_capacity, const std::string& thread_name,
+                                   InflightBudget* budget)
+    : budget_(budget), tasks_(queue_capacity), spare_buffers_(queue_capacity) {
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back(&VerificationPool::worker_loop, this, thread_name + "-" + std::to_string(i));
+    }
+}
+
+VerificationPool::~VerificationPool() {
+    drain();
+    stopping_.store(true, std::memory_order_release);
+    for (auto& worker : workers_) worker.join();
+}
+
+void VerificationPool::submit(Task&& task) {
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    int idle_spins = 0;
+    while (!tasks_.try_push(task)) queue_idle_wait(idle_spins);
+}
+
+void VerificationPool::drain() {
+    int idle_spins = 0;
+    while (completed_.load(std::memory_order_acquire) != submitted_.load(std::memory_order_relaxed)) {
+        queue_idle_wait(idle_spins);
+    }
+}
+
+std::vector<std::string> VerificationPool::take_errors() {
+    std::lock_guard<std::mutex> lock(errors_mutex_);
+    std::vector<std::string> errors;
+    errors.swap(errors_);
+    return errors;
+}
+
+void VerificationPool::worker_loop(const std::string& thread_name) {
+    set_event_trace_thread_name(thread_name);
+    Task task;
+    int idle_spins = 0;
+    while (true) {
+        if (tasks_.try_pop(task)) {
+            idle_spins = 0;
+            verify(task);
+            if (budget_) budget_->release(task.budget_bytes);
+            // Буфер ответа - обратно потоку чтения; если запас полон, строка просто освободится
+            task.received.clear();
+            spare_buffers_.try_push(task.received);
+            completed_.fetch_add(1, std::memory_order_release);
+            continue;
+        }
+        if (stopping_.load(std::memory_order_acquire)) return;
+        queue_idle_wait(idle_spins);
+    }
+}
+
+void VerificationPool::verify(Task& task) {
+    BENCHMARK_TRACE_SCOPE("verify", "verification_pool");
+    const std::vector<char>& original = task.original;
+    const std::string& received = task.received;
+    std::string error;
+    if (received.size() != original.size()) {
+        error = "VERIFICATION FAILED for client_id " + std::to_string(task.chunk_id) + ". Size mismatch. Expected " +
+                std::to_string(original.size()) + ", got " + std::to_string(received.size());
+    } else {
+        // Сравнение с перевернутым оригиналом на месте, без копий
+        auto mismatch = std::mismatch(original.rbegin(), original.rend(), received.begin());
+        if (mismatch.first != original.rend()) {
+            error = "VERIFICATION FAILED for client_id " + std::to_string(task.chunk_id) +
+                    ". Content mismatch at byte " + std::to_string(mismatch.second - received.begin()) + ".";
+        }
+    }
+    if (!error.empty()) {
+        std::cerr << "[VERIFY ERROR] " << error << std::endl;
+        std::lock_guard<std::mutex> lock(errors_mutex_);
+        errors_.push_back(std::move(error));
+        return;
+    }
+    verified_bytes_.fetch_add(original.size(), std::memory_order_relaxed);
+    verified_chunks_.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace benchmark_common
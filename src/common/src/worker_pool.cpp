@@ -0,0 +1,53 @@
+#include "../include/worker_pool.hpp"
+#include "../include/event_tracer.hpp"
+
+namespace benchmark_common {
+
+WorkerPool::WorkerPool(size_t threads, size_t queue_capacity, const std::string& thread_name)
+    : tasks_(queue_capacity) {
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back(&WorkerPool::worker_loop, this, thread_name + "-" + std::to_string(i));
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    int idle_spins = 0;
+    while (completed_.load(std::memory_order_acquire) != submitted_.load(std::memory_order_relaxed)) {
+        queue_idle_wait(idle_spins);
+    }
+    stopping_.store(true, std::memory_order_release);
+    for (auto& worker : workers_) worker.join();
+}
+
+void WorkerPool::submit(Task task) {
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    int idle_spins = 0;
+    while (!tasks_.try_push(task)) queue_idle_wait(idle_spins);
+}
+
+bool WorkerPool::try_submit(Task& task) {
+    // Счетчик растет до push, чтобы деструктор не разминулся с уже взятой рабочим задачей
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    if (tasks_.try_push(task)) return true;
+    submitted_.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+}
+
+void WorkerPool::worker_loop(const std::string& thread_name) {
+    set_event_trace_thread_name(thread_name);
+    Task task;
+    int idle_spins = 0;
+    while (true) {
+        if (tasks_.try_pop(task)) {
+            idle_spins = 0;
+            task();
+            task = nullptr; // Захваченное задачей освобождается сразу, а не со следующей задачей
+            completed_.fetch_add(1, std::memory_order_release);
+            continue;
+        }
+        if (stopping_.load(std::memory_order_acquire)) return;
+        queue_idle_wait(idle_spins);
+    }
+}
+
+} // namespace benchmark_common
@@ -0,0 +1,37 @@
+#include "../include/workload.hpp"
+
+#include <stdexcept>
+
+#include <zlib.h>
+
+namespace benchmark_common {
+
+WorkloadMode workload_mode_from_string(const std::string& name) {
+    if (name == "echo") return WorkloadMode::ECHO;
+    if (name == "upload") return WorkloadMode::UPLOAD;
+    if (name == "download") return WorkloadMode::DOWNLOAD;
+    throw std::invalid_argument("Unknown workload mode: " + name + " (expected echo|upload|download)");
+}
+
+std::string workload_mode_to_string(WorkloadMode mode) {
+    switch (mode) {
+        case WorkloadMode::ECHO: return "echo";
+        case WorkloadMode::UPLOAD: return "upload";
+        case WorkloadMode::DOWNLOAD: return "download";
+        default: return "unknown";
+    }
+}
+
+uint32_t chunk_checksum(const char* data, size_t size) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    // crc32() принимает uInt; чанки до 16 MB, но на всякий случай идем кусками
+    while (size > 0) {
+        const uInt part = static_cast<uInt>(size > (1u << 30) ? (1u << 30) : size);
+        crc = crc32(crc, reinterpret_cast<const Bytef*>(data), part);
+        data += part;
+        size -= part;
+    }
+    return static_cast<uint32_t>(crc);
+}
+
+} // namespace benchmark_common
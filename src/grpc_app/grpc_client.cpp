@@ -12,16 +12,33 @@
 #include <atomic>
 #include <iomanip>
 #include <algorithm>
+#include <climits> // INT_MAX для окон HTTP/2
 
 #include <grpcpp/grpcpp.h>
+#include <grpcpp/create_channel_posix.h> // CreateCustomInsecureChannelFromFd
 #include <grpcpp/impl/codegen/byte_buffer.h> // Для ByteSizeLong
 
 #include "gen_proto/benchmark.grpc.pb.h" // Путь к вашим сгенерированным файлам
 
 #include "common/include/config.hpp"
 #include "common/include/file_utils.hpp"
+#include "common/include/alloc_counter.hpp"
 #include "common/include/reversal_utils.hpp"
 #include "common/include/metrics_aggregator.hpp"
+#include "common/include/cli_options.hpp"
+#include "common/include/sweep.hpp"
+#include "common/include/socket_tuning.hpp"
+#include "common/include/workload.hpp"
+#include "common/include/latency_trace.hpp"
+#include "common/include/event_tracer.hpp"
+#include "common/include/progress_reporter.hpp"
+#include "common/include/verification_pool.hpp"
+#include "common/include/inflight_budget.hpp"
+#include "common/include/adaptive_window.hpp"
+#include "common/include/server_stats.hpp"
+#include "grpc_app/grpc_service.hpp"
+#include "grpc_app/grpc_tuning.hpp"
+#include "grpc_app/write_coalescing.hpp"
 
 #ifndef UNUSED_PARAM
 #define UNUSED_PARAM(x) (void)(x)
@@ -48,16 +65,58 @@ void print_client_hex_data(const std::string& title, const std::vector<char>& da
 
 class GrpcFileClient {
 public:
-    GrpcFileClient(std::shared_ptr<Channel> channel)
-        : stub_(FileProcessor::NewStub(channel)) {}
+    GrpcFileClient(std::shared_ptr<Channel> channel,
+                   benchmark_common::WorkloadMode mode = benchmark_common::WorkloadMode::ECHO)
+        : stub_(FileProcessor::NewStub(channel)), mode_(mode) {}
 
+    // --trace: запросы несут отметку отправки, ответы с серверными отметками идут в коллектор.
+    // Режим download не трассируется: у его чанков нет парного запроса.
+    void set_trace_collector(benchmark_common::TraceCollector* collector) { trace_collector_ = collector; }
+
+    // --write-batch / --write-flush-us: склейка записей запросов, см. write_coalescing.hpp.
+    // Сервер придерживает ответы на придержанные запросы, так что склейка идет в обе стороны.
+    void set_write_coalescing(size_t batch, std::chrono::microseconds flush_after) {
+        write_batch_ = batch;
+        write_flush_after_ = flush_after;
+    }
+
+    // --verify-threads: сколько потоков сверяют эхо-ответы; 0 - поток чтения сверяет сам.
+    void set_verify_threads(size_t threads) { verify_threads_ = threads; }
+
+    // --adaptive-window: число запросов в полете подбирает AdaptiveWindow (не выше лимита
+    // запросов бюджета); каждый ProcessFile начинает подбор заново.
+    void set_adaptive_window(const benchmark_common::AdaptiveWindowOptions& options) {
+        adaptive_window_options_ = options;
+        adaptive_window_enabled_ = true;
+    }
+    // Окно последнего ProcessFile с --adaptive-window, иначе nullptr.
+    const benchmark_common::AdaptiveWindow* adaptive_window() const { return adaptive_window_.get(); }
+
+    // Счетчики хода прогона пополняются всегда; отчеты печатает тот, кто вызвал progress().start().
+    benchmark_common::ProgressReporter& progress() { return progress_; }
+
+    // byte_limit != 0 - отправить только первые ~byte_limit байт файла (целыми чанками), для --sweep.
+    // В режиме download файл клиента не читается: сервер отдает столько же байт своего файла.
     void ProcessFile(const std::string& filename_to_send,
                      size_t configured_chunk_size,
-                     benchmark_common::MetricsAggregator& metrics_collector) {
+                     benchmark_common::MetricsAggregator& metrics_collector,
+                     size_t byte_limit = 0) {
+        if (mode_ == benchmark_common::WorkloadMode::DOWNLOAD) {
+            DownloadFile(configured_chunk_size, metrics_collector,
+                         byte_limit != 0 ? byte_limit : benchmark_common::ACTUAL_FILE_SIZE_BYTES);
+            return;
+        }
+        const bool upload_only = mode_ == benchmark_common::WorkloadMode::UPLOAD;
 
-        std::cout << "[gRPC CLIENT INFO] Preparing to process file: " << filename_to_send << std::endl;
+        std::cout << "[gRPC CLIENT INFO] Preparing to process file: " << filename_to_send
+                  << " (chunk size " << configured_chunk_size << " bytes)" << std::endl;
 
         benchmark_common::ChunkReader reader(filename_to_send, configured_chunk_size);
+        size_t expected_payload_bytes = benchmark_common::ACTUAL_FILE_SIZE_BYTES;
+        if (byte_limit != 0) {
+            size_t limit_in_whole_chunks = (byte_limit + configured_chunk_size - 1) / configured_chunk_size * configured_chunk_size;
+            expected_payload_bytes = std::min(reader.get_file_size_from_impl(), limit_in_whole_chunks);
+        }
 
         ClientContext context;
         std::chrono::system_clock::time_point deadline =
@@ -77,36 +136,75 @@ public:
         std::cout << "[gRPC CLIENT INFO] Connected to server. Starting to stream file." << std::endl;
 
         auto overall_processing_start_time = std::chrono::steady_clock::now();
+        const uint64_t heap_allocations_at_start = benchmark_common::heap_allocations();
 
         struct SentChunkInfo {
             size_t client_assigned_id;
             size_t original_payload_size;
             size_t on_wire_request_size_bytes;
-            std::vector<char> original_data_for_verification;
+            std::vector<char> original_data_for_verification; // Только echo
+            uint32_t checksum = 0;                            // Только upload
             std::chrono::steady_clock::time_point time_sent;
         };
 
         std::map<size_t, SentChunkInfo> inflight_requests_map; // Используем map
         std::mutex map_mutex;
-        std::condition_variable cv_can_send;
         std::atomic<bool> writer_thread_finished_sending{false}; // Переименовал для ясности
         std::atomic<bool> writer_stream_broken{false};
+        std::atomic<bool> reader_finished{false}; // Ответов больше не будет: писателю незачем ждать бюджет
         std::atomic<size_t> total_chunks_actually_sent_by_writer{0};
 
-        const size_t MAX_INFLIGHT_REQUESTS = 2000; // Можно настроить
+        // Окно запросов - общий бюджет данных в полете (--inflight-bytes, --inflight-requests):
+        // чанк занимает его от отправки до проверки ответа, то есть пока клиент держит его копию
+        benchmark_common::InflightBudget& budget = benchmark_common::shared_inflight_budget();
+        const benchmark_common::InflightBudget::Stats budget_stats_at_start = budget.begin_run();
+        const uint64_t configured_max_requests = budget.max_requests();
+        // С --adaptive-window лимит запросов бюджета - текущее окно; по окончании он восстанавливается
+        adaptive_window_.reset();
+        if (adaptive_window_enabled_) {
+            benchmark_common::AdaptiveWindowOptions window_options = adaptive_window_options_;
+            window_options.max_window = std::min<size_t>(window_options.max_window, configured_max_requests);
+            adaptive_window_ = std::make_unique<benchmark_common::AdaptiveWindow>(window_options);
+            budget.set_limits(budget.max_bytes(), adaptive_window_->window());
+        }
+        const size_t budget_window_requests = std::min<size_t>(
+            configured_max_requests, std::max<size_t>(1, budget.max_bytes() / configured_chunk_size));
+
+        grpc_tuning::WriteCoalescer coalescer(write_batch_, write_flush_after_);
+
+        // Эхо-ответы сверяют рабочие потоки: поток чтения только отмечает RTT и отдает ответ.
+        // Очередь не длиннее окна запросов, так что памяти под непроверенные чанки не больше,
+        // чем под чанки в полете.
+        std::unique_ptr<benchmark_common::VerificationPool> verify_pool;
+        if (!upload_only && verify_threads_ > 0) {
+            verify_pool = std::make_unique<benchmark_common::VerificationPool>(
+                verify_threads_, std::max<size_t>(2, std::min<size_t>(1024, budget_window_requests)), "grpc-verify",
+                &budget);
+        }
 
         std::thread writer_thread([&]() {
             size_t client_chunk_id_counter = 0;
-            std::vector<char> chunk_data_buffer;
+            size_t payload_bytes_queued = 0;
+            bool wrote_last = false;
+            // Место в бюджете, занятое под следующий чанк до записи текущего (0 - не занято)
+            uint64_t reserved_bytes = 0;
+            // Одно сообщение на весь поток: чанк читается прямо в data_chunk, строка сохраняет
+            // емкость между итерациями, остальные поля перезаписываются каждый раз
+            ChunkRequest request;
+            std::string& chunk_data_buffer = *request.mutable_data_chunk();
+            if (upload_only) request.set_mode(benchmark_grpc::WORKLOAD_UPLOAD);
+            benchmark_common::set_event_trace_thread_name("grpc-writer");
 
             try {
                 while (true) {
+                    if (byte_limit != 0 && payload_bytes_queued >= byte_limit) {
+                        std::cout << "[gRPC CLIENT INFO] (Writer): Reached byte limit of " << byte_limit << " bytes." << std::endl;
+                        break;
+                    }
                     {
-                        std::unique_lock<std::mutex> lock(map_mutex);
-                        cv_can_send.wait(lock, [&]{ return inflight_requests_map.size() < MAX_INFLIGHT_REQUESTS; });
+                        BENCHMARK_TRACE_SCOPE("read_file", "grpc_client");
+                        reader.next_chunk_into(chunk_data_buffer);
                     }
-
-                    chunk_data_buffer = reader.next_chunk();
                     if (chunk_data_buffer.empty() && reader.eof()) {
                         std::cout << "[gRPC CLIENT INFO] (Writer): Reached EOF from ChunkReader." << std::endl;
                         break;
@@ -116,52 +214,103 @@ public:
                         std::cerr << "[gRPC CLIENT ERROR] " << err_msg << std::endl;
                         metrics_collector.log_error(err_msg);
                         writer_stream_broken = true; // Помечаем проблему
+                        if (reserved_bytes > 0) budget.release(reserved_bytes);
                         return;
                     }
 
+                    if (reserved_bytes > 0) {
+                        // Место заняли заранее под полный чанк: подгоняем под прочитанный
+                        budget.adjust(reserved_bytes, chunk_data_buffer.size());
+                        reserved_bytes = 0;
+                    } else {
+                        // Придержанных записей нет (пачка закрыта), можно ждать места
+                        BENCHMARK_TRACE_SCOPE("wait_window", "grpc_client");
+                        if (!budget.acquire(chunk_data_buffer.size(), reader_finished)) {
+                            std::cerr << "[gRPC CLIENT ERROR] (Writer): Stream closed while waiting for the in-flight budget." << std::endl;
+                            writer_stream_broken = true;
+                            break;
+                        }
+                    }
+
                     client_chunk_id_counter++;
+                    payload_bytes_queued += chunk_data_buffer.size();
+                    // Последний чанк уходит как WriteLast(): запись и WritesDone() одной операцией
+                    const bool last_chunk = reader.eof() || (byte_limit != 0 && payload_bytes_queued >= byte_limit);
+                    // Место под следующий чанк занимается до этой записи и без ожидания: если его
+                    // нет, писатель заснет в acquire(), поэтому пачка закрывается этой записью.
+                    // Так писатель не спит, пока транспорт держит его записи, даже если читатель
+                    // тем временем ужмет бюджет (--adaptive-window)
+                    if (!last_chunk && write_batch_ > 1 && budget.try_acquire(configured_chunk_size)) {
+                        reserved_bytes = configured_chunk_size;
+                    }
+                    const grpc::WriteOptions write_options = coalescer.next(reserved_bytes == 0 || last_chunk);
 
-                    ChunkRequest request;
-                    request.set_data_chunk(chunk_data_buffer.data(), chunk_data_buffer.size());
                     request.set_client_assigned_chunk_id(client_chunk_id_counter); // Отправляем ID клиента
+                    request.set_buffered(write_options.get_buffer_hint());
+                    // Отметка ставится заранее, чтобы ByteSizeLong() учел поле; перед Write()
+                    // она обновляется значением той же длины
+                    if (trace_collector_) request.mutable_trace()->set_client_send_ns(benchmark_common::trace_now_ns());
 
                     SentChunkInfo log_entry;
                     log_entry.client_assigned_id = client_chunk_id_counter;
                     log_entry.original_payload_size = chunk_data_buffer.size();
                     log_entry.on_wire_request_size_bytes = request.ByteSizeLong();
-                    log_entry.original_data_for_verification = chunk_data_buffer;
+                    if (upload_only) {
+                        // Для подтверждения хватает контрольной суммы, копия чанка не нужна
+                        log_entry.checksum = benchmark_common::chunk_checksum(chunk_data_buffer.data(), chunk_data_buffer.size());
+                    } else {
+                        log_entry.original_data_for_verification.assign(chunk_data_buffer.begin(), chunk_data_buffer.end());
+                    }
                     log_entry.time_sent = std::chrono::steady_clock::now();
 
-                    if (client_chunk_id_counter % 500 == 0 || client_chunk_id_counter == 1) {
-                         std::cout << "[CLIENT PROGRESS] gRPC (Writer): Sending client_id " << log_entry.client_assigned_id
-                                   << ", size: " << log_entry.original_payload_size << std::endl;
-                    }
                     // print_client_hex_data("Writer: Sending client_id " + std::to_string(log_entry.client_assigned_id), log_entry.original_data_for_verification);
+                    const size_t payload_size = log_entry.original_payload_size;
+                    // Запись в map - до Write(): ответ может прийти читателю раньше, чем Write() вернется
+                    {
+                        std::lock_guard<std::mutex> lock(map_mutex);
+                        inflight_requests_map[log_entry.client_assigned_id] = std::move(log_entry);
+                    }
 
-                    if (!stream->Write(request)) {
+                    if (trace_collector_) request.mutable_trace()->set_client_send_ns(benchmark_common::trace_now_ns());
+                    bool written;
+                    {
+                        BENCHMARK_TRACE_SCOPE("write", "grpc_client");
+                        // set_last_message() - то же, что WriteLast(), но с результатом записи
+                        written = last_chunk ? stream->Write(request, grpc::WriteOptions(write_options).set_last_message())
+                                             : stream->Write(request, write_options);
+                        wrote_last = written && last_chunk;
+                    }
+                    if (!written) {
                         std::cerr << "[gRPC CLIENT ERROR] (Writer): Failed to write to stream for client_id " << client_chunk_id_counter << "." << std::endl;
                         writer_stream_broken = true;
-                        cv_can_send.notify_all();
+                        // Запрос не ушел: снимаем его из map и возвращаем место в бюджете
+                        // (если читатель успел забрать запись, он освободит место сам)
+                        bool erased;
+                        {
+                            std::lock_guard<std::mutex> lock(map_mutex);
+                            erased = inflight_requests_map.erase(client_chunk_id_counter) > 0;
+                        }
+                        if (erased) budget.release(payload_size);
                         break;
                     }
                     total_chunks_actually_sent_by_writer++;
-
-                    {
-                        std::lock_guard<std::mutex> lock(map_mutex);
-                        inflight_requests_map[log_entry.client_assigned_id] = log_entry;
-                    }
+                    progress_.on_sent();
+                    if (wrote_last) break;
                 }
             } catch (const std::exception& e) {
                  std::cerr << "[gRPC CLIENT ERROR] (Writer): Exception: " << e.what() << std::endl;
                  metrics_collector.log_error(std::string("Writer thread exception: ") + e.what());
                  writer_stream_broken = true;
             }
+            if (reserved_bytes > 0) budget.release(reserved_bytes); // Следующего чанка не будет
 
             // Поток писателя завершил отправку данных из файла
             writer_thread_finished_sending = true; // Устанавливаем флаг
             std::cout << "[gRPC CLIENT INFO] (Writer): Finished reading file. Total chunks prepared by writer: " << client_chunk_id_counter << std::endl;
 
-            if (!writer_stream_broken.load()) {
+            if (wrote_last) {
+                 std::cout << "[gRPC CLIENT INFO] (Writer): Last chunk sent with WriteLast()." << std::endl;
+            } else if (!writer_stream_broken.load()) {
                  std::cout << "[gRPC CLIENT INFO] (Writer): Calling WritesDone()." << std::endl;
                  if(!stream->WritesDone()){
                     std::cerr << "[gRPC CLIENT ERROR] (Writer): WritesDone() failed." << std::endl;
@@ -170,7 +319,6 @@ public:
                     std::cout << "[gRPC CLIENT INFO] (Writer): WritesDone() successful." << std::endl;
                  }
             }
-            cv_can_send.notify_all(); // Разбудить читателя, если он ждет, и сообщить, что больше данных не будет
         });
 
 
@@ -178,8 +326,10 @@ public:
         size_t received_responses_count = 0;
         size_t total_bytes_verified_payload_by_reader = 0;
 
+        benchmark_common::set_event_trace_thread_name("grpc-reader");
         try {
             while (stream->Read(&response)) {
+                BENCHMARK_TRACE_SCOPE("handle_response", "grpc_client");
                 auto chunk_received_time = std::chrono::steady_clock::now();
                 long long server_echoed_client_id_long = response.original_client_chunk_id();
                 size_t server_echoed_client_id = static_cast<size_t>(server_echoed_client_id_long);
@@ -190,7 +340,7 @@ public:
                     std::lock_guard<std::mutex> lock(map_mutex);
                     auto it = inflight_requests_map.find(server_echoed_client_id);
                     if (it != inflight_requests_map.end()) {
-                        request_log_entry = it->second; // Копируем данные
+                        request_log_entry = std::move(it->second); // Забираем данные без копии
                         inflight_requests_map.erase(it); // Удаляем из map
                         found_request_in_map = true;
                     } else {
@@ -209,33 +359,76 @@ public:
                     }
                 }
                 if (found_request_in_map) { // Только если нашли соответствующий запрос
-                    cv_can_send.notify_one(); // Сообщаем писателю, что место в map освободилось
                     received_responses_count++;
 
                     auto rtt_us = std::chrono::duration_cast<std::chrono::microseconds>(chunk_received_time - request_log_entry.time_sent);
                     metrics_collector.record_chunk_rtt_us(rtt_us.count());
                     metrics_collector.record_chunk_sent(request_log_entry.original_payload_size, request_log_entry.on_wire_request_size_bytes);
+                    progress_.on_completed(request_log_entry.original_payload_size, rtt_us.count());
+                    if (adaptive_window_ &&
+                        adaptive_window_->on_completion(request_log_entry.original_payload_size, rtt_us.count())) {
+                        budget.set_limits(budget.max_bytes(), adaptive_window_->window());
+                    }
+                    if (trace_collector_ && response.has_trace()) {
+                        benchmark_common::TraceStamps stamps;
+                        stamps.client_send_ns = response.trace().client_send_ns();
+                        stamps.server_recv_ns = response.trace().server_recv_ns();
+                        stamps.server_process_done_ns = response.trace().server_process_done_ns();
+                        stamps.server_send_ns = response.trace().server_send_ns();
+                        trace_collector_->record(stamps, benchmark_common::to_trace_ns(chunk_received_time));
+                    }
 
-                    std::vector<char> expected_reversed_chunk = request_log_entry.original_data_for_verification;
-                    benchmark_common::reverse_bytes(expected_reversed_chunk);
+                    if (upload_only) {
+                        if (static_cast<size_t>(response.payload_bytes()) != request_log_entry.original_payload_size ||
+                            response.checksum() != request_log_entry.checksum) {
+                            std::string err_msg = "VERIFICATION FAILED for client_id " + std::to_string(request_log_entry.client_assigned_id)
+                                               + ". Upload ack mismatch: server got " + std::to_string(response.payload_bytes())
+                                               + " bytes, checksum " + std::to_string(response.checksum())
+                                               + ", expected " + std::to_string(request_log_entry.original_payload_size)
+                                               + " bytes, checksum " + std::to_string(request_log_entry.checksum);
+                            std::cerr << "[gRPC CLIENT ERROR] " << err_msg << std::endl;
+                            metrics_collector.log_error(err_msg);
+                        } else {
+                            total_bytes_verified_payload_by_reader += request_log_entry.original_payload_size;
+                        }
+                        budget.release(request_log_entry.original_payload_size);
+                        continue;
+                    }
 
-                    std::string received_data_str = response.reversed_chunk_data();
-                    std::vector<char> received_chunk_vec(received_data_str.begin(), received_data_str.end());
+                    if (verify_pool) {
+                        // Байты ответа забираются обменом на свободный буфер пула: без копии,
+                        // и следующий Read() разбирает ответ в уже выделенную емкость
+                        benchmark_common::VerificationPool::Task task;
+                        task.chunk_id = request_log_entry.client_assigned_id;
+                        task.original = std::move(request_log_entry.original_data_for_verification);
+                        task.budget_bytes = request_log_entry.original_payload_size; // Освободит рабочий после проверки
+                        verify_pool->take_spare_buffer(task.received);
+                        task.received.swap(*response.mutable_reversed_chunk_data());
+                        verify_pool->submit(std::move(task));
+                        continue;
+                    }
+
+                    // Сравнение с перевернутым оригиналом на месте, без копий ответа и оригинала
+                    const std::vector<char>& original_chunk = request_log_entry.original_data_for_verification;
+                    const std::string& received_data_str = response.reversed_chunk_data();
 
-                    if (received_chunk_vec.size() != expected_reversed_chunk.size()) {
+                    if (received_data_str.size() != original_chunk.size()) {
                         std::string err_msg = "VERIFICATION FAILED for client_id " + std::to_string(request_log_entry.client_assigned_id)
-                                           + ". Size mismatch. Expected " + std::to_string(expected_reversed_chunk.size())
-                                           + ", got " + std::to_string(received_chunk_vec.size());
+                                           + ". Size mismatch. Expected " + std::to_string(original_chunk.size())
+                                           + ", got " + std::to_string(received_data_str.size());
                         std::cerr << "[gRPC CLIENT ERROR] " << err_msg << std::endl;
                         metrics_collector.log_error(err_msg);
                     } else {
-                        if (received_chunk_vec != expected_reversed_chunk) {
+                        if (!std::equal(original_chunk.rbegin(), original_chunk.rend(), received_data_str.begin())) {
                             std::string err_msg = "VERIFICATION FAILED for client_id " + std::to_string(request_log_entry.client_assigned_id) + ". Content mismatch.";
                             std::cerr << "[gRPC CLIENT ERROR] " << err_msg << std::endl;
                             metrics_collector.log_error(err_msg);
 
+                            std::vector<char> expected_reversed_chunk = original_chunk;
+                            benchmark_common::reverse_bytes(expected_reversed_chunk);
+                            std::vector<char> received_chunk_vec(received_data_str.begin(), received_data_str.end());
                             std::cout << "==== ERROR DEBUG CLIENT_ID: " << request_log_entry.client_assigned_id << " ====" << std::endl;
-                            print_client_hex_data("Original Data", request_log_entry.original_data_for_verification, 64);
+                            print_client_hex_data("Original Data", original_chunk, 64);
                             print_client_hex_data("Expected Reversed", expected_reversed_chunk, 64);
                             print_client_hex_data("Received Reversed", received_chunk_vec, 64);
                             std::cout << "====================================" << std::endl;
@@ -243,12 +436,7 @@ public:
                             total_bytes_verified_payload_by_reader += request_log_entry.original_payload_size;
                         }
                     }
-                    if (received_responses_count % 500 == 0 || received_responses_count == 1 || received_responses_count == total_chunks_actually_sent_by_writer.load()) {
-                         std::cout << "[CLIENT PROGRESS] gRPC: Processed " << received_responses_count << " of " << total_chunks_actually_sent_by_writer.load()
-                                   << " sent responses. Verified "
-                                   << std::fixed << std::setprecision(2) << (total_bytes_verified_payload_by_reader / (1024.0*1024.0))
-                                   << " MB. Last RTT: " << rtt_us.count() << " us." << std::endl;
-                    }
+                    budget.release(request_log_entry.original_payload_size);
                 } else { // Не нашли запрос в map
                     // Если writer уже закончил и карта пуста, это может быть нормально, если Read() вернул false после этого
                     // Но если Read() все еще возвращает true, это проблема.
@@ -263,6 +451,9 @@ public:
              metrics_collector.log_error(std::string("Exception in Read loop: ") + e.what());
         }
         std::cout << "[gRPC CLIENT INFO] (Reader): Read loop finished or broken." << std::endl;
+        // Если поток оборвался, писатель может ждать места, которое уже никто не освободит
+        reader_finished = true;
+        budget.wake_waiters();
 
         // Убеждаемся, что writer_thread завершился
         if (writer_thread.joinable()) {
@@ -270,6 +461,12 @@ public:
         }
         std::cout << "[gRPC CLIENT INFO] Writer thread joined." << std::endl;
 
+        if (verify_pool) {
+            verify_pool->drain();
+            total_bytes_verified_payload_by_reader += verify_pool->verified_bytes();
+            for (const std::string& err_msg : verify_pool->take_errors()) metrics_collector.log_error(err_msg);
+        }
+
         // Проверяем, остались ли необработанные запросы в map (не должно быть, если все ответы пришли)
         {
             std::lock_guard<std::mutex> lock(map_mutex);
@@ -280,9 +477,16 @@ public:
                 metrics_collector.log_error(warn_msg);
                 for (const auto& pair : inflight_requests_map) {
                     std::cerr << "  - Unanswered client_id: " << pair.first << std::endl;
+                    budget.release(pair.second.original_payload_size); // Бюджет общий: не оставлять занятым
                 }
+                inflight_requests_map.clear();
             }
         }
+        if (adaptive_window_) budget.set_limits(budget.max_bytes(), configured_max_requests);
+        const std::string budget_report = benchmark_common::InflightBudget::describe(
+            budget_stats_at_start, budget.stats(), budget.max_bytes(), budget.max_requests());
+        metrics_collector.set_run_parameter("inflight_budget", budget_report);
+        if (adaptive_window_) metrics_collector.set_run_parameter("adaptive_window", adaptive_window_->describe());
 
 
         Status status = stream->Finish();
@@ -303,34 +507,341 @@ public:
         std::cout << "[gRPC CLIENT SUMMARY] Total chunks prepared by writer: " << total_chunks_actually_sent_by_writer.load() << std::endl;
         std::cout << "[gRPC CLIENT SUMMARY] Total responses processed by reader: " << received_responses_count << std::endl;
         std::cout << "[gRPC CLIENT SUMMARY] Total bytes (payload) verified by reader: " << total_bytes_verified_payload_by_reader << std::endl;
+        std::cout << "[gRPC CLIENT SUMMARY] In-flight " << budget_report << std::endl;
+        if (adaptive_window_) {
+            std::cout << "[gRPC CLIENT SUMMARY] Adaptive " << adaptive_window_->describe() << std::endl;
+        }
+        if (coalescer.batch() > 1 && coalescer.flushes() > 0) {
+            std::cout << "[gRPC CLIENT SUMMARY] Write coalescing (batch " << coalescer.batch() << "): "
+                      << coalescer.writes() << " requests in " << coalescer.flushes() << " flushes ("
+                      << static_cast<double>(coalescer.writes()) / coalescer.flushes() << " per flush)" << std::endl;
+        }
+        if (benchmark_common::heap_allocations_counted() && received_responses_count > 0) {
+            // Весь процесс, включая C++-выделения gRPC и protobuf; malloc внутри gRPC core не виден
+            const uint64_t allocations = benchmark_common::heap_allocations() - heap_allocations_at_start;
+            std::cout << "[gRPC CLIENT SUMMARY] Heap allocations: " << allocations << " for "
+                      << received_responses_count << " chunks ("
+                      << static_cast<double>(allocations) / received_responses_count << " per chunk)" << std::endl;
+        }
 
         if (writer_thread_finished_sending.load() && !writer_stream_broken.load() && status.ok() && // <--- ИЗМЕНЕНО ЗДЕСЬ
-            total_bytes_verified_payload_by_reader != benchmark_common::ACTUAL_FILE_SIZE_BYTES ) {
+            total_bytes_verified_payload_by_reader != expected_payload_bytes ) {
              std::string final_warn = "Potential data loss or incomplete processing: Verified bytes (" +
                                      std::to_string(total_bytes_verified_payload_by_reader) +
-                                     ") != Expected total bytes (" + std::to_string(benchmark_common::ACTUAL_FILE_SIZE_BYTES) + ")";
+                                     ") != Expected total bytes (" + std::to_string(expected_payload_bytes) + ")";
              std::cerr << "[gRPC CLIENT WARNING] " << final_warn << std::endl;
              metrics_collector.log_error(final_warn);
         } else if (writer_thread_finished_sending.load() && !writer_stream_broken.load() && status.ok() && // <--- И ИЗМЕНЕНО ЗДЕСЬ
-                   total_bytes_verified_payload_by_reader == benchmark_common::ACTUAL_FILE_SIZE_BYTES) {
+                   total_bytes_verified_payload_by_reader == expected_payload_bytes) {
             std::cout << "[gRPC CLIENT INFO] All data successfully transferred and verified!" << std::endl;
         }
     }
 
 private:
+    // Режим download: один запрос с объемом и размером чанка, дальше только прием. Каждый чанк
+    // проверяется по CRC32 из ответа; "RTT" чанка здесь - интервал между соседними чанками.
+    void DownloadFile(size_t configured_chunk_size,
+                      benchmark_common::MetricsAggregator& metrics_collector,
+                      size_t requested_bytes) {
+        std::cout << "[gRPC CLIENT INFO] Download: requesting " << requested_bytes << " bytes in "
+                  << configured_chunk_size << "-byte chunks." << std::endl;
+
+        ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::minutes(15));
+        std::unique_ptr<ClientReaderWriter<ChunkRequest, ChunkResponse>> stream(stub_->ProcessFileChunks(&context));
+        if (!stream) {
+            std::string err_msg = "gRPC Client: Failed to create stream. Stub returned nullptr.";
+            std::cerr << "[gRPC CLIENT ERROR] " << err_msg << std::endl;
+            metrics_collector.log_error(err_msg);
+            return;
+        }
+
+        auto overall_processing_start_time = std::chrono::steady_clock::now();
+        ChunkRequest request;
+        request.set_mode(benchmark_grpc::WORKLOAD_DOWNLOAD);
+        request.set_download_bytes(static_cast<long long>(requested_bytes));
+        request.set_download_chunk_size(static_cast<long long>(configured_chunk_size));
+        if (!stream->Write(request) || !stream->WritesDone()) {
+            std::cerr << "[gRPC CLIENT ERROR] Failed to send the download request." << std::endl;
+            metrics_collector.log_error("gRPC Client: failed to send the download request");
+        }
+
+        ChunkResponse response;
+        size_t received_chunks = 0;
+        size_t verified_bytes = 0;
+        auto last_arrival = std::chrono::steady_clock::now();
+        while (stream->Read(&response)) {
+            auto now = std::chrono::steady_clock::now();
+            const long long interarrival_us =
+                std::chrono::duration_cast<std::chrono::microseconds>(now - last_arrival).count();
+            metrics_collector.record_chunk_rtt_us(interarrival_us);
+            last_arrival = now;
+            received_chunks++;
+
+            const std::string& data = response.reversed_chunk_data();
+            metrics_collector.record_chunk_sent(data.size(), response.ByteSizeLong());
+            progress_.on_completed(data.size(), interarrival_us);
+            if (benchmark_common::chunk_checksum(data.data(), data.size()) != response.checksum()) {
+                std::string err_msg = "VERIFICATION FAILED for download chunk " +
+                                      std::to_string(response.original_client_chunk_id()) + ". Checksum mismatch.";
+                std::cerr << "[gRPC CLIENT ERROR] " << err_msg << std::endl;
+                metrics_collector.log_error(err_msg);
+            } else {
+                verified_bytes += data.size();
+            }
+        }
+
+        Status status = stream->Finish();
+        auto total_duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - overall_processing_start_time);
+        metrics_collector.set_total_transaction_time_ms(total_duration_ms.count());
+
+        if (!status.ok()) {
+            std::string err_msg = "gRPC Client: Download RPC failed. Error code: " + std::to_string(status.error_code()) +
+                                  ", message: " + status.error_message();
+            std::cerr << "[gRPC CLIENT ERROR] " << err_msg << std::endl;
+            metrics_collector.log_error(err_msg);
+        } else if (verified_bytes != requested_bytes) {
+            std::string warn_msg = "Download incomplete: verified " + std::to_string(verified_bytes) +
+                                   " of " + std::to_string(requested_bytes) +
+                                   " requested bytes (server file shorter than the request?)";
+            std::cerr << "[gRPC CLIENT WARNING] " << warn_msg << std::endl;
+            metrics_collector.log_error(warn_msg);
+        } else {
+            std::cout << "[gRPC CLIENT INFO] All downloaded data verified (" << received_chunks << " chunks)." << std::endl;
+        }
+    }
+
     std::unique_ptr<FileProcessor::Stub> stub_;
+    benchmark_common::WorkloadMode mode_;
+    benchmark_common::TraceCollector* trace_collector_ = nullptr;
+    size_t verify_threads_ = benchmark_common::DEFAULT_VERIFY_THREADS;
+    size_t write_batch_ = benchmark_common::DEFAULT_GRPC_WRITE_BATCH;
+    std::chrono::microseconds write_flush_after_{benchmark_common::DEFAULT_GRPC_WRITE_FLUSH_US};
+    bool adaptive_window_enabled_ = false;
+    benchmark_common::AdaptiveWindowOptions adaptive_window_options_;
+    std::unique_ptr<benchmark_common::AdaptiveWindow> adaptive_window_;
+    benchmark_common::ProgressReporter progress_{"gRPC client"};
 };
 
-int main(int argc, char** argv) {
-    UNUSED_PARAM(argc);
-    UNUSED_PARAM(argv);
+// Канал к серверу с данным профилем сокета. Профиль, отличный от default, на TCP требует
+// собственного сокета: gRPC не выставляет SO_SNDBUF/SO_RCVBUF/TCP_QUICKACK/SO_BUSY_POLL, поэтому
+// соединение открывается здесь и передается каналу готовым дескриптором. nullptr при ошибке.
+static std::shared_ptr<Channel> CreateBenchmarkChannel(const std::string& target,
+                                                       benchmark_common::Transport transport,
+                                                       const benchmark_common::SocketTuning& tuning,
+                                                       ChannelArguments args) {
+    grpc_tuning::apply_socket_tuning(args, tuning);
+    if (transport != benchmark_common::Transport::TCP || tuning.is_default()) {
+        return grpc::CreateCustomChannel(target, grpc::InsecureChannelCredentials(), args);
+    }
+    int fd = benchmark_common::connect_tuned_tcp_socket(
+        benchmark_common::GRPC_SERVER_ADDRESS, benchmark_common::GRPC_SERVER_PORT, tuning, "[gRPC CLIENT ERROR]");
+    if (fd < 0) return nullptr;
+    std::cout << "[gRPC CLIENT INFO] Socket profile: " << benchmark_common::socket_tuning_to_string(tuning) << std::endl;
+    return grpc::CreateCustomInsecureChannelFromFd(target, fd, args);
+}
+
+// --transport=inproc: сервис FileProcessor работает в процессе клиента, канал к нему -
+// Server::InProcessChannel: ни сокетов, ни HTTP/2-кадров, но та же сериализация protobuf и та
+// же обработка чанков, что в grpc_server. Метрики этапов сервера печатаются после каждого потока.
+class InProcessServer {
+public:
+    explicit InProcessServer(const std::string& download_file)
+        : stats_("gRPC-inproc", "grpc_inproc_server_stats.csv"),
+          // Ход обработки на стороне сервера не печатается: его и так показывает клиент
+          progress_("gRPC in-process server"),
+          service_(download_file, stats_, progress_) {
+        grpc::ServerBuilder builder;
+        builder.SetMaxReceiveMessageSize(-1);
+        builder.SetMaxSendMessageSize(-1);
+        builder.RegisterService(&service_); // Без AddListeningPort: только внутрипроцессные каналы
+        server_ = builder.BuildAndStart();
+    }
+    ~InProcessServer() {
+        if (server_) server_->Shutdown();
+    }
 
+    InProcessServer(const InProcessServer&) = delete;
+    InProcessServer& operator=(const InProcessServer&) = delete;
+
+    // nullptr, если сервер не запустился.
+    std::shared_ptr<Channel> CreateChannel(const ChannelArguments& args) {
+        return server_ ? server_->InProcessChannel(args) : nullptr;
+    }
+
+private:
+    benchmark_common::ServerStats stats_;
+    benchmark_common::ProgressReporter progress_;
+    FileProcessorServiceImpl service_;
+    std::unique_ptr<grpc::Server> server_;
+};
+
+int main(int argc, char** argv) {
     std::cout << "[gRPC CLIENT INFO] Starting gRPC client." << std::endl;
 
-    const std::string test_filename = benchmark_common::TEST_FILE_NAME;
+    benchmark_common::CliOptions options(argc, argv);
+    benchmark_common::Transport transport;
+    try {
+        transport = benchmark_common::transport_from_string(
+            options.get_string("transport", benchmark_common::DEFAULT_TRANSPORT));
+    } catch (const std::exception& e) {
+        std::cerr << "[gRPC CLIENT ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    if (transport == benchmark_common::Transport::SHM) {
+        std::cerr << "[gRPC CLIENT ERROR] Transport 'shm' is only supported by the Cap'n Proto path." << std::endl;
+        return 1;
+    }
+    if (transport == benchmark_common::Transport::INPROC &&
+        (options.get_bool("socket-sweep", false) || options.get_bool("window-sweep", false))) {
+        std::cerr << "[gRPC CLIENT ERROR] --socket-sweep and --window-sweep need a real connection "
+                     "(--transport=tcp|unix)." << std::endl;
+        return 1;
+    }
+
+    benchmark_common::ContentProfile content_profile;
+    grpc_compression_algorithm compression;
+    benchmark_common::SocketTuning socket_tuning;
+    grpc_tuning::Http2Tuning http2_tuning;
+    benchmark_common::WorkloadMode workload_mode;
+    try {
+        content_profile = benchmark_common::content_profile_from_string(options.get_string("content", "random"));
+        compression = grpc_tuning::compression_from_string(options.get_string("compression", "none"));
+        socket_tuning = benchmark_common::socket_tuning_from_options(options);
+        http2_tuning = grpc_tuning::http2_tuning_from_options(options);
+        workload_mode = benchmark_common::workload_mode_from_string(options.get_string("mode", "echo"));
+    } catch (const std::exception& e) {
+        std::cerr << "[gRPC CLIENT ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    const std::string test_filename =
+        benchmark_common::test_file_name_for_profile(benchmark_common::TEST_FILE_NAME, content_profile);
     const size_t target_file_size_bytes = benchmark_common::ACTUAL_FILE_SIZE_BYTES;
-    const size_t chunk_size_bytes = benchmark_common::CHUNK_SIZE_BYTES;
-    const std::string server_target_address = benchmark_common::GRPC_SERVER_ADDRESS + ":" + std::to_string(benchmark_common::GRPC_SERVER_PORT);
+    size_t chunk_size_bytes;
+    try {
+        chunk_size_bytes = options.get_size("chunk-size", benchmark_common::CHUNK_SIZE_BYTES);
+    } catch (const std::exception& e) {
+        std::cerr << "[gRPC CLIENT ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    if (chunk_size_bytes == 0) {
+        std::cerr << "[gRPC CLIENT ERROR] --chunk-size must be positive." << std::endl;
+        return 1;
+    }
+    try {
+        benchmark_common::configure_shared_inflight_budget(options);
+    } catch (const std::exception& e) {
+        std::cerr << "[gRPC CLIENT ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << "[gRPC CLIENT INFO] In-flight budget: " << benchmark_common::shared_inflight_budget().max_bytes()
+              << " bytes, " << benchmark_common::shared_inflight_budget().max_requests() << " requests." << std::endl;
+    // --write-batch / --write-flush-us: склейка записей; --write-batch-sweep-max: предел ее свипа.
+    // Пачка больше лимита запросов в полете никогда не наберется.
+    long long write_flush_us;
+    size_t write_batch;
+    size_t write_batch_sweep_max;
+    try {
+        write_flush_us = options.get_int("write-flush-us", benchmark_common::DEFAULT_GRPC_WRITE_FLUSH_US);
+        write_batch = options.get_size("write-batch", benchmark_common::DEFAULT_GRPC_WRITE_BATCH);
+        write_batch_sweep_max =
+            options.get_size("write-batch-sweep-max", benchmark_common::GRPC_WRITE_BATCH_SWEEP_MAX);
+    } catch (const std::exception& e) {
+        std::cerr << "[gRPC CLIENT ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    const size_t max_write_batch = benchmark_common::shared_inflight_budget().max_requests();
+    if (write_flush_us < 0) {
+        std::cerr << "[gRPC CLIENT ERROR] --write-flush-us must not be negative." << std::endl;
+        return 1;
+    }
+    if (write_batch == 0 || write_batch > max_write_batch) {
+        std::cerr << "[gRPC CLIENT ERROR] --write-batch must be between 1 and " << max_write_batch
+                  << " (--inflight-requests)." << std::endl;
+        return 1;
+    }
+    if (options.get_bool("write-batch-sweep", false) &&
+        (write_batch_sweep_max == 0 || write_batch_sweep_max > max_write_batch)) {
+        std::cerr << "[gRPC CLIENT ERROR] --write-batch-sweep-max must be between 1 and " << max_write_batch
+                  << " (--inflight-requests)." << std::endl;
+        return 1;
+    }
+    // --verify-threads: 0 - эхо-ответы сверяет поток чтения
+    size_t verify_threads;
+    try {
+        verify_threads = options.get_size("verify-threads", benchmark_common::DEFAULT_VERIFY_THREADS);
+    } catch (const std::exception& e) {
+        std::cerr << "[gRPC CLIENT ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    // --sweep-bytes: данных на точку любого свипа; --sweep-min/--sweep-max: размеры чанков
+    // в --sweep, --knee-tolerance-pct: насколько ниже максимума пропускной способности колено
+    size_t sweep_bytes;
+    size_t sweep_min_bytes;
+    size_t sweep_max_bytes;
+    long long knee_tolerance_pct;
+    try {
+        sweep_bytes = options.get_size("sweep-bytes", benchmark_common::SWEEP_BYTES_PER_POINT);
+        sweep_min_bytes = options.get_size("sweep-min", benchmark_common::SWEEP_MIN_CHUNK_BYTES);
+        sweep_max_bytes = options.get_size("sweep-max", benchmark_common::SWEEP_MAX_CHUNK_BYTES);
+        knee_tolerance_pct = options.get_int("knee-tolerance-pct", benchmark_common::SWEEP_KNEE_TOLERANCE_PCT);
+    } catch (const std::exception& e) {
+        std::cerr << "[gRPC CLIENT ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    if (sweep_bytes == 0 || sweep_min_bytes == 0 || sweep_min_bytes > sweep_max_bytes) {
+        std::cerr << "[gRPC CLIENT ERROR] --sweep-bytes and --sweep-min must be positive, --sweep-min at most --sweep-max."
+                  << std::endl;
+        return 1;
+    }
+    if (knee_tolerance_pct < 0 || knee_tolerance_pct > 100) {
+        std::cerr << "[gRPC CLIENT ERROR] --knee-tolerance-pct must be between 0 and 100." << std::endl;
+        return 1;
+    }
+    // --window-sweep-min/--window-sweep-max: окна HTTP/2 в --window-sweep (окно в gRPC - int)
+    size_t window_sweep_min_bytes;
+    size_t window_sweep_max_bytes;
+    try {
+        window_sweep_min_bytes = options.get_size("window-sweep-min", benchmark_common::HTTP2_WINDOW_SWEEP_MIN_BYTES);
+        window_sweep_max_bytes = options.get_size("window-sweep-max", benchmark_common::HTTP2_WINDOW_SWEEP_MAX_BYTES);
+    } catch (const std::exception& e) {
+        std::cerr << "[gRPC CLIENT ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    if (window_sweep_min_bytes == 0 || window_sweep_min_bytes > window_sweep_max_bytes ||
+        window_sweep_max_bytes > static_cast<size_t>(INT_MAX)) {
+        std::cerr << "[gRPC CLIENT ERROR] --window-sweep-min must be positive and at most --window-sweep-max, "
+                  << "--window-sweep-max at most " << INT_MAX << " bytes." << std::endl;
+        return 1;
+    }
+    // --progress-interval-ms (0 - без временного ряда) / --progress-window
+    long long progress_interval_ms;
+    long long progress_window_intervals;
+    try {
+        progress_interval_ms = options.get_int("progress-interval-ms", benchmark_common::DEFAULT_PROGRESS_INTERVAL_MS);
+        progress_window_intervals =
+            options.get_int("progress-window", benchmark_common::DEFAULT_PROGRESS_WINDOW_INTERVALS);
+    } catch (const std::exception& e) {
+        std::cerr << "[gRPC CLIENT ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    if (progress_interval_ms < 0 || progress_interval_ms > INT_MAX) {
+        std::cerr << "[gRPC CLIENT ERROR] --progress-interval-ms must be between 0 and " << INT_MAX << "." << std::endl;
+        return 1;
+    }
+    if (progress_window_intervals < 1 ||
+        progress_window_intervals > benchmark_common::MAX_PROGRESS_WINDOW_INTERVALS) {
+        std::cerr << "[gRPC CLIENT ERROR] --progress-window must be between 1 and "
+                  << benchmark_common::MAX_PROGRESS_WINDOW_INTERVALS << " intervals." << std::endl;
+        return 1;
+    }
+    const std::string server_target_address = (transport == benchmark_common::Transport::INPROC)
+        ? "in-process server"
+        : (transport == benchmark_common::Transport::UNIX)
+        ? "unix:" + options.get_string("socket-path", benchmark_common::GRPC_UNIX_SOCKET_PATH)
+        : benchmark_common::GRPC_SERVER_ADDRESS + ":" + std::to_string(benchmark_common::GRPC_SERVER_PORT);
+    const std::string transport_name = benchmark_common::transport_to_string(transport);
     const std::string csv_file_prefix = benchmark_common::CSV_OUTPUT_FILE_PREFIX;
 
     bool generate_new_file = true;
@@ -353,17 +864,22 @@ int main(int argc, char** argv) {
     }
 
     if (generate_new_file) {
-        if (!benchmark_common::generate_test_file(test_filename, target_file_size_bytes)) {
+        if (!benchmark_common::generate_test_file(test_filename, target_file_size_bytes, content_profile)) {
             std::cerr << "[gRPC CLIENT ERROR] Failed to generate test file. Exiting." << std::endl;
             return 1;
         }
     }
 
+    const std::string metrics_name =
+        transport == benchmark_common::Transport::TCP ? "gRPC" : "gRPC-" + transport_name;
     benchmark_common::MetricsAggregator metrics(
-        "gRPC",
+        metrics_name,
         target_file_size_bytes,
         chunk_size_bytes
     );
+    metrics.set_run_parameter("socket_profile", benchmark_common::socket_tuning_to_string(socket_tuning));
+    metrics.set_run_parameter("http2", grpc_tuning::http2_tuning_to_string(http2_tuning));
+    metrics.set_run_parameter("mode", benchmark_common::workload_mode_to_string(workload_mode));
 
     ChannelArguments ch_args;
     ch_args.SetMaxReceiveMessageSize(-1);
@@ -373,14 +889,212 @@ int main(int argc, char** argv) {
     ch_args.SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
     ch_args.SetInt(GRPC_ARG_HTTP2_MAX_PINGS_WITHOUT_DATA, 0);
     ch_args.SetInt(GRPC_ARG_HTTP2_MIN_RECV_PING_INTERVAL_WITHOUT_DATA_MS, 10000);
+    std::cout << "[gRPC CLIENT INFO] HTTP/2 flow control: " << grpc_tuning::http2_tuning_to_string(http2_tuning)
+              << std::endl;
+    if (compression != GRPC_COMPRESS_NONE) {
+        ch_args.SetCompressionAlgorithm(compression);
+        std::cout << "[gRPC CLIENT INFO] Message compression: " << options.get_string("compression", "none")
+                  << ", content profile: " << benchmark_common::content_profile_to_string(content_profile) << std::endl;
+    }
 
-    std::shared_ptr<Channel> channel = grpc::CreateCustomChannel(
-        server_target_address, grpc::InsecureChannelCredentials(), ch_args);
+    std::string csv_transport_suffix = (transport == benchmark_common::Transport::TCP) ? "" : "_" + transport_name;
+    if (compression != GRPC_COMPRESS_NONE) {
+        csv_transport_suffix += "_" + options.get_string("compression", "none") + "_"
+                              + benchmark_common::content_profile_to_string(content_profile);
+    }
+    if (workload_mode != benchmark_common::WorkloadMode::ECHO) {
+        csv_transport_suffix += "_" + benchmark_common::workload_mode_to_string(workload_mode);
+        std::cout << "[gRPC CLIENT INFO] Workload mode: " << benchmark_common::workload_mode_to_string(workload_mode)
+                  << std::endl;
+    }
+
+    // ch_args без окон HTTP/2 остаются основой для --window-sweep
+    ChannelArguments tuned_args = ch_args;
+    grpc_tuning::apply_http2_tuning(tuned_args, http2_tuning);
+
+    if (options.get_bool("socket-sweep", false)) {
+        // Новое соединение на каждый профиль сокета; сервер работает со своим --socket-profile
+        std::vector<benchmark_common::LabeledSweepPoint> points;
+        for (const std::string& preset : benchmark_common::socket_tuning_sweep_presets()) {
+            benchmark_common::SocketTuning point_tuning = benchmark_common::socket_tuning_preset(preset);
+            std::cout << "[gRPC CLIENT INFO] Socket sweep: " << benchmark_common::socket_tuning_to_string(point_tuning)
+                      << std::endl;
+            benchmark_common::MetricsAggregator point_metrics(metrics_name, sweep_bytes, chunk_size_bytes);
+            std::shared_ptr<Channel> point_channel =
+                CreateBenchmarkChannel(server_target_address, transport, point_tuning, tuned_args);
+            if (!point_channel) {
+                point_metrics.log_error("gRPC Client (socket sweep): failed to connect");
+            } else {
+                try {
+                    GrpcFileClient point_client(point_channel, workload_mode);
+                    point_client.ProcessFile(test_filename, chunk_size_bytes, point_metrics, sweep_bytes);
+                } catch (const std::exception& e) {
+                    point_metrics.log_error(std::string("gRPC Client (socket sweep): Exception caught: ") + e.what());
+                }
+            }
+            benchmark_common::LabeledSweepPoint point;
+            point.label = preset;
+            point.result.chunk_size_bytes = chunk_size_bytes;
+            point.result.throughput_mbps = point_metrics.get_throughput_payload_mbps();
+            point.result.avg_rtt_ms = point_metrics.get_avg_chunk_rtt_ms();
+            point.result.p99_rtt_ms = point_metrics.get_percentile_chunk_rtt_ms(99.0);
+            point.result.errors = point_metrics.get_error_count();
+            points.push_back(point);
+        }
+        benchmark_common::print_labeled_sweep_report("Socket Profile Sweep", metrics_name, points);
+        benchmark_common::save_labeled_sweep_csv(csv_file_prefix + "grpc" + csv_transport_suffix + "_socket_sweep.csv",
+                                                 metrics_name, points);
+        std::cout << "[gRPC CLIENT INFO] gRPC client finished." << std::endl;
+        return 0;
+    }
+
+    if (options.get_bool("window-sweep", false)) {
+        // Пропускная способность от окна HTTP/2: новый канал с фиксированным окном (без BDP-проб)
+        // на каждую точку. Сервер запускается с окном не меньше --window-sweep-max, иначе
+        // поток запросов ограничит его окно, а не клиентское.
+        std::vector<benchmark_common::LabeledSweepPoint> points;
+        for (size_t window : benchmark_common::sweep_chunk_sizes(window_sweep_min_bytes, window_sweep_max_bytes)) {
+            grpc_tuning::Http2Tuning point_tuning = grpc_tuning::http2_fixed_window(static_cast<int>(window));
+            std::cout << "[gRPC CLIENT INFO] Window sweep: " << grpc_tuning::http2_tuning_to_string(point_tuning)
+                      << std::endl;
+            benchmark_common::MetricsAggregator point_metrics(metrics_name, sweep_bytes, chunk_size_bytes);
+            ChannelArguments point_args = ch_args;
+            grpc_tuning::apply_http2_tuning(point_args, point_tuning);
+            std::shared_ptr<Channel> point_channel =
+                CreateBenchmarkChannel(server_target_address, transport, socket_tuning, point_args);
+            if (!point_channel) {
+                point_metrics.log_error("gRPC Client (window sweep): failed to connect");
+            } else {
+                try {
+                    GrpcFileClient point_client(point_channel, workload_mode);
+                    point_client.ProcessFile(test_filename, chunk_size_bytes, point_metrics, sweep_bytes);
+                } catch (const std::exception& e) {
+                    point_metrics.log_error(std::string("gRPC Client (window sweep): Exception caught: ") + e.what());
+                }
+            }
+            benchmark_common::LabeledSweepPoint point;
+            point.label = std::to_string(window / 1024) + "K";
+            point.result.chunk_size_bytes = chunk_size_bytes;
+            point.result.throughput_mbps = point_metrics.get_throughput_payload_mbps();
+            point.result.avg_rtt_ms = point_metrics.get_avg_chunk_rtt_ms();
+            point.result.p99_rtt_ms = point_metrics.get_percentile_chunk_rtt_ms(99.0);
+            point.result.errors = point_metrics.get_error_count();
+            points.push_back(point);
+        }
+        benchmark_common::print_labeled_sweep_report("HTTP/2 Window Sweep", metrics_name, points);
+        benchmark_common::save_labeled_sweep_csv(csv_file_prefix + "grpc" + csv_transport_suffix + "_window_sweep.csv",
+                                                 metrics_name, points);
+        std::cout << "[gRPC CLIENT INFO] gRPC client finished." << std::endl;
+        return 0;
+    }
+
+    // Сервер в процессе (--transport=inproc) живет дольше канала и клиента; в download он отдает
+    // --download-file, как и grpc_server
+    std::unique_ptr<InProcessServer> inproc_server;
+    if (transport == benchmark_common::Transport::INPROC) {
+        inproc_server = std::make_unique<InProcessServer>(
+            options.get_string("download-file", benchmark_common::TEST_FILE_NAME));
+    }
+    std::shared_ptr<Channel> channel =
+        inproc_server ? inproc_server->CreateChannel(tuned_args)
+                      : CreateBenchmarkChannel(server_target_address, transport, socket_tuning, tuned_args);
+    if (!channel) {
+        std::cerr << "[gRPC CLIENT ERROR] Could not open a channel to " << server_target_address << std::endl;
+        return 1;
+    }
 
     std::cout << "[gRPC CLIENT INFO] Attempting to connect to " << server_target_address << std::endl;
 
-    GrpcFileClient grpc_client_instance(channel);
+    GrpcFileClient grpc_client_instance(channel, workload_mode);
+    benchmark_common::TraceCollector trace_collector(metrics_name);
+    const bool trace_enabled = options.get_bool("trace", false) &&
+                               workload_mode != benchmark_common::WorkloadMode::DOWNLOAD;
+    if (trace_enabled) {
+        grpc_client_instance.set_trace_collector(&trace_collector);
+        std::cout << "[gRPC CLIENT INFO] Per-stage latency tracing enabled." << std::endl;
+    }
+
+    const std::chrono::microseconds write_flush_after(write_flush_us);
+    grpc_client_instance.set_write_coalescing(write_batch, write_flush_after);
+    grpc_client_instance.set_verify_threads(verify_threads);
+    if (options.get_bool("adaptive-window", false)) {
+        try {
+            grpc_client_instance.set_adaptive_window(benchmark_common::adaptive_window_options_from_options(
+                options, benchmark_common::shared_inflight_budget().max_requests()));
+        } catch (const std::exception& e) {
+            std::cerr << "[gRPC CLIENT ERROR] " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "[gRPC CLIENT INFO] Adaptive in-flight window enabled." << std::endl;
+    }
+    if (write_batch > 1) {
+        std::cout << "[gRPC CLIENT INFO] Write coalescing: up to " << write_batch << " messages per flush, "
+                  << write_flush_after.count() << " us max hold." << std::endl;
+    }
 
+    if (options.get_bool("write-batch-sweep", false)) {
+        // Пропускная способность против хвостовой задержки при склейке записей: новый поток на
+        // каждый размер пачки, 1 - без склейки как базовая точка
+        std::vector<benchmark_common::LabeledSweepPoint> points;
+        for (size_t batch = 1; batch <= write_batch_sweep_max; batch *= 2) {
+            std::cout << "[gRPC CLIENT INFO] Write batch sweep: batch " << batch << std::endl;
+            grpc_client_instance.set_write_coalescing(batch, write_flush_after);
+            benchmark_common::MetricsAggregator point_metrics(metrics_name, sweep_bytes, chunk_size_bytes);
+            try {
+                grpc_client_instance.ProcessFile(test_filename, chunk_size_bytes, point_metrics, sweep_bytes);
+            } catch (const std::exception& e) {
+                point_metrics.log_error(std::string("gRPC Client (write batch sweep): Exception caught: ") + e.what());
+            }
+            benchmark_common::LabeledSweepPoint point;
+            point.label = "batch" + std::to_string(batch);
+            point.result.chunk_size_bytes = chunk_size_bytes;
+            point.result.throughput_mbps = point_metrics.get_throughput_payload_mbps();
+            point.result.avg_rtt_ms = point_metrics.get_avg_chunk_rtt_ms();
+            point.result.p99_rtt_ms = point_metrics.get_percentile_chunk_rtt_ms(99.0);
+            point.result.errors = point_metrics.get_error_count();
+            points.push_back(point);
+        }
+        benchmark_common::print_labeled_sweep_report("gRPC Write Coalescing Sweep", metrics_name, points);
+        benchmark_common::save_labeled_sweep_csv(csv_file_prefix + "grpc" + csv_transport_suffix + "_write_batch_sweep.csv",
+                                                 metrics_name, points);
+        std::cout << "[gRPC CLIENT INFO] gRPC client finished." << std::endl;
+        return 0;
+    }
+
+    if (options.get_bool("sweep", false)) {
+        // Один и тот же канал, новый поток на каждый размер чанка
+        std::vector<benchmark_common::SweepPoint> points;
+        for (size_t sweep_chunk : benchmark_common::sweep_chunk_sizes(sweep_min_bytes, sweep_max_bytes)) {
+            std::cout << "[gRPC CLIENT INFO] Sweep: chunk size " << sweep_chunk << " bytes." << std::endl;
+            benchmark_common::MetricsAggregator point_metrics(metrics_name, sweep_bytes, sweep_chunk);
+            try {
+                grpc_client_instance.ProcessFile(test_filename, sweep_chunk, point_metrics, sweep_bytes);
+            } catch (const std::exception& e) {
+                point_metrics.log_error(std::string("gRPC Client (sweep): Exception caught: ") + e.what());
+            }
+            benchmark_common::SweepPoint point;
+            point.chunk_size_bytes = sweep_chunk;
+            point.throughput_mbps = point_metrics.get_throughput_payload_mbps();
+            point.avg_rtt_ms = point_metrics.get_avg_chunk_rtt_ms();
+            point.p99_rtt_ms = point_metrics.get_percentile_chunk_rtt_ms(99.0);
+            point.errors = point_metrics.get_error_count();
+            points.push_back(point);
+        }
+        size_t knee = benchmark_common::find_throughput_knee(
+            points, knee_tolerance_pct / 100.0);
+        benchmark_common::print_sweep_report(metrics_name, points, knee);
+        benchmark_common::save_sweep_csv(csv_file_prefix + "grpc" + csv_transport_suffix + "_sweep.csv",
+                                         metrics_name, points, knee);
+        std::cout << "[gRPC CLIENT INFO] gRPC client finished." << std::endl;
+        return 0;
+    }
+
+    // --event-trace=файл.json: трасса потоков писателя и читателя за основной прогон
+    benchmark_common::start_event_trace(options.get_string("event-trace", ""));
+    // --progress-interval-ms / --progress-window: временной ряд пропускной способности и p99
+    grpc_client_instance.progress().start(
+        static_cast<int>(progress_interval_ms), static_cast<int>(progress_window_intervals),
+        csv_file_prefix + "grpc" + csv_transport_suffix + "_progress.csv");
     try {
         grpc_client_instance.ProcessFile(
             test_filename,
@@ -397,9 +1111,18 @@ int main(int argc, char** argv) {
         metrics.log_error(error_msg);
     }
 
+    grpc_client_instance.progress().stop();
+    benchmark_common::stop_event_trace();
     metrics.print_summary_to_console();
-    metrics.save_summary_csv(csv_file_prefix + "grpc_summary.csv");
-    metrics.save_detailed_rtt_csv(csv_file_prefix + "grpc_detailed_rtt.csv");
+    metrics.save_summary_csv(csv_file_prefix + "grpc" + csv_transport_suffix + "_summary.csv");
+    metrics.save_detailed_rtt_csv(csv_file_prefix + "grpc" + csv_transport_suffix + "_detailed_rtt.csv");
+    if (trace_enabled) {
+        trace_collector.print_summary();
+        trace_collector.save_csv(csv_file_prefix + "grpc" + csv_transport_suffix + "_trace.csv");
+    }
+    if (grpc_client_instance.adaptive_window()) {
+        grpc_client_instance.adaptive_window()->save_csv(csv_file_prefix + "grpc" + csv_transport_suffix + "_window.csv");
+    }
 
     std::cout << "[gRPC CLIENT INFO] gRPC client finished." << std::endl;
     return 0;
@@ -3,12 +3,14 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <thread>     // Не используется в этом простом сервере, но может быть в будущем
+#include <chrono>
+#include <thread>     // Поток приема соединений для профиля сокета (--socket-profile)
 #include <algorithm>  // Для std::reverse (если бы использовался напрямую)
 #include <iomanip>    // Для std::hex, std::setw, std::setfill (для отладочного вывода)
 
 #include <grpcpp/grpcpp.h>
 #include <grpcpp/health_check_service_interface.h>
+#include <grpcpp/server_posix.h> // AddInsecureChannelFromFd
 // Попытка включить заголовок для старого API рефлексии
 // Если этот файл не найден, или класс ProtoServerReflectionPlugin не найден,
 // то ваша версия gRPC может использовать другой механизм.
@@ -19,7 +21,18 @@
 
 // Общие утилиты (пути от корня проекта)
 #include "common/include/config.hpp"
-#include "common/include/reversal_utils.hpp"
+#include "common/include/cli_options.hpp"
+#include "common/include/file_utils.hpp"
+#include "common/include/socket_tuning.hpp"
+#include "common/include/server_stats.hpp"
+#include "common/include/progress_reporter.hpp"
+#include "common/include/event_tracer.hpp"
+#include "common/include/worker_pool.hpp"
+#include "grpc_app/grpc_service.hpp"
+#include "grpc_app/grpc_tuning.hpp"
+
+#include <cstdio> // Для std::remove (удаление устаревшего файла сокета)
+#include <sys/socket.h> // accept()
 
 #ifndef UNUSED_PARAM
 #define UNUSED_PARAM(x) (void)(x)
@@ -28,12 +41,6 @@
 // Используем пространства имен из сгенерированного proto файла и gRPC
 using grpc::Server;
 using grpc::ServerBuilder;
-using grpc::ServerContext;
-using grpc::ServerReaderWriter;
-using grpc::Status;
-using benchmark_grpc::ChunkRequest;
-using benchmark_grpc::ChunkResponse;
-using benchmark_grpc::FileProcessor;
 
 // Вспомогательная функция для вывода HEX-дампа (для отладки на сервере)
 void print_server_hex_data_debug(const std::string& title, const std::vector<char>& data, size_t count = 32) {
@@ -47,53 +54,82 @@ void print_server_hex_data_debug(const std::string& title, const std::vector<cha
     */
 }
 
-// Реализация сервиса FileProcessor
-class FileProcessorServiceImpl final : public FileProcessor::Service {
-public:
-    Status ProcessFileChunks(ServerContext* context,
-                             ServerReaderWriter<ChunkResponse, ChunkRequest>* stream) override {
-        UNUSED_PARAM(context); // Контекст может использоваться для метаданных, отмены и т.д.
-
-        std::cout << "[gRPC SERVER INFO] Client connection established. Starting to process chunks." << std::endl;
-        ChunkRequest request;
-        long long server_processed_chunk_count = 0;
-
-        // Цикл чтения запросов от клиента
-        while (stream->Read(&request)) {
-            // server_processed_chunk_count++; // Этот счетчик теперь не так важен для ответа
-
-            long long client_id_from_request = request.client_assigned_chunk_id(); // Получаем ID от клиента
-
-            if (server_processed_chunk_count % 500 == 0 || server_processed_chunk_count == 1 || client_id_from_request % 500 == 0) {
-                 std::cout << "[gRPC SERVER PROGRESS] Received client_id: " << client_id_from_request
-                           << ", size: " << request.data_chunk().length() << " bytes." << std::endl;
-            }
-            server_processed_chunk_count++; // Все еще считаем для логов сервера
-
-
-            const std::string& chunk_str_data = request.data_chunk();
-            std::vector<char> chunk_vec_data(chunk_str_data.begin(), chunk_str_data.end());
-            benchmark_common::reverse_bytes(chunk_vec_data);
-
-            ChunkResponse response;
-            response.set_reversed_chunk_data(chunk_vec_data.data(), chunk_vec_data.size());
-            response.set_original_client_chunk_id(client_id_from_request); // Возвращаем ID клиента
-            // Отправка ответа клиенту
-            if (!stream->Write(response)) {
-                std::cerr << "[gRPC SERVER ERROR] Failed to write response to stream for server_id " << server_processed_chunk_count << "." << std::endl;
-                return Status(grpc::StatusCode::UNKNOWN, "Server failed to write response to stream.");
-            }
+// Принимает TCP-соединения сам, применяет профиль сокета к каждому и отдает дескриптор серверу
+// gRPC. Используется вместо AddListeningPort, когда профиль не default: сам gRPC не выставляет
+// SO_SNDBUF/SO_RCVBUF/TCP_QUICKACK/SO_BUSY_POLL. Работает, пока жив процесс (как и server->Wait()).
+static void AcceptTunedConnections(Server* server, int listen_fd, benchmark_common::SocketTuning tuning) {
+    while (true) {
+        int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            std::cerr << "[gRPC SERVER ERROR] accept() failed, stopping tuned listener." << std::endl;
+            return;
         }
-
-        std::cout << "[gRPC SERVER INFO] Client finished streaming or stream broken. Total chunks processed in this session: " << server_processed_chunk_count << "." << std::endl;
-        return Status::OK; // Сигнализируем об успешном завершении RPC
+        // TCP_QUICKACK и SO_BUSY_POLL от слушающего сокета не наследуются
+        benchmark_common::apply_socket_tuning(fd, tuning, "[gRPC SERVER WARNING]");
+        grpc::AddInsecureChannelFromFd(server, fd);
+        std::cout << "[gRPC SERVER INFO] Accepted tuned connection (fd " << fd << ")." << std::endl;
     }
-};
+}
 
 // Функция запуска сервера
-void RunServer() {
+void RunServer(const benchmark_common::CliOptions& options) {
+    benchmark_common::Transport transport = benchmark_common::transport_from_string(
+        options.get_string("transport", benchmark_common::DEFAULT_TRANSPORT));
+    if (transport == benchmark_common::Transport::SHM) {
+        std::cerr << "[gRPC SERVER ERROR] Transport 'shm' is only supported by the Cap'n Proto path." << std::endl;
+        return;
+    }
+    if (transport == benchmark_common::Transport::INPROC) {
+        std::cerr << "[gRPC SERVER ERROR] Transport 'inproc' runs the server inside the client "
+                     "(grpc_client --transport=inproc)." << std::endl;
+        return;
+    }
+
     std::string server_address = benchmark_common::GRPC_SERVER_ADDRESS + ":" + std::to_string(benchmark_common::GRPC_SERVER_PORT);
-    FileProcessorServiceImpl service_impl; // Экземпляр нашей реализации сервиса
+    if (transport == benchmark_common::Transport::UNIX) {
+        std::string socket_path = options.get_string("socket-path", benchmark_common::GRPC_UNIX_SOCKET_PATH);
+        std::remove(socket_path.c_str()); // Файл от предыдущего запуска помешает bind()
+        server_address = "unix:" + socket_path;
+    }
+    // Метрики этапов обработки: итог после каждого прогона, --stats-interval=N - еще и каждые N секунд
+    benchmark_common::ServerStats stats("gRPC", "grpc_server_stats.csv");
+    // --event-trace=файл.json: трасса потоков, сохраняется вместе с отчетом после каждого прогона
+    benchmark_common::start_event_trace(options.get_string("event-trace", ""));
+    stats.start_periodic_dump(static_cast<int>(
+        options.get_int("stats-interval", benchmark_common::DEFAULT_SERVER_STATS_INTERVAL_S)));
+
+    // Экземпляр нашей реализации сервиса; в режиме download отдает --download-file
+    // Ход обработки во времени (--progress-interval-ms, --progress-window); ряд дописывается в CSV
+    // до остановки сервера, интервалы простоя пропускаются
+    benchmark_common::ProgressReporter progress("gRPC server");
+    progress.start(
+        static_cast<int>(options.get_int("progress-interval-ms", benchmark_common::DEFAULT_PROGRESS_INTERVAL_MS)),
+        static_cast<int>(options.get_int("progress-window", benchmark_common::DEFAULT_PROGRESS_WINDOW_INTERVALS)),
+        "grpc_server_progress.csv");
+
+    FileProcessorServiceImpl service_impl(options.get_string("download-file", benchmark_common::TEST_FILE_NAME), stats,
+                                          progress);
+
+    // --parallel-chunks=N: реверс чанков в пуле из N потоков, ответы пишутся по мере готовности;
+    // --response-order=unordered|ordered, --parallel-inflight - чанков одного потока в пуле.
+    // Пул общий для всех соединений и живет дольше сервера.
+    const size_t parallel_chunks = options.get_size("parallel-chunks", benchmark_common::DEFAULT_SERVER_PARALLEL_CHUNKS);
+    std::unique_ptr<benchmark_common::WorkerPool> chunk_pool;
+    if (parallel_chunks > 0) {
+        const std::string response_order = options.get_string("response-order", "unordered");
+        const size_t parallel_inflight =
+            options.get_size("parallel-inflight", benchmark_common::DEFAULT_SERVER_PARALLEL_INFLIGHT);
+        if ((response_order != "ordered" && response_order != "unordered") || parallel_inflight == 0) {
+            std::cerr << "[gRPC SERVER ERROR] --response-order must be 'ordered' or 'unordered' and "
+                         "--parallel-inflight must be positive." << std::endl;
+            return;
+        }
+        chunk_pool = std::make_unique<benchmark_common::WorkerPool>(
+            parallel_chunks, benchmark_common::SERVER_WORKER_QUEUE_CAPACITY, "grpc-chunk-worker");
+        service_impl.EnableParallelChunks(chunk_pool.get(), parallel_inflight, response_order == "ordered");
+        std::cout << "[gRPC SERVER INFO] Parallel chunks: " << parallel_chunks << " worker threads, up to "
+                  << parallel_inflight << " chunks per stream, " << response_order << " responses." << std::endl;
+    }
 
     // Включаем стандартный сервис проверки состояния (health checking)
     grpc::EnableDefaultHealthCheckService(true);
@@ -113,8 +149,31 @@ void RunServer() {
     builder.SetMaxReceiveMessageSize(-1);
     builder.SetMaxSendMessageSize(-1);
 
-    // Добавляем порт для прослушивания без шифрования
-    builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
+    // Профиль сокета (--socket-profile, --nodelay, --sndbuf, ...): только для tcp
+    benchmark_common::SocketTuning socket_tuning = benchmark_common::socket_tuning_from_options(options);
+    const bool tuned_tcp = transport == benchmark_common::Transport::TCP && !socket_tuning.is_default();
+    grpc_tuning::apply_socket_tuning(builder, socket_tuning);
+    std::cout << "[gRPC SERVER INFO] Socket profile: " << benchmark_common::socket_tuning_to_string(socket_tuning)
+              << std::endl;
+
+    // Окна HTTP/2 (--http2-profile, --http2-window, ...): окно сервера ограничивает поток запросов.
+    // Для --window-sweep клиента сервер должен объявлять окно не меньше наибольшего в прогоне.
+    grpc_tuning::Http2Tuning http2_tuning = grpc_tuning::http2_tuning_from_options(options);
+    grpc_tuning::apply_http2_tuning(builder, http2_tuning);
+    std::cout << "[gRPC SERVER INFO] HTTP/2 flow control: " << grpc_tuning::http2_tuning_to_string(http2_tuning)
+              << std::endl;
+
+    // Сжатие ответов (клиент объявляет поддерживаемые алгоритмы сам, запросы распаковываются автоматически)
+    grpc_compression_algorithm compression = grpc_tuning::compression_from_string(options.get_string("compression", "none"));
+    if (compression != GRPC_COMPRESS_NONE) {
+        builder.SetDefaultCompressionAlgorithm(compression);
+        std::cout << "[gRPC SERVER INFO] Response compression: " << options.get_string("compression", "none") << std::endl;
+    }
+
+    // Добавляем порт для прослушивания без шифрования (с профилем сокета соединения принимаются вручную)
+    if (!tuned_tcp) {
+        builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
+    }
 
     // Регистрируем нашу реализацию сервиса
     builder.RegisterService(&service_impl);
@@ -126,6 +185,16 @@ void RunServer() {
         std::cerr << "[gRPC SERVER ERROR] Failed to build or start server on " << server_address << "." << std::endl;
         return;
     }
+    if (tuned_tcp) {
+        int listen_fd = benchmark_common::listen_tuned_tcp_socket(
+            benchmark_common::GRPC_SERVER_ADDRESS, benchmark_common::GRPC_SERVER_PORT, socket_tuning,
+            "[gRPC SERVER ERROR]");
+        if (listen_fd < 0) {
+            server->Shutdown();
+            return;
+        }
+        std::thread(AcceptTunedConnections, server.get(), listen_fd, socket_tuning).detach();
+    }
     std::cout << "[gRPC SERVER INFO] Server listening on " << server_address << "." << std::endl;
     std::cout << "[gRPC SERVER INFO] Reflection service hopefully enabled (via static plugin instance)." << std::endl;
 
@@ -135,11 +204,14 @@ void RunServer() {
 }
 
 int main(int argc, char** argv) {
-    UNUSED_PARAM(argc);
-    UNUSED_PARAM(argv);
-
     std::cout << "[gRPC SERVER INFO] Server process starting..." << std::endl;
-    RunServer(); // Запускаем сервер
+    try {
+        benchmark_common::CliOptions options(argc, argv);
+        RunServer(options); // Запускаем сервер
+    } catch (const std::exception& e) {
+        std::cerr << "[gRPC SERVER ERROR] " << e.what() << std::endl;
+        return 1;
+    }
     std::cout << "[gRPC SERVER INFO] Server process shut down." << std::endl;
     return 0;
 }
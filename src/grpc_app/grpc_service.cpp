@@ -0,0 +1,391 @@
+// grpc_app/grpc_service.cpp
+#include "grpc_app/grpc_service.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/include/alloc_counter.hpp"
+#include "common/include/event_tracer.hpp"
+#include "common/include/file_utils.hpp"
+#include "common/include/latency_trace.hpp"
+#include "common/include/reversal_utils.hpp"
+#include "common/include/workload.hpp"
+
+#ifndef UNUSED_PARAM
+#define UNUSED_PARAM(x) (void)(x)
+#endif
+
+using grpc::ServerContext;
+using grpc::ServerReaderWriter;
+using grpc::Status;
+using benchmark_grpc::ChunkRequest;
+using benchmark_grpc::ChunkResponse;
+
+namespace {
+
+// Строит ответ на запрос echo/upload в response (переиспользуется между запросами) и размечает
+// этапы deserialize/reverse/serialize. Возвращает размер ответа в байтах; отметку server_send_ns
+// (--trace у клиента) ставит тот, кто пишет ответ.
+size_t BuildChunkResponse(const ChunkRequest& request, int64_t recv_ns,
+                          benchmark_common::RequestTiming& timing, ChunkResponse& response) {
+    const std::string& chunk_str_data = request.data_chunk();
+    int64_t process_done_ns = 0;
+    if (request.mode() == benchmark_grpc::WORKLOAD_UPLOAD) {
+        // Только подтверждение: обратное направление почти пустое
+        const uint32_t checksum = benchmark_common::chunk_checksum(chunk_str_data.data(), chunk_str_data.size());
+        timing.lap(benchmark_common::ServerStage::REVERSE);
+        process_done_ns = benchmark_common::trace_now_ns();
+        response.clear_reversed_chunk_data();
+        response.set_payload_bytes(static_cast<long long>(chunk_str_data.size()));
+        response.set_checksum(checksum);
+    } else {
+        // Переворот сразу в поле ответа: без промежуточного вектора, resize в пределах
+        // емкости строки не выделяет память
+        timing.lap(benchmark_common::ServerStage::DESERIALIZE);
+        std::string& reversed = *response.mutable_reversed_chunk_data();
+        reversed.resize(chunk_str_data.size());
+        benchmark_common::reverse_copy_bytes(chunk_str_data.data(), chunk_str_data.size(), &reversed[0]);
+        timing.lap(benchmark_common::ServerStage::REVERSE);
+        process_done_ns = benchmark_common::trace_now_ns();
+        response.clear_payload_bytes();
+        response.clear_checksum();
+    }
+    // --trace у клиента: отметки запроса возвращаются в ответе вместе с серверными
+    if (!request.has_trace()) {
+        response.clear_trace();
+    } else {
+        benchmark_grpc::TraceTimestamps* trace = response.mutable_trace();
+        trace->set_client_send_ns(request.trace().client_send_ns());
+        trace->set_server_recv_ns(recv_ns);
+        trace->set_server_process_done_ns(process_done_ns);
+    }
+    response.set_original_client_chunk_id(request.client_assigned_chunk_id()); // Возвращаем ID клиента
+    const size_t response_bytes = response.ByteSizeLong();
+    timing.lap(benchmark_common::ServerStage::SERIALIZE);
+    return response_bytes;
+}
+
+// Чанки одного потока, которые обрабатывает пул (--parallel-chunks=N). Поток обработчика только
+// читает запросы в свободные ячейки и отдает их пулу; рабочий строит ответ и сам его пишет.
+// Запись сериализована мьютексом: синхронный API допускает одну Write() за раз (параллельно
+// с Read() обработчика). ordered - ответы уходят в порядке запросов: готовый ответ ждет в
+// кольце, пока не запишутся предыдущие, и их дописывает рабочий, закончивший последним.
+// unordered - ответ уходит, как только готов: клиент сопоставляет ответы по client_assigned_chunk_id.
+// Ячеек (--parallel-inflight) не больше, чем мест в кольце, поэтому номера в кольце не сталкиваются.
+class ParallelChunkStream {
+public:
+    struct Slot {
+        ChunkRequest request;   // Переиспользуются, как и в обработке в потоке соединения
+        ChunkResponse response;
+        benchmark_common::RequestTiming timing;
+        int64_t recv_ns = 0;
+        uint64_t sequence = 0;
+        size_t response_bytes = 0;
+    };
+
+    ParallelChunkStream(ServerReaderWriter<ChunkResponse, ChunkRequest>* stream, benchmark_common::WorkerPool& pool,
+                        size_t inflight, bool ordered, benchmark_common::ServerStats& stats,
+                        benchmark_common::ProgressReporter& progress)
+        : stream_(stream), pool_(pool), ordered_(ordered), stats_(stats), progress_(progress),
+          reorder_(inflight, nullptr) {
+        for (size_t i = 0; i < inflight; ++i) {
+            slots_.push_back(std::make_unique<Slot>());
+            free_slots_.push_back(slots_.back().get());
+        }
+    }
+    // Рабочие ссылаются на поток и ячейки, поэтому объект живет, пока пул не вернет все чанки
+    ~ParallelChunkStream() { drain(); }
+
+    ParallelChunkStream(const ParallelChunkStream&) = delete;
+    ParallelChunkStream& operator=(const ParallelChunkStream&) = delete;
+
+    // Свободная ячейка; если все у пула - ждет, пока какой-нибудь ответ не будет записан.
+    Slot* acquire_slot() {
+        std::unique_lock<std::mutex> lock(slots_mutex_);
+        slots_cv_.wait(lock, [this] { return !free_slots_.empty(); });
+        Slot* slot = free_slots_.back();
+        free_slots_.pop_back();
+        return slot;
+    }
+
+    // Ячейка, которая не отдавалась пулу (поток закрыт, запрос download).
+    void release_slot(Slot* slot) {
+        std::lock_guard<std::mutex> lock(slots_mutex_);
+        free_slots_.push_back(slot);
+    }
+
+    // Отдает пулу запрос, прочитанный в ячейку.
+    void submit(Slot* slot, int64_t recv_ns) {
+        slot->recv_ns = recv_ns;
+        slot->sequence = next_sequence_++;
+        slot->timing = benchmark_common::RequestTiming();
+        slot->timing.start();
+        {
+            std::lock_guard<std::mutex> lock(slots_mutex_);
+            in_pool_++;
+        }
+        progress_.on_sent();
+        pool_.submit([this, slot] { Process(slot); });
+    }
+
+    // Ждет, пока все отданные пулу чанки не будут записаны (или отброшены после ошибки записи).
+    void drain() {
+        std::unique_lock<std::mutex> lock(slots_mutex_);
+        slots_cv_.wait(lock, [this] { return in_pool_ == 0; });
+    }
+
+    bool failed() const { return failed_.load(std::memory_order_acquire); }
+    long long buffered_responses() const { return buffered_responses_.load(std::memory_order_relaxed); }
+
+private:
+    // В рабочем потоке пула.
+    void Process(Slot* slot) {
+        {
+            BENCHMARK_TRACE_SCOPE("handle_chunk", "grpc_server");
+            slot->timing.lap(benchmark_common::ServerStage::QUEUE_WAIT);
+            slot->response_bytes = BuildChunkResponse(slot->request, slot->recv_ns, slot->timing, slot->response);
+        }
+        // Ожидание записи (мьютекс и, в ordered, очередь предыдущих ответов) относится к этапу write
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        if (!ordered_) {
+            WriteLocked(slot);
+            return;
+        }
+        reorder_[slot->sequence % reorder_.size()] = slot;
+        // Дописываем все готовые подряд, начиная с первого незаписанного
+        while (Slot* next = reorder_[next_to_write_ % reorder_.size()]) {
+            reorder_[next_to_write_ % reorder_.size()] = nullptr;
+            next_to_write_++;
+            WriteLocked(next);
+        }
+    }
+
+    // Под write_mutex_: пишет ответ ячейки и возвращает ячейку обработчику.
+    void WriteLocked(Slot* slot) {
+        if (!failed()) {
+            grpc::WriteOptions write_options;
+            // Придержанный клиентом запрос (--write-batch): в unordered его ответ может уйти после
+            // ответа, закрывающего пачку, и застрять в буфере, поэтому подсказка - только в ordered
+            if (ordered_ && slot->request.buffered()) {
+                write_options.set_buffer_hint();
+                buffered_responses_.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (slot->response.has_trace()) {
+                slot->response.mutable_trace()->set_server_send_ns(benchmark_common::trace_now_ns());
+            }
+            bool written;
+            {
+                BENCHMARK_TRACE_SCOPE("write", "grpc_server");
+                written = stream_->Write(slot->response, write_options);
+            }
+            if (written) {
+                slot->timing.lap(benchmark_common::ServerStage::WRITE);
+                stats_.add_bytes_out(slot->response_bytes);
+                stats_.record(slot->timing);
+                progress_.on_completed(slot->request.data_chunk().size(),
+                                       (benchmark_common::trace_now_ns() - slot->recv_ns) / 1000);
+            } else {
+                std::cerr << "[gRPC SERVER ERROR] Failed to write response to stream for client_id "
+                          << slot->request.client_assigned_chunk_id() << "." << std::endl;
+                failed_.store(true, std::memory_order_release);
+            }
+        }
+        std::lock_guard<std::mutex> lock(slots_mutex_);
+        free_slots_.push_back(slot);
+        in_pool_--;
+        slots_cv_.notify_all();
+    }
+
+    ServerReaderWriter<ChunkResponse, ChunkRequest>* stream_;
+    benchmark_common::WorkerPool& pool_;
+    const bool ordered_;
+    benchmark_common::ServerStats& stats_;
+    benchmark_common::ProgressReporter& progress_;
+
+    std::vector<std::unique_ptr<Slot>> slots_;
+    std::mutex slots_mutex_;
+    std::condition_variable slots_cv_;
+    std::vector<Slot*> free_slots_; // Под slots_mutex_
+    size_t in_pool_ = 0;            // Под slots_mutex_
+    uint64_t next_sequence_ = 0;    // Только поток обработчика
+
+    std::mutex write_mutex_;
+    std::vector<Slot*> reorder_;    // Под write_mutex_: готовые ответы, ждущие очереди (ordered)
+    uint64_t next_to_write_ = 0;    // Под write_mutex_
+    std::atomic<bool> failed_{false};
+    std::atomic<long long> buffered_responses_{0};
+};
+
+} // namespace
+
+Status FileProcessorServiceImpl::ProcessFileChunks(ServerContext* context, Stream* stream) {
+    UNUSED_PARAM(context); // Контекст может использоваться для метаданных, отмены и т.д.
+
+    std::cout << "[gRPC SERVER INFO] Client connection established. Starting to process chunks." << std::endl;
+    benchmark_common::set_event_trace_thread_name("grpc-stream-handler");
+    benchmark_common::ScopedServerSession session(stats_);
+    long long server_processed_chunk_count = 0;
+    long long buffered_responses = 0;
+    const uint64_t heap_allocations_at_start = benchmark_common::heap_allocations();
+
+    Status status = pool_ ? ProcessChunksParallel(stream, server_processed_chunk_count, buffered_responses)
+                          : ProcessChunksInline(stream, server_processed_chunk_count, buffered_responses);
+    if (!status.ok()) return status;
+
+    std::cout << "[gRPC SERVER INFO] Client finished streaming or stream broken. Total chunks processed in this session: " << server_processed_chunk_count << "." << std::endl;
+    if (buffered_responses > 0) {
+        std::cout << "[gRPC SERVER INFO] Write coalescing: " << buffered_responses << " of "
+                  << server_processed_chunk_count << " responses held back for batching." << std::endl;
+    }
+    if (benchmark_common::heap_allocations_counted() && server_processed_chunk_count > 0) {
+        // Счетчик на весь процесс: параллельные сессии учитываются вместе
+        const uint64_t allocations = benchmark_common::heap_allocations() - heap_allocations_at_start;
+        std::cout << "[gRPC SERVER INFO] Heap allocations: " << allocations << " for "
+                  << server_processed_chunk_count << " chunks ("
+                  << static_cast<double>(allocations) / server_processed_chunk_count << " per chunk)" << std::endl;
+    }
+    return Status::OK; // Сигнализируем об успешном завершении RPC
+}
+
+// Чанк за чанком в потоке соединения: Read -> реверс -> Write.
+Status FileProcessorServiceImpl::ProcessChunksInline(Stream* stream, long long& server_processed_chunk_count,
+                                                     long long& buffered_responses) {
+    // Запрос и ответ переиспользуются на весь поток: строки полезной нагрузки сохраняют
+    // емкость, и в установившемся режиме чанк обходится без выделений памяти под protobuf
+    ChunkRequest request;
+    ChunkResponse response;
+
+    // Цикл чтения запросов от клиента. Синхронный API разбирает сообщение внутри Read(),
+    // который к тому же ждет следующий запрос, поэтому очередь и разбор protobuf не
+    // отделить от простоя: замеряется все, что после Read().
+    while (stream->Read(&request)) {
+        const int64_t recv_ns = benchmark_common::trace_now_ns();
+        stats_.add_bytes_in(request.ByteSizeLong());
+        server_processed_chunk_count++; // Все еще считаем для логов сервера
+
+        if (request.mode() == benchmark_grpc::WORKLOAD_DOWNLOAD) {
+            Status download_status = StreamDownload(request, stream);
+            if (!download_status.ok()) return download_status;
+            continue;
+        }
+
+        BENCHMARK_TRACE_SCOPE("handle_chunk", "grpc_server");
+        progress_.on_sent();
+        benchmark_common::RequestTiming timing;
+        timing.start();
+        const size_t response_bytes = BuildChunkResponse(request, recv_ns, timing, response);
+        if (response.has_trace()) response.mutable_trace()->set_server_send_ns(benchmark_common::trace_now_ns());
+        // Отправка ответа клиенту (сериализация protobuf происходит внутри Write()).
+        // Ответ на придержанный клиентом запрос (--write-batch) тоже придерживается: пачка
+        // ответов уходит вместе с ответом на запрос, которым клиент закрыл свою пачку
+        grpc::WriteOptions write_options;
+        if (request.buffered()) {
+            write_options.set_buffer_hint();
+            buffered_responses++;
+        }
+        bool written;
+        {
+            BENCHMARK_TRACE_SCOPE("write", "grpc_server");
+            written = stream->Write(response, write_options);
+        }
+        if (!written) {
+            std::cerr << "[gRPC SERVER ERROR] Failed to write response to stream for server_id " << server_processed_chunk_count << "." << std::endl;
+            return Status(grpc::StatusCode::UNKNOWN, "Server failed to write response to stream.");
+        }
+        timing.lap(benchmark_common::ServerStage::WRITE);
+        stats_.add_bytes_out(response_bytes);
+        stats_.record(timing);
+        progress_.on_completed(request.data_chunk().size(), (benchmark_common::trace_now_ns() - recv_ns) / 1000);
+    }
+    return Status::OK;
+}
+
+// --parallel-chunks: поток соединения только читает, реверс и запись ответов - в пуле.
+// Время от Read() до начала обработки рабочим идет в этап queue_wait.
+Status FileProcessorServiceImpl::ProcessChunksParallel(Stream* stream, long long& server_processed_chunk_count,
+                                                       long long& buffered_responses) {
+    ParallelChunkStream chunks(stream, *pool_, parallel_inflight_, ordered_responses_, stats_, progress_);
+    while (!chunks.failed()) {
+        ParallelChunkStream::Slot* slot = chunks.acquire_slot();
+        if (!stream->Read(&slot->request)) {
+            chunks.release_slot(slot);
+            break;
+        }
+        const int64_t recv_ns = benchmark_common::trace_now_ns();
+        stats_.add_bytes_in(slot->request.ByteSizeLong());
+        server_processed_chunk_count++;
+
+        if (slot->request.mode() == benchmark_grpc::WORKLOAD_DOWNLOAD) {
+            // Download пишет в поток сам, поэтому сначала дописываются ответы, уже отданные пулу
+            chunks.drain();
+            Status download_status = StreamDownload(slot->request, stream);
+            chunks.release_slot(slot);
+            if (!download_status.ok()) return download_status;
+            continue;
+        }
+        chunks.submit(slot, recv_ns);
+    }
+    chunks.drain();
+    buffered_responses = chunks.buffered_responses();
+    if (chunks.failed()) {
+        return Status(grpc::StatusCode::UNKNOWN, "Server failed to write response to stream.");
+    }
+    return Status::OK;
+}
+
+// Режим DOWNLOAD: отдает первые download_bytes файла сервера чанками download_chunk_size,
+// каждый с CRC32 для проверки на клиенте. Файл короче запроса - отдается сколько есть.
+Status FileProcessorServiceImpl::StreamDownload(const ChunkRequest& request, Stream* stream) {
+    const size_t chunk_size = static_cast<size_t>(request.download_chunk_size());
+    const size_t requested_bytes = static_cast<size_t>(request.download_bytes());
+    if (chunk_size == 0) {
+        return Status(grpc::StatusCode::INVALID_ARGUMENT, "download_chunk_size must be positive.");
+    }
+    std::unique_ptr<benchmark_common::ChunkReader> reader;
+    try {
+        reader = std::make_unique<benchmark_common::ChunkReader>(download_file_, chunk_size);
+    } catch (const std::exception& e) {
+        std::cerr << "[gRPC SERVER ERROR] " << e.what() << std::endl;
+        return Status(grpc::StatusCode::FAILED_PRECONDITION,
+                      "Download file '" + download_file_ + "' is not available on the server.");
+    }
+    std::cout << "[gRPC SERVER INFO] Download: sending up to " << requested_bytes << " bytes of '"
+              << download_file_ << "' in " << chunk_size << "-byte chunks." << std::endl;
+
+    size_t bytes_sent = 0;
+    long long chunk_id = 0;
+    ChunkResponse response;
+    while (bytes_sent < requested_bytes) {
+        // Каждый отданный чанк - отдельный "запрос" в метриках: чтение файла и CRC32
+        // идут в serialize, Write() - в write.
+        benchmark_common::RequestTiming timing;
+        timing.start();
+        const auto chunk_started_at = std::chrono::steady_clock::now();
+        // Чанк читается прямо в поле переиспользуемого ответа
+        std::string& chunk = *response.mutable_reversed_chunk_data();
+        if (reader->next_chunk_into(chunk) == 0) break;
+        if (chunk.size() > requested_bytes - bytes_sent) chunk.resize(requested_bytes - bytes_sent);
+        response.set_original_client_chunk_id(++chunk_id);
+        response.set_checksum(benchmark_common::chunk_checksum(chunk.data(), chunk.size()));
+        const size_t response_bytes = response.ByteSizeLong();
+        timing.lap(benchmark_common::ServerStage::SERIALIZE);
+        if (!stream->Write(response)) {
+            std::cerr << "[gRPC SERVER ERROR] Failed to write download chunk " << chunk_id << "." << std::endl;
+            return Status(grpc::StatusCode::UNKNOWN, "Server failed to write download chunk.");
+        }
+        timing.lap(benchmark_common::ServerStage::WRITE);
+        stats_.add_bytes_out(response_bytes);
+        stats_.record(timing);
+        progress_.on_completed(chunk.size(), std::chrono::duration_cast<std::chrono::microseconds>(
+                                                 std::chrono::steady_clock::now() - chunk_started_at).count());
+        bytes_sent += chunk.size();
+    }
+    std::cout << "[gRPC SERVER INFO] Download finished: " << chunk_id << " chunks, " << bytes_sent << " bytes." << std::endl;
+    return Status::OK;
+}
@@ -0,0 +1,51 @@
+// grpc_app/grpc_service.hpp
+#pragma once
+
+#include <string>
+
+#include <grpcpp/grpcpp.h>
+
+#include "gen_proto/benchmark.grpc.pb.h"
+
+#include "common/include/progress_reporter.hpp"
+#include "common/include/server_stats.hpp"
+#include "common/include/worker_pool.hpp"
+
+// Реализация сервиса FileProcessor. Общая для grpc_server и для клиента с --transport=inproc,
+// который регистрирует сервис в своем процессе и ходит к нему через InProcessChannel.
+class FileProcessorServiceImpl final : public benchmark_grpc::FileProcessor::Service {
+public:
+    using Stream = grpc::ServerReaderWriter<benchmark_grpc::ChunkResponse, benchmark_grpc::ChunkRequest>;
+
+    // download_file - файл, который сервер отдает в режиме DOWNLOAD (--download-file)
+    FileProcessorServiceImpl(std::string download_file, benchmark_common::ServerStats& stats,
+                             benchmark_common::ProgressReporter& progress)
+        : download_file_(std::move(download_file)), stats_(stats), progress_(progress) {}
+
+    // --parallel-chunks: чанки echo/upload обрабатывает pool, до inflight чанков на поток;
+    // ordered - ответы в порядке запросов. Без вызова чанк обрабатывает поток соединения.
+    void EnableParallelChunks(benchmark_common::WorkerPool* pool, size_t inflight, bool ordered) {
+        pool_ = pool;
+        parallel_inflight_ = inflight;
+        ordered_responses_ = ordered;
+    }
+
+    grpc::Status ProcessFileChunks(grpc::ServerContext* context, Stream* stream) override;
+
+private:
+    // Чанк за чанком в потоке соединения: Read -> реверс -> Write.
+    grpc::Status ProcessChunksInline(Stream* stream, long long& server_processed_chunk_count,
+                                     long long& buffered_responses);
+    // --parallel-chunks: поток соединения только читает, реверс и запись ответов - в пуле.
+    grpc::Status ProcessChunksParallel(Stream* stream, long long& server_processed_chunk_count,
+                                       long long& buffered_responses);
+    // Режим DOWNLOAD: отдает первые download_bytes файла сервера чанками download_chunk_size.
+    grpc::Status StreamDownload(const benchmark_grpc::ChunkRequest& request, Stream* stream);
+
+    std::string download_file_;
+    benchmark_common::ServerStats& stats_;
+    benchmark_common::ProgressReporter& progress_;
+    benchmark_common::WorkerPool* pool_ = nullptr;
+    size_t parallel_inflight_ = 0;
+    bool ordered_responses_ = false;
+};
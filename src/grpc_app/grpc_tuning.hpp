@@ -0,0 +1,146 @@
+// grpc_app/grpc_tuning.hpp
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+
+#include <grpc/compression.h>
+#include <grpc/grpc.h>
+#include <grpcpp/server_builder.h>
+#include <grpcpp/support/channel_arguments.h>
+
+#include "common/include/cli_options.hpp"
+#include "common/include/config.hpp"
+#include "common/include/socket_tuning.hpp"
+
+// Общие для клиента и сервера gRPC настройки транспорта, задаваемые из командной строки.
+namespace grpc_tuning {
+
+// --compression=none|gzip|deflate -> алгоритм сжатия сообщений gRPC.
+inline grpc_compression_algorithm compression_from_string(const std::string& name) {
+    if (name == "none") return GRPC_COMPRESS_NONE;
+    if (name == "gzip") return GRPC_COMPRESS_GZIP;
+    if (name == "deflate") return GRPC_COMPRESS_DEFLATE;
+    throw std::invalid_argument("Unknown gRPC compression: " + name + " (expected none|gzip|deflate)");
+}
+
+// Часть профиля сокета, которую gRPC принимает аргументами канала: размер чтения из TCP
+// подгоняется под SO_RCVBUF, чтобы большой буфер ядра забирался за один read().
+// TCP_NODELAY gRPC выставляет на своих сокетах сам; остальные опции применяются к сокету
+// напрямую (см. создание канала/сервера из готового дескриптора).
+template <typename SetIntArg>
+inline void for_each_socket_channel_arg(const benchmark_common::SocketTuning& tuning, SetIntArg set_int_arg) {
+    if (tuning.receive_buffer_bytes > 0) {
+        set_int_arg(GRPC_ARG_TCP_READ_CHUNK_SIZE, tuning.receive_buffer_bytes);
+        set_int_arg(GRPC_ARG_TCP_MAX_READ_CHUNK_SIZE, tuning.receive_buffer_bytes);
+    }
+}
+
+inline void apply_socket_tuning(grpc::ChannelArguments& args, const benchmark_common::SocketTuning& tuning) {
+    for_each_socket_channel_arg(tuning, [&](const char* name, int value) { args.SetInt(name, value); });
+}
+
+inline void apply_socket_tuning(grpc::ServerBuilder& builder, const benchmark_common::SocketTuning& tuning) {
+    for_each_socket_channel_arg(tuning, [&](const char* name, int value) { builder.AddChannelArgument(name, value); });
+}
+
+// Управление потоком HTTP/2. Для одного длинного bidi-стрима на 10 GB именно окно решает,
+// сколько байт может быть в полете: при окне меньше bandwidth x RTT отправитель простаивает
+// в ожидании WINDOW_UPDATE. Нули и -1 означают "значение gRPC по умолчанию".
+struct Http2Tuning {
+    std::string name = "default";
+    // Начальное окно стрима (lookahead). Окно соединения chttp2 отдельным аргументом не задается:
+    // его целевое значение выводится из того же lookahead (и растет вместе с BDP-оценкой).
+    int stream_window_bytes = 0;
+    int max_frame_bytes = 0;     // SETTINGS_MAX_FRAME_SIZE, 16 KB..16 MB-1
+    int bdp_probe = -1;          // 1 - окно подстраивается по BDP-пингам, 0 - окно фиксированное
+    int write_buffer_bytes = 0;  // Сколько данных транспорт копит на запись до flow control
+};
+
+// Окно под канал bandwidth x RTT с двукратным запасом (окно должно покрывать и задержку
+// WINDOW_UPDATE), в пределах [64 KB, 2^31-1].
+inline int http2_window_for_link(long long link_mbps, long long rtt_us) {
+    const double bdp_bytes = static_cast<double>(link_mbps) * 1e6 / 8.0 * static_cast<double>(rtt_us) / 1e6;
+    const double window = std::max(2.0 * bdp_bytes, 64.0 * 1024);
+    return window >= static_cast<double>(INT_MAX) ? INT_MAX : static_cast<int>(window);
+}
+
+// Фиксированное окно без BDP-проб; кадр - четверть окна, чтобы в окно помещалось
+// несколько кадров, но не меньше минимума протокола и не больше его максимума.
+inline Http2Tuning http2_fixed_window(int window_bytes) {
+    Http2Tuning t;
+    t.name = "window";
+    t.stream_window_bytes = window_bytes;
+    t.max_frame_bytes = std::min(std::max(window_bytes / 4, 16 * 1024), 16 * 1024 * 1024 - 1);
+    t.bdp_probe = 0;
+    t.write_buffer_bytes = std::min(window_bytes, 64 * 1024 * 1024);
+    return t;
+}
+
+// --http2-profile=default|nobdp|bdp. bdp считает окно из --link-mbps и --link-rtt-us;
+// поверх профиля отдельные --http2-window, --http2-max-frame, --http2-bdp-probe=0|1,
+// --http2-write-buffer (любая из них переименовывает профиль в "custom").
+inline Http2Tuning http2_tuning_from_options(const benchmark_common::CliOptions& options) {
+    const std::string profile = options.get_string("http2-profile", "default");
+    Http2Tuning t;
+    if (profile == "bdp") {
+        t = http2_fixed_window(http2_window_for_link(
+            options.get_int("link-mbps", benchmark_common::HTTP2_DEFAULT_LINK_MBPS),
+            options.get_int("link-rtt-us", benchmark_common::HTTP2_DEFAULT_LINK_RTT_US)));
+    } else if (profile == "nobdp") {
+        t.bdp_probe = 0;
+    } else if (profile != "default") {
+        throw std::invalid_argument("Unknown HTTP/2 profile: " + profile + " (expected default|nobdp|bdp)");
+    }
+    t.name = profile;
+    bool overridden = false;
+    if (options.has("http2-window")) {
+        t.stream_window_bytes = static_cast<int>(options.get_size("http2-window", 0));
+        overridden = true;
+    }
+    if (options.has("http2-max-frame")) {
+        t.max_frame_bytes = static_cast<int>(options.get_size("http2-max-frame", 0));
+        overridden = true;
+    }
+    if (options.has("http2-bdp-probe")) {
+        t.bdp_probe = options.get_bool("http2-bdp-probe", true) ? 1 : 0;
+        overridden = true;
+    }
+    if (options.has("http2-write-buffer")) {
+        t.write_buffer_bytes = static_cast<int>(options.get_size("http2-write-buffer", 0));
+        overridden = true;
+    }
+    if (overridden) t.name = "custom";
+    return t;
+}
+
+// "bdp(window=2500000 max_frame=625000 bdp_probe=0 write_buffer=2500000)" - для логов и CSV.
+inline std::string http2_tuning_to_string(const Http2Tuning& t) {
+    std::ostringstream out;
+    out << t.name << "(window=" << t.stream_window_bytes << " max_frame=" << t.max_frame_bytes
+        << " bdp_probe=" << t.bdp_probe << " write_buffer=" << t.write_buffer_bytes << ")";
+    return out.str();
+}
+
+template <typename SetIntArg>
+inline void for_each_http2_channel_arg(const Http2Tuning& t, SetIntArg set_int_arg) {
+    if (t.stream_window_bytes > 0) set_int_arg(GRPC_ARG_HTTP2_STREAM_LOOKAHEAD_BYTES, t.stream_window_bytes);
+    if (t.max_frame_bytes > 0) set_int_arg(GRPC_ARG_HTTP2_MAX_FRAME_SIZE, t.max_frame_bytes);
+    if (t.bdp_probe >= 0) set_int_arg(GRPC_ARG_HTTP2_BDP_PROBE, t.bdp_probe);
+    if (t.write_buffer_bytes > 0) set_int_arg(GRPC_ARG_HTTP2_WRITE_BUFFER_SIZE, t.write_buffer_bytes);
+}
+
+// Окна задаются с обеих сторон: окно, объявленное сервером, ограничивает поток чанков
+// от клиента, окно клиента - поток ответов обратно.
+inline void apply_http2_tuning(grpc::ChannelArguments& args, const Http2Tuning& t) {
+    for_each_http2_channel_arg(t, [&](const char* name, int value) { args.SetInt(name, value); });
+}
+
+inline void apply_http2_tuning(grpc::ServerBuilder& builder, const Http2Tuning& t) {
+    for_each_http2_channel_arg(t, [&](const char* name, int value) { builder.AddChannelArgument(name, value); });
+}
+
+} // namespace grpc_tuning
@@ -0,0 +1,62 @@
+// grpc_app/write_coalescing.hpp
+#pragma once
+
+#include <chrono>
+#include <cstddef> // Для size_t
+#include <cstdint>
+
+#include <grpcpp/support/sync_stream.h> // Для grpc::WriteOptions
+
+namespace grpc_tuning {
+
+// Склейка записей потока (--write-batch=N): первые записи пачки идут с
+// WriteOptions::set_buffer_hint(), и транспорт копит их, не отправляя, до записи без подсказки,
+// которая выталкивает всю пачку меньшим числом кадров HTTP/2 и системных вызовов.
+// Пачка закрывается на N-й записи, по принуждению вызывающего (нет места под следующий чанк,
+// последний чанк) или по сроку flush_after от первой записи пачки. Вытолкнуть пачку можно только
+// записью, поэтому срок соблюдается наперед: пачка закрывается, если следующая запись, судя по
+// среднему промежутку между записями, придет уже после срока. Вызывающий не должен засыпать
+// с открытой пачкой - для этого он закрывает ее, когда не смог занять место под следующий чанк.
+// Цена - хвостовая задержка: запрос в пачке ждет, пока ее не закроют.
+class WriteCoalescer {
+public:
+    WriteCoalescer(size_t batch, std::chrono::microseconds flush_after)
+        : batch_(batch == 0 ? 1 : batch), flush_after_(flush_after) {}
+
+    // Опции для очередной записи; flush - закрыть пачку этой записью.
+    grpc::WriteOptions next(bool flush) {
+        writes_++;
+        if (batch_ == 1) {
+            flushes_++;
+            return grpc::WriteOptions();
+        }
+        const auto now = std::chrono::steady_clock::now();
+        // Средний промежуток между записями (EWMA 1/8): чтение файла, копия для проверки, Write()
+        if (writes_ > 1) gap_estimate_ += ((now - last_write_at_) - gap_estimate_) / 8;
+        last_write_at_ = now;
+        if (buffered_ == 0) first_buffered_at_ = now;
+        buffered_++;
+        if (flush || buffered_ >= batch_ || now - first_buffered_at_ + gap_estimate_ >= flush_after_) {
+            buffered_ = 0;
+            flushes_++;
+            return grpc::WriteOptions();
+        }
+        return grpc::WriteOptions().set_buffer_hint();
+    }
+
+    size_t batch() const { return batch_; }
+    uint64_t writes() const { return writes_; }
+    uint64_t flushes() const { return flushes_; }
+
+private:
+    size_t batch_;
+    std::chrono::microseconds flush_after_;
+    size_t buffered_ = 0;
+    std::chrono::steady_clock::time_point first_buffered_at_;
+    std::chrono::steady_clock::time_point last_write_at_;
+    std::chrono::steady_clock::duration gap_estimate_{0};
+    uint64_t writes_ = 0;
+    uint64_t flushes_ = 0;
+};
+
+} // namespace grpc_tuning
@@ -0,0 +1,100 @@
+// loadgen_app/capnp_load_target.cpp
+#include "loadgen_app/load_target.hpp"
+
+#include <stdexcept>
+
+#include <kj/async-io.h>
+#include <kj/exception.h>
+#include <capnp/rpc-twoparty.h>
+
+#include "benchmark.capnp.h"
+#include "capnp_app/message_sizing.hpp"
+
+namespace loadgen {
+
+namespace {
+
+// Свое соединение, TwoPartyClient и ChunkHandler на клиента; вызовы ждут ответа в цикле
+// событий потока, которому принадлежит коннектор.
+class CapnpLoadTarget final : public LoadTarget {
+public:
+    CapnpLoadTarget(kj::Own<kj::AsyncIoStream> stream, kj::WaitScope& waitScope)
+        : stream_(kj::mv(stream)),
+          rpc_client_(*stream_),
+          handler_(rpc_client_.bootstrap()
+                       .castAs<FileProcessor>()
+                       .startStreamingRequest()
+                       .send()
+                       .wait(waitScope)
+                       .getHandler()),
+          waitScope_(waitScope) {}
+
+    ~CapnpLoadTarget() override {
+        if (broken_) return;
+        try {
+            handler_.doneStreamingRequest().send().wait(waitScope_);
+        } catch (const kj::Exception&) {
+            // Сервер уже закрыл соединение - на итоги прогона это не влияет
+        }
+    }
+
+    bool call(const std::vector<char>& payload, std::string& error) override {
+        try {
+            auto request = handler_.processChunkRequest(capnp_benchmark::chunkMessageSize(payload.size()));
+            request.getRequest().setData(
+                kj::ArrayPtr<const kj::byte>(reinterpret_cast<const kj::byte*>(payload.data()), payload.size()));
+            auto response = request.send().wait(waitScope_);
+            capnp::Data::Reader data = response.getResponse().getData();
+            if (!is_reversed_echo(reinterpret_cast<const char*>(data.begin()), data.size(), payload)) {
+                error = "Cap'n Proto response verification failed";
+                return false;
+            }
+            return true;
+        } catch (const kj::Exception& e) {
+            broken_ = true;
+            error = std::string("Cap'n Proto call failed: ") + e.getDescription().cStr();
+            return false;
+        }
+    }
+
+private:
+    kj::Own<kj::AsyncIoStream> stream_;
+    capnp::TwoPartyClient rpc_client_;
+    FileProcessor::ChunkHandler::Client handler_;
+    kj::WaitScope& waitScope_;
+    bool broken_ = false;
+};
+
+class CapnpLoadConnector final : public LoadConnector {
+public:
+    explicit CapnpLoadConnector(const LoadTargetOptions& options)
+        : address_(options.host + ":" + std::to_string(options.port)),
+          ioContext_(kj::setupAsyncIo()) {}
+
+    std::unique_ptr<LoadTarget> connect() override {
+        try {
+            kj::Own<kj::AsyncIoStream> stream = ioContext_.provider->getNetwork()
+                                                    .parseAddress(address_)
+                                                    .then([](kj::Own<kj::NetworkAddress> addr) {
+                                                        return addr->connect();
+                                                    })
+                                                    .wait(ioContext_.waitScope);
+            return std::make_unique<CapnpLoadTarget>(kj::mv(stream), ioContext_.waitScope);
+        } catch (const kj::Exception& e) {
+            throw std::runtime_error("Cap'n Proto: could not connect to " + address_ + ": " +
+                                     e.getDescription().cStr());
+        }
+    }
+
+private:
+    std::string address_;
+    kj::AsyncIoContext ioContext_; // Цикл событий KJ этого потока
+};
+
+} // namespace
+
+std::unique_ptr<LoadConnector> make_capnp_connector(const LoadTargetOptions& options) {
+    return std::make_unique<CapnpLoadConnector>(options);
+}
+
+} // namespace loadgen
@@ -0,0 +1,97 @@
+// loadgen_app/grpc_load_target.cpp
+#include "loadgen_app/load_target.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+#include <grpcpp/grpcpp.h>
+
+#include "gen_proto/benchmark.grpc.pb.h"
+
+using benchmark_grpc::ChunkRequest;
+using benchmark_grpc::ChunkResponse;
+using benchmark_grpc::FileProcessor;
+
+namespace loadgen {
+
+namespace {
+
+// Один открытый поток ProcessFileChunks на клиента: запрос и ответ по очереди.
+class GrpcLoadTarget final : public LoadTarget {
+public:
+    explicit GrpcLoadTarget(const std::shared_ptr<grpc::Channel>& channel)
+        : stub_(FileProcessor::NewStub(channel)),
+          stream_(stub_->ProcessFileChunks(&context_)) {}
+
+    ~GrpcLoadTarget() override {
+        if (!broken_) {
+            stream_->WritesDone();
+            stream_->Finish();
+        } else {
+            context_.TryCancel();
+        }
+    }
+
+    bool call(const std::vector<char>& payload, std::string& error) override {
+        request_.set_data_chunk(payload.data(), payload.size());
+        request_.set_client_assigned_chunk_id(++next_chunk_id_);
+        if (!stream_->Write(request_)) {
+            broken_ = true;
+            error = "gRPC stream write failed";
+            return false;
+        }
+        if (!stream_->Read(&response_)) {
+            broken_ = true;
+            error = "gRPC stream closed before the response";
+            return false;
+        }
+        const std::string& data = response_.reversed_chunk_data();
+        if (response_.original_client_chunk_id() != next_chunk_id_ ||
+            !is_reversed_echo(data.data(), data.size(), payload)) {
+            error = "gRPC response verification failed";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::unique_ptr<FileProcessor::Stub> stub_;
+    grpc::ClientContext context_; // Должен жить дольше stream_
+    std::unique_ptr<grpc::ClientReaderWriter<ChunkRequest, ChunkResponse>> stream_;
+    ChunkRequest request_;
+    ChunkResponse response_;
+    long long next_chunk_id_ = 0;
+    bool broken_ = false;
+};
+
+class GrpcLoadConnector final : public LoadConnector {
+public:
+    explicit GrpcLoadConnector(const LoadTargetOptions& options)
+        : target_(options.host + ":" + std::to_string(options.port)) {
+        args_.SetMaxReceiveMessageSize(-1);
+        args_.SetMaxSendMessageSize(-1);
+        // Без этого каналы с одинаковыми аргументами делят одно TCP-соединение (общий пул
+        // подканалов), и M клиентов превращаются в M потоков HTTP/2 поверх одного сокета.
+        args_.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+    }
+
+    std::unique_ptr<LoadTarget> connect() override {
+        auto channel = grpc::CreateCustomChannel(target_, grpc::InsecureChannelCredentials(), args_);
+        if (!channel->WaitForConnected(std::chrono::system_clock::now() + std::chrono::seconds(5))) {
+            throw std::runtime_error("gRPC: could not connect to " + target_);
+        }
+        return std::make_unique<GrpcLoadTarget>(channel);
+    }
+
+private:
+    std::string target_;
+    grpc::ChannelArguments args_;
+};
+
+} // namespace
+
+std::unique_ptr<LoadConnector> make_grpc_connector(const LoadTargetOptions& options) {
+    return std::make_unique<GrpcLoadConnector>(options);
+}
+
+} // namespace loadgen
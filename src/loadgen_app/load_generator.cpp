@@ -0,0 +1,413 @@
+// loadgen_app/load_generator.cpp
+// Генератор нагрузки: M логических клиентов на пуле из N потоков шлют эхо-запросы одному из
+// серверов бенчмарка (grpc | capnp | tcp) с заданной суммарной частотой (open loop).
+//
+// Обычные клиенты работают в замкнутом цикле: следующий запрос уходит только после ответа на
+// предыдущий, и если сервер "притормозил", запросы, которые должны были уйти за это время,
+// просто не отправляются - медленные ответы почти не попадают в статистику (coordinated omission).
+// Здесь у каждого запроса есть запланированное время отправки, и задержка считается от него,
+// а не от фактической отправки: запрос, задержанный занятым соединением, честно получает
+// и время ожидания. Отдельно пишется время обслуживания (от фактической отправки), чтобы было
+// видно, сколько из задержки - очередь на стороне клиента.
+//
+// Клиенты синхронные: поток по очереди обслуживает свои соединения, так что одновременно в
+// полете не больше --threads запросов. Если поток не успевает, это видно по счетчику опозданий
+// и по разнице предложенной и достигнутой частоты. Поверх этого потоки делят общий бюджет
+// данных в полете (--inflight-bytes, --inflight-requests): ожидание места в нем входит в
+// задержку от запланированной отправки, как и любая другая очередь на стороне клиента.
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/include/cli_options.hpp"
+#include "common/include/config.hpp"
+#include "common/include/hdr_histogram.hpp"
+#include "common/include/inflight_budget.hpp"
+#include "loadgen_app/load_target.hpp"
+
+using Clock = std::chrono::steady_clock;
+using benchmark_common::HdrHistogram;
+using loadgen::LoadTargetOptions;
+
+namespace {
+
+struct LoadPlan {
+    size_t clients = 0;
+    size_t threads = 0;
+    double rate = 0.0; // Запросов в секунду на всех клиентов; 0 - closed loop
+    std::chrono::seconds duration{0};
+    size_t payload_bytes = 0;
+
+    bool open_loop() const { return rate > 0.0; }
+};
+
+HdrHistogram make_latency_histogram() {
+    return HdrHistogram(1, benchmark_common::LATENCY_HISTOGRAM_MAX_US, benchmark_common::LATENCY_HISTOGRAM_DIGITS);
+}
+
+// Итоги одного рабочего потока; сливаются после прогона, так что запись идет без блокировок.
+struct WorkerResult {
+    HdrHistogram latency_us = make_latency_histogram(); // От запланированной отправки до ответа
+    HdrHistogram service_us = make_latency_histogram(); // От фактической отправки до ответа
+    uint64_t completed = 0;
+    uint64_t errors = 0;
+    uint64_t late_sends = 0; // Ушли позже плана больше чем на LOADGEN_LATE_SEND_THRESHOLD_US
+    uint64_t unsent = 0;     // Запланированы до конца прогона, но так и не отправлены
+    bool connect_failed = false;
+    std::string first_error;
+    Clock::time_point last_completion{};
+};
+
+// Все потоки стартуют в один момент, когда их соединения уже установлены.
+class StartGate {
+public:
+    explicit StartGate(size_t workers) : pending_(workers) {}
+
+    // Поток готов; ждет решения main. false - прогон отменен.
+    bool arrive_and_wait(Clock::time_point& start) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (--pending_ == 0) cv_.notify_all();
+        cv_.wait(lock, [this] { return opened_; });
+        start = start_;
+        return run_;
+    }
+
+    void wait_all_ready() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return pending_ == 0; });
+    }
+
+    void open(Clock::time_point start, bool run) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        start_ = start;
+        run_ = run;
+        opened_ = true;
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    size_t pending_;
+    bool opened_ = false;
+    bool run_ = false;
+    Clock::time_point start_;
+};
+
+struct ClientSlot {
+    size_t index = 0; // Глобальный номер логического клиента
+    uint64_t sent = 0; // Номер следующего запроса в расписании клиента
+    std::unique_ptr<loadgen::LoadTarget> target;
+    Clock::time_point next_send;
+    bool done = false;
+};
+
+// Общий поток запросов с периодом 1/rate раздается клиентам по кругу: запрос k клиента i -
+// (i + k*M)-й. Время считается от старта, а не накапливается, чтобы не копить ошибку округления.
+Clock::time_point intended_send_time(const LoadPlan& plan, Clock::time_point start, size_t client, uint64_t k) {
+    const double offset_s =
+        (static_cast<double>(client) + static_cast<double>(k) * static_cast<double>(plan.clients)) / plan.rate;
+    return start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(offset_s));
+}
+
+long long to_us(Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+// Запросы клиента, запланированные до конца прогона, но не отправленные (соединение потеряно
+// или вышло время досылки). Во втором случае каждый уже ждал не меньше (now - план), и это
+// попадает в гистограмму задержки: выбросить их значило бы снова занизить хвост.
+void account_unsent(const LoadPlan& plan, Clock::time_point start, Clock::time_point end, ClientSlot& slot,
+                    WorkerResult& result, const Clock::time_point* waited_until) {
+    for (uint64_t k = slot.sent;; ++k) {
+        const Clock::time_point intended = intended_send_time(plan, start, slot.index, k);
+        if (intended >= end) break;
+        ++result.unsent;
+        if (waited_until) result.latency_us.record(to_us(*waited_until - intended));
+    }
+    slot.done = true;
+}
+
+void drive_clients(const LoadPlan& plan, Clock::time_point start, const std::vector<char>& payload,
+                   std::vector<ClientSlot>& slots, WorkerResult& result) {
+    const Clock::time_point end = start + plan.duration;
+    const Clock::time_point drain_deadline = end + std::chrono::seconds(benchmark_common::LOADGEN_DRAIN_TIMEOUT_S);
+    const auto late_threshold = std::chrono::microseconds(benchmark_common::LOADGEN_LATE_SEND_THRESHOLD_US);
+    for (auto& slot : slots) {
+        slot.next_send = plan.open_loop() ? intended_send_time(plan, start, slot.index, 0) : start;
+    }
+
+    std::string error;
+    for (;;) {
+        // Следующим идет клиент с самым ранним запланированным запросом
+        ClientSlot* next = nullptr;
+        for (auto& slot : slots) {
+            if (!slot.done && (next == nullptr || slot.next_send < next->next_send)) next = &slot;
+        }
+        if (next == nullptr) break;
+        if (next->next_send >= end) {
+            next->done = true;
+            continue;
+        }
+
+        Clock::time_point now = Clock::now();
+        if (plan.open_loop() && now > drain_deadline) {
+            for (auto& slot : slots) {
+                if (!slot.done) account_unsent(plan, start, end, slot, result, &now);
+            }
+            break;
+        }
+        if (next->next_send > now) {
+            std::this_thread::sleep_until(next->next_send);
+            now = Clock::now();
+        }
+        const Clock::time_point intended = plan.open_loop() ? next->next_send : now;
+        if (now - intended > late_threshold) ++result.late_sends;
+
+        bool ok;
+        {
+            benchmark_common::InflightReservation reservation(benchmark_common::shared_inflight_budget(),
+                                                              payload.size());
+            ok = next->target->call(payload, error);
+        }
+        const Clock::time_point done_at = Clock::now();
+        result.last_completion = done_at;
+        ++next->sent;
+        if (!ok) {
+            ++result.errors;
+            if (result.first_error.empty()) result.first_error = error;
+            // Соединение считается потерянным; его оставшееся расписание не выполняется
+            if (plan.open_loop()) {
+                account_unsent(plan, start, end, *next, result, nullptr);
+            } else {
+                next->done = true;
+            }
+            continue;
+        }
+        ++result.completed;
+        result.latency_us.record(to_us(done_at - intended));
+        result.service_us.record(to_us(done_at - now));
+        next->next_send = plan.open_loop() ? intended_send_time(plan, start, next->index, next->sent) : done_at;
+    }
+}
+
+// Поток пула: подключает своих клиентов (i = worker, worker + N, ...), ждет общего старта и
+// ведет их расписание. Соединения создаются и закрываются в этом же потоке.
+void run_worker(size_t worker, const LoadPlan& plan, const LoadTargetOptions& target_options,
+                const std::vector<char>& payload, StartGate& gate, WorkerResult& result) {
+    std::unique_ptr<loadgen::LoadConnector> connector;
+    std::vector<ClientSlot> slots;
+    try {
+        connector = loadgen::make_load_connector(target_options);
+        for (size_t i = worker; i < plan.clients; i += plan.threads) {
+            ClientSlot slot;
+            slot.index = i;
+            slot.target = connector->connect();
+            slots.push_back(std::move(slot));
+        }
+    } catch (const std::exception& e) {
+        result.connect_failed = true;
+        result.first_error = e.what();
+        slots.clear();
+    }
+
+    Clock::time_point start;
+    if (gate.arrive_and_wait(start) && !result.connect_failed) {
+        drive_clients(plan, start, payload, slots, result);
+    }
+    slots.clear(); // Соединения закрываются раньше коннектора
+    connector.reset();
+}
+
+double to_ms(int64_t us) {
+    return static_cast<double>(us) / 1000.0;
+}
+
+void print_histogram_line(const std::string& title, const HdrHistogram& h) {
+    std::cout << title << " (ms): p50 " << to_ms(h.value_at_percentile(50.0))
+              << ", p90 " << to_ms(h.value_at_percentile(90.0))
+              << ", p99 " << to_ms(h.value_at_percentile(99.0))
+              << ", p99.9 " << to_ms(h.value_at_percentile(99.9))
+              << ", p99.99 " << to_ms(h.value_at_percentile(99.99))
+              << ", max " << to_ms(h.max())
+              << ", mean " << h.mean() / 1000.0 << std::endl;
+}
+
+void print_load_report(const std::string& protocol_name, const LoadPlan& plan, const WorkerResult& total,
+                       double elapsed_s, const std::string& budget_report) {
+    const double achieved_rate = elapsed_s > 0.0 ? static_cast<double>(total.completed) / elapsed_s : 0.0;
+    std::cout << "\n--- Load Generator Summary (" << protocol_name << ") ---" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Clients: " << plan.clients << ", threads: " << plan.threads << ", duration: "
+              << plan.duration.count() << " s, payload: " << plan.payload_bytes << " bytes" << std::endl;
+    if (plan.open_loop()) {
+        std::cout << "Offered rate: " << plan.rate << " req/s (open loop)" << std::endl;
+        std::cout << "Achieved rate: " << achieved_rate << " req/s (" << achieved_rate / plan.rate * 100.0
+                  << "% of offered)" << std::endl;
+    } else {
+        std::cout << "Offered rate: closed loop" << std::endl;
+        std::cout << "Achieved rate: " << achieved_rate << " req/s" << std::endl;
+    }
+    std::cout << "Completed: " << total.completed << ", errors: " << total.errors
+              << ", sent late (>" << benchmark_common::LOADGEN_LATE_SEND_THRESHOLD_US << " us): " << total.late_sends
+              << ", never sent: " << total.unsent << std::endl;
+    if (total.latency_us.overflow_count() > 0) {
+        std::cout << "Latencies above the histogram range (clamped): " << total.latency_us.overflow_count()
+                  << std::endl;
+    }
+    if (!total.first_error.empty()) {
+        std::cout << "First error: " << total.first_error << std::endl;
+    }
+    if (total.latency_us.total_count() > 0) {
+        print_histogram_line(plan.open_loop() ? "Latency from intended send" : "Latency", total.latency_us);
+        if (plan.open_loop()) print_histogram_line("Service time", total.service_us);
+    }
+    std::cout << "In-flight " << budget_report << std::endl;
+    std::cout << "--- End of Summary ---" << std::endl;
+}
+
+bool save_load_summary_csv(const std::string& filename, const std::string& protocol_name, const LoadPlan& plan,
+                           const WorkerResult& total, double elapsed_s,
+                           const benchmark_common::InflightBudget::Stats& budget_stats) {
+    std::ofstream outfile(filename);
+    if (!outfile) {
+        std::cerr << "[ERROR] Failed to open summary CSV file for writing: " << filename << std::endl;
+        return false;
+    }
+    const double achieved_rate = elapsed_s > 0.0 ? static_cast<double>(total.completed) / elapsed_s : 0.0;
+    outfile << "Metric,Value,Unit\n";
+    outfile << std::fixed << std::setprecision(6);
+    outfile << "Protocol," << protocol_name << ",\n";
+    outfile << "Clients," << plan.clients << ",\n";
+    outfile << "Threads," << plan.threads << ",\n";
+    outfile << "PayloadSize," << plan.payload_bytes << ",bytes\n";
+    outfile << "Duration," << elapsed_s << ",s\n";
+    outfile << "OfferedRate," << plan.rate << ",req/s\n";
+    outfile << "AchievedRate," << achieved_rate << ",req/s\n";
+    outfile << "Completed," << total.completed << ",\n";
+    outfile << "Errors," << total.errors << ",\n";
+    outfile << "LateSends," << total.late_sends << ",\n";
+    outfile << "NeverSent," << total.unsent << ",\n";
+    const double percentiles[] = {50.0, 90.0, 99.0, 99.9, 99.99};
+    for (double p : percentiles) {
+        outfile << "Latency_p" << p << "," << to_ms(total.latency_us.value_at_percentile(p)) << ",ms\n";
+    }
+    outfile << "Latency_max," << to_ms(total.latency_us.max()) << ",ms\n";
+    for (double p : percentiles) {
+        outfile << "ServiceTime_p" << p << "," << to_ms(total.service_us.value_at_percentile(p)) << ",ms\n";
+    }
+    outfile << "ServiceTime_max," << to_ms(total.service_us.max()) << ",ms\n";
+    outfile << "BudgetBlocked," << budget_stats.blocked_ns / 1e6 << ",ms\n";
+    outfile << "BudgetBlockedRequests," << budget_stats.blocked_waits << ",\n";
+    outfile << "BudgetPeakBytes," << budget_stats.peak_bytes << ",bytes\n";
+    std::cout << "[INFO] Summary metrics saved to " << filename << std::endl;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    benchmark_common::CliOptions options(argc, argv);
+    LoadTargetOptions target_options;
+    LoadPlan plan;
+    try {
+        target_options.protocol = loadgen::load_protocol_from_string(options.get_string("protocol", "grpc"));
+        target_options.host = options.get_string("host", benchmark_common::TARGET_SERVER_IP);
+        target_options.port = static_cast<int>(
+            options.get_int("port", loadgen::default_port_for(target_options.protocol)));
+        plan.clients = static_cast<size_t>(options.get_int("clients", benchmark_common::LOADGEN_DEFAULT_CLIENTS));
+        const size_t hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+        plan.threads = static_cast<size_t>(
+            options.get_int("threads", static_cast<long long>(std::min(plan.clients, hardware_threads))));
+        plan.rate = std::stod(options.get_string("rate", std::to_string(benchmark_common::LOADGEN_DEFAULT_RATE)));
+        plan.duration = std::chrono::seconds(options.get_int("duration", benchmark_common::LOADGEN_DEFAULT_DURATION_S));
+        plan.payload_bytes = options.get_size("chunk-size", benchmark_common::LOADGEN_DEFAULT_PAYLOAD_BYTES);
+        benchmark_common::configure_shared_inflight_budget(options);
+    } catch (const std::exception& e) {
+        std::cerr << "[LOADGEN ERROR] " << e.what() << std::endl;
+        return 1;
+    }
+    if (plan.clients == 0 || plan.threads == 0 || plan.rate < 0.0 || plan.duration.count() <= 0 ||
+        plan.payload_bytes == 0) {
+        std::cerr << "[LOADGEN ERROR] --clients, --threads, --duration and --chunk-size must be positive, "
+                     "--rate non-negative." << std::endl;
+        return 1;
+    }
+    plan.threads = std::min(plan.threads, plan.clients);
+    const std::string protocol_name = loadgen::load_protocol_to_string(target_options.protocol);
+
+    std::cout << "[LOADGEN INFO] " << plan.clients << " clients on " << plan.threads << " threads -> "
+              << protocol_name << " at " << target_options.host << ":" << target_options.port << ", ";
+    if (plan.open_loop()) {
+        std::cout << plan.rate << " req/s";
+    } else {
+        std::cout << "closed loop";
+    }
+    std::cout << " for " << plan.duration.count() << " s, " << plan.payload_bytes << "-byte requests." << std::endl;
+
+    std::vector<char> payload(plan.payload_bytes);
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> byte_dist(0, 255);
+    for (char& c : payload) c = static_cast<char>(byte_dist(rng));
+
+    StartGate gate(plan.threads);
+    std::vector<WorkerResult> results(plan.threads);
+    std::vector<std::thread> workers;
+    workers.reserve(plan.threads);
+    for (size_t t = 0; t < plan.threads; ++t) {
+        workers.emplace_back(run_worker, t, std::cref(plan), std::cref(target_options), std::cref(payload),
+                             std::ref(gate), std::ref(results[t]));
+    }
+
+    gate.wait_all_ready();
+    bool connected = true;
+    for (const auto& r : results) {
+        if (r.connect_failed) {
+            std::cerr << "[LOADGEN ERROR] " << r.first_error << std::endl;
+            connected = false;
+        }
+    }
+    // Небольшой запас, чтобы все потоки успели проснуться до первого запланированного запроса
+    const Clock::time_point start = Clock::now() + std::chrono::milliseconds(50);
+    gate.open(start, connected);
+    if (connected) {
+        std::cout << "[LOADGEN INFO] All " << plan.clients << " clients connected. Running..." << std::endl;
+    }
+    for (auto& w : workers) w.join();
+    if (!connected) return 1;
+
+    WorkerResult total;
+    Clock::time_point last_completion = start + plan.duration;
+    for (const auto& r : results) {
+        total.latency_us.merge(r.latency_us);
+        total.service_us.merge(r.service_us);
+        total.completed += r.completed;
+        total.errors += r.errors;
+        total.late_sends += r.late_sends;
+        total.unsent += r.unsent;
+        if (total.first_error.empty()) total.first_error = r.first_error;
+        last_completion = std::max(last_completion, r.last_completion);
+    }
+    const double elapsed_s = std::chrono::duration<double>(last_completion - start).count();
+
+    const benchmark_common::InflightBudget& budget = benchmark_common::shared_inflight_budget();
+    const benchmark_common::InflightBudget::Stats budget_stats = budget.stats();
+    print_load_report(protocol_name, plan, total, elapsed_s,
+                      benchmark_common::InflightBudget::describe({}, budget_stats, budget.max_bytes(),
+                                                                 budget.max_requests()));
+    const std::string csv_prefix = "loadgen_" + protocol_name;
+    save_load_summary_csv(csv_prefix + "_summary.csv", protocol_name, plan, total, elapsed_s, budget_stats);
+    total.latency_us.save_distribution_csv(csv_prefix + "_latency_hdr.csv", 1000.0);
+    if (plan.open_loop()) total.service_us.save_distribution_csv(csv_prefix + "_service_hdr.csv", 1000.0);
+    return total.errors == 0 && total.unsent == 0 ? 0 : 1;
+}
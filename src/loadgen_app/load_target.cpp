@@ -0,0 +1,44 @@
+// loadgen_app/load_target.cpp
+#include "loadgen_app/load_target.hpp"
+
+#include <stdexcept>
+
+#include "common/include/config.hpp"
+
+namespace loadgen {
+
+LoadProtocol load_protocol_from_string(const std::string& name) {
+    if (name == "grpc") return LoadProtocol::GRPC;
+    if (name == "capnp") return LoadProtocol::CAPNP;
+    if (name == "tcp") return LoadProtocol::TCP;
+    throw std::invalid_argument("Unknown protocol: " + name + " (expected grpc|capnp|tcp)");
+}
+
+std::string load_protocol_to_string(LoadProtocol protocol) {
+    switch (protocol) {
+        case LoadProtocol::GRPC: return "grpc";
+        case LoadProtocol::CAPNP: return "capnp";
+        case LoadProtocol::TCP: return "tcp";
+        default: return "unknown";
+    }
+}
+
+int default_port_for(LoadProtocol protocol) {
+    switch (protocol) {
+        case LoadProtocol::GRPC: return benchmark_common::GRPC_SERVER_PORT;
+        case LoadProtocol::CAPNP: return benchmark_common::CAPNP_SERVER_PORT;
+        case LoadProtocol::TCP: return benchmark_common::TCP_SERVER_PORT;
+        default: return 0;
+    }
+}
+
+std::unique_ptr<LoadConnector> make_load_connector(const LoadTargetOptions& options) {
+    switch (options.protocol) {
+        case LoadProtocol::GRPC: return make_grpc_connector(options);
+        case LoadProtocol::CAPNP: return make_capnp_connector(options);
+        case LoadProtocol::TCP: return make_tcp_connector(options);
+    }
+    throw std::invalid_argument("Unsupported protocol");
+}
+
+} // namespace loadgen
@@ -0,0 +1,63 @@
+// loadgen_app/load_target.hpp
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Подключение генератора нагрузки к одному из трех серверов бенчмарка. Каждый логический клиент
+// держит собственное соединение (LoadTarget) и делает синхронные эхо-запросы: чанк туда,
+// перевернутый чанк обратно, с проверкой ответа.
+namespace loadgen {
+
+enum class LoadProtocol {
+    GRPC,  // grpc_server: двунаправленный поток ProcessFileChunks
+    CAPNP, // capnp_server: ChunkHandler.processChunk
+    TCP    // tcp_server из GO++PROJECT/src/cpp_tcp_benchmark: кадры [длина u32][данные]
+};
+
+LoadProtocol load_protocol_from_string(const std::string& name);
+std::string load_protocol_to_string(LoadProtocol protocol);
+int default_port_for(LoadProtocol protocol);
+
+struct LoadTargetOptions {
+    LoadProtocol protocol = LoadProtocol::GRPC;
+    std::string host;
+    int port = 0;
+};
+
+class LoadTarget {
+public:
+    virtual ~LoadTarget() = default;
+    // Один запрос-ответ. false - ошибка транспорта или неверный ответ (причина в error);
+    // после ошибки соединение считается потерянным.
+    virtual bool call(const std::vector<char>& payload, std::string& error) = 0;
+};
+
+// Создает соединения для логических клиентов одного рабочего потока. Создается и разрушается
+// в этом же потоке: у Cap'n Proto цикл событий KJ привязан к потоку, и все соединения потока
+// живут в нем. Соединения должны быть разрушены раньше создавшего их коннектора.
+class LoadConnector {
+public:
+    virtual ~LoadConnector() = default;
+    // Бросает std::runtime_error, если подключиться не удалось.
+    virtual std::unique_ptr<LoadTarget> connect() = 0;
+};
+
+std::unique_ptr<LoadConnector> make_load_connector(const LoadTargetOptions& options);
+
+// Реализации по протоколам (grpc_load_target.cpp, capnp_load_target.cpp, tcp_load_target.cpp)
+std::unique_ptr<LoadConnector> make_grpc_connector(const LoadTargetOptions& options);
+std::unique_ptr<LoadConnector> make_capnp_connector(const LoadTargetOptions& options);
+std::unique_ptr<LoadConnector> make_tcp_connector(const LoadTargetOptions& options);
+
+// Ответ эхо-сервера - тот же чанк задом наперед.
+inline bool is_reversed_echo(const char* response, size_t response_size, const std::vector<char>& payload) {
+    if (response_size != payload.size()) return false;
+    for (size_t i = 0; i < response_size; ++i) {
+        if (response[i] != payload[response_size - 1 - i]) return false;
+    }
+    return true;
+}
+
+} // namespace loadgen
@@ -0,0 +1,123 @@
+// loadgen_app/tcp_load_target.cpp
+#include "loadgen_app/load_target.hpp"
+
+#include <arpa/inet.h> // htonl, ntohl
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <sys/uio.h>   // writev
+#include <unistd.h>
+
+#include "common/include/socket_tuning.hpp"
+
+namespace loadgen {
+
+namespace {
+
+const size_t TCP_HEADER_SIZE = sizeof(uint32_t);
+// Старшие биты заголовка у tcp_server - флаги (сжатие, пакеты, режимы нагрузки); на обычный
+// эхо-кадр сервер отвечает обычным кадром, так что флаги в ответе - ошибка.
+const uint32_t TCP_FLAGS_MASK = 0xF0000000u;
+
+// Блокирующий сокет с кадрами [длина u32, сетевой порядок][данные].
+class TcpLoadTarget final : public LoadTarget {
+public:
+    explicit TcpLoadTarget(int fd) : fd_(fd) {}
+    ~TcpLoadTarget() override { ::close(fd_); }
+
+    bool call(const std::vector<char>& payload, std::string& error) override {
+        uint32_t header_net = htonl(static_cast<uint32_t>(payload.size()));
+        iovec parts[2] = {{&header_net, TCP_HEADER_SIZE},
+                          {const_cast<char*>(payload.data()), payload.size()}};
+        if (!write_all(parts, 2)) {
+            error = std::string("TCP write failed: ") + std::strerror(errno);
+            return false;
+        }
+        if (!read_exact(&header_net, TCP_HEADER_SIZE)) {
+            error = "TCP connection closed before the response header";
+            return false;
+        }
+        const uint32_t header = ntohl(header_net);
+        if ((header & TCP_FLAGS_MASK) != 0 || header != payload.size()) {
+            error = "TCP response header mismatch";
+            return false;
+        }
+        response_.resize(header);
+        if (!read_exact(response_.data(), response_.size())) {
+            error = "TCP connection closed in the middle of the response";
+            return false;
+        }
+        if (!is_reversed_echo(response_.data(), response_.size(), payload)) {
+            error = "TCP response verification failed";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool write_all(iovec* parts, int count) {
+        while (count > 0) {
+            ssize_t written = ::writev(fd_, parts, count);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            size_t left = static_cast<size_t>(written);
+            while (count > 0 && left >= parts->iov_len) {
+                left -= parts->iov_len;
+                ++parts;
+                --count;
+            }
+            if (count > 0) {
+                parts->iov_base = static_cast<char*>(parts->iov_base) + left;
+                parts->iov_len -= left;
+            }
+        }
+        return true;
+    }
+
+    bool read_exact(void* out, size_t size) {
+        char* dst = static_cast<char*>(out);
+        while (size > 0) {
+            ssize_t got = ::read(fd_, dst, size);
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+            dst += got;
+            size -= static_cast<size_t>(got);
+        }
+        return true;
+    }
+
+    int fd_;
+    std::vector<char> response_;
+};
+
+class TcpLoadConnector final : public LoadConnector {
+public:
+    // Запросы маленькие и синхронные: алгоритм Нейгла только добавил бы задержку
+    explicit TcpLoadConnector(const LoadTargetOptions& options)
+        : options_(options), tuning_(benchmark_common::socket_tuning_preset("nodelay")) {}
+
+    std::unique_ptr<LoadTarget> connect() override {
+        int fd = benchmark_common::connect_tuned_tcp_socket(options_.host, options_.port, tuning_,
+                                                            "[LOADGEN ERROR]");
+        if (fd < 0) {
+            throw std::runtime_error("TCP: could not connect to " + options_.host + ":" +
+                                     std::to_string(options_.port));
+        }
+        return std::make_unique<TcpLoadTarget>(fd);
+    }
+
+private:
+    LoadTargetOptions options_;
+    benchmark_common::SocketTuning tuning_;
+};
+
+} // namespace
+
+std::unique_ptr<LoadConnector> make_tcp_connector(const LoadTargetOptions& options) {
+    return std::make_unique<TcpLoadConnector>(options);
+}
+
+} // namespace loadgen